@@ -47,7 +47,7 @@ std::string random_string(int len)
     srand(time(0));
     std::string str = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
     int pos;
-    while(str.size() != len) {
+    while(str.size() != (size_t)len) {
         pos = ((rand() % (str.size() - 1)));
         str.erase (pos, 1);
     }
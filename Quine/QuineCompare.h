@@ -120,6 +120,92 @@
  *          Default (and recommended) is 0.96 (emperically determined).
  */
 -(void)setSensitivity:(CGFloat)sensitivity;
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Starts comparing frames on the frame pipeline: resizing,
+ *  feature extraction and matching run on a thread each, so consecutive
+ *  frames overlap. When frames come faster than the slowest stage, the
+ *  older ones are dropped and the latest frame wins.
+ *
+ *  @param result (block) Called with the results of each frame that made
+ *                it through, in the same form as
+ *                @c compareMatToLoadedDatabase: returns them. It is called
+ *                on the pipeline's matching thread.
+ */
+-(void)startPipelineWithResult:(void (^)(NSDictionary *results))result;
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Stops the pipeline and drops the frames still in it.
+ */
+-(void)stopPipeline;
+
+
+/* ************************************************************************* */
+/*!
+ *  @protected
+ *  @brief Hands a frame to the pipeline. Returns immediately.
+ *
+ *  @param frame (cv::Mat&) Not copied, so its pixels must not be written
+ *               to afterwards.
+ *
+ *  @returns (BOOL) NO if the pipeline isn't running.
+ */
+-(BOOL)submitFrame:(cv::Mat&)frame;
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Whether the pipeline tracks a recognized image with optical flow
+ *  (see QuineImageTracker) instead of recognizing every frame again.
+ *  Default is YES.
+ */
+-(void)setTrackingEnabled:(BOOL)enabled;
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Whether the pipeline skips frames that show the same scene as the
+ *  last one compared, or are too blurred to describe (see QuineFrameGate.h).
+ *  The skip counters are in @c pipelineStats. Default is YES.
+ */
+-(void)setFrameGatingEnabled:(BOOL)enabled;
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Throughput and latency of the pipeline, frames tracked rather
+ *  than recognized, frames skipped by the gate and the time that saved, plus queue depth, dropped frames and timings of each
+ *  stage (preprocess, extract, match).
+ *
+ *  @returns (NSDictionary *) nil if the pipeline never started.
+ */
+-(NSDictionary *)pipelineStats;
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Latency percentiles of each stage of a query, across every
+ *  QuineCompare and database operation of the process (see QuineLatency.h):
+ *  preprocess, scale_space, detection, description, matching, vote, load
+ *  and save, then "matching:<database path>" for each database. Each holds
+ *  count, meanMs, p50Ms, p95Ms, p99Ms and maxMs.
+ *
+ *  @returns (NSDictionary *)
+ */
+-(NSDictionary *)latencyStats;
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Empties the latency histograms, or turns their recording on and
+ *  off. Recording is on by default.
+ */
+-(void)resetLatencyStats;
+-(void)setLatencyStatsEnabled:(BOOL)enabled;
 @end
 
 
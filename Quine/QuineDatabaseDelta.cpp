@@ -0,0 +1,235 @@
+//
+//  QuineDatabaseDelta.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineDatabaseDelta.h"
+#include "QuineMappedDatabase.h"
+
+#include <zlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes a file next to its destination, syncs it, and renames it
+ *        into place.
+ *
+ * @return (bool)
+ */
+static bool write_file_atomic(const std::string &path, const char *data, size_t size)
+{
+    std::string tmp_path = path + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if(!f) {
+        return false;
+    }
+
+    bool ok = fwrite(data, 1, size, f) == size;
+    ok = (fflush(f) == 0) && ok;
+    ok = (fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+
+    if(!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+#pragma mark -
+#pragma mark Versions
+std::string version_path(const std::string &database_path)
+{
+    return database_path + ".version";
+}
+
+
+uint64_t read_database_version(const std::string &database_path)
+{
+    std::ifstream in(version_path(database_path).c_str());
+    unsigned long long version = 0;
+    if(!(in >> version)) {
+        return 0;
+    }
+    return (uint64_t)version;
+}
+
+
+bool write_database_version(const std::string &database_path, uint64_t version)
+{
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%llu\n", (unsigned long long)version);
+    if(!write_file_atomic(version_path(database_path), text, (size_t)length)) {
+        std::cout << "[Quine: Error]: Could not write the version of database: " << database_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+#pragma mark -
+#pragma mark Delta files
+/* ************************************************************************* */
+/*!
+ * @brief Reads a delta file, checking its header and every record.
+ *
+ * @return (bool)
+ */
+bool read_delta(const std::string &path, quine_delta_t &delta)
+{
+    QuineMappedFile file;
+    if(!file.open(path)) {
+        std::cout << "[Quine: Error]: Could not read delta: " << path << std::endl;
+        return false;
+    }
+
+    quine_delta_header_t header;
+    if(file.size() < sizeof(header)) {
+        std::cout << "[Quine: Error]: Delta is truncated: " << path << std::endl;
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    if(header.magic != QUINE_DELTA_MAGIC || header.format_version > QUINE_DELTA_VERSION) {
+        std::cout << "[Quine: Error]: Not a valid delta: " << path << std::endl;
+        return false;
+    }
+
+    const char *records = file.data() + sizeof(header);
+    size_t size = file.size() - sizeof(header);
+    if(crc32(crc32(0L, Z_NULL, 0), (const Bytef *)records, (uInt)size) != header.crc) {
+        std::cout << "[Quine: Error]: Delta is corrupt: " << path << std::endl;
+        return false;
+    }
+
+    delta.base_version = header.base_version;
+    delta.version = header.version;
+    delta.entries.clear();
+    delta.entries.reserve(header.record_count);
+
+    size_t pos = 0;
+    while(pos < size) {
+        quine_log_entry_t entry;
+        size_t consumed = decode_log_entry(records + pos, size - pos, entry);
+        if(consumed == 0) {
+            std::cout << "[Quine: Error]: Delta has a corrupt record: " << path << std::endl;
+            return false;
+        }
+        delta.entries.push_back(entry);
+        pos += consumed;
+    }
+
+    if(delta.entries.size() != header.record_count) {
+        std::cout << "[Quine: Error]: Delta is truncated: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool write_delta(const std::string &path, const quine_delta_t &delta)
+{
+    std::string records;
+    for(size_t i = 0; i < delta.entries.size(); i++) {
+        std::string record;
+        encode_log_entry(delta.entries[i], record);
+        records.append(record);
+    }
+
+    quine_delta_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = QUINE_DELTA_MAGIC;
+    header.format_version = QUINE_DELTA_VERSION;
+    header.base_version = delta.base_version;
+    header.version = delta.version;
+    header.record_count = (uint32_t)delta.entries.size();
+    header.crc = (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef *)records.data(), (uInt)records.size());
+
+    std::string data((const char *)&header, sizeof(header));
+    data.append(records);
+    return write_file_atomic(path, data.data(), data.size());
+}
+
+
+#pragma mark -
+#pragma mark Diff
+/* ************************************************************************* */
+/*!
+ * @brief Computes the delta between two versions of a database.
+ *        Deletions come first, so a changed image is never retired by
+ *        its own replacement.
+ *
+ * @return (void)
+ */
+void diff_databases(const QuineStringTable &base_meta,
+                    const cv::vector<std::string> &base_hashtable,
+                    const std::vector<bool> &base_tombstones,
+                    const cv::Mat &desc,
+                    const cv::Mat &filter,
+                    const QuineStringTable &meta,
+                    const cv::vector<std::string> &hashtable,
+                    const std::vector<bool> &tombstones,
+                    size_t rows_per_image,
+                    quine_delta_t &delta)
+{
+    delta.entries.clear();
+
+    // Live images of each version by metadata; the most recent one wins
+    std::map<std::string, std::string> base;
+    for(size_t i = 0; i < base_meta.size(); i++) {
+        if(i < base_tombstones.size() && base_tombstones[i]) {
+            continue;
+        }
+        base[base_meta[i]] = i < base_hashtable.size() ? base_hashtable[i] : "";
+    }
+
+    std::map<std::string, size_t> target;
+    for(size_t i = 0; i < meta.size(); i++) {
+        if(i < tombstones.size() && tombstones[i]) {
+            continue;
+        }
+        target[meta[i]] = i;
+    }
+
+    for(std::map<std::string, std::string>::const_iterator it = base.begin(); it != base.end(); ++it) {
+        if(target.find(it->first) == target.end()) {
+            quine_log_entry_t entry;
+            entry.type = QUINE_LOG_DELETE_IMAGE;
+            entry.meta = it->first;
+            delta.entries.push_back(entry);
+        }
+    }
+
+    for(std::map<std::string, size_t>::const_iterator it = target.begin(); it != target.end(); ++it) {
+        size_t slot = it->second;
+        std::string hash = slot < hashtable.size() ? hashtable[slot] : "";
+
+        // Without hashes there is no telling whether an image changed
+        std::map<std::string, std::string>::const_iterator found = base.find(it->first);
+        if(found != base.end() && !hash.empty() && found->second == hash) {
+            continue;
+        }
+
+        int first = (int)(slot * rows_per_image);
+        int end = (int)((slot + 1) * rows_per_image);
+
+        quine_log_entry_t entry;
+        entry.type = QUINE_LOG_REPLACE_IMAGE;
+        entry.desc = desc.rowRange(first, end);
+        entry.filter = filter.rowRange(first, end);
+        entry.meta = it->first;
+        entry.hash = hash;
+        delta.entries.push_back(entry);
+    }
+}
@@ -0,0 +1,132 @@
+//
+//  QuineDatabaseDelta.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineDatabaseDelta__
+#define __Quine__QuineDatabaseDelta__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "QuineDatabaseLog.h"
+#include "QuineStringTable.h"
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Database versions and sync deltas.
+ *
+ *        Every synced database carries the version the server gave it, in
+ *        <database>.version next to it (a database without one is version 0).
+ *        A delta brings a database from one version to the next without
+ *        downloading it again:
+ *
+ *          uint32 magic | uint32 format version
+ *          uint64 base version | uint64 version
+ *          uint32 record count | uint32 crc32 of the records
+ *          records
+ *
+ *        The records are write-ahead log records (see QuineDatabaseLog.h):
+ *        QUINE_LOG_REPLACE_IMAGE for each added or changed image, with its
+ *        descriptors, filter, metadata and hash, and QUINE_LOG_DELETE_IMAGE
+ *        for each deleted image id. Both are idempotent, so a delta that was
+ *        interrupted half way through can simply be applied again.
+ */
+#define QUINE_DELTA_MAGIC           0x31444451  // "QDD1"
+#define QUINE_DELTA_VERSION         1
+
+
+typedef struct quine_delta_header {
+    uint32_t magic;
+    uint32_t format_version;
+    uint64_t base_version;
+    uint64_t version;
+    uint32_t record_count;
+    uint32_t crc;
+} quine_delta_header_t;
+
+
+typedef struct quine_delta {
+
+    /*!
+     * Database version the delta applies to, and the version it results in
+     */
+    uint64_t base_version;
+    uint64_t version;
+
+    /*!
+     * Changes, in the order they are applied
+     */
+    std::vector<quine_log_entry_t> entries;
+
+} quine_delta_t;
+
+
+std::string version_path(const std::string &database_path);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads the synced version of a database.
+ *
+ * @return (uint64_t) 0 if the database was never synced
+ */
+uint64_t read_database_version(const std::string &database_path);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Records the synced version of a database, replacing it atomically.
+ *
+ * @return (bool)
+ */
+bool write_database_version(const std::string &database_path, uint64_t version);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads a delta file, checking its header and every record.
+ *
+ * @return (bool) false if the file is missing, truncated or corrupt
+ */
+bool read_delta(const std::string &path, quine_delta_t &delta);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes a delta file atomically.
+ *
+ * @return (bool)
+ */
+bool write_delta(const std::string &path, const quine_delta_t &delta);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Computes the delta between two versions of a database. Images are
+ *        matched by metadata; a live target image whose hash differs from
+ *        (or is missing in) the base is sent again.
+ *
+ * @param desc, filter (cv::Mat)
+ *        Descriptors and class filter of every target slot, dead or not,
+ *        rows_per_image rows per slot.
+ *
+ * @return (void)
+ */
+void diff_databases(const QuineStringTable &base_meta,
+                    const cv::vector<std::string> &base_hashtable,
+                    const std::vector<bool> &base_tombstones,
+                    const cv::Mat &desc,
+                    const cv::Mat &filter,
+                    const QuineStringTable &meta,
+                    const cv::vector<std::string> &hashtable,
+                    const std::vector<bool> &tombstones,
+                    size_t rows_per_image,
+                    quine_delta_t &delta);
+
+
+#endif /* defined(__Quine__QuineDatabaseDelta__) */
@@ -0,0 +1,95 @@
+//
+//  QuineDatabaseHandle.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineDatabaseHandle__
+#define __Quine__QuineDatabaseHandle__
+
+#include <memory>
+#include <vector>
+#include "QuineDatabaseSnapshot.h"
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineDatabaseHandle
+ *
+ *  @abstract   Read-only view of one loaded database for a query.
+ *
+ *  @discussion Opening a handle is one hashed registry lookup and one
+ *              reference count; nothing is copied or allocated. The
+ *              descriptors and filter are the store's own chunks, and the
+ *              metadata is the string table (arena and offsets) the
+ *              database was loaded with. Everything stays valid, and
+ *              unchanged, for as long as the handle is held.
+ */
+class QuineDatabaseHandle {
+public:
+
+    QuineDatabaseHandle() { }
+
+    explicit QuineDatabaseHandle(const std::shared_ptr<const quine_database_snapshot_t> &snapshot)
+    : m_snapshot(snapshot) { }
+
+
+    /*!
+     * False if the database could not be loaded
+     */
+    bool valid() const { return (bool)m_snapshot; }
+
+
+    /*!
+     * Image slots, live or deleted
+     */
+    size_t size() const { return m_snapshot->metadata.size(); }
+
+    bool is_live(size_t slot) const {
+        const std::vector<bool> &tombstones = *m_snapshot->tombstones;
+        return slot < size() && !(slot < tombstones.size() && tombstones[slot]);
+    }
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Descriptor (CV_32FC1) and filter (CV_8UC1) rows of every slot,
+     *        as the chunks they are stored in. The cv::Mat headers share
+     *        the store's memory.
+     *
+     * @return (const std::vector<quine_store_chunk_t>&)
+     */
+    const std::vector<quine_store_chunk_t> &chunks() const { return m_snapshot->chunks; }
+
+
+    const QuineStringTable &metadata() const { return m_snapshot->metadata; }
+
+    /*!
+     * Deleted flags; may be shorter than size(), slots past its end are live
+     */
+    const std::vector<bool> &tombstones() const { return *m_snapshot->tombstones; }
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Metadata of a slot, in place (not null terminated).
+     *
+     * @return (const char*)
+     */
+    const char *meta(size_t slot, size_t &length) const { return m_snapshot->metadata.data(slot, length); }
+
+
+    /*!
+     * Snapshot generation; a handle opened later on a changed database has a larger one
+     */
+    uint64_t generation() const { return m_snapshot->generation; }
+
+private:
+
+    std::shared_ptr<const quine_database_snapshot_t> m_snapshot;
+};
+
+
+#endif /* defined(__Quine__QuineDatabaseHandle__) */
@@ -0,0 +1,565 @@
+//
+//  QuineDatabaseLog.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineDatabaseLog.h"
+#include "QuineMappedDatabase.h"
+
+#include <zlib.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+
+#pragma mark -
+#pragma mark Record encoding
+/* ************************************************************************* */
+/*!
+ * @brief Helpers to append / consume fields of a record payload
+ */
+static void put_u32(std::string &out, uint32_t v)
+{
+    out.append((const char *)&v, sizeof(v));
+}
+
+
+static void put_bytes(std::string &out, const void *data, size_t bytes)
+{
+    put_u32(out, (uint32_t)bytes);
+    out.append((const char *)data, bytes);
+}
+
+
+static bool get_u32(const char *&p, const char *end, uint32_t &v)
+{
+    if((size_t)(end - p) < sizeof(v)) {
+        return false;
+    }
+    memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
+
+
+static bool get_bytes(const char *&p, const char *end, std::string &out)
+{
+    uint32_t bytes = 0;
+    if(!get_u32(p, end, bytes) || (size_t)(end - p) < bytes) {
+        return false;
+    }
+    out.assign(p, bytes);
+    p += bytes;
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Serializes a log entry as a complete record.
+ *
+ *        QUINE_LOG_ADD_IMAGE / QUINE_LOG_REPLACE_IMAGE payload:
+ *          uint32 desc rows | uint32 desc cols | uint32 filter rows
+ *          float descriptors[rows * cols] | uint8 filter[filter rows]
+ *          uint32 length | metadata
+ *          uint32 length | hash
+ *
+ *        QUINE_LOG_DELETE_IMAGE payload:
+ *          uint32 length | metadata
+ *
+ * @return (void)
+ */
+void encode_log_entry(const quine_log_entry_t &entry, std::string &record)
+{
+    std::string payload;
+
+    if(entry.type == QUINE_LOG_DELETE_IMAGE) {
+        put_bytes(payload, entry.meta.data(), entry.meta.size());
+    }
+    else if(entry.type == QUINE_LOG_ADD_IMAGE || entry.type == QUINE_LOG_REPLACE_IMAGE) {
+        cv::Mat desc = entry.desc;
+        if(desc.type() != CV_32FC1) {
+            entry.desc.convertTo(desc, CV_32FC1);
+        }
+        if(!desc.isContinuous()) {
+            desc = desc.clone();
+        }
+
+        cv::Mat filter = entry.filter;
+        if(filter.type() != CV_8UC1) {
+            entry.filter.convertTo(filter, CV_8UC1);
+        }
+        if(!filter.isContinuous()) {
+            filter = filter.clone();
+        }
+
+        put_u32(payload, (uint32_t)desc.rows);
+        put_u32(payload, (uint32_t)desc.cols);
+        put_u32(payload, (uint32_t)filter.total());
+        payload.append((const char *)desc.data, desc.total() * desc.elemSize());
+        payload.append((const char *)filter.data, filter.total());
+        put_bytes(payload, entry.meta.data(), entry.meta.size());
+        put_bytes(payload, entry.hash.data(), entry.hash.size());
+    }
+
+    quine_log_record_header_t header;
+    header.magic = QUINE_LOG_MAGIC;
+    header.type = entry.type;
+    header.bytes = (uint32_t)payload.size();
+    header.crc = (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef *)payload.data(), (uInt)payload.size());
+
+    record.assign((const char *)&header, sizeof(header));
+    record.append(payload);
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Parses one record from a buffer.
+ *
+ * @return (size_t) bytes consumed, or 0 if the record is truncated or corrupt
+ */
+size_t decode_log_entry(const char *data, size_t size, quine_log_entry_t &entry)
+{
+    quine_log_record_header_t header;
+    if(size < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if(header.magic != QUINE_LOG_MAGIC || size - sizeof(header) < header.bytes) {
+        return 0;
+    }
+
+    const char *p = data + sizeof(header);
+    const char *end = p + header.bytes;
+    if(crc32(crc32(0L, Z_NULL, 0), (const Bytef *)p, (uInt)header.bytes) != header.crc) {
+        return 0;
+    }
+
+    entry.type = header.type;
+    if(header.type == QUINE_LOG_DELETE_IMAGE) {
+        if(!get_bytes(p, end, entry.meta)) {
+            return 0;
+        }
+    }
+    else if(header.type == QUINE_LOG_ADD_IMAGE || header.type == QUINE_LOG_REPLACE_IMAGE) {
+        uint32_t rows = 0, cols = 0, filter_rows = 0;
+        if(!get_u32(p, end, rows) || !get_u32(p, end, cols) || !get_u32(p, end, filter_rows)) {
+            return 0;
+        }
+
+        size_t desc_bytes = (size_t)rows * cols * sizeof(float);
+        if((size_t)(end - p) < desc_bytes + filter_rows) {
+            return 0;
+        }
+
+        // Copy out of the buffer; the entry must outlive it
+        entry.desc = cv::Mat(rows, cols, CV_32FC1, (void *)p).clone();
+        p += desc_bytes;
+        entry.filter = cv::Mat(filter_rows, 1, CV_8UC1, (void *)p).clone();
+        p += filter_rows;
+
+        if(!get_bytes(p, end, entry.meta) || !get_bytes(p, end, entry.hash)) {
+            return 0;
+        }
+    }
+
+    return sizeof(header) + header.bytes;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Links a slot just added (or loaded) into the chain of its metadata.
+ *
+ * @return (void)
+ */
+static void add_image_slot(const QuineStringTable &meta, size_t i, quine_image_slots_t &images)
+{
+    size_t length = 0;
+    const char *s = meta.data(i, length);
+
+    // The index holds fingerprints, so a slot found for other metadata starts a new chain
+    uint32_t slot = 0;
+    uint32_t previous = QUINE_LOG_NO_SLOT;
+    if(images.latest.find(s, length, slot) && slot < i) {
+        size_t other = 0;
+        const char *o = meta.data(slot, other);
+        if(other == length && memcmp(o, s, length) == 0) {
+            previous = slot;
+        }
+    }
+
+    images.previous.resize(i + 1, QUINE_LOG_NO_SLOT);
+    images.previous[i] = previous;
+    images.latest.insert(s, length, (uint32_t)i);
+}
+
+
+void build_image_slots(const QuineStringTable &meta,
+                       const std::vector<bool> &tombstones,
+                       quine_image_slots_t &images)
+{
+    images.latest = QuineHashIndex();
+    images.previous.assign(meta.size(), QUINE_LOG_NO_SLOT);
+    for(size_t i = 0; i < meta.size(); i++) {
+        if(i >= tombstones.size() || !tombstones[i]) {
+            add_image_slot(meta, i, images);
+        }
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Applies a log entry to an in-memory database.
+ *        Deleting only sets tombstones; no rows move.
+ *
+ * @return (void)
+ */
+void apply_log_entry(const quine_log_entry_t &entry,
+                     QuineDescriptorStore &store,
+                     QuineStringTable &meta,
+                     cv::vector<std::string> &hashtable,
+                     std::vector<bool> &tombstones,
+                     quine_image_slots_t &images,
+                     std::vector<uint32_t> *killed)
+{
+    if(entry.type == QUINE_LOG_DELETE_IMAGE || entry.type == QUINE_LOG_REPLACE_IMAGE) {
+
+        // Retire the chain of live slots with this metadata, newest first
+        uint32_t slot = QUINE_LOG_NO_SLOT;
+        if(images.latest.find(entry.meta, slot) && slot < meta.size() && meta.equals(slot, entry.meta)) {
+            images.latest.erase(entry.meta);
+        }
+        else {
+            slot = QUINE_LOG_NO_SLOT;
+        }
+
+        while(slot != QUINE_LOG_NO_SLOT) {
+            if(slot >= tombstones.size()) {
+                tombstones.resize(meta.size(), false);
+            }
+            tombstones[slot] = true;
+            if(killed) {
+                killed->push_back(slot);
+            }
+            slot = slot < images.previous.size() ? images.previous[slot] : QUINE_LOG_NO_SLOT;
+        }
+    }
+
+    // Added slots are live without a flag, so the flags are left alone
+    if(entry.type == QUINE_LOG_ADD_IMAGE || entry.type == QUINE_LOG_REPLACE_IMAGE) {
+        store.append(entry.desc, entry.filter);
+        meta.push_back(entry.meta);
+        hashtable.push_back(entry.hash);
+        add_image_slot(meta, meta.size() - 1, images);
+    }
+}
+
+
+#pragma mark -
+#pragma mark QuineDatabaseLog
+/* ************************************************************************* */
+/*!
+ * @brief Opens the log of a database. New records go to a segment after
+ *        every segment already on disk.
+ *
+ * @return (QuineDatabaseLog)
+ */
+QuineDatabaseLog::QuineDatabaseLog(const std::string &database_path)
+: m_path(database_path), m_active(1), m_fd(-1), m_compacting(false)
+{
+    std::vector<uint32_t> segments = list_segments();
+    if(!segments.empty()) {
+        m_active = segments.back() + 1;
+    }
+}
+
+
+QuineDatabaseLog::~QuineDatabaseLog()
+{
+    wait();
+    close_active();
+}
+
+
+std::string QuineDatabaseLog::segment_path(uint32_t segment) const
+{
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".log.%u", segment);
+    return m_path + suffix;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Lists the segment numbers on disk, in ascending order.
+ *
+ * @return (std::vector<uint32_t>)
+ */
+std::vector<uint32_t> QuineDatabaseLog::list_segments() const
+{
+    std::vector<uint32_t> segments;
+
+    std::string::size_type slash = m_path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : m_path.substr(0, slash);
+    std::string prefix = (slash == std::string::npos ? m_path : m_path.substr(slash + 1)) + ".log.";
+
+    DIR *d = opendir(dir.c_str());
+    if(!d) {
+        return segments;
+    }
+
+    struct dirent *e;
+    while((e = readdir(d)) != NULL) {
+        std::string name = e->d_name;
+        if(name.compare(0, prefix.size(), prefix) != 0 || name.size() == prefix.size()) {
+            continue;
+        }
+
+        char *end = NULL;
+        unsigned long segment = strtoul(name.c_str() + prefix.size(), &end, 10);
+        if(end && *end == '\0' && segment > 0) {
+            segments.push_back((uint32_t)segment);
+        }
+    }
+    closedir(d);
+
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+
+void QuineDatabaseLog::close_active()
+{
+    if(m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Appends a record to the active segment and syncs it to disk.
+ *
+ * @return (bool)
+ */
+bool QuineDatabaseLog::append(const quine_log_entry_t &entry)
+{
+    return append(std::vector<quine_log_entry_t>(1, entry));
+}
+
+
+bool QuineDatabaseLog::append(const std::vector<quine_log_entry_t> &entries)
+{
+    std::string record;
+    for(size_t i = 0; i < entries.size(); i++) {
+        std::string one;
+        encode_log_entry(entries[i], one);
+        record.append(one);
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    if(m_fd < 0) {
+        m_fd = ::open(segment_path(m_active).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if(m_fd < 0) {
+            return false;
+        }
+    }
+
+    // One write per batch, so a crash can only ever tear the last record
+    const char *p = record.data();
+    size_t left = record.size();
+    while(left > 0) {
+        ssize_t n = ::write(m_fd, p, left);
+        if(n <= 0) {
+            return false;
+        }
+        p += n;
+        left -= n;
+    }
+
+    if(fsync(m_fd) != 0) {
+        return false;
+    }
+
+    m_records[m_active] += entries.size();
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads the records of every segment newer than folded_segment.
+ *
+ * @return (bool)
+ */
+bool QuineDatabaseLog::read(uint32_t folded_segment, std::vector<quine_log_entry_t> &entries)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    // Never append to a segment number that the database file claims to contain
+    if(m_active <= folded_segment) {
+        close_active();
+        m_active = folded_segment + 1;
+    }
+
+    bool ok = true;
+    std::vector<uint32_t> segments = list_segments();
+    for(size_t s = 0; s < segments.size(); s++) {
+
+        // Already part of the database file; left over from an interrupted compaction.
+        //   The active segment is read too: a database reloaded after being
+        //   evicted still has its unfolded records there.
+        if(segments[s] <= folded_segment) {
+            continue;
+        }
+
+        QuineMappedFile segment;
+        if(!segment.open(segment_path(segments[s]))) {
+            ok = false;
+            continue;
+        }
+
+        size_t pos = 0;
+        size_t count = 0;
+        while(pos < segment.size()) {
+            quine_log_entry_t entry;
+            size_t consumed = decode_log_entry(segment.data() + pos, segment.size() - pos, entry);
+            if(consumed == 0) {
+                std::cout << "[Quine: Warning]: Dropping torn log record in " << segment_path(segments[s]) << std::endl;
+                break;
+            }
+            entries.push_back(entry);
+            pos += consumed;
+            count++;
+        }
+
+        // Cut off a torn tail so it can never be mistaken for a record later
+        if(pos < segment.size()) {
+            segment.close();
+            if(truncate(segment_path(segments[s]).c_str(), (off_t)pos) != 0) {
+                ok = false;
+            }
+        }
+
+        m_records[segments[s]] = count;
+    }
+
+    return ok;
+}
+
+
+size_t QuineDatabaseLog::pending_records()
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    size_t total = 0;
+    for(std::map<uint32_t, size_t>::const_iterator it = m_records.begin(); it != m_records.end(); ++it) {
+        total += it->second;
+    }
+    return total;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Seals the log and folds it into the database on a background thread.
+ *
+ * @return (bool)
+ */
+bool QuineDatabaseLog::compact_async(const std::function<bool(uint32_t)> &fold)
+{
+    if(m_compacting.exchange(true)) {
+        return false;
+    }
+
+    // Held until the new thread is assigned, so wait() never joins a
+    //   thread object that is being replaced
+    std::lock_guard<std::mutex> compactor_guard(m_compactor_lock);
+    if(m_compactor.joinable()) {
+        m_compactor.join();
+    }
+
+    // Seal: everything up to and including the active segment gets folded,
+    //   and new records go to the next segment.
+    uint32_t sealed = 0;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        std::vector<uint32_t> segments = list_segments();
+        if(!segments.empty()) {
+            sealed = segments.back();
+        }
+        if(sealed > 0) {
+            close_active();
+            m_active = std::max(m_active, sealed) + 1;
+        }
+    }
+
+    if(sealed == 0) {
+        m_compacting = false;
+        return false;
+    }
+
+    m_compactor = std::thread([this, fold, sealed]() {
+
+        if(fold(sealed)) {
+            std::lock_guard<std::mutex> guard(m_lock);
+
+            std::vector<uint32_t> segments = list_segments();
+            for(size_t s = 0; s < segments.size() && segments[s] <= sealed; s++) {
+                unlink(segment_path(segments[s]).c_str());
+                m_records.erase(segments[s]);
+            }
+        }
+        else {
+            std::cout << "[Quine: Error]: Could not compact database: " << m_path << std::endl;
+        }
+
+        m_compacting = false;
+    });
+
+    return true;
+}
+
+
+void QuineDatabaseLog::wait()
+{
+    std::lock_guard<std::mutex> guard(m_compactor_lock);
+    if(m_compactor.joinable()) {
+        m_compactor.join();
+    }
+}
+
+
+bool QuineDatabaseLog::discard()
+{
+    wait();
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    close_active();
+
+    bool ok = true;
+    std::vector<uint32_t> segments = list_segments();
+    for(size_t s = 0; s < segments.size(); s++) {
+        if(unlink(segment_path(segments[s]).c_str()) != 0) {
+            ok = false;
+        }
+    }
+    m_records.clear();
+    return ok;
+}
@@ -0,0 +1,300 @@
+//
+//  QuineDatabaseLog.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineDatabaseLog__
+#define __Quine__QuineDatabaseLog__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "QuineDescriptorStore.h"
+#include "QuineHashIndex.h"
+#include "QuineStringTable.h"
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Write-ahead log layout.
+ *
+ *        Images added to a database are appended to log segments that sit
+ *        next to the database file (<database>.log.1, <database>.log.2, ...)
+ *        instead of rewriting the whole database. Each record is:
+ *
+ *          uint32 magic | uint32 type | uint32 payload bytes | uint32 crc32
+ *          payload
+ *
+ *        A record is only trusted if it is complete and its crc matches, so a
+ *        record torn by a crash is dropped on replay along with anything after
+ *        it in the same segment.
+ *
+ *        Compaction folds whole segments into the database file. The database
+ *        file records the last segment folded into it, and replay skips those,
+ *        so a crash between writing the database and deleting the folded
+ *        segments does not apply them twice.
+ */
+#define QUINE_LOG_MAGIC             0x31524c51  // "QLR1"
+#define QUINE_LOG_ADD_IMAGE         1
+#define QUINE_LOG_DELETE_IMAGE      2
+#define QUINE_LOG_REPLACE_IMAGE     3
+
+// Number of unfolded records that triggers a background compaction
+#define QUINE_LOG_COMPACT_RECORDS   64
+
+
+typedef struct quine_log_record_header {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t bytes;
+    uint32_t crc;
+} quine_log_record_header_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Decoded log record
+ */
+typedef struct quine_log_entry {
+
+    /*!
+     * One of the QUINE_LOG_* record types
+     */
+    uint32_t type;
+
+    /*!
+     * QUINE_LOG_ADD_IMAGE, QUINE_LOG_REPLACE_IMAGE: descriptors (CV_32FC1)
+     *   and class filter (CV_8UC1) of the image, one row per keypoint
+     */
+    cv::Mat desc;
+    cv::Mat filter;
+
+    /*!
+     * Metadata of the image. QUINE_LOG_DELETE_IMAGE and QUINE_LOG_REPLACE_IMAGE
+     *   retire every live image with this metadata. Images are named by their
+     *   metadata rather than their slot, since compaction renumbers slots.
+     */
+    std::string meta;
+
+    /*!
+     * QUINE_LOG_ADD_IMAGE, QUINE_LOG_REPLACE_IMAGE: content hash of the image
+     */
+    std::string hash;
+
+} quine_log_entry_t;
+
+
+// No slot, at the end of a quine_image_slots_t chain
+#define QUINE_LOG_NO_SLOT           0xffffffff
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Live image slots of a database by metadata, so deleting or
+ *        replacing an image finds its slots without scanning the database.
+ *
+ *        Several live images may share metadata; the index holds the most
+ *        recently added one, and each slot links to the one added before
+ *        it. A deletion retires the whole chain at once.
+ */
+typedef struct quine_image_slots {
+
+    /*!
+     * Metadata to the most recently added live slot with it
+     */
+    QuineHashIndex latest;
+
+    /*!
+     * Per slot, the live slot with the same metadata added before it, or
+     *   QUINE_LOG_NO_SLOT
+     */
+    std::vector<uint32_t> previous;
+
+    size_t bytes() const { return latest.bytes() + previous.capacity() * sizeof(uint32_t); }
+
+} quine_image_slots_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Serializes a log entry as a complete record (header and payload).
+ *
+ * @return (void)
+ */
+void encode_log_entry(const quine_log_entry_t &entry, std::string &record);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Parses one record from a buffer.
+ *
+ * @return (size_t) bytes consumed, or 0 if the record is truncated or corrupt
+ */
+size_t decode_log_entry(const char *data, size_t size, quine_log_entry_t &entry);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Indexes the live image slots of a database by metadata.
+ *
+ * @return (void)
+ */
+void build_image_slots(const QuineStringTable &meta,
+                       const std::vector<bool> &tombstones,
+                       quine_image_slots_t &images);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Applies a log entry to an in-memory database.
+ *
+ * @param tombstones (std::vector<bool>)
+ *        Flags set for deleted (or replaced) images. Slots past its end
+ *        are live; it only grows when one of them is deleted.
+ *
+ * @param images (quine_image_slots_t)
+ *        Live slots by metadata (see build_image_slots()), kept up to date.
+ *
+ * @param killed (std::vector<uint32_t>*)
+ *        If not NULL, receives the slots the entry deleted.
+ *
+ * @return (void)
+ */
+void apply_log_entry(const quine_log_entry_t &entry,
+                     QuineDescriptorStore &store,
+                     QuineStringTable &meta,
+                     cv::vector<std::string> &hashtable,
+                     std::vector<bool> &tombstones,
+                     quine_image_slots_t &images,
+                     std::vector<uint32_t> *killed = NULL);
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineDatabaseLog
+ *
+ *  @abstract   Append-only log of changes to one database.
+ *
+ *  @discussion Appends go to the active segment and are synced before
+ *              append() returns. compact_async() seals the active segment so that it
+ *              (and every older one) can be folded into the database file on
+ *              a background thread, while new appends go to a fresh segment.
+ */
+class QuineDatabaseLog {
+public:
+
+    QuineDatabaseLog(const std::string &database_path);
+    ~QuineDatabaseLog();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Appends a record to the active segment and syncs it to disk.
+     *
+     * @return (bool)
+     */
+    bool append(const quine_log_entry_t &entry);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Appends several records with one write and one sync. A crash
+     *        can still keep only the first of them.
+     *
+     * @return (bool)
+     */
+    bool append(const std::vector<quine_log_entry_t> &entries);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Reads the records of every segment newer than folded_segment, in order.
+     *
+     * @param folded_segment (uint32_t)
+     *        Last segment already folded into the database file.
+     *
+     * @return (bool) false if a segment could not be read
+     */
+    bool read(uint32_t folded_segment, std::vector<quine_log_entry_t> &entries);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Number of records appended but not yet folded into the database file.
+     *
+     * @return (size_t)
+     */
+    size_t pending_records();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Seals the log and folds it into the database on a background thread.
+     *
+     *        The caller hands over a fold function that writes the database
+     *        (as of this call) with the given segment number recorded in it.
+     *        If it succeeds, the folded segments are deleted. Does nothing if
+     *        a compaction is already running or there is nothing to fold.
+     *
+     * @return (bool) true if a compaction was started
+     */
+    bool compact_async(const std::function<bool(uint32_t)> &fold);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Waits for a running compaction to finish. Safe to call from
+     *        any thread, concurrently with compact_async().
+     *
+     * @return (void)
+     */
+    void wait();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Deletes every segment, once a running compaction has finished.
+     *        Used when the database file is replaced by one the log does not
+     *        belong to.
+     *
+     * @return (bool)
+     */
+    bool discard();
+
+private:
+
+    QuineDatabaseLog(const QuineDatabaseLog &);
+    QuineDatabaseLog& operator=(const QuineDatabaseLog &);
+
+    std::string segment_path(uint32_t segment) const;
+    std::vector<uint32_t> list_segments() const;
+    void close_active();
+
+    std::string m_path;
+    std::mutex m_lock;
+
+    // Active segment, opened on the first append
+    uint32_t m_active;
+    int m_fd;
+
+    // Records per segment that have not been folded yet
+    std::map<uint32_t, size_t> m_records;
+
+    // Background compaction. wait() may be called from any thread (e.g. a
+    //   reload that does not hold the database's write lock), so joining or
+    //   replacing the thread is serialized by its own lock.
+    std::thread m_compactor;
+    std::mutex m_compactor_lock;
+    std::atomic<bool> m_compacting;
+};
+
+
+#endif /* defined(__Quine__QuineDatabaseLog__) */
@@ -13,4 +13,6 @@
 -(void)setVerbose:(BOOL)verbose;
 -(void)loadDatabase:(NSString *)databaseName;
 -(NSArray *)listLoadedImagesForDatabase:(NSString *)databaseName;
+-(void)setMemoryBudget:(NSUInteger)bytes;
+-(NSDictionary *)statsForDatabase:(NSString *)databaseName;
 @end
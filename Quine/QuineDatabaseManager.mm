@@ -108,4 +108,58 @@
     return imageArray;
 }
 
+
+/* ************************************************************************* */
+/*!
+ * @brief Limits the memory taken by the loaded databases. Least recently
+ *        queried databases are evicted beyond it and reloaded when needed.
+ *        0 disables the limit.
+ *
+ * @return (void)
+ */
+-(void)setMemoryBudget:(NSUInteger)bytes {
+    QuineDatabaseOperations database_op = QuineDatabaseOperations();
+    database_op.set_memory_budget(bytes);
+    database_op.~QuineDatabaseOperations();
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Residency, footprint by section and hit/miss counters of a loaded database
+ *
+ * @return (NSDictionary *) nil if the database was never loaded
+ */
+-(NSDictionary *)statsForDatabase:(NSString *)databaseName {
+    
+    // Get the full path of the database
+    NSString *databasePath = [QuineImageManager getDatabasePathForDatabase:databaseName withExt:@"bin"];
+    
+    quine_database_stats_t stats;
+    QuineDatabaseOperations database_op = QuineDatabaseOperations();
+    bool found = database_op.get_database_stats([databasePath cStringUsingEncoding: NSASCIIStringEncoding], stats);
+    database_op.~QuineDatabaseOperations();
+    
+    if(!found) {
+        return nil;
+    }
+    
+    NSDictionary *footprint = @{@"descriptors" : @(stats.footprint.descriptors),
+                                @"filter"      : @(stats.footprint.filter),
+                                @"metadata"    : @(stats.footprint.metadata),
+                                @"hashes"      : @(stats.footprint.hashes),
+                                @"indexes"     : @(stats.footprint.indexes),
+                                @"tombstones"  : @(stats.footprint.tombstones),
+                                @"snapshot"    : @(stats.footprint.snapshot),
+                                @"total"       : @(stats.footprint.total)};
+    
+    return @{@"resident"       : @(stats.resident),
+             @"residentBytes"  : @(stats.resident_bytes),
+             @"footprint"      : footprint,
+             @"peakQueryBytes" : @(stats.peak_query_bytes),
+             @"hits"           : @(stats.hits),
+             @"misses"         : @(stats.misses),
+             @"evictions"      : @(stats.evictions)};
+}
+
 @end
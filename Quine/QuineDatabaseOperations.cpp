@@ -7,7 +7,9 @@
 //
 
 #include "QuineDatabaseOperations.h"
+#include <algorithm>
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,8 +17,10 @@
 #include <vector>
 #include "QuineMemoryDatabase.h"
 #include "QuineFeatureDetection.h"
+#include "QuineMatcher.h"
 #include "QuineFeatureStruct.h"
 #include "QuineCommon.h"
+#include "QuineLatency.h"
 
 
 #pragma mark -
@@ -71,59 +75,80 @@ QuineDatabaseOperations::~QuineDatabaseOperations()
 
 void QuineDatabaseOperations::add_image(const cv::Mat& img,
                                         const std::string& hash,
-                                        const std::string& img_id,
+                                        const std::string& /* img_id */,
                                         const std::string& meta,
                                         const std::string& path)
 {
     // Initial declarations
     cv::Mat resized_img, gray_img;
     
-    // Database reference which to add the image to
-    cv::Mat source;
-    cv::Mat filter;
-    
-    // JSON string reference which to add the image metadata to
-    cv::vector<std::string> metadata;
-    cv::vector<std::string> hashtable;
-    
-    // Get a reference to the current in-memory database
-    //  source -> Current database associated with the path
-    //  filter -> Current database class filter information. 1 x source.rows() in size.
-    //  metadata -> Current database image information associated with the path
-    //  hashtable -> NOT YET IMPLEMENTED
-    QuineMemory::database()->get_database(path, source, filter, metadata, hashtable, false);
+    // Re-submitted images are skipped before any feature extraction
+    if(QuineMemory::database()->contains_image(path, hash)) {
+        std::cout << "[Quine: Warning]: Image already in database" << std::endl;
+        return;
+    }
     
     // Initialize the feature detection
     QuineFeatureDetection image = QuineFeatureDetection();
     
     // Resize and gray the input image
+    QuineLatencyTimer preprocess_timer(QuineLatency::instance()->stage(QUINE_LATENCY_PREPROCESS));
     image.resize_to_width(img, resized_img, RESIZED_IMAGE_WIDTH);
     image.get_gray(resized_img, gray_img);
+    preprocess_timer.stop();
     
     // Calculate the query descriptor and add it to the specified database
     akaze_response_struc result_img;
     image.compute_signature(gray_img, result_img, false);
     
-    // Add or append the descriptors to the in memory database
-    if(source.empty()) {
-        source = result_img.desc;
-        filter = result_img.filter;
-    }
-    else {
-        source.push_back(result_img.desc);
-        filter.push_back(result_img.filter);
-    }
+    // Append the descriptors to the in memory database and its log on disk
+    QuineMemory::database()->append_image(path, result_img.desc, result_img.filter, meta, hash);
+}
+
+
+/* ************************************************************************* */
+/**
+ * @brief Deletes the image(s) with the given meta data from the specified database
+ *
+ * @param meta (const std::string)
+ *        Meta data the image was added with
+ *
+ * @param path (const std::string)
+ *        Full path to the database
+ *
+ * @return (bool)
+ */
+bool QuineDatabaseOperations::delete_image(const std::string& meta,
+                                           const std::string& path)
+{
+    return QuineMemory::database()->delete_image(path, meta);
+}
+
+
+/* ************************************************************************* */
+/**
+ * @brief Replaces the image(s) with the given meta data by a new image
+ *
+ * @return (bool)
+ */
+bool QuineDatabaseOperations::replace_image(const cv::Mat& img,
+                                            const std::string& hash,
+                                            const std::string& meta,
+                                            const std::string& path)
+{
+    cv::Mat resized_img, gray_img;
     
-    //Update the metadata information and add it to the specified database
-    metadata.push_back(meta);
-    //hashtable.push_back(hash);
+    // Describe the new image exactly as add_image does
+    QuineFeatureDetection image = QuineFeatureDetection();
+    QuineLatencyTimer preprocess_timer(QuineLatency::instance()->stage(QUINE_LATENCY_PREPROCESS));
+    image.resize_to_width(img, resized_img, RESIZED_IMAGE_WIDTH);
+    image.get_gray(resized_img, gray_img);
+    preprocess_timer.stop();
     
-    // Push the appended database to memory (and disk)
-    QuineMemory::database()->update_database(path, source, filter, metadata, hashtable, true);
-
-    // Cleanup
-    image.~QuineFeatureDetection();
+    akaze_response_struc result_img;
+    image.compute_signature(gray_img, result_img, false);
     
+    return QuineMemory::database()->replace_image(path, result_img.desc, result_img.filter, meta, hash);
 }
 
 
@@ -139,7 +164,7 @@ void QuineDatabaseOperations::add_image(const cv::Mat& img,
  *
  * @return (void)
  */
-void QuineDatabaseOperations::load_database(const std::string& path, bool force)
+void QuineDatabaseOperations::load_database(const std::string& path, bool /* force */)
 {
     QuineMemory::database()->load_database(path);
 }
@@ -174,14 +199,223 @@ std::vector<std::string> QuineDatabaseOperations::list_loaded_databases()
     
 }
 
-void QuineDatabaseOperations::get_database(std::string &db,
-                                           cv::Mat &source,
-                                           cv::Mat &filter,
-                                           cv::vector<std::string> &metadata,
-                                           cv::vector<std::string> &hashtable,
-                                           bool force) {
+std::shared_ptr<const std::vector<std::string> > QuineDatabaseOperations::loaded_databases()
+{
+    return QuineMemory::database()->loaded_databases();
+}
+
+
+void QuineDatabaseOperations::set_memory_budget(size_t bytes)
+{
+    QuineMemory::database()->set_memory_budget(bytes);
+}
+
+
+QuineDatabaseHandle QuineDatabaseOperations::open_database(const std::string& path)
+{
+    return QuineMemory::database()->open_database(path);
+}
+
+
+void QuineDatabaseOperations::match_loaded_databases(const akaze_response_struc& signature,
+                                                     float dratio,
+                                                     float accept_ratio,
+                                                     QuineFrameArena *arena,
+                                                     std::vector<quine_database_match_t> &matches)
+{
+    matches.clear();
+    if(signature.kpts.empty()) {
+        return;
+    }
     
-    QuineMemory::database()->get_database(db, source, filter, metadata, hashtable, force);
+    QuineLatency *latency = QuineLatency::instance();
+    std::shared_ptr<const std::vector<std::string> > loaded = loaded_databases();
+    for(size_t i = 0; i < loaded->size(); i++) {
+        const std::string &db = (*loaded)[i];
+        
+        // Descriptors, metadata and tombstones are viewed in place and all
+        //   come from the same version, whatever reloads or changes happen
+        //   during the match
+        QuineDatabaseHandle handle = open_database(db);
+        if(!handle.valid()) {
+            continue;
+        }
+        
+        std::set<int> results;
+        quine_match_stats_t match_stats;
+        int64_t started = cv::getTickCount();
+        int matched_slot = compare_mat_souces(signature.desc,
+                                              signature.kpts_count,
+                                              handle.chunks(),
+                                              signature.filter,
+                                              handle.metadata(),
+                                              handle.tombstones(),
+                                              results,
+                                              dratio,
+                                              accept_ratio,
+                                              &match_stats,
+                                              arena);
+        if(latency->enabled()) {
+            int64_t ticks = cv::getTickCount() - started;
+            latency->stage(QUINE_LATENCY_MATCHING).record_ticks(ticks);
+            latency->matching(db).record_ticks(ticks);
+        }
+        record_query_bytes(db, match_stats.peak_transient_bytes);
+        
+        quine_database_match_t match;
+        match.database = db;
+        if(matched_slot >= 0) {
+            match.meta = handle.metadata()[matched_slot];
+            matched_query_features(signature.desc, signature.filter, handle.chunks(), matched_slot, dratio,
+                                   match.features);
+        }
+        matches.push_back(match);
+    }
+}
+
+
+/* ************************************************************************* */
+/**
+ * @brief Votes of the batch for a database are counted in one pass, then
+ *        each query keeps its top_k of that database; the rankings of all
+ *        databases are merged at the end.
+ *
+ * @return (void)
+ */
+void QuineDatabaseOperations::rank_loaded_databases(const std::vector<const akaze_response_struc*>& signatures,
+                                                    float dratio,
+                                                    float accept_ratio,
+                                                    size_t top_k,
+                                                    std::vector<std::vector<quine_ranked_match_t> > &rankings)
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    rankings.assign(signatures.size(), std::vector<quine_ranked_match_t>());
+    if(signatures.empty() || top_k == 0) {
+        return;
+    }
+    
+    std::vector<cv::Mat> queries(signatures.size()), filters(signatures.size());
+    for(size_t q = 0; q < signatures.size(); q++) {
+        queries[q] = signatures[q]->desc;
+        filters[q] = signatures[q]->filter;
+    }
+    
+    QuineLatency *latency = QuineLatency::instance();
+    std::shared_ptr<const std::vector<std::string> > loaded = loaded_databases();
+    for(size_t i = 0; i < loaded->size(); i++) {
+        const std::string &db = (*loaded)[i];
+        QuineDatabaseHandle handle = open_database(db);
+        if(!handle.valid()) {
+            continue;
+        }
+        
+        size_t images = handle.metadata().size();
+        std::vector<int> votes(signatures.size() * images);
+        quine_match_stats_t match_stats;
+        int64_t started = cv::getTickCount();
+        count_batch_votes(queries, filters, handle.chunks(), images, handle.tombstones(), dratio,
+                          votes.data(), &match_stats);
+        if(latency->enabled()) {
+            int64_t ticks = cv::getTickCount() - started;
+            latency->stage(QUINE_LATENCY_MATCHING).record_ticks(ticks);
+            latency->matching(db).record_ticks(ticks);
+        }
+        record_query_bytes(db, match_stats.peak_transient_bytes);
+        
+        std::vector<quine_ranked_image_t> ranked;
+        for(size_t q = 0; q < signatures.size(); q++) {
+            const int *query_votes = votes.data() + q * images;
+            int accepted = select_voted_image(query_votes, images, signatures[q]->kpts_count, accept_ratio);
+            rank_voted_images(query_votes, images, top_k, ranked);
+            
+            for(size_t r = 0; r < ranked.size(); r++) {
+                quine_ranked_match_t match;
+                match.database = db;
+                match.meta = handle.metadata()[ranked[r].slot];
+                match.votes = ranked[r].votes;
+                match.score = (float)ranked[r].votes / K;
+                match.accepted = ranked[r].slot == accepted;
+                rankings[q].push_back(match);
+            }
+        }
+    }
     
+    // Databases in loaded order among equal votes
+    for(size_t q = 0; q < rankings.size(); q++) {
+        std::stable_sort(rankings[q].begin(), rankings[q].end(),
+                         [](const quine_ranked_match_t &a, const quine_ranked_match_t &b) {
+                             return a.votes > b.votes;
+                         });
+        if(rankings[q].size() > top_k) {
+            rankings[q].resize(top_k);
+        }
+    }
 }
 
+
+std::future<bool> QuineDatabaseOperations::reload_database_async(const std::string& path)
+{
+    return QuineMemory::database()->reload_database_async(path);
+}
+
+
+std::vector<bool> QuineDatabaseOperations::get_tombstones(const std::string& path)
+{
+    return QuineMemory::database()->get_tombstones(path);
+}
+
+
+bool QuineDatabaseOperations::find_image(const std::string& meta, const std::string& path, uint32_t &slot)
+{
+    return QuineMemory::database()->find_image(path, meta, slot);
+}
+
+
+bool QuineDatabaseOperations::get_database_stats(const std::string& path, quine_database_stats_t &stats)
+{
+    return QuineMemory::database()->get_database_stats(path, stats);
+}
+
+
+size_t QuineDatabaseOperations::get_resident_bytes()
+{
+    return QuineMemory::database()->get_resident_bytes();
+}
+
+
+void QuineDatabaseOperations::record_query_bytes(const std::string& path, size_t bytes)
+{
+    QuineMemory::database()->record_query_bytes(path, bytes);
+}
+
+
+bool QuineDatabaseOperations::get_allocator_stats(quine_allocator_stats_t &stats)
+{
+    return read_allocator_stats(stats);
+}
+
+
+#pragma mark -
+#pragma mark QuineDatabaseOperations | Sync
+uint64_t QuineDatabaseOperations::get_database_version(const std::string& path)
+{
+    return QuineMemory::database()->get_database_version(path);
+}
+
+
+/* ************************************************************************* */
+/**
+ * @brief Applies a downloaded sync delta to a database.
+ *
+ * @return (bool)
+ */
+bool QuineDatabaseOperations::apply_delta(const std::string& delta_path, const std::string& path)
+{
+    return QuineMemory::database()->apply_database_delta(path, delta_path);
+}
+
+
+bool QuineDatabaseOperations::install_database(const std::string& downloaded_path, const std::string& path, uint64_t version)
+{
+    return QuineMemory::database()->install_database(path, downloaded_path, version);
+}
@@ -20,8 +20,15 @@
 #ifndef __Quine__QuineDatabaseOperations__
 #define __Quine__QuineDatabaseOperations__
 
+#include <future>
 #include <iostream>
+#include <memory>
 #include "QuineConstants.h"
+#include "QuineDescriptorStore.h"
+#include "QuineDatabaseHandle.h"
+#include "QuineMemoryStats.h"
+#include "QuineFrameArena.h"
+#include "QuineStringTable.h"
 
 //TODO: Remove below mst likely
 /*
@@ -51,6 +58,38 @@ struct database_struc {
 */
 
 
+class akaze_response_struc;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Outcome of matching one query against one loaded database.
+ */
+typedef struct quine_database_match {
+    std::string database;
+    std::string meta;       // matched image, "" if none was accepted
+    
+    /*!
+     * Query keypoints (indices into the signature's kpts) that matched
+     *   the accepted image, e.g. to track it from frame to frame
+     */
+    std::vector<int> features;
+} quine_database_match_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief One of the best images for a query, among all loaded databases.
+ */
+typedef struct quine_ranked_match {
+    std::string database;
+    std::string meta;
+    int votes;              // query features matching the image
+    float score;            // votes / AKAZE_KEYPOINTCOUNT, as accept_ratio is
+    bool accepted;          // the image match_loaded_databases would return
+} quine_ranked_match_t;
+
+
 class QuineDatabaseOperations {
 public:
     
@@ -79,7 +118,8 @@ public:
      *
      * @param hash (const std::string)
      *        Hash value for the image. Used so that the same images are
-     *        not duplicated in the database
+     *        not duplicated in the database: if a live image with the same
+     *        hash exists, nothing is extracted or written
      *
      * @param img_id (const std::string)
      *        String GUID used as an identifier for the image
@@ -100,6 +140,35 @@ public:
                            const std::string& path);
     
     
+    /* ************************************************************************* */
+    /**
+     * @brief Deletes an image from the specified database. The image is
+     *        tombstoned, so the database is neither rewritten nor reloaded.
+     *
+     * @param meta (const std::string)
+     *        Meta data the image was added with. Every image with it is deleted.
+     *
+     * @param path (const std::string)
+     *        Full path to the database
+     *
+     * @return (bool) true if the deletion was persisted
+     */
+    virtual bool delete_image(const std::string& meta,
+                              const std::string& path);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Replaces the image(s) with the given meta data by a new image
+     *
+     * @return (bool) true if the replacement was persisted
+     */
+    virtual bool replace_image(const cv::Mat& img,
+                               const std::string& hash,
+                               const std::string& meta,
+                               const std::string& path);
+    
+    
     /* ************************************************************************* */
     /**
      * @brief Loads a database from disk to memory. This method may be called
@@ -135,12 +204,197 @@ public:
      */
     virtual std::vector<std::string> list_loaded_databases();
     
-    virtual void get_database(std::string &db,
-                              cv::Mat &source,
-                              cv::Mat &filter,
-                              cv::vector<std::string> &metadata,
-                              cv::vector<std::string> &hashtable,
-                              bool force);
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Lists the loaded databases without copying the list, for
+     *        callers that go through it on every frame.
+     *
+     * @return (std::shared_ptr<const std::vector<std::string> >)
+     */
+    virtual std::shared_ptr<const std::vector<std::string> > loaded_databases();
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Opens a read-only handle on a database for one query, loading
+     *        the database if needed. The handle views the database's
+     *        descriptors, filter and metadata in place; reloads and changes
+     *        never disturb an open handle.
+     *
+     * @param path (const std::string)
+     *        Full path to the database
+     *
+     * @return (QuineDatabaseHandle) invalid if the database can't be loaded
+     */
+    virtual QuineDatabaseHandle open_database(const std::string& path);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Matches the signature of a query image against every loaded
+     *        database, each through a handle of its own.
+     *
+     * @param arena (QuineFrameArena*)
+     *        Frame arena the matcher allocates from, or NULL for the heap.
+     *
+     * @param matches (std::vector<quine_database_match_t>)
+     *        Receives one match per loaded database, in the order of
+     *        loaded_databases(). Empty if the query has no keypoints.
+     *
+     * @return (void)
+     */
+    virtual void match_loaded_databases(const akaze_response_struc& signature,
+                                        float dratio,
+                                        float accept_ratio,
+                                        QuineFrameArena *arena,
+                                        std::vector<quine_database_match_t> &matches);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Ranks the images of every loaded database for a batch of
+     *        queries. Each database is read once for the whole batch.
+     *
+     * @param signatures (std::vector<const akaze_response_struc*>)
+     *        Queries; only their desc, filter and kpts_count are used.
+     *
+     * @param top_k (size_t)
+     *        Images kept per query, over all databases.
+     *
+     * @param rankings (std::vector<std::vector<quine_ranked_match_t> >)
+     *        Receives the ranking of each query, best first; images without
+     *        votes are left out.
+     *
+     * @return (void)
+     */
+    virtual void rank_loaded_databases(const std::vector<const akaze_response_struc*>& signatures,
+                                       float dratio,
+                                       float accept_ratio,
+                                       size_t top_k,
+                                       std::vector<std::vector<quine_ranked_match_t> > &rankings);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Reloads a database from disk on a background thread and swaps it
+     *        in once read. Queries go on against the previous snapshot.
+     *
+     * @return (std::future<bool>) true once the database is loaded
+     */
+    virtual std::future<bool> reload_database_async(const std::string& path);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Limits the memory taken by the loaded databases. Least recently
+     *        queried databases are evicted beyond it and reloaded on their
+     *        next query.
+     *
+     * @param bytes (size_t)
+     *        Memory budget in bytes. 0 disables the limit.
+     *
+     * @return (void)
+     */
+    virtual void set_memory_budget(size_t bytes);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Flags of the deleted images of a loaded database, in the
+     *        order of its metadata.
+     *
+     * @return (std::vector<bool>)
+     */
+    virtual std::vector<bool> get_tombstones(const std::string& path);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Looks up the slot of the live image with the given meta data
+     *        in a loaded database, without scanning it.
+     *
+     * @return (bool) false if no live image has this meta data
+     */
+    virtual bool find_image(const std::string& meta, const std::string& path, uint32_t &slot);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Reports residency and hit/miss counters of a loaded database.
+     *
+     * @param path (const std::string)
+     *        Full path to the database
+     *
+     * @return (bool) false if the database was never loaded
+     */
+    virtual bool get_database_stats(const std::string& path, quine_database_stats_t &stats);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Bytes taken by every resident database together. The footprint
+     *        of each one, by section, is in its get_database_stats().
+     *
+     * @return (size_t)
+     */
+    virtual size_t get_resident_bytes();
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Records the transient bytes a query against a database used,
+     *        as reported by compare_mat_souces(). The largest is reported
+     *        in the database's stats and kept free when databases are loaded.
+     *
+     * @return (void)
+     */
+    virtual void record_query_bytes(const std::string& path, size_t bytes);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Heap counters of the whole process (see QuineMemoryStats.h).
+     *
+     * @return (bool) false if the platform doesn't report them
+     */
+    virtual bool get_allocator_stats(quine_allocator_stats_t &stats);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Version of a database as last synced from the server.
+     *
+     * @return (uint64_t) 0 if the database was never synced
+     */
+    virtual uint64_t get_database_version(const std::string& path);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Applies a downloaded sync delta to a database, on disk and in
+     *        memory, and moves the database to the delta's version.
+     *
+     * @param delta_path (const std::string)
+     *        Full path to the downloaded delta
+     *
+     * @param path (const std::string)
+     *        Full path to the database
+     *
+     * @return (bool) false if the delta can't be applied to the database's
+     *         current version, in which case the whole database is needed
+     */
+    virtual bool apply_delta(const std::string& delta_path, const std::string& path);
+    
+    
+    /* ************************************************************************* */
+    /**
+     * @brief Replaces a database by a downloaded copy of it, at the given
+     *        version, and reloads it if it was loaded.
+     *
+     * @return (bool)
+     */
+    virtual bool install_database(const std::string& downloaded_path, const std::string& path, uint64_t version);
     
 };
 
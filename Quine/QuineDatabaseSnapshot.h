@@ -0,0 +1,110 @@
+//
+//  QuineDatabaseSnapshot.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineDatabaseSnapshot__
+#define __Quine__QuineDatabaseSnapshot__
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "QuineDescriptorStore.h"
+#include "QuineStringTable.h"
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Immutable view of a loaded database, as a query sees it.
+ *
+ *        QuineMemory publishes a new snapshot after every change to a
+ *        database (a load, a logged change, a reload) and never modifies
+ *        a published one. A query pins the snapshot once, through a
+ *        std::shared_ptr, and matches against it to the end, so it always
+ *        sees descriptors, metadata and tombstones of the same version;
+ *        the memory behind them lives as long as any query holds it, even
+ *        if the database is evicted or replaced meanwhile.
+ */
+typedef struct quine_database_snapshot {
+
+    /*!
+     * Descriptor and filter rows of every image slot. The chunks are
+     *   reference counted, and the rows they cover are never written again.
+     */
+    std::vector<quine_store_chunk_t> chunks;
+
+    /*!
+     * Metadata of each image slot. Shares its arena with the resident
+     *   table, which only ever appends past what the snapshot sees.
+     */
+    QuineStringTable metadata;
+
+    /*!
+     * Deleted flag of each image slot, shared with every snapshot published
+     *   since the last deletion. Slots past its end are live.
+     */
+    std::shared_ptr<const std::vector<bool> > tombstones;
+
+    /*!
+     * Increases with every snapshot QuineMemory publishes, for any database
+     */
+    uint64_t generation;
+
+} quine_database_snapshot_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Query counters of a database, bumped by query threads without a
+ *        lock, and read (atomically) by eviction under QuineMemory's lock
+ */
+typedef struct quine_database_usage {
+
+    std::atomic<uint64_t> hits;
+
+    /*!
+     * Logical time of the last query, for least-recently-used eviction
+     */
+    std::atomic<uint64_t> last_used;
+
+    /*!
+     * Most transient bytes a query against the database used
+     */
+    std::atomic<size_t> peak_query_bytes;
+
+    quine_database_usage() : hits(0), last_used(0), peak_query_bytes(0) { }
+
+    /*!
+     * Records a use at logical time now. Query threads get their times from
+     *   one clock but may store them out of order, so last_used only ever
+     *   moves forward; eviction never sees a database as older than it is.
+     */
+    void touch(uint64_t now) {
+        uint64_t current = last_used.load();
+        while(now > current && !last_used.compare_exchange_weak(current, now)) { }
+    }
+
+} quine_database_usage_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Published databases, hashed by path. A registry is never modified
+ *        once published either: a writer publishes a modified copy, so
+ *        readers can look databases up without any lock.
+ */
+typedef struct quine_published_database {
+    std::shared_ptr<const quine_database_snapshot_t> snapshot;
+    std::shared_ptr<quine_database_usage_t> usage;
+} quine_published_database_t;
+
+typedef std::unordered_map<std::string, quine_published_database_t> quine_snapshot_registry_t;
+
+
+#endif /* defined(__Quine__QuineDatabaseSnapshot__) */
@@ -0,0 +1,284 @@
+//
+//  QuineDescriptorStore.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineDescriptorStore.h"
+
+#include <string.h>
+#include <algorithm>
+
+
+QuineDescriptorStore::QuineDescriptorStore(size_t chunk_rows)
+: m_chunk_rows(std::max<size_t>(chunk_rows, 1)), m_appended(0), m_rows(0), m_cols(0)
+{
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Adds existing descriptors as a (full) chunk of their own.
+ *
+ * @return (bool) false if the descriptor width does not match the store,
+ *         or filter does not have one row per descriptor
+ */
+bool QuineDescriptorStore::adopt(const cv::Mat &desc, const cv::Mat &filter, const std::shared_ptr<void> &owner)
+{
+    if(desc.empty()) {
+        return true;
+    }
+    if(filter.rows != desc.rows) {
+        return false;
+    }
+
+    chunk_t c;
+    c.desc = desc;
+    c.filter = filter;
+    if(desc.type() != CV_32FC1) {
+        desc.convertTo(c.desc, CV_32FC1);
+    }
+    if(filter.type() != CV_8UC1) {
+        filter.convertTo(c.filter, CV_8UC1);
+    }
+    c.used = desc.rows;
+    c.capacity = desc.rows;
+    c.owner = owner;
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    if(m_cols == 0) {
+        m_cols = desc.cols;
+    }
+    if(desc.cols != m_cols) {
+        return false;
+    }
+    c.first_row = m_rows;
+    m_chunks.push_back(c);
+    m_rows += c.used;
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Appends descriptors into the free rows of the last chunk, allocating
+ *        new chunks as they fill up. Filled rows are never moved or rewritten.
+ *
+ * @return (bool)
+ */
+bool QuineDescriptorStore::append(const cv::Mat &desc, const cv::Mat &filter)
+{
+    if(desc.empty()) {
+        return true;
+    }
+
+    cv::Mat d = desc;
+    if(d.type() != CV_32FC1) {
+        desc.convertTo(d, CV_32FC1);
+    }
+    cv::Mat f = filter;
+    if(f.type() != CV_8UC1) {
+        filter.convertTo(f, CV_8UC1);
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    if(m_cols == 0) {
+        m_cols = d.cols;
+    }
+    if(d.cols != m_cols || (size_t)f.total() < (size_t)d.rows) {
+        return false;
+    }
+
+    size_t row = 0;
+    while(row < (size_t)d.rows) {
+
+        if(m_chunks.empty() || m_chunks.back().used == m_chunks.back().capacity) {
+
+            // Each chunk is as large as every appended chunk before it, so
+            //   small databases stay small and growth stays amortized O(1)
+            size_t capacity = std::max(std::max((size_t)d.rows - row, m_appended), (size_t)QUINE_STORE_MIN_CHUNK_ROWS);
+            capacity = std::min(capacity, m_chunk_rows);
+
+            chunk_t c;
+            c.desc.create((int)capacity, m_cols, CV_32FC1);
+            c.filter.create((int)capacity, 1, CV_8UC1);
+            c.first_row = m_rows;
+            c.used = 0;
+            c.capacity = capacity;
+            m_chunks.push_back(c);
+            m_appended += capacity;
+        }
+
+        // Write past the rows any reader can see, then publish them
+        chunk_t &c = m_chunks.back();
+        size_t n = std::min((size_t)d.rows - row, c.capacity - c.used);
+        for(size_t r = 0; r < n; r++) {
+            memcpy(c.desc.ptr<float>((int)(c.used + r)), d.ptr<float>((int)(row + r)), m_cols * sizeof(float));
+            c.filter.ptr<uchar>((int)(c.used + r))[0] = f.isContinuous() ? f.data[row + r] : f.ptr<uchar>((int)(row + r))[0];
+        }
+
+        c.used += n;
+        m_rows += n;
+        row += n;
+    }
+
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Headers over every chunk as of now, in row order.
+ *
+ * @return (void)
+ */
+void QuineDescriptorStore::snapshot(std::vector<quine_store_chunk_t> &chunks) const
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    chunks.clear();
+    chunks.reserve(m_chunks.size());
+    for(size_t i = 0; i < m_chunks.size(); i++) {
+        const chunk_t &c = m_chunks[i];
+        if(c.used == 0) {
+            continue;
+        }
+
+        quine_store_chunk_t s;
+        s.desc = c.used == (size_t)c.desc.rows ? c.desc : c.desc.rowRange(0, (int)c.used);
+        s.filter = c.used == (size_t)c.filter.rows ? c.filter : c.filter.rowRange(0, (int)c.used);
+        s.first_row = c.first_row;
+        s.owner = c.owner;
+        chunks.push_back(s);
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Copies a snapshot into contiguous matrices, leaving out the rows of
+ *        tombstoned images.
+ *
+ * @return (void)
+ */
+void QuineDescriptorStore::gather(const std::vector<quine_store_chunk_t> &chunks,
+                                  cv::Mat &desc,
+                                  cv::Mat &filter,
+                                  const std::vector<bool> *tombstones,
+                                  size_t rows_per_image)
+{
+    bool skip = tombstones && rows_per_image > 0 &&
+                std::find(tombstones->begin(), tombstones->end(), true) != tombstones->end();
+
+    size_t rows = 0;
+    int cols = 0;
+    for(size_t i = 0; i < chunks.size(); i++) {
+        rows += chunks[i].desc.rows;
+        cols = chunks[i].desc.cols;
+    }
+
+    if(skip) {
+        for(size_t i = 0; i < tombstones->size(); i++) {
+            if((*tombstones)[i]) {
+                rows -= std::min(rows, rows_per_image);
+            }
+        }
+    }
+
+    if(rows == 0) {
+        desc = cv::Mat();
+        filter = cv::Mat();
+        return;
+    }
+
+    // A single chunk needs no copy; the caller's snapshot keeps it alive
+    if(chunks.size() == 1 && !skip) {
+        desc = chunks[0].desc;
+        filter = chunks[0].filter;
+        return;
+    }
+
+    desc.create((int)rows, cols, CV_32FC1);
+    filter.create((int)rows, 1, CV_8UC1);
+
+    if(!skip) {
+        for(size_t i = 0; i < chunks.size(); i++) {
+            const quine_store_chunk_t &c = chunks[i];
+            c.desc.copyTo(desc.rowRange((int)c.first_row, (int)c.first_row + c.desc.rows));
+            c.filter.copyTo(filter.rowRange((int)c.first_row, (int)c.first_row + c.filter.rows));
+        }
+        return;
+    }
+
+    // Copy runs of live rows; a run ends at a chunk or a dead image boundary
+    size_t out = 0;
+    for(size_t i = 0; i < chunks.size(); i++) {
+        const quine_store_chunk_t &c = chunks[i];
+
+        int r = 0;
+        while(r < c.desc.rows) {
+            size_t image = (c.first_row + r) / rows_per_image;
+            int image_end = (int)std::min((size_t)c.desc.rows, (image + 1) * rows_per_image - c.first_row);
+
+            bool dead = image < tombstones->size() && (*tombstones)[image];
+            if(!dead && out + (image_end - r) <= rows) {
+                c.desc.rowRange(r, image_end).copyTo(desc.rowRange((int)out, (int)out + image_end - r));
+                c.filter.rowRange(r, image_end).copyTo(filter.rowRange((int)out, (int)out + image_end - r));
+                out += image_end - r;
+            }
+            r = image_end;
+        }
+    }
+}
+
+
+size_t QuineDescriptorStore::rows() const
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_rows;
+}
+
+
+int QuineDescriptorStore::cols() const
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_cols;
+}
+
+
+size_t QuineDescriptorStore::bytes() const
+{
+    size_t descriptors = 0;
+    size_t filter = 0;
+    footprint(descriptors, filter);
+    return descriptors + filter;
+}
+
+
+void QuineDescriptorStore::footprint(size_t &descriptors, size_t &filter) const
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    descriptors = 0;
+    filter = 0;
+    for(size_t i = 0; i < m_chunks.size(); i++) {
+        descriptors += m_chunks[i].used * m_chunks[i].desc.cols * m_chunks[i].desc.elemSize();
+        filter += m_chunks[i].used * m_chunks[i].filter.elemSize();
+    }
+}
+
+
+size_t QuineDescriptorStore::reserved_bytes() const
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    size_t bytes = 0;
+    for(size_t i = 0; i < m_chunks.size(); i++) {
+        const chunk_t &c = m_chunks[i];
+        bytes += c.capacity * (c.desc.cols * c.desc.elemSize() + c.filter.elemSize());
+    }
+    return bytes;
+}
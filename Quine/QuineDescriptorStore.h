@@ -0,0 +1,243 @@
+//
+//  QuineDescriptorStore.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineDescriptorStore__
+#define __Quine__QuineDescriptorStore__
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+
+// Most descriptor rows per chunk (16 MB of CV_32FC1 at 64 columns)
+#define QUINE_STORE_CHUNK_ROWS  65536
+
+// Fewest rows an appended chunk is allocated with
+#define QUINE_STORE_MIN_CHUNK_ROWS  1024
+
+
+/* ************************************************************************* */
+/*!
+ * @brief One chunk of a descriptor store, as seen by a reader.
+ */
+typedef struct quine_store_chunk {
+
+    /*!
+     * Descriptors (CV_32FC1) and keypoint class ids (CV_8UC1) of the chunk,
+     *   one row per keypoint. Only the rows that were filled are included.
+     */
+    cv::Mat desc;
+    cv::Mat filter;
+
+    /*!
+     * Row of the database at which the chunk starts
+     */
+    size_t first_row;
+
+    /*!
+     * Keeps the memory behind desc and filter alive (e.g. a mapped file)
+     *   when it is not owned by the cv::Mat itself.
+     */
+    std::shared_ptr<void> owner;
+
+} quine_store_chunk_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Bytes a resident database takes, by section. Mapped sections count
+ *        the whole mapping, whether or not the system paged it in.
+ */
+typedef struct quine_database_footprint {
+
+    /*!
+     * Descriptor (CV_32FC1) and class filter (CV_8UC1) rows in use. The
+     *   unfilled rows of the last chunk are not counted (see
+     *   QuineDescriptorStore::reserved_bytes())
+     */
+    size_t descriptors;
+    size_t filter;
+
+    /*!
+     * Metadata strings and their offsets, and the content hashes
+     */
+    size_t metadata;
+    size_t hashes;
+
+    /*!
+     * Hash and image id lookup tables, and the deleted flags
+     */
+    size_t indexes;
+    size_t tombstones;
+
+    /*!
+     * Copies held by the published snapshot (appended metadata, deleted flags)
+     */
+    size_t snapshot;
+
+    size_t total;
+
+} quine_database_footprint_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Residency and cache counters of one database.
+ */
+typedef struct quine_database_stats {
+
+    /*!
+     * Whether the database is in memory, and how many bytes it takes
+     */
+    bool resident;
+    size_t resident_bytes;
+
+    /*!
+     * Section sizes as last measured. Kept while the database is evicted,
+     *   as the room it needs to be loaded again.
+     */
+    quine_database_footprint_t footprint;
+
+    /*!
+     * Most bytes a single query against the database allocated at once
+     *   (votes, scores), beyond the database itself
+     */
+    size_t peak_query_bytes;
+
+    /*!
+     * Queries served from memory / that had to load the database first
+     */
+    uint64_t hits;
+    uint64_t misses;
+
+    /*!
+     * Times the database was evicted to stay within the memory budget
+     */
+    uint64_t evictions;
+
+    /*!
+     * Logical time of the last query, for least-recently-used eviction
+     */
+    uint64_t last_used;
+
+} quine_database_stats_t;
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineDescriptorStore
+ *
+ *  @abstract   Growable, chunked descriptor storage for one database.
+ *
+ *  @discussion Appends fill chunks that are allocated once and never
+ *              moved, so growing the database costs amortized O(1) per
+ *              row instead of cv::Mat::push_back copying the whole
+ *              matrix. Chunks grow geometrically from
+ *              QUINE_STORE_MIN_CHUNK_ROWS up to the store's chunk size. A snapshot() taken by a reader stays valid while
+ *              other rows are appended: the rows it covers are never
+ *              written again and the chunks are reference counted.
+ *
+ *              Databases loaded from disk are adopted as a single chunk
+ *              without copying; appends then start a new chunk after it.
+ */
+class QuineDescriptorStore {
+public:
+
+    QuineDescriptorStore(size_t chunk_rows = QUINE_STORE_CHUNK_ROWS);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Adds existing descriptors as a chunk of their own, without copying.
+     *
+     * @param owner (std::shared_ptr<void>)
+     *        Object that owns the memory of desc and filter, if they do not own it.
+     *
+     * @return (bool) false if the descriptor width does not match the store,
+     *         or filter does not have one row per descriptor
+     */
+    bool adopt(const cv::Mat &desc, const cv::Mat &filter, const std::shared_ptr<void> &owner = std::shared_ptr<void>());
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Appends descriptors (converted to CV_32FC1) and their class ids.
+     *
+     * @return (bool) false if the descriptor width does not match the store
+     */
+    bool append(const cv::Mat &desc, const cv::Mat &filter);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Headers over every chunk as of now, in row order.
+     *
+     * @return (void)
+     */
+    void snapshot(std::vector<quine_store_chunk_t> &chunks) const;
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Copies a snapshot into contiguous matrices, e.g. to save it.
+     *
+     * @param tombstones (const std::vector<bool>*)
+     *        If given, the rows of every image flagged in it are left out.
+     *        Images are rows_per_image rows each.
+     *
+     * @return (void)
+     */
+    static void gather(const std::vector<quine_store_chunk_t> &chunks,
+                       cv::Mat &desc,
+                       cv::Mat &filter,
+                       const std::vector<bool> *tombstones = NULL,
+                       size_t rows_per_image = 0);
+
+
+    size_t rows() const;
+    int cols() const;
+    bool empty() const { return rows() == 0; }
+
+
+    /*!
+     * Bytes of the rows in use
+     */
+    size_t bytes() const;
+
+    void footprint(size_t &descriptors, size_t &filter) const;
+
+    /*!
+     * Bytes held by the chunks, including rows not filled yet
+     */
+    size_t reserved_bytes() const;
+
+private:
+
+    QuineDescriptorStore(const QuineDescriptorStore &);
+    QuineDescriptorStore& operator=(const QuineDescriptorStore &);
+
+    typedef struct chunk {
+        cv::Mat desc;
+        cv::Mat filter;
+        size_t first_row;
+        size_t used;
+        size_t capacity;
+        std::shared_ptr<void> owner;
+    } chunk_t;
+
+    mutable std::mutex m_lock;
+    std::vector<chunk_t> m_chunks;
+    size_t m_chunk_rows;
+    size_t m_appended;
+    size_t m_rows;
+    int m_cols;
+};
+
+
+#endif /* defined(__Quine__QuineDescriptorStore__) */
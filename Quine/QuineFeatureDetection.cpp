@@ -20,6 +20,7 @@
 #include "QuineConstants.h"
 #include "AKAZE.h"
 #include "AKAZEConfig.h"
+#include "QuineLatency.h"
 
 
 #pragma mark -
@@ -30,7 +31,7 @@
  *
  * @return (akaze_response_struc)
  */
-akaze_response_struc::akaze_response_struc() {
+akaze_response_struc::akaze_response_struc() : kpts_count(0), akaze_ms(0.0) {
 }
 
 
@@ -53,6 +54,7 @@ akaze_response_struc::~akaze_response_struc() {
  * @return (QuineFeatureDetection)
  */
 QuineFeatureDetection::QuineFeatureDetection()
+: m_evolution_width(0), m_evolution_height(0)
 {
     initialize();
 }
@@ -90,12 +92,19 @@ void QuineFeatureDetection::initialize() {
  * @param dst (cv::Mat)
  *        Output destination image of OpenCV type cv::Mat, single (gray) channel.
  *
+ * @param arena (QuineFrameArena*)
+ *        Frame arena dst is allocated from, or NULL for the heap.
+ *
  * @return (void)
  */
-void QuineFeatureDetection::get_gray(const cv::Mat& src, cv::Mat& dst)
+void QuineFeatureDetection::get_gray(const cv::Mat& src, cv::Mat& dst, QuineFrameArena *arena)
 {
     const int numChannes = src.channels();
     
+    // cvtColor writes into a matrix of the right size and type in place
+    if(arena && (numChannes == 4 || numChannes == 3)) {
+        dst = arena->mat(src.rows, src.cols, CV_8UC1);
+    }
     
     if (numChannes == 4) {
         //src.convertTo(dst, CV_BGRA2GRAY);
@@ -150,9 +159,12 @@ void QuineFeatureDetection::get_gray(const cv::Mat& src, cv::Mat& dst)
  * @param width (float)
  *        The width of the outputted cv::Mat image (dst).
  *
+ * @param arena (QuineFrameArena*)
+ *        Frame arena dst is allocated from, or NULL for the heap.
+ *
  * @return (void)
  */
-void QuineFeatureDetection::resize_to_width(const cv::Mat& src, cv::Mat& dst, float width) {
+void QuineFeatureDetection::resize_to_width(const cv::Mat& src, cv::Mat& dst, float width, QuineFrameArena *arena) {
     
     float oldWidth = src.cols;
     float scaleFactor = width / oldWidth;
@@ -160,7 +172,11 @@ void QuineFeatureDetection::resize_to_width(const cv::Mat& src, cv::Mat& dst, fl
     float newHeight = src.rows * scaleFactor;
     float newWidth = oldWidth * scaleFactor;
     
-    cv::resize(src, dst, cv::Size(newWidth, newHeight), 0, 0, CV_INTER_LINEAR);
+    cv::Size size((int)newWidth, (int)newHeight);
+    if(arena) {
+        dst = arena->mat(size.height, size.width, src.type());
+    }
+    cv::resize(src, dst, size, 0, 0, CV_INTER_LINEAR);
 }
 
 
@@ -190,9 +206,14 @@ bool sort_responses(cv::KeyPoint i, cv::KeyPoint j) { return i.response > j.resp
  *              and grayscale. For performance, the image should also
  *              be reduced in size, yet still have the correct aspect ratio.
  *
+ * @param arena (QuineFrameArena*)
+ *              Frame arena the working image and the response's
+ *              descriptors and filter are allocated from, or NULL.
+ *
  * @return (akaze_response_struc)
  */
-void QuineFeatureDetection::compute_signature(const cv::Mat& frame, akaze_response_struc &response, bool is_query) {
+void QuineFeatureDetection::compute_signature(const cv::Mat& frame, akaze_response_struc &response, bool is_query,
+                                              QuineFrameArena *arena) {
     
     // Time declarations
     double t1 = 0.0;
@@ -209,20 +230,37 @@ void QuineFeatureDetection::compute_signature(const cv::Mat& frame, akaze_respon
     options.img_width = frame.cols;
     options.img_height = frame.rows;
     
-    // Declare the AKAZE evolution steps
-    libAKAZE::AKAZE evolution1(options);
+    // Declare the AKAZE evolution steps. Allocating the scale space is most
+    //   of the memory a frame takes, so it's kept while the size doesn't change.
+    if(!m_evolution || m_evolution_width != frame.cols || m_evolution_height != frame.rows) {
+        m_evolution.reset(new libAKAZE::AKAZE(options));
+        m_evolution_width = frame.cols;
+        m_evolution_height = frame.rows;
+    }
+    libAKAZE::AKAZE &evolution1 = *m_evolution;
     
     // Feature detection process
+    QuineLatency *latency = QuineLatency::instance();
     t1 = cv::getTickCount();
+    QuineLatencyTimer scale_space_timer(latency->stage(QUINE_LATENCY_SCALE_SPACE));
+    if(arena) {
+        img_32 = arena->mat(frame.rows, frame.cols, CV_32FC1);
+    }
     frame.convertTo(img_32,CV_32F,1.0/255.0,0);
     
     // Build the scale space and detect the features
     evolution1.Create_Nonlinear_Scale_Space(img_32);
+    scale_space_timer.stop();
+    
+    QuineLatencyTimer detection_timer(latency->stage(QUINE_LATENCY_DETECTION));
     evolution1.Feature_Detection(kpts_akaze);
     std::sort(kpts_akaze.begin(), kpts_akaze.end(), sort_responses);
+    detection_timer.stop();
     
     // Feature description process
+    QuineLatencyTimer description_timer(latency->stage(QUINE_LATENCY_DESCRIPTION));
     evolution1.Compute_Descriptors(kpts_akaze, desc_akaze);
+    description_timer.stop();
     t2 = cv::getTickCount();
     takaze = 1000.0*(t2-t1)/cv::getTickFrequency();
     
@@ -247,26 +285,39 @@ void QuineFeatureDetection::compute_signature(const cv::Mat& frame, akaze_respon
         kpts_akaze.resize(AKAZEOptions::AKAZE_KEYPOINTCOUNT);
         
         // Copy descriptor data to response object
+        if(arena) {
+            response.desc = arena->mat(mat.rows, mat.cols, CV_32FC1);
+        }
         mat.copyTo(response.desc);
         mat.release();
     }
     else {
-        desc_akaze.copyTo(response.desc);
+        // Nothing else holds the descriptors, so the response takes them
+        response.desc = desc_akaze;
     }
     
-    std::vector<uint8_t> feature_class;
-    for(auto kpt:kpts_akaze) {
-        feature_class.push_back(kpt.class_id);
+    // Class id of each keypoint, written straight into the filter
+    int class_count = (int)kpts_akaze.size();
+    if(class_count == 0) {
+        response.filter = cv::Mat();
+    }
+    else if(arena) {
+        response.filter = arena->mat(class_count, 1, CV_8UC1);
+    }
+    else {
+        response.filter.create(class_count, 1, CV_8UC1);
+    }
+    for(int i = 0; i < class_count; i++) {
+        response.filter.at<uchar>(i) = (uchar)kpts_akaze[i].class_id;
     }
-    cv::Mat filter((int)feature_class.size(), 1, CV_8UC1, &feature_class[0]);
     
     // Copy keypoint information to response object
     response.kpts_count = desc_akaze.rows;
-    response.kpts = kpts_akaze;
-    filter.copyTo(response.filter);
+    response.kpts.swap(kpts_akaze);
     
     // Set the response options
     response.options = options;
+    response.akaze_ms = takaze;
     
     // Uncomment to show the description proccess time
     //std::cout << "A-KAZE Features (" << desc_akaze.rows << ") Extraction Time (ms): " << takaze << std::endl;
@@ -275,7 +326,6 @@ void QuineFeatureDetection::compute_signature(const cv::Mat& frame, akaze_respon
     //evolution1.Show_Computation_Times();
 
     // Cleanup
-    filter.release();
     desc_akaze.release();
     //evolution1.~AKAZE(); //Not sure if this works...
     
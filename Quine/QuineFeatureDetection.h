@@ -20,10 +20,12 @@
 #define __Quine__QuineFeatureDetection__
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include "AKAZE.h"
 #include "AKAZEConfig.h"
 #include "utils.h"
+#include "QuineFrameArena.h"
 
 
 class akaze_response_struc {
@@ -39,6 +41,10 @@ public:
     cv::Mat desc;
     AKAZEOptions options;
     
+    // Detection and description time (ms) of the compute_signature call
+    //   that filled the response
+    double akaze_ms;
+    
     
     /* ************************************************************************* */
     /*!
@@ -61,7 +67,11 @@ public:
 
 /* ************************************************************************* */
 /*!
- * @class Defines the image feature detection methods
+ * @class Defines the image feature detection methods.
+ *
+ *        An instance keeps the AKAZE scale space of the last frame size it
+ *        described and reuses it for frames of the same size, so it should
+ *        describe one frame at a time (one instance per thread).
  */
 class QuineFeatureDetection {
 public:
@@ -102,9 +112,15 @@ public:
      *              and grayscale. For performance, the image should also
      *              be reduced in size, yet still have the correct aspect ratio.
      *
+     * @param arena (QuineFrameArena*)
+     *              Frame arena the working image and the response's
+     *              descriptors and filter are allocated from, or NULL for
+     *              the heap. The response is then only valid for the frame.
+     *
      * @return (akaze_response_struc)
      */
-    virtual void compute_signature(const cv::Mat& greyFrame, akaze_response_struc &response, bool is_query);
+    virtual void compute_signature(const cv::Mat& greyFrame, akaze_response_struc &response, bool is_query,
+                                   QuineFrameArena *arena = NULL);
     
     
     /* ************************************************************************* */
@@ -117,9 +133,12 @@ public:
      * @param dst (cv::Mat)
      *        Output destination image of OpenCV type cv::Mat, single (gray) channel.
      *
+     * @param arena (QuineFrameArena*)
+     *        Frame arena dst is allocated from, or NULL for the heap.
+     *
      * @return (void)
      */
-    virtual void get_gray(const cv::Mat& src, cv::Mat& dst);
+    virtual void get_gray(const cv::Mat& src, cv::Mat& dst, QuineFrameArena *arena = NULL);
     
     
     /* ************************************************************************* */
@@ -136,10 +155,19 @@ public:
      * @param width (float)
      *        The width of the outputted cv::Mat image (dst).
      *
+     * @param arena (QuineFrameArena*)
+     *        Frame arena dst is allocated from, or NULL for the heap.
+     *
      * @return (void)
      */
-    virtual void resize_to_width(const cv::Mat& src, cv::Mat& dst, float width);
+    virtual void resize_to_width(const cv::Mat& src, cv::Mat& dst, float width, QuineFrameArena *arena = NULL);
 
+private:
+    
+    // Scale space of the last frame size described
+    std::shared_ptr<libAKAZE::AKAZE> m_evolution;
+    int m_evolution_width;
+    int m_evolution_height;
 };
 
 #endif /* defined(__Quine__QuineFeatureDetection__) */
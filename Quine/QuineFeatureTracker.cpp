@@ -0,0 +1,141 @@
+//
+//  QuineFeatureTracker.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineFeatureTracker.h"
+
+#include <algorithm>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/video/tracking.hpp>
+
+
+QuineFeatureTracker::QuineFeatureTracker()
+: m_started_points(0), m_quality(0.0f), m_tracking(false)
+{
+}
+
+
+bool QuineFeatureTracker::start(const cv::Mat &gray, const std::vector<cv::Point2f> &points)
+{
+    reset();
+    if(gray.empty() || points.size() < QUINE_TRACKER_MIN_POINTS) {
+        return false;
+    }
+
+    cv::buildOpticalFlowPyramid(gray, m_pyramid, cv::Size(QUINE_TRACKER_WINDOW, QUINE_TRACKER_WINDOW),
+                                QUINE_TRACKER_LEVELS);
+    m_points = points;
+    m_size = gray.size();
+    m_started_points = points.size();
+    m_quality = 1.0f;
+    m_tracking = true;
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Forward flow, backward flow to check it, then a RANSAC homography
+ *        over the points that passed. Only its inliers are kept.
+ *
+ * @return (bool)
+ */
+bool QuineFeatureTracker::track(const cv::Mat &gray)
+{
+    if(!m_tracking) {
+        return false;
+    }
+    if(gray.size() != m_size) {
+        reset();
+        return false;
+    }
+
+    cv::Size window(QUINE_TRACKER_WINDOW, QUINE_TRACKER_WINDOW);
+    std::vector<cv::Mat> pyramid;
+    cv::buildOpticalFlowPyramid(gray, pyramid, window, QUINE_TRACKER_LEVELS);
+
+
+    //////////////////////////////////////////////////////////
+    // There and back again
+
+    std::vector<cv::Point2f> forward, backward;
+    std::vector<uchar> forward_status, backward_status;
+    std::vector<float> error;
+    cv::calcOpticalFlowPyrLK(m_pyramid, pyramid, m_points, forward, forward_status, error,
+                             window, QUINE_TRACKER_LEVELS);
+    cv::calcOpticalFlowPyrLK(pyramid, m_pyramid, forward, backward, backward_status, error,
+                             window, QUINE_TRACKER_LEVELS);
+
+    std::vector<cv::Point2f> from, to;
+    from.reserve(m_points.size());
+    to.reserve(m_points.size());
+    for(size_t i = 0; i < m_points.size(); i++) {
+        if(!forward_status[i] || !backward_status[i]) {
+            continue;
+        }
+        float dx = backward[i].x - m_points[i].x;
+        float dy = backward[i].y - m_points[i].y;
+        if(dx * dx + dy * dy > QUINE_TRACKER_MAX_FB_ERROR * QUINE_TRACKER_MAX_FB_ERROR) {
+            continue;
+        }
+        from.push_back(m_points[i]);
+        to.push_back(forward[i]);
+    }
+
+
+    //////////////////////////////////////////////////////////
+    // Keep the points that move with the image
+
+    std::vector<cv::Point2f> tracked;
+    if(to.size() >= QUINE_TRACKER_MIN_POINTS) {
+        cv::Mat inliers;
+        cv::Mat homography = cv::findHomography(from, to, cv::RANSAC, QUINE_TRACKER_RANSAC_PX, inliers);
+        if(!homography.empty()) {
+            tracked.reserve(to.size());
+            for(size_t i = 0; i < to.size(); i++) {
+                if(inliers.at<uchar>((int)i)) {
+                    tracked.push_back(to[i]);
+                }
+            }
+        }
+    }
+
+    m_quality = (float)tracked.size() / (float)m_started_points;
+    if(tracked.size() < QUINE_TRACKER_MIN_POINTS || m_quality < QUINE_TRACKER_MIN_QUALITY) {
+        reset();
+        return false;
+    }
+
+    m_points.swap(tracked);
+    m_pyramid.swap(pyramid);
+    return true;
+}
+
+
+void QuineFeatureTracker::reset()
+{
+    m_pyramid.clear();
+    m_points.clear();
+    m_started_points = 0;
+    m_quality = 0.0f;
+    m_tracking = false;
+}
+
+
+cv::Rect QuineFeatureTracker::region(int margin) const
+{
+    if(m_points.empty()) {
+        return cv::Rect();
+    }
+
+    cv::Rect box = cv::boundingRect(m_points);
+    int x = std::max(box.x - margin, 0);
+    int y = std::max(box.y - margin, 0);
+    int right = std::min(box.x + box.width + margin, m_size.width);
+    int bottom = std::min(box.y + box.height + margin, m_size.height);
+    return cv::Rect(x, y, std::max(right - x, 0), std::max(bottom - y, 0));
+}
@@ -0,0 +1,114 @@
+//
+//  QuineFeatureTracker.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineFeatureTracker__
+#define __Quine__QuineFeatureTracker__
+
+#include <stddef.h>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+// Lucas-Kanade search window (px) and pyramid levels above the frame
+#define QUINE_TRACKER_WINDOW        21
+#define QUINE_TRACKER_LEVELS        3
+
+// A point tracked back to the previous frame must land this close (px)
+//   to where it started, or it is dropped
+#define QUINE_TRACKER_MAX_FB_ERROR  1.0f
+
+// RANSAC reprojection error (px) of the frame to frame homography
+#define QUINE_TRACKER_RANSAC_PX     3.0
+
+// Tracking is lost below this many points, or below this fraction of
+//   the points it was started with
+#define QUINE_TRACKER_MIN_POINTS    10
+#define QUINE_TRACKER_MIN_QUALITY   0.4f
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineFeatureTracker
+ *
+ *  @abstract   Follows a recognized image from frame to frame with
+ *              pyramidal Lucas-Kanade optical flow.
+ *
+ *  @discussion Started on the keypoints that matched the image, it tracks
+ *              them into every following frame instead of describing and
+ *              matching the frame again. A point survives a frame only if
+ *              it tracks there and back to where it started, and if it
+ *              agrees with the homography RANSAC fits to the others (the
+ *              target is a flat image). When too few points survive, the
+ *              tracker stops and the caller falls back to recognition.
+ *
+ *              The pyramid of the last frame is kept, so each frame's
+ *              pyramid is built once. Frames must be grayscale and all of
+ *              the same size; one instance serves one thread.
+ */
+class QuineFeatureTracker {
+public:
+
+    QuineFeatureTracker();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Starts tracking points of a frame, usually the keypoints that
+     *        matched the recognized image.
+     *
+     * @param gray (const cv::Mat&)
+     *        Grayscale frame the points were found in.
+     *
+     * @return (bool) false if there are fewer than QUINE_TRACKER_MIN_POINTS
+     */
+    bool start(const cv::Mat &gray, const std::vector<cv::Point2f> &points);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Tracks the points into the next frame.
+     *
+     * @return (bool) false if tracking is lost (or was never started)
+     */
+    bool track(const cv::Mat &gray);
+
+
+    void reset();
+
+    bool is_tracking() const { return m_tracking; }
+
+
+    /*!
+     * Fraction of the points tracking started with that are still tracked
+     */
+    float quality() const { return m_quality; }
+
+    const std::vector<cv::Point2f> &points() const { return m_points; }
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Bounding box of the tracked points, grown by a margin and
+     *        clipped to the frame. Re-detection can be limited to it.
+     *
+     * @return (cv::Rect) empty if nothing is tracked
+     */
+    cv::Rect region(int margin = 0) const;
+
+private:
+
+    std::vector<cv::Mat> m_pyramid;
+    std::vector<cv::Point2f> m_points;
+    cv::Size m_size;
+    size_t m_started_points;
+    float m_quality;
+    bool m_tracking;
+};
+
+
+#endif /* defined(__Quine__QuineFeatureTracker__) */
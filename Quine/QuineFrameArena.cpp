@@ -0,0 +1,93 @@
+//
+//  QuineFrameArena.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineFrameArena.h"
+
+#include <stdlib.h>
+#include <algorithm>
+
+
+static size_t align_size(size_t bytes)
+{
+    return (bytes + QUINE_FRAME_ARENA_ALIGN - 1) & ~(size_t)(QUINE_FRAME_ARENA_ALIGN - 1);
+}
+
+
+static char *allocate_block(size_t bytes)
+{
+    void *block = NULL;
+    if(posix_memalign(&block, QUINE_FRAME_ARENA_ALIGN, std::max(bytes, (size_t)QUINE_FRAME_ARENA_ALIGN)) != 0) {
+        throw std::bad_alloc();
+    }
+    return (char *)block;
+}
+
+
+QuineFrameArena::QuineFrameArena(size_t bytes)
+: m_data(NULL), m_capacity(align_size(bytes)), m_offset(0), m_overflow_bytes(0), m_peak(0)
+{
+    m_data = allocate_block(m_capacity);
+}
+
+
+QuineFrameArena::~QuineFrameArena()
+{
+    reset();
+    free(m_data);
+}
+
+
+void *QuineFrameArena::allocate(size_t bytes)
+{
+    size_t size = align_size(bytes);
+    size_t offset = m_offset.fetch_add(size);
+    if(offset + size <= m_capacity) {
+        return m_data + offset;
+    }
+
+    // Doesn't fit this frame; the arena grows at the next reset
+    char *block = allocate_block(size);
+    std::lock_guard<std::mutex> guard(m_overflow_lock);
+    m_overflow.push_back(block);
+    m_overflow_bytes += size;
+    return block;
+}
+
+
+cv::Mat QuineFrameArena::mat(int rows, int cols, int type)
+{
+    size_t bytes = (size_t)rows * cols * CV_ELEM_SIZE(type);
+    return cv::Mat(rows, cols, type, allocate(bytes));
+}
+
+
+size_t QuineFrameArena::used() const
+{
+    return std::min(m_offset.load(), m_capacity) + m_overflow_bytes;
+}
+
+
+void QuineFrameArena::reset()
+{
+    size_t frame = used();
+    m_peak = std::max(m_peak, frame);
+
+    if(!m_overflow.empty()) {
+        for(size_t i = 0; i < m_overflow.size(); i++) {
+            free(m_overflow[i]);
+        }
+        m_overflow.clear();
+        m_overflow_bytes = 0;
+
+        // Room for the largest frame so far, so the next one doesn't spill
+        free(m_data);
+        m_capacity = align_size(m_peak);
+        m_data = allocate_block(m_capacity);
+    }
+    m_offset = 0;
+}
@@ -0,0 +1,142 @@
+//
+//  QuineFrameArena.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineFrameArena__
+#define __Quine__QuineFrameArena__
+
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+// Bytes reserved up front; a frame that needs more grows the arena once
+#define QUINE_FRAME_ARENA_BYTES     (4 * 1024 * 1024)
+
+// Every allocation starts on this boundary, as cv::fastMalloc does
+#define QUINE_FRAME_ARENA_ALIGN     16
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineFrameArena
+ *
+ *  @abstract   Bump allocator for everything one camera frame needs, from
+ *              preprocessing to matching, released all at once.
+ *
+ *  @discussion Allocating is one atomic add, so the parallel ranges of the
+ *              matcher allocate from the same arena without contending on
+ *              the system allocator. reset() at the end of the frame gives
+ *              everything back in O(1). A frame that needs more than the
+ *              arena holds spills into heap blocks; the next reset() frees
+ *              them and grows the arena to the frame's size, so after the
+ *              first frames every frame runs in the same, bounded, memory.
+ *
+ *              Nothing allocated from the arena may outlive the frame:
+ *              cv::Mat headers from mat() don't own their data.
+ */
+class QuineFrameArena {
+public:
+
+    QuineFrameArena(size_t bytes = QUINE_FRAME_ARENA_BYTES);
+    ~QuineFrameArena();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Allocates bytes for the current frame. Thread safe.
+     *
+     * @return (void*) aligned to QUINE_FRAME_ARENA_ALIGN
+     */
+    void *allocate(size_t bytes);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Matrix for the current frame. OpenCV functions given it as
+     *        their output write into it in place, so long as the size and
+     *        type they produce are the ones it was made with.
+     *
+     * @return (cv::Mat) not reference counted
+     */
+    cv::Mat mat(int rows, int cols, int type);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Releases everything allocated since the last reset. Must not
+     *        run while anything still allocates or uses the memory.
+     *
+     * @return (void)
+     */
+    void reset();
+
+
+    /*!
+     * Bytes allocated since the last reset, and the most any frame took
+     */
+    size_t used() const;
+    size_t peak() const { return m_peak; }
+
+    size_t capacity() const { return m_capacity; }
+
+private:
+
+    QuineFrameArena(const QuineFrameArena &);
+    QuineFrameArena &operator=(const QuineFrameArena &);
+
+    char *m_data;
+    size_t m_capacity;
+    std::atomic<size_t> m_offset;
+
+    // Blocks of the current frame that didn't fit
+    std::mutex m_overflow_lock;
+    std::vector<void *> m_overflow;
+    size_t m_overflow_bytes;
+
+    size_t m_peak;
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief STL allocator drawing from a frame arena, for containers that live
+ *        no longer than the frame. deallocate() is a no-op.
+ */
+template <class T>
+class QuineArenaAllocator {
+public:
+    typedef T value_type;
+
+    explicit QuineArenaAllocator(QuineFrameArena &arena) : m_arena(&arena) { }
+
+    template <class U>
+    QuineArenaAllocator(const QuineArenaAllocator<U> &other) : m_arena(other.arena()) { }
+
+    T *allocate(size_t n) { return (T *)m_arena->allocate(n * sizeof(T)); }
+    void deallocate(T *, size_t) { }
+
+    QuineFrameArena *arena() const { return m_arena; }
+
+    template <class U>
+    struct rebind { typedef QuineArenaAllocator<U> other; };
+
+private:
+    QuineFrameArena *m_arena;
+};
+
+template <class T, class U>
+bool operator==(const QuineArenaAllocator<T> &a, const QuineArenaAllocator<U> &b) { return a.arena() == b.arena(); }
+
+template <class T, class U>
+bool operator!=(const QuineArenaAllocator<T> &a, const QuineArenaAllocator<U> &b) { return a.arena() != b.arena(); }
+
+
+#endif /* defined(__Quine__QuineFrameArena__) */
@@ -0,0 +1,81 @@
+//
+//  QuineFrameGate.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineFrameGate.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+QuineFrameGate::QuineFrameGate()
+: m_static_skips(0)
+{
+    m_stats.passed = 0;
+    m_stats.skipped_static = 0;
+    m_stats.skipped_blurry = 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief The thumbnail difference comes first, as it is the cheaper of the
+ *        two; a blurry frame doesn't replace the last thumbnail.
+ *
+ * @return (quine_gate_decision_t)
+ */
+quine_gate_decision_t QuineFrameGate::check(const cv::Mat &gray, double *sharpness)
+{
+    if(sharpness) {
+        *sharpness = 0.0;
+    }
+
+
+    //////////////////////////////////////////////////////////
+    // Same scene as the last frame let through?
+
+    cv::Mat thumbnail;
+    cv::resize(gray, thumbnail, cv::Size(QUINE_GATE_THUMB_WIDTH, QUINE_GATE_THUMB_HEIGHT), 0, 0, CV_INTER_AREA);
+
+    if(!m_thumbnail.empty() && m_static_skips < QUINE_GATE_MAX_SKIPS) {
+        double difference = cv::norm(thumbnail, m_thumbnail, cv::NORM_L1) / thumbnail.total();
+        if(difference < QUINE_GATE_STATIC_DIFF) {
+            m_static_skips++;
+            m_stats.skipped_static++;
+            return QUINE_GATE_STATIC;
+        }
+    }
+
+
+    //////////////////////////////////////////////////////////
+    // Sharp enough to describe?
+
+    cv::Mat laplacian;
+    cv::Scalar mean, deviation;
+    cv::Laplacian(gray, laplacian, CV_16S);
+    cv::meanStdDev(laplacian, mean, deviation);
+    double variance = deviation[0] * deviation[0];
+    if(sharpness) {
+        *sharpness = variance;
+    }
+
+    if(variance < QUINE_GATE_MIN_SHARPNESS) {
+        m_stats.skipped_blurry++;
+        return QUINE_GATE_BLURRY;
+    }
+
+    m_thumbnail = thumbnail;
+    m_static_skips = 0;
+    m_stats.passed++;
+    return QUINE_GATE_PASS;
+}
+
+
+void QuineFrameGate::reset()
+{
+    m_thumbnail.release();
+    m_static_skips = 0;
+}
@@ -0,0 +1,95 @@
+//
+//  QuineFrameGate.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineFrameGate__
+#define __Quine__QuineFrameGate__
+
+#include <stdint.h>
+#include <opencv2/core/core.hpp>
+
+
+// Thumbnail a frame is compared by (px)
+#define QUINE_GATE_THUMB_WIDTH      16
+#define QUINE_GATE_THUMB_HEIGHT     12
+
+// Mean absolute difference (gray levels) of the thumbnails below which
+//   a frame counts as unchanged
+#define QUINE_GATE_STATIC_DIFF      3.0
+
+// Variance of the Laplacian below which a frame is too blurred to describe
+#define QUINE_GATE_MIN_SHARPNESS    40.0
+
+// Unchanged frames skipped in a row before one is let through anyway, so a
+//   scene that wasn't recognized keeps being retried
+#define QUINE_GATE_MAX_SKIPS        15
+
+
+typedef enum {
+    QUINE_GATE_PASS = 0,
+    QUINE_GATE_STATIC,              // nothing changed since the last frame let through
+    QUINE_GATE_BLURRY               // too blurred for usable keypoints
+} quine_gate_decision_t;
+
+
+typedef struct quine_gate_stats {
+    uint64_t passed;
+    uint64_t skipped_static;
+    uint64_t skipped_blurry;
+} quine_gate_stats_t;
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineFrameGate
+ *
+ *  @abstract   Decides, cheaply, whether a frame is worth recognizing.
+ *
+ *  @discussion A frame is skipped when its thumbnail barely differs from
+ *              the thumbnail of the last frame let through (the camera is
+ *              looking at the same scene), or when the variance of its
+ *              Laplacian is too low (motion blur leaves no usable
+ *              keypoints). Both take a fraction of a millisecond on the
+ *              resized frame, against tens for extraction and matching.
+ *
+ *              One instance serves one thread.
+ */
+class QuineFrameGate {
+public:
+
+    QuineFrameGate();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Looks at a grayscale frame. A frame let through becomes the
+     *        one later frames are compared to.
+     *
+     * @param sharpness (double*)
+     *        Receives the frame's sharpness, if computed, or NULL.
+     *
+     * @return (quine_gate_decision_t)
+     */
+    quine_gate_decision_t check(const cv::Mat &gray, double *sharpness = NULL);
+
+
+    /*!
+     * Forgets the last frame, so the next sharp frame is let through
+     */
+    void reset();
+
+    const quine_gate_stats_t &stats() const { return m_stats; }
+
+private:
+
+    cv::Mat m_thumbnail;
+    int m_static_skips;
+    quine_gate_stats_t m_stats;
+};
+
+
+#endif /* defined(__Quine__QuineFrameGate__) */
@@ -0,0 +1,460 @@
+//
+//  QuineFramePipeline.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineFramePipeline.h"
+#include "QuineConstants.h"
+#include "QuineLatency.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+static uint64_t elapsed_us(int64_t since)
+{
+    return (uint64_t)(1e6 * (cv::getTickCount() - since) / cv::getTickFrequency());
+}
+
+
+static void store_max(std::atomic<uint64_t> &target, uint64_t value)
+{
+    uint64_t current = target.load();
+    while(value > current && !target.compare_exchange_weak(current, value)) { }
+}
+
+
+#pragma mark -
+#pragma mark QuineFramePipeline | Signal
+void QuineFramePipeline::Signal::raise()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_raised = true;
+    }
+    m_condition.notify_one();
+}
+
+
+void QuineFramePipeline::Signal::wait()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_condition.wait_for(lock, std::chrono::milliseconds(QUINE_PIPELINE_IDLE_MS), [this]() { return m_raised; });
+    m_raised = false;
+}
+
+
+#pragma mark -
+#pragma mark QuineFramePipeline
+QuineFramePipeline::QuineFramePipeline(float dratio, float accept_ratio, size_t depth)
+: m_running(false), m_dratio(dratio), m_accept_ratio(accept_ratio), m_tracking(true), m_next_id(0),
+  m_started(0), m_results(0), m_latency_us(0), m_tracked_frames(0), m_tracking_lost(0), m_gating(true),
+  m_skipped_static(0), m_skipped_blurry(0)
+{
+    for(int i = 0; i < QUINE_PIPELINE_STAGES; i++) {
+        m_stages.push_back(std::unique_ptr<stage_t>(new stage_t(std::max(depth, (size_t)1))));
+    }
+}
+
+
+QuineFramePipeline::~QuineFramePipeline()
+{
+    stop();
+}
+
+
+void QuineFramePipeline::start(const result_callback &callback)
+{
+    if(m_running) {
+        return;
+    }
+    m_callback = callback;
+    m_started = cv::getTickCount();
+    m_running = true;
+    m_threads.push_back(std::thread(&QuineFramePipeline::run_preprocess, this));
+    m_threads.push_back(std::thread(&QuineFramePipeline::run_extract, this));
+    m_threads.push_back(std::thread(&QuineFramePipeline::run_match, this));
+}
+
+
+void QuineFramePipeline::stop()
+{
+    if(!m_running) {
+        return;
+    }
+    m_running = false;
+    for(size_t i = 0; i < m_stages.size(); i++) {
+        m_stages[i]->signal.raise();
+    }
+    for(size_t i = 0; i < m_threads.size(); i++) {
+        m_threads[i].join();
+    }
+    m_threads.clear();
+
+    // Every thread is gone, so the queues can be emptied from here
+    for(size_t i = 0; i < m_stages.size(); i++) {
+        frame_ptr frame;
+        while(m_stages[i]->input.try_pop(frame)) { }
+        delete m_stages[i]->held.exchange(NULL);
+    }
+    std::lock_guard<std::mutex> guard(m_seed_lock);
+    m_seed.reset();
+}
+
+
+bool QuineFramePipeline::submit(const cv::Mat &frame)
+{
+    if(!m_running || frame.empty()) {
+        return false;
+    }
+
+    frame_ptr item(new quine_pipeline_frame_t());
+    item->id = ++m_next_id;
+    item->image = frame;
+    item->submitted = cv::getTickCount();
+    hand_off(*m_stages[QUINE_STAGE_PREPROCESS], item);
+    return true;
+}
+
+
+void QuineFramePipeline::set_ratios(float dratio, float accept_ratio)
+{
+    m_dratio = dratio;
+    m_accept_ratio = accept_ratio;
+}
+
+
+void QuineFramePipeline::set_tracking(bool enabled)
+{
+    m_tracking = enabled;
+}
+
+
+void QuineFramePipeline::set_gating(bool enabled)
+{
+    m_gating = enabled;
+}
+
+
+#pragma mark -
+#pragma mark QuineFramePipeline | Hand off
+/* ************************************************************************* */
+/*!
+ * @brief Queues a frame for the next stage. If the queue is full, the
+ *        frame is held back instead, and a frame held back before it
+ *        is dropped.
+ *
+ * @return (void)
+ */
+void QuineFramePipeline::hand_off(stage_t &next, frame_ptr &frame)
+{
+    frame->queued = cv::getTickCount();
+
+    // A frame still held back is older than this one
+    quine_pipeline_frame_t *stale = next.held.exchange(NULL);
+    if(stale) {
+        delete stale;
+        next.dropped++;
+    }
+
+    if(next.input.try_push(frame)) {
+        size_t depth = next.input.size();
+        size_t max_depth = next.max_depth.load();
+        while(depth > max_depth && !next.max_depth.compare_exchange_weak(max_depth, depth)) { }
+    }
+    else {
+        stale = next.held.exchange(frame.release());
+        if(stale) {
+            delete stale;
+            next.dropped++;
+        }
+    }
+    next.signal.raise();
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Keeps whichever of the two frames is newer, dropping the other.
+ *
+ * @return (void)
+ */
+void QuineFramePipeline::keep_newest(stage_t &current, frame_ptr &frame, frame_ptr &candidate)
+{
+    if(!candidate) {
+        return;
+    }
+    if(candidate->id > current.last_id && (!frame || candidate->id > frame->id)) {
+        frame.swap(candidate);
+    }
+    if(candidate) {
+        candidate.reset();
+        current.dropped++;
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Takes the newest frame waiting for a stage, queued or held back,
+ *        and drops the older ones.
+ *
+ * @return (bool) false if none came before the stage gave up waiting
+ */
+bool QuineFramePipeline::next_frame(stage_t &current, frame_ptr &frame)
+{
+    for(int attempt = 0; attempt < 2 && !frame; attempt++) {
+        if(attempt > 0) {
+            current.signal.wait();
+        }
+
+        frame_ptr candidate;
+        while(current.input.try_pop(candidate)) {
+            keep_newest(current, frame, candidate);
+        }
+        candidate.reset(current.held.exchange(NULL));
+        keep_newest(current, frame, candidate);
+    }
+
+    if(!frame) {
+        return false;
+    }
+    current.last_id = frame->id;
+    current.wait_us += elapsed_us(frame->queued);
+    return true;
+}
+
+
+void QuineFramePipeline::finished(stage_t &current, int64_t started)
+{
+    uint64_t us = elapsed_us(started);
+    current.busy_us += us;
+    store_max(current.max_us, us);
+    current.processed++;
+}
+
+
+#pragma mark -
+#pragma mark QuineFramePipeline | Tracking
+/* ************************************************************************* */
+/*!
+ * @brief Starts tracking on the last recognized frame, if one came in,
+ *        then tracks the frame. Runs on the extraction thread, which owns
+ *        the tracker.
+ *
+ * @return (bool) true if the frame was tracked and needs no recognition
+ */
+bool QuineFramePipeline::track(QuineFeatureTracker &tracker, quine_pipeline_frame_t &frame)
+{
+    frame_ptr seed;
+    {
+        std::lock_guard<std::mutex> guard(m_seed_lock);
+        seed.swap(m_seed);
+    }
+
+    if(!m_tracking) {
+        tracker.reset();
+        return false;
+    }
+
+    // A frame recognized while tracking is no news
+    if(seed && !tracker.is_tracking() && tracker.start(seed->image, seed->tracked_points)) {
+        m_tracked_matches = seed->matches;
+    }
+    if(!tracker.is_tracking()) {
+        return false;
+    }
+
+    if(!tracker.track(frame.image)) {
+        m_tracking_lost++;
+        return false;
+    }
+
+    frame.tracked = true;
+    frame.matches = m_tracked_matches;
+    frame.tracked_points = tracker.points();
+    frame.region = tracker.region();
+    m_tracked_frames++;
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Hands a recognized frame to the extraction thread to track from,
+ *        with the keypoints that matched the image with the most of them.
+ *
+ * @return (void)
+ */
+void QuineFramePipeline::seed_tracker(const quine_pipeline_frame_t &frame)
+{
+    if(!m_tracking) {
+        return;
+    }
+
+    const quine_database_match_t *best = NULL;
+    for(size_t i = 0; i < frame.matches.size(); i++) {
+        if(!best || frame.matches[i].features.size() > best->features.size()) {
+            best = &frame.matches[i];
+        }
+    }
+    if(!best || best->features.size() < QUINE_TRACKER_MIN_POINTS) {
+        return;
+    }
+
+    frame_ptr seed(new quine_pipeline_frame_t());
+    seed->id = frame.id;
+    seed->image = frame.image;
+    seed->matches = frame.matches;
+    seed->tracked_points.reserve(best->features.size());
+    for(size_t i = 0; i < best->features.size(); i++) {
+        seed->tracked_points.push_back(frame.signature.kpts[best->features[i]].pt);
+    }
+
+    std::lock_guard<std::mutex> guard(m_seed_lock);
+    m_seed.swap(seed);
+}
+
+
+#pragma mark -
+#pragma mark QuineFramePipeline | Stages
+void QuineFramePipeline::run_preprocess()
+{
+    stage_t &current = *m_stages[QUINE_STAGE_PREPROCESS];
+    stage_t &next = *m_stages[QUINE_STAGE_EXTRACT];
+    QuineFeatureDetection feature;
+    QuineFrameGate gate;
+
+    while(m_running) {
+        frame_ptr frame;
+        if(!next_frame(current, frame)) {
+            continue;
+        }
+
+        int64_t started = cv::getTickCount();
+        cv::Mat resized_img, gray_img;
+        QuineLatencyTimer preprocess_timer(QuineLatency::instance()->stage(QUINE_LATENCY_PREPROCESS));
+        feature.resize_to_width(frame->image, resized_img, RESIZED_IMAGE_WIDTH);
+        feature.get_gray(resized_img, gray_img);
+        preprocess_timer.stop();
+        frame->image = gray_img;
+
+        // Unchanged or blurred frames go no further
+        quine_gate_decision_t decision = m_gating ? gate.check(frame->image) : QUINE_GATE_PASS;
+        finished(current, started);
+
+        if(decision == QUINE_GATE_STATIC) {
+            m_skipped_static++;
+            continue;
+        }
+        if(decision == QUINE_GATE_BLURRY) {
+            m_skipped_blurry++;
+            continue;
+        }
+        hand_off(next, frame);
+    }
+}
+
+
+void QuineFramePipeline::run_extract()
+{
+    stage_t &current = *m_stages[QUINE_STAGE_EXTRACT];
+    stage_t &next = *m_stages[QUINE_STAGE_MATCH];
+
+    // Keeps its scale space from frame to frame
+    QuineFeatureDetection feature;
+    QuineFeatureTracker tracker;
+
+    while(m_running) {
+        frame_ptr frame;
+        if(!next_frame(current, frame)) {
+            continue;
+        }
+
+        // The gray frame stays with the frame, to start tracking on if it is recognized
+        int64_t started = cv::getTickCount();
+        if(!track(tracker, *frame)) {
+            feature.compute_signature(frame->image, frame->signature, true);
+        }
+        finished(current, started);
+
+        hand_off(next, frame);
+    }
+}
+
+
+void QuineFramePipeline::run_match()
+{
+    stage_t &current = *m_stages[QUINE_STAGE_MATCH];
+    QuineDatabaseOperations database_op;
+
+    // Matching is the last stage, so its allocations never outlive the frame
+    QuineFrameArena arena;
+
+    while(m_running) {
+        frame_ptr frame;
+        if(!next_frame(current, frame)) {
+            continue;
+        }
+
+        int64_t started = cv::getTickCount();
+        quine_pipeline_result_t result;
+        result.frame_id = frame->id;
+        result.tracked = frame->tracked;
+        result.region = frame->region;
+        if(frame->tracked) {
+            result.matches.swap(frame->matches);
+            cv::KeyPoint::convert(frame->tracked_points, result.keypoints);
+        }
+        else {
+            database_op.match_loaded_databases(frame->signature, m_dratio, m_accept_ratio, &arena,
+                                               frame->matches);
+            arena.reset();
+            seed_tracker(*frame);
+            result.matches.swap(frame->matches);
+            result.keypoints.swap(frame->signature.kpts);
+        }
+        finished(current, started);
+
+        uint64_t latency_us = elapsed_us(frame->submitted);
+        result.latency_ms = latency_us / 1000.0;
+        m_latency_us += latency_us;
+        m_results++;
+
+        if(m_callback) {
+            m_callback(result);
+        }
+    }
+}
+
+
+#pragma mark -
+#pragma mark QuineFramePipeline | Stats
+void QuineFramePipeline::get_stats(quine_pipeline_stats_t &stats)
+{
+    for(int i = 0; i < QUINE_PIPELINE_STAGES; i++) {
+        const stage_t &s = *m_stages[i];
+        quine_stage_stats_t &out = stats.stages[i];
+        out.processed = s.processed;
+        out.dropped = s.dropped;
+        out.depth = s.input.size();
+        out.max_depth = s.max_depth;
+        out.mean_ms = out.processed ? s.busy_us / 1000.0 / out.processed : 0.0;
+        out.max_ms = s.max_us / 1000.0;
+        out.mean_wait_ms = out.processed ? s.wait_us / 1000.0 / out.processed : 0.0;
+    }
+
+    uint64_t results = m_results;
+    double seconds = m_started ? (cv::getTickCount() - m_started) / cv::getTickFrequency() : 0.0;
+    stats.frames_per_second = seconds > 0.0 ? results / seconds : 0.0;
+    stats.mean_latency_ms = results ? m_latency_us / 1000.0 / results : 0.0;
+    stats.tracked_frames = m_tracked_frames;
+    stats.tracking_lost = m_tracking_lost;
+    stats.skipped_static = m_skipped_static;
+    stats.skipped_blurry = m_skipped_blurry;
+    stats.saved_ms = (stats.skipped_static + stats.skipped_blurry) *
+                     (stats.stages[QUINE_STAGE_EXTRACT].mean_ms + stats.stages[QUINE_STAGE_MATCH].mean_ms);
+}
@@ -0,0 +1,338 @@
+//
+//  QuineFramePipeline.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineFramePipeline__
+#define __Quine__QuineFramePipeline__
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "QuineDatabaseOperations.h"
+#include "QuineFeatureDetection.h"
+#include "QuineFeatureTracker.h"
+#include "QuineFrameGate.h"
+#include "QuineSPSCQueue.h"
+
+
+// Frames queued in front of each stage
+#define QUINE_PIPELINE_DEPTH        2
+
+// How long an idle stage sleeps before looking at its queue again (ms)
+#define QUINE_PIPELINE_IDLE_MS      5
+
+
+typedef enum {
+    QUINE_STAGE_PREPROCESS = 0,     // resize, gray and gate
+    QUINE_STAGE_EXTRACT,            // AKAZE keypoints and descriptors
+    QUINE_STAGE_MATCH,              // every loaded database
+    QUINE_PIPELINE_STAGES
+} quine_pipeline_stage_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief A camera frame on its way through the pipeline.
+ */
+typedef struct quine_pipeline_frame {
+
+    uint64_t id;
+
+    /*!
+     * The captured frame, then its resized gray version
+     */
+    cv::Mat image;
+
+    akaze_response_struc signature;
+
+    /*!
+     * Set when the extraction stage tracked the recognized image into the
+     *   frame; it then carries the tracked matches and skips matching
+     */
+    bool tracked;
+    std::vector<quine_database_match_t> matches;
+    std::vector<cv::Point2f> tracked_points;
+    cv::Rect region;
+
+    /*!
+     * Tick counts of the submission, and of the frame entering its current queue
+     */
+    int64_t submitted;
+    int64_t queued;
+
+} quine_pipeline_frame_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief What the pipeline delivers for each frame that makes it through.
+ */
+typedef struct quine_pipeline_result {
+
+    uint64_t frame_id;
+
+    /*!
+     * One per loaded database (see QuineDatabaseOperations::match_loaded_databases)
+     */
+    std::vector<quine_database_match_t> matches;
+
+    /*!
+     * Keypoints of the frame, in the resized frame's coordinates. For a
+     *   tracked frame, the tracked points.
+     */
+    std::vector<cv::KeyPoint> keypoints;
+
+    /*!
+     * Whether the matches come from tracking rather than recognition, and
+     *   where the tracked image is (resized frame's coordinates)
+     */
+    bool tracked;
+    cv::Rect region;
+
+    /*!
+     * From submission to result
+     */
+    double latency_ms;
+
+} quine_pipeline_result_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Counters of one stage since the pipeline started.
+ */
+typedef struct quine_stage_stats {
+
+    /*!
+     * Frames the stage finished, and frames it skipped for a newer one
+     */
+    uint64_t processed;
+    uint64_t dropped;
+
+    /*!
+     * Frames queued in front of the stage now, and the most there were
+     */
+    size_t depth;
+    size_t max_depth;
+
+    /*!
+     * Time the stage spent on a frame, and time a frame waited in its queue
+     */
+    double mean_ms;
+    double max_ms;
+    double mean_wait_ms;
+
+} quine_stage_stats_t;
+
+
+typedef struct quine_pipeline_stats {
+    quine_stage_stats_t stages[QUINE_PIPELINE_STAGES];
+
+    /*!
+     * Results delivered per second, and their mean latency from submission
+     */
+    double frames_per_second;
+    double mean_latency_ms;
+
+    /*!
+     * Results that came from tracking, and times tracking was lost
+     */
+    uint64_t tracked_frames;
+    uint64_t tracking_lost;
+
+    /*!
+     * Frames the gate kept from extraction and matching (see QuineFrameGate),
+     *   and the extraction and matching time that saved, at the mean cost
+     */
+    uint64_t skipped_static;
+    uint64_t skipped_blurry;
+    double saved_ms;
+} quine_pipeline_stats_t;
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineFramePipeline
+ *
+ *  @abstract   Runs preprocessing, feature extraction and matching of
+ *              camera frames on a thread each, so they overlap.
+ *
+ *  @discussion Stages hand frames on through bounded lock-free queues
+ *              (QuineSPSCQueue); a stage with nothing to do sleeps until
+ *              the stage before signals it. The latest frame wins: a
+ *              stage always takes the newest frame waiting for it, and
+ *              when its queue is full the newest frame is held back in a
+ *              single slot, replacing any frame held back before it.
+ *              Stale frames are dropped, never queued up, so
+ *              throughput approaches that of the slowest stage and the
+ *              latency stays bounded.
+ *
+ *              The preprocessing stage drops frames that show the same
+ *              scene as the last one, or are too blurred to describe
+ *              (QuineFrameGate), before they cost anything more.
+ *
+ *              Once a frame is recognized, the keypoints that matched
+ *              seed a QuineFeatureTracker on the extraction thread, and
+ *              later frames are tracked with optical flow instead of
+ *              described and matched, until tracking is lost.
+ *
+ *              Frames must be submitted from one thread at a time.
+ *              Results are delivered on the matching thread.
+ */
+class QuineFramePipeline {
+public:
+
+    typedef std::unique_ptr<quine_pipeline_frame_t> frame_ptr;
+    typedef std::function<void(const quine_pipeline_result_t &)> result_callback;
+
+    QuineFramePipeline(float dratio, float accept_ratio, size_t depth = QUINE_PIPELINE_DEPTH);
+    ~QuineFramePipeline();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Starts the stage threads.
+     *
+     * @param callback (result_callback)
+     *        Called on the matching thread with the result of each frame.
+     *
+     * @return (void)
+     */
+    void start(const result_callback &callback);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Stops the stage threads, dropping the frames in flight.
+     *
+     * @return (void)
+     */
+    void stop();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Hands a captured frame to the pipeline. Never blocks. The
+     *        matrix is kept as is (not copied), so the caller must not
+     *        write to its pixels afterwards.
+     *
+     * @return (bool) false if the pipeline isn't running
+     */
+    bool submit(const cv::Mat &frame);
+
+
+    void set_ratios(float dratio, float accept_ratio);
+
+
+    /*!
+     * Tracking is on by default; turning it off stops any tracking under way
+     */
+    void set_tracking(bool enabled);
+
+
+    /*!
+     * Gating is on by default
+     */
+    void set_gating(bool enabled);
+
+    void get_stats(quine_pipeline_stats_t &stats);
+
+private:
+
+    QuineFramePipeline(const QuineFramePipeline &);
+    QuineFramePipeline &operator=(const QuineFramePipeline &);
+
+
+    /*!
+     * Wakes a stage up when a frame is queued for it
+     */
+    class Signal {
+    public:
+        Signal() : m_raised(false) { }
+        void raise();
+        void wait();
+    private:
+        std::mutex m_lock;
+        std::condition_variable m_condition;
+        bool m_raised;
+    };
+
+
+    typedef struct stage {
+
+        stage(size_t depth) : input(depth), held(NULL), last_id(0), processed(0), dropped(0),
+                              max_depth(0), busy_us(0), max_us(0), wait_us(0) { }
+        ~stage() { delete held.exchange(NULL); }
+
+        QuineSPSCQueue<frame_ptr> input;
+
+        // Newest frame that didn't fit in the queue. The stage before swaps
+        //   a newer one in, the stage itself takes it out.
+        std::atomic<quine_pipeline_frame_t *> held;
+
+        // Id of the last frame the stage took, so it never goes back to an older one
+        uint64_t last_id;
+
+        Signal signal;
+
+        std::atomic<uint64_t> processed;
+        std::atomic<uint64_t> dropped;
+        std::atomic<size_t> max_depth;
+        std::atomic<uint64_t> busy_us;
+        std::atomic<uint64_t> max_us;
+        std::atomic<uint64_t> wait_us;
+
+    } stage_t;
+
+
+    void hand_off(stage_t &next, frame_ptr &frame);
+    void keep_newest(stage_t &current, frame_ptr &frame, frame_ptr &candidate);
+    bool next_frame(stage_t &current, frame_ptr &frame);
+    void finished(stage_t &current, int64_t started);
+
+    bool track(QuineFeatureTracker &tracker, quine_pipeline_frame_t &frame);
+    void seed_tracker(const quine_pipeline_frame_t &frame);
+
+    void run_preprocess();
+    void run_extract();
+    void run_match();
+
+    std::vector<std::unique_ptr<stage_t> > m_stages;
+    std::vector<std::thread> m_threads;
+    std::atomic<bool> m_running;
+    result_callback m_callback;
+
+    std::atomic<float> m_dratio;
+    std::atomic<float> m_accept_ratio;
+
+    // A recognized frame, handed from the matching to the extraction
+    //   thread to start tracking on. Rare, so a lock is fine.
+    std::atomic<bool> m_tracking;
+    std::mutex m_seed_lock;
+    frame_ptr m_seed;
+    std::vector<quine_database_match_t> m_tracked_matches;
+
+    uint64_t m_next_id;
+    int64_t m_started;
+    std::atomic<uint64_t> m_results;
+    std::atomic<uint64_t> m_latency_us;
+    std::atomic<uint64_t> m_tracked_frames;
+    std::atomic<uint64_t> m_tracking_lost;
+
+    std::atomic<bool> m_gating;
+    std::atomic<uint64_t> m_skipped_static;
+    std::atomic<uint64_t> m_skipped_blurry;
+};
+
+
+#endif /* defined(__Quine__QuineFramePipeline__) */
@@ -0,0 +1,535 @@
+//
+//  QuineGzip.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineGzip.h"
+#include "QuineMappedDatabase.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdint.h>
+#include <atomic>
+#include <algorithm>
+
+
+#pragma mark -
+#pragma mark Block gzip helpers
+/* ************************************************************************* */
+/*!
+ * @brief Reads a little-endian integer from the gzip stream
+ */
+static uint32_t read_le32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static uint16_t read_le16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+static void write_le32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)(v);
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Inflates (part of) a single block. When out_bytes is smaller than the
+ *        block, only the first out_bytes are produced and no crc is checked.
+ *
+ * @return (size_t) number of bytes inflated, or 0 on error
+ */
+static size_t inflate_block(const char *data,
+                            const gzip_block_t &block,
+                            char *out,
+                            size_t out_bytes)
+{
+    const unsigned char *member = (const unsigned char *)data + block.offset;
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if(inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+        return 0;
+    }
+
+    strm.next_in = (Bytef *)(member + QUINE_GZIP_BLOCK_HEADER_BYTES);
+    strm.avail_in = (uInt)(block.bytes - QUINE_GZIP_BLOCK_HEADER_BYTES - QUINE_GZIP_BLOCK_TRAILER_BYTES);
+    strm.next_out = (Bytef *)out;
+    strm.avail_out = (uInt)out_bytes;
+
+    int ret = inflate(&strm, Z_FINISH);
+    size_t produced = strm.total_out;
+    inflateEnd(&strm);
+
+    // Partial read of the block
+    if(out_bytes < block.raw_bytes) {
+        return (ret == Z_OK || ret == Z_BUF_ERROR || ret == Z_STREAM_END) ? produced : 0;
+    }
+
+    // Full read of the block, so it must be complete and intact
+    const unsigned char *trailer = member + block.bytes - QUINE_GZIP_BLOCK_TRAILER_BYTES;
+    if(ret != Z_STREAM_END || produced != block.raw_bytes ||
+       crc32(crc32(0L, Z_NULL, 0), (const Bytef *)out, (uInt)produced) != read_le32(trailer)) {
+        return 0;
+    }
+
+    return produced;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief cv::parallel_for_ body that inflates a range of blocks
+ */
+class GzipInflateBody : public cv::ParallelLoopBody {
+public:
+    GzipInflateBody(const char *data,
+                    const std::vector<gzip_block_t> &blocks,
+                    char *out,
+                    std::atomic<bool> *failed)
+    : m_data(data), m_blocks(blocks), m_out(out), m_failed(failed) { }
+
+    void operator()(const cv::Range &range) const {
+        for(int i = range.start; i < range.end && !m_failed->load(); i++) {
+            const gzip_block_t &block = m_blocks[i];
+            if(inflate_block(m_data, block, m_out + block.raw_offset, block.raw_bytes) != block.raw_bytes) {
+                m_failed->store(true);
+            }
+        }
+    }
+
+private:
+    const char *m_data;
+    const std::vector<gzip_block_t> &m_blocks;
+    char *m_out;
+    std::atomic<bool> *m_failed;
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Deflates one chunk into a complete block gzip member
+ *
+ * @return (bool)
+ */
+static bool deflate_block(const char *data, size_t size, int level, std::string &member)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if(deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    size_t bound = deflateBound(&strm, (uLong)size);
+    member.resize(QUINE_GZIP_BLOCK_HEADER_BYTES + bound + QUINE_GZIP_BLOCK_TRAILER_BYTES);
+    unsigned char *p = (unsigned char *)&member[0];
+
+    strm.next_in = (Bytef *)data;
+    strm.avail_in = (uInt)size;
+    strm.next_out = p + QUINE_GZIP_BLOCK_HEADER_BYTES;
+    strm.avail_out = (uInt)bound;
+
+    int ret = deflate(&strm, Z_FINISH);
+    size_t deflated = strm.total_out;
+    deflateEnd(&strm);
+
+    if(ret != Z_STREAM_END) {
+        return false;
+    }
+
+    size_t bytes = QUINE_GZIP_BLOCK_HEADER_BYTES + deflated + QUINE_GZIP_BLOCK_TRAILER_BYTES;
+
+    // Header, see QuineGzip.h
+    static const unsigned char header[16] = {
+        0x1f, 0x8b, Z_DEFLATED, 0x04,   // magic, deflate, FEXTRA
+        0, 0, 0, 0,                     // mtime
+        0, 0xff,                        // xfl, os (unknown)
+        12, 0,                          // xlen
+        'Q', 'B', 8, 0                  // subfield id and length
+    };
+    memcpy(p, header, sizeof(header));
+    write_le32(p + 16, (uint32_t)bytes);
+    write_le32(p + 20, (uint32_t)size);
+
+    // Trailer
+    unsigned char *trailer = p + QUINE_GZIP_BLOCK_HEADER_BYTES + deflated;
+    write_le32(trailer, (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef *)data, (uInt)size));
+    write_le32(trailer + 4, (uint32_t)size);
+
+    member.resize(bytes);
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief cv::parallel_for_ body that deflates a range of chunks
+ */
+class GzipDeflateBody : public cv::ParallelLoopBody {
+public:
+    GzipDeflateBody(const char *data,
+                    size_t size,
+                    size_t block_bytes,
+                    int level,
+                    std::vector<std::string> &members,
+                    std::atomic<bool> *failed)
+    : m_data(data), m_size(size), m_block_bytes(block_bytes), m_level(level),
+      m_members(members), m_failed(failed) { }
+
+    void operator()(const cv::Range &range) const {
+        for(int i = range.start; i < range.end && !m_failed->load(); i++) {
+            size_t offset = (size_t)i * m_block_bytes;
+            size_t bytes = std::min(m_block_bytes, m_size - offset);
+            if(!deflate_block(m_data + offset, bytes, m_level, m_members[i])) {
+                m_failed->store(true);
+            }
+        }
+    }
+
+private:
+    const char *m_data;
+    size_t m_size;
+    size_t m_block_bytes;
+    int m_level;
+    std::vector<std::string> &m_members;
+    std::atomic<bool> *m_failed;
+};
+
+
+#pragma mark -
+#pragma mark Block gzip
+/* ************************************************************************* */
+/*!
+ * @brief Walks the member headers of block gzip data and builds the index.
+ *
+ * @return (bool)
+ */
+bool gzip_block_index(const char *data, size_t size, std::vector<gzip_block_t> &blocks)
+{
+    blocks.clear();
+
+    size_t pos = 0;
+    size_t raw_offset = 0;
+    while(pos < size) {
+
+        const unsigned char *p = (const unsigned char *)data + pos;
+        if(size - pos < QUINE_GZIP_BLOCK_HEADER_BYTES + QUINE_GZIP_BLOCK_TRAILER_BYTES) {
+            return false;
+        }
+
+        // gzip magic, deflate, FEXTRA only, one 'QB' subfield of 8 bytes
+        if(p[0] != 0x1f || p[1] != 0x8b || p[2] != Z_DEFLATED || p[3] != 0x04 ||
+           read_le16(p + 10) != 12 || p[12] != 'Q' || p[13] != 'B' || read_le16(p + 14) != 8) {
+            return false;
+        }
+
+        gzip_block_t block;
+        block.offset = pos;
+        block.bytes = read_le32(p + 16);
+        block.raw_offset = raw_offset;
+        block.raw_bytes = read_le32(p + 20);
+
+        if(block.bytes < QUINE_GZIP_BLOCK_HEADER_BYTES + QUINE_GZIP_BLOCK_TRAILER_BYTES ||
+           block.bytes > size - pos ||
+           read_le32(p + block.bytes - 4) != (uint32_t)block.raw_bytes) {
+            return false;
+        }
+
+        blocks.push_back(block);
+        pos += block.bytes;
+        raw_offset += block.raw_bytes;
+    }
+
+    return !blocks.empty();
+}
+
+
+size_t gzip_block_raw_size(const std::vector<gzip_block_t> &blocks)
+{
+    if(blocks.empty()) {
+        return 0;
+    }
+    return blocks.back().raw_offset + blocks.back().raw_bytes;
+}
+
+
+size_t gzip_block_peek(const char *data, const gzip_block_t &block, char *out, size_t out_bytes)
+{
+    return inflate_block(data, block, out, std::min(out_bytes, block.raw_bytes));
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Inflates every block, in parallel, straight into its final place in out.
+ *
+ * @return (bool)
+ */
+bool gzip_inflate_blocks(const char *data, const std::vector<gzip_block_t> &blocks, char *out)
+{
+    std::atomic<bool> failed(false);
+    cv::parallel_for_(cv::Range(0, (int)blocks.size()), GzipInflateBody(data, blocks, out, &failed));
+    return !failed.load();
+}
+
+
+#pragma mark -
+#pragma mark GZip decompression
+/* ************************************************************************* */
+/*!
+ * @brief Streams a gzip file through gzread() into a string.
+ *
+ * @param size_hint (size_t)
+ *        Expected inflated size. The string is sized to this up front
+ *        and only grown (geometrically) if the hint was too small.
+ *
+ * @return (bool)
+ */
+static bool gzip_uncompress_stream(const std::string &compressed_file_path,
+                                   std::string &out,
+                                   size_t size_hint)
+{
+    gzFile infile = (gzFile)gzopen(compressed_file_path.c_str(), "rb");
+    if(!infile) {
+        return false;
+    }
+
+    // One byte of slack so the final read hits EOF without growing the string
+    out.resize(std::max<size_t>(size_hint + 1, 1024*16));
+
+    size_t used = 0;
+    int len = 0;
+    while(true) {
+        if(used == out.size()) {
+            out.resize(out.size() * 2);
+        }
+
+        unsigned chunk = (unsigned)std::min<size_t>(out.size() - used, INT_MAX);
+        len = gzread(infile, &out[used], chunk);
+        if(len <= 0) {
+            break;
+        }
+        used += len;
+    }
+    gzclose(infile);
+
+    out.resize(used);
+    return len == 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Decompresses a Quine database file to a std::string.
+ *
+ * @param compressed_file_path (std::string)
+ *        Full path to the gzipped binary database.
+ *
+ * @param out (std::string)
+ *        Receives the decompressed data.
+ *
+ * @return (bool)
+ */
+bool gzip_uncompress(const std::string &compressed_file_path, std::string &out)
+{
+    out.clear();
+
+    // Map the compressed file rather than reading it; it is only needed
+    //   for as long as the inflate takes.
+    QuineMappedFile compressed;
+    if(!compressed.open(compressed_file_path)) {
+        return false;
+    }
+
+    std::vector<gzip_block_t> blocks;
+    if(gzip_block_index(compressed.data(), compressed.size(), blocks)) {
+        compressed.advise(0, compressed.size(), MADV_WILLNEED);
+
+        out.resize(gzip_block_raw_size(blocks));
+        if(!out.empty() && !gzip_inflate_blocks(compressed.data(), blocks, &out[0])) {
+            out.clear();
+            return false;
+        }
+        return true;
+    }
+
+    // Not block gzip. For a single member gzip file the last four bytes hold
+    //   the inflated size (mod 2^32), which is a good enough hint.
+    size_t size_hint = 0;
+    const unsigned char *p = (const unsigned char *)compressed.data();
+    if(compressed.size() > 18 && p[0] == 0x1f && p[1] == 0x8b) {
+        size_hint = read_le32(p + compressed.size() - 4);
+    }
+    else {
+        size_hint = compressed.size();
+    }
+    compressed.close();
+
+    return gzip_uncompress_stream(compressed_file_path, out, size_hint);
+}
+
+
+#pragma mark -
+#pragma mark GZip compression
+/* ************************************************************************* */
+/*!
+ * @brief Compresses a buffer as block gzip, deflating the blocks in parallel.
+ *
+ * @return (bool)
+ */
+bool gzip_compress_blocks(const char *data,
+                          size_t size,
+                          std::string &out,
+                          int level,
+                          size_t block_bytes)
+{
+    out.clear();
+
+    // Blocks have to fit the 32 bit lengths in the member header
+    block_bytes = std::max<size_t>(1, std::min<size_t>(block_bytes, 64*1024*1024));
+
+    // An empty input still produces one (empty) member so the file is valid gzip
+    size_t count = std::max<size_t>(1, (size + block_bytes - 1) / block_bytes);
+    std::vector<std::string> members(count);
+
+    std::atomic<bool> failed(false);
+    cv::parallel_for_(cv::Range(0, (int)count),
+                      GzipDeflateBody(data, size, block_bytes, level, members, &failed));
+    if(failed.load()) {
+        return false;
+    }
+
+    size_t total = 0;
+    for(size_t i = 0; i < count; i++) {
+        total += members[i].size();
+    }
+
+    out.reserve(total);
+    for(size_t i = 0; i < count; i++) {
+        out.append(members[i]);
+        std::string().swap(members[i]);
+    }
+
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief cv::parallel_for_ body reading and deflating the blocks of one
+ *        round of a streamed compression.
+ */
+class GzipStreamBody : public cv::ParallelLoopBody {
+public:
+    GzipStreamBody(const gzip_block_reader_t &read,
+                   size_t size,
+                   size_t first_block,
+                   int level,
+                   std::vector<std::string> &raw,
+                   std::vector<std::string> &members,
+                   std::atomic<bool> *failed)
+    : m_read(read), m_size(size), m_first_block(first_block), m_level(level), m_raw(raw),
+      m_members(members), m_failed(failed) { }
+
+    void operator()(const cv::Range &range) const {
+        for(int i = range.start; i < range.end && !m_failed->load(); i++) {
+            size_t offset = (m_first_block + i) * (size_t)QUINE_GZIP_BLOCK_BYTES;
+            size_t bytes = std::min((size_t)QUINE_GZIP_BLOCK_BYTES, m_size - offset);
+            m_raw[i].resize(bytes);
+            if(bytes > 0) {
+                m_read(offset, bytes, &m_raw[i][0]);
+            }
+            if(!deflate_block(m_raw[i].data(), bytes, m_level, m_members[i])) {
+                m_failed->store(true);
+            }
+        }
+    }
+
+private:
+    const gzip_block_reader_t &m_read;
+    size_t m_size;
+    size_t m_first_block;
+    int m_level;
+    std::vector<std::string> &m_raw;
+    std::vector<std::string> &m_members;
+    std::atomic<bool> *m_failed;
+};
+
+
+bool gzip_compress_stream(size_t size,
+                          const gzip_block_reader_t &read,
+                          const std::string &compressed_file_path,
+                          int level)
+{
+    std::string tmp_path = compressed_file_path + ".tmp";
+    FILE *outfile = fopen(tmp_path.c_str(), "wb");
+    if(!outfile) {
+        return false;
+    }
+
+    // An empty input still produces one (empty) member so the file is valid gzip
+    size_t count = std::max<size_t>(1, (size + QUINE_GZIP_BLOCK_BYTES - 1) / QUINE_GZIP_BLOCK_BYTES);
+    size_t round = (size_t)std::max(1, cv::getNumThreads()) * QUINE_GZIP_STREAM_BLOCKS;
+    std::vector<std::string> raw(std::min(round, count)), members(std::min(round, count));
+
+    bool ok = true;
+    std::atomic<bool> failed(false);
+    for(size_t first = 0; ok && first < count; first += round) {
+        int blocks = (int)std::min(round, count - first);
+        cv::parallel_for_(cv::Range(0, blocks),
+                          GzipStreamBody(read, size, first, level, raw, members, &failed));
+        ok = !failed.load();
+
+        for(int i = 0; ok && i < blocks; i++) {
+            ok = fwrite(members[i].data(), 1, members[i].size(), outfile) == members[i].size();
+        }
+    }
+
+    ok = (fflush(outfile) == 0) && ok;
+    ok = (fsync(fileno(outfile)) == 0) && ok;
+    ok = (fclose(outfile) == 0) && ok;
+
+    if(!ok || rename(tmp_path.c_str(), compressed_file_path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+bool gzip_compress(const char *data,
+                   size_t size,
+                   const std::string &compressed_file_path,
+                   int level)
+{
+    return gzip_compress_stream(size, [data](size_t offset, size_t bytes, char *out) {
+        memcpy(out, data + offset, bytes);
+    }, compressed_file_path, level);
+}
+
+
+bool gzip_compress(const std::string &uncompressed_file_path,
+                   const std::string &compressed_file_path,
+                   int level)
+{
+    QuineMappedFile infile;
+    if(!infile.open(uncompressed_file_path)) {
+        return false;
+    }
+
+    infile.advise(0, infile.size(), MADV_SEQUENTIAL);
+    return gzip_compress(infile.data(), infile.size(), compressed_file_path, level);
+}
@@ -9,6 +9,9 @@
 #include <stdio.h>
 #include <cstdio>
 #include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
 #include <zlib.h>
 #include "zlib.h"
 
@@ -16,7 +19,173 @@
 #define Quine_QuineGzip_h
 
 
+/* ************************************************************************* */
+/*!
+ * @brief Block gzip layout.
+ *
+ *        A block gzip file is a series of ordinary gzip members, each holding
+ *        an independently deflated chunk of the data. Every member carries a
+ *        'QB' extra subfield with its own compressed length and its inflated
+ *        length, which makes the member headers a chained index: the file can
+ *        be walked without inflating anything, every chunk's final position is
+ *        known up front, and the chunks can be inflated in parallel.
+ *
+ *        Since the members are plain gzip, gzread() (and gunzip) still read
+ *        the file as one stream.
+ *
+ *        Member header (24 bytes):
+ *          1f 8b 08 04 | mtime(4) | xfl | os | xlen=12(2)
+ *          'Q' 'B' | len=8(2) | member_bytes(4) | raw_bytes(4)
+ *        followed by the raw deflate data and the usual crc32 / isize trailer.
+ */
+#define QUINE_GZIP_BLOCK_HEADER_BYTES   24
+#define QUINE_GZIP_BLOCK_TRAILER_BYTES  8
+#define QUINE_GZIP_BLOCK_BYTES          (256*1024)
 
+// Blocks a streamed compression holds at once, per thread
+#define QUINE_GZIP_STREAM_BLOCKS        4
+
+
+typedef struct gzip_block {
+
+    /*!
+     * Offset and length of the gzip member in the compressed data
+     */
+    size_t offset;
+    size_t bytes;
+
+    /*!
+     * Offset and length of the inflated chunk in the output
+     */
+    size_t raw_offset;
+    size_t raw_bytes;
+
+} gzip_block_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Walks the member headers of block gzip data and builds the index.
+ *
+ * @return (bool) false if the data is not (entirely) block gzip, in which
+ *         case it has to be streamed through gzread().
+ */
+bool gzip_block_index(const char *data, size_t size, std::vector<gzip_block_t> &blocks);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Total inflated size of an indexed block gzip file.
+ *
+ * @return (size_t)
+ */
+size_t gzip_block_raw_size(const std::vector<gzip_block_t> &blocks);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Inflates the first bytes of a block, e.g. to sniff the payload format.
+ *
+ * @return (size_t) number of bytes written to out
+ */
+size_t gzip_block_peek(const char *data, const gzip_block_t &block, char *out, size_t out_bytes);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Inflates every block, in parallel, straight into its final place in out.
+ *
+ * @param out (char*)
+ *        Destination buffer of gzip_block_raw_size(blocks) bytes.
+ *
+ * @return (bool) false if any block is corrupt (bad deflate data or crc)
+ */
+bool gzip_inflate_blocks(const char *data, const std::vector<gzip_block_t> &blocks, char *out);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Decompresses a gzipped file into a string.
+ *
+ *        Block gzip files are inflated in parallel into a string sized once.
+ *        Any other gzip (or uncompressed) file is streamed through gzread(),
+ *        using the isize trailer to size the string up front.
+ *
+ * @return (bool) false if the file could not be read
+ */
+bool gzip_uncompress(const std::string &compressed_file_path, std::string &out);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Compresses a buffer as block gzip.
+ *
+ *        The buffer is split into block_bytes chunks that are deflated in
+ *        parallel (pigz style). Unlike pigz, a block does not prime its
+ *        dictionary with the tail of the previous one, so that every block
+ *        can also be inflated on its own. The cost is a slightly lower ratio.
+ *
+ * @param level (int)
+ *        zlib compression level, e.g. Z_DEFAULT_COMPRESSION
+ *
+ * @return (bool)
+ */
+bool gzip_compress_blocks(const char *data,
+                          size_t size,
+                          std::string &out,
+                          int level = Z_DEFAULT_COMPRESSION,
+                          size_t block_bytes = QUINE_GZIP_BLOCK_BYTES);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Fills out with bytes [offset, offset + bytes) of the data a
+ *        streamed compression writes. Called from several threads at once,
+ *        for distinct ranges.
+ */
+typedef std::function<void(size_t offset, size_t bytes, char *out)> gzip_block_reader_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes size bytes, read block by block, to a block gzip file.
+ *
+ *        Blocks are read and deflated in parallel, a few per thread at a
+ *        time, and written out before the next ones are read, so the data
+ *        never has to be in one buffer and memory stays at a few blocks per
+ *        thread whatever its size. The file is written next to the
+ *        destination and renamed into place.
+ *
+ * @return (bool)
+ */
+bool gzip_compress_stream(size_t size,
+                          const gzip_block_reader_t &read,
+                          const std::string &compressed_file_path,
+                          int level = Z_DEFAULT_COMPRESSION);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Compresses a buffer as block gzip and writes it to a file.
+ *        The file is written next to the destination and renamed into place.
+ *
+ * @return (bool)
+ */
+bool gzip_compress(const char *data,
+                   size_t size,
+                   const std::string &compressed_file_path,
+                   int level = Z_DEFAULT_COMPRESSION);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Compresses a file as block gzip.
+ *
+ * @return (bool)
+ */
+bool gzip_compress(const std::string &uncompressed_file_path,
+                   const std::string &compressed_file_path,
+                   int level = Z_DEFAULT_COMPRESSION);
 
 
 #endif
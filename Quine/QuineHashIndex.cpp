@@ -0,0 +1,178 @@
+//
+//  QuineHashIndex.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineHashIndex.h"
+
+
+// Initial number of entries (a power of 2)
+#define QUINE_HASH_INDEX_MIN_CAPACITY 64
+
+
+QuineHashIndex::QuineHashIndex()
+: m_table(QUINE_HASH_INDEX_MIN_CAPACITY), m_count(0)
+{
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief 64-bit FNV-1a of the hash string. 0 is reserved for empty entries.
+ *
+ * @return (uint64_t)
+ */
+uint64_t QuineHashIndex::fingerprint(const char *hash, size_t length)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)hash[i];
+        h *= 1099511628211ULL;
+    }
+    return h == 0 ? 1 : h;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Entry holding key, or the empty entry where it would go.
+ *
+ * @return (size_t)
+ */
+size_t QuineHashIndex::probe(uint64_t key) const
+{
+    size_t mask = m_table.size() - 1;
+    size_t i = (size_t)(key ^ (key >> 32)) & mask;
+    while(m_table[i].key != 0 && m_table[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Doubles the table and reinserts every entry.
+ *
+ * @return (void)
+ */
+void QuineHashIndex::grow()
+{
+    std::vector<entry_t> old;
+    old.swap(m_table);
+    m_table.assign(old.size() * 2, entry_t());
+
+    for(size_t i = 0; i < old.size(); i++) {
+        if(old[i].key != 0) {
+            m_table[probe(old[i].key)] = old[i];
+        }
+    }
+}
+
+
+void QuineHashIndex::build(const std::vector<std::string> &hashes, const std::vector<bool> &tombstones)
+{
+    size_t capacity = QUINE_HASH_INDEX_MIN_CAPACITY;
+    while(capacity * 7 < hashes.size() * 10) {
+        capacity *= 2;
+    }
+    m_table.assign(capacity, entry_t());
+    m_count = 0;
+
+    for(size_t i = 0; i < hashes.size(); i++) {
+        if(i < tombstones.size() && tombstones[i]) {
+            continue;
+        }
+        insert(hashes[i], (uint32_t)i);
+    }
+}
+
+
+void QuineHashIndex::insert(const std::string &hash, uint32_t slot)
+{
+    insert(hash.data(), hash.size(), slot);
+}
+
+
+void QuineHashIndex::insert(const char *hash, size_t length, uint32_t slot)
+{
+    if(length == 0) {
+        return;
+    }
+
+    // Keep the load factor under 0.7 so probe runs stay short
+    if((m_count + 1) * 10 > m_table.size() * 7) {
+        grow();
+    }
+
+    uint64_t key = fingerprint(hash, length);
+    entry_t &e = m_table[probe(key)];
+    if(e.key == 0) {
+        m_count++;
+    }
+    e.key = key;
+    e.slot = slot;
+}
+
+
+bool QuineHashIndex::find(const std::string &hash, uint32_t &slot) const
+{
+    return find(hash.data(), hash.size(), slot);
+}
+
+
+bool QuineHashIndex::find(const char *hash, size_t length, uint32_t &slot) const
+{
+    if(length == 0) {
+        return false;
+    }
+
+    const entry_t &e = m_table[probe(fingerprint(hash, length))];
+    if(e.key == 0) {
+        return false;
+    }
+    slot = e.slot;
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Removes a hash, then shifts back the entries of the probe run after
+ *        it that would no longer be reachable across the hole.
+ *
+ * @return (void)
+ */
+void QuineHashIndex::erase(const std::string &hash)
+{
+    if(hash.empty()) {
+        return;
+    }
+
+    size_t mask = m_table.size() - 1;
+    size_t hole = probe(fingerprint(hash.data(), hash.size()));
+    if(m_table[hole].key == 0) {
+        return;
+    }
+
+    m_table[hole] = entry_t();
+    m_count--;
+
+    size_t i = (hole + 1) & mask;
+    while(m_table[i].key != 0) {
+        uint64_t key = m_table[i].key;
+        size_t home = (size_t)(key ^ (key >> 32)) & mask;
+
+        // Move the entry into the hole unless its home lies in (hole, i]
+        bool reachable = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if(!reachable) {
+            m_table[hole] = m_table[i];
+            m_table[i] = entry_t();
+            hole = i;
+        }
+        i = (i + 1) & mask;
+    }
+}
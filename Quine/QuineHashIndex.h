@@ -0,0 +1,99 @@
+//
+//  QuineHashIndex.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineHashIndex__
+#define __Quine__QuineHashIndex__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineHashIndex
+ *
+ *  @abstract   Content hash to image slot index of one database.
+ *
+ *  @discussion An open addressing table with linear probing. Entries are a
+ *              64-bit fingerprint of the hash string and the image slot, so
+ *              the table is a flat array of 16-byte entries with no per-entry
+ *              allocation, and a lookup usually touches one cache line.
+ *              Removal shifts the following entries back instead of leaving
+ *              deleted markers, so probe chains never degrade.
+ *
+ *              The table is rebuilt from the database's hash list on load;
+ *              the hash list itself is what is persisted.
+ */
+class QuineHashIndex {
+public:
+
+    QuineHashIndex();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Rebuilds the index from the hash of every image slot.
+     *        Empty hashes and dead slots are left out.
+     *
+     * @return (void)
+     */
+    void build(const std::vector<std::string> &hashes, const std::vector<bool> &tombstones);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Maps a hash to an image slot, replacing any previous slot.
+     *
+     * @return (void)
+     */
+    void insert(const std::string &hash, uint32_t slot);
+    void insert(const char *hash, size_t length, uint32_t slot);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Looks up the image slot of a hash.
+     *
+     * @return (bool) false if the hash is not in the index
+     */
+    bool find(const std::string &hash, uint32_t &slot) const;
+    bool find(const char *hash, size_t length, uint32_t &slot) const;
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Removes a hash from the index.
+     *
+     * @return (void)
+     */
+    void erase(const std::string &hash);
+
+
+    size_t size() const { return m_count; }
+
+    size_t bytes() const { return m_table.capacity() * sizeof(entry_t); }
+
+private:
+
+    typedef struct entry {
+        uint64_t key;       // fingerprint, 0 marks an empty entry
+        uint32_t slot;
+        uint32_t reserved;
+    } entry_t;
+
+    static uint64_t fingerprint(const char *hash, size_t length);
+    size_t probe(uint64_t key) const;
+    void grow();
+
+    std::vector<entry_t> m_table;
+    size_t m_count;
+};
+
+
+#endif /* defined(__Quine__QuineHashIndex__) */
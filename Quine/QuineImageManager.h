@@ -76,6 +76,21 @@ typedef void (^SyncProgressBlock)(QuineImageManager *, CGFloat);
 -(id)initWithKey:(NSString *)key;
 
 
+/* ************************************************************************* */
+/*!
+ *  @brief Initializes the QuineImageManager against another API endpoint
+ *
+ *  The endpoint may be a file:// URL of a directory laid out like the API
+ *  (api/reachable/connected, api/database/connect, and the database and
+ *  delta files the latter lists), which serves as a local stand-in server.
+ *
+ *  @param key          User identifier key. See http://quinevision.com/me.
+ *  @param endpoint     Base URL of the API, without a trailing slash.
+ *  @return             void
+ */
+-(id)initWithKey:(NSString *)key endpoint:(NSString *)endpoint;
+
+
 /* ************************************************************************* */
 /*!
  *  @brief Connects to the server and syncs the users databases.
@@ -86,7 +101,9 @@ typedef void (^SyncProgressBlock)(QuineImageManager *, CGFloat);
  *
  *  1. Connect to the server and retrieve a list of endpoints (databases) to download.
  *
- *  2. Download and overwrite the current databases with the newly downloaded ones.
+ *  2. Bring each database up to the server's version. If the server lists a delta
+ *     from the local version, only the delta is downloaded and it is applied in
+ *     place; otherwise the whole database is downloaded and overwrites the local one.
  *
  *  @return     void
  */
@@ -167,6 +184,37 @@ typedef void (^SyncProgressBlock)(QuineImageManager *, CGFloat);
    withMetadata:(NSString *)metadata;
 
 
+/* ************************************************************************* */
+/*!
+ *  @brief Removes a local image from a database.
+ *
+ *  The image is marked as deleted and is no longer matched. The database
+ *  is neither rewritten nor reloaded; the space is reclaimed when the
+ *  database is next compacted.
+ *
+ *  @param metadata     Metadata the image was added with.
+ *  @param databaseName Name of the database holding the image.
+ *  @return             YES if the image was removed
+ */
+-(BOOL)removeImageWithMetadata:(NSString *)metadata
+                  fromDatabase:(NSString *)databaseName;
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Replaces a local image in a database.
+ *
+ *  @param metadata     Metadata the replaced image was added with.
+ *                      The new image is stored with the same metadata.
+ *  @param image        New image.
+ *  @param databaseName Name of the database holding the image.
+ *  @return             YES if the image was replaced
+ */
+-(BOOL)replaceImageWithMetadata:(NSString *)metadata
+                      withImage:(UIImage *)image
+                     inDatabase:(NSString *)databaseName;
+
+
 /* ************************************************************************* */
 /*!
  *  @brief Sets the verbosity for the current class.
@@ -66,11 +66,21 @@ NSString *const kApiEndpoint = @"https://quine-api.azurewebsites.net";
     BOOL _verbose;
     BOOL _reachable;
     NSString *_key;
+    NSString *_endpoint;
 }
 
 // Objectove-C methods
 - (NSString *)imageHash:(UIImage *)image;
 - (BOOL)isApiReachable;
+- (void)downloadDatabase:(NSString *)databaseName
+                 fromURL:(NSString *)url
+                 version:(uint64_t)version
+                   queue:(NSOperationQueue *)queue;
+- (void)downloadDelta:(NSString *)deltaUrl
+          forDatabase:(NSString *)databaseName
+              fromURL:(NSString *)url
+              version:(uint64_t)version
+                queue:(NSOperationQueue *)queue;
 
 // C-methods
 void createMatFromUIImage(const UIImage* image, cv::Mat& m, bool alphaExist);
@@ -91,9 +101,15 @@ void createMatFromUIImage(const UIImage* image, cv::Mat& m, bool alphaExist);
  *  @return self
  */
 -(id)initWithKey:(NSString *)key {
+    return [self initWithKey:key endpoint:kApiEndpoint];
+}
+
+
+-(id)initWithKey:(NSString *)key endpoint:(NSString *)endpoint {
     self = [super init];
     if(self) {
         _key = key;
+        _endpoint = endpoint;
         _reachable = [self isApiReachable];
     }
     return self;
@@ -125,8 +141,9 @@ void createMatFromUIImage(const UIImage* image, cv::Mat& m, bool alphaExist);
  *        (1) Connect to the server and retrieve a list
  *        of endpoints (databases) to download.
  *
- *        (2) Download and overwrite the current databases
- *        with the newly downloaded ones.
+ *        (2) Bring each database up to the server's version: apply
+ *        the delta from the local version when the server has one,
+ *        otherwise download and overwrite the whole database.
  *
  * @return (void)
  */
@@ -167,7 +184,7 @@ void createMatFromUIImage(const UIImage* image, cv::Mat& m, bool alphaExist);
     // Call the syncing endpoint
     //   Should this be quinevision.com?
 
-    NSString *syncEndpoint = [NSString stringWithFormat:@"%@/api/database/connect", kApiEndpoint];
+    NSString *syncEndpoint = [NSString stringWithFormat:@"%@/api/database/connect", _endpoint];
     if(_verbose) {
         NSLog(@"[Syncing STARTING]: %@", syncEndpoint);
     }
@@ -204,53 +221,153 @@ void createMatFromUIImage(const UIImage* image, cv::Mat& m, bool alphaExist);
                                    // {
                                    //    md5: ""
                                    //    url: ""
+                                   //    version: 12                      (optional)
+                                   //    deltas: { "11": "<url>", ... }   (optional, keyed by base version)
                                    // }
-                                   NSURLRequest *req = [NSURLRequest requestWithURL:[NSURL URLWithString:[[JSON objectForKey:key] objectForKey:@"url"]]];
-                                   if(_verbose) {
-                                       NSLog(@"[Syncing STARTED]: %@", key);
+                                   NSDictionary *entry = [JSON objectForKey:key];
+                                   NSString *databaseName = [key lastPathComponent];
+                                   NSString *databasePath = [QuineImageManager getDatabasePathForDatabase:databaseName withExt:@""];
+                                   NSString *url = [entry objectForKey:@"url"];
+                                   uint64_t version = [[entry objectForKey:@"version"] unsignedLongLongValue];
+                                   
+                                   QuineDatabaseOperations database_op = QuineDatabaseOperations();
+                                   uint64_t localVersion = database_op.get_database_version([databasePath cStringUsingEncoding: NSASCIIStringEncoding]);
+                                   BOOL exists = [[NSFileManager defaultManager] fileExistsAtPath:databasePath];
+                                   
+                                   // Unversioned databases are always downloaded in full, as before
+                                   if(version > 0 && exists && localVersion == version) {
+                                       if(_verbose) {
+                                           NSLog(@"[Syncing UP TO DATE]: %@ (version %llu)", key, version);
+                                       }
+                                       if (self.syncCompletetionBlock) {
+                                           self.syncCompletetionBlock(self, nil);
+                                       }
+                                       continue;
+                                   }
+                                   
+                                   NSString *deltaUrl = [[entry objectForKey:@"deltas"] objectForKey:[NSString stringWithFormat:@"%llu", localVersion]];
+                                   if(version > 0 && exists && deltaUrl) {
+                                       if(_verbose) {
+                                           NSLog(@"[Syncing STARTED]: %@ (delta %llu -> %llu)", key, localVersion, version);
+                                       }
+                                       [self downloadDelta:deltaUrl forDatabase:databaseName fromURL:url version:version queue:queue];
+                                   }
+                                   else {
+                                       if(_verbose) {
+                                           NSLog(@"[Syncing STARTED]: %@", key);
+                                       }
+                                       [self downloadDatabase:databaseName fromURL:url version:version queue:queue];
                                    }
-                                   [NSURLConnection sendAsynchronousRequest:req
-                                                                      queue:queue
-                                                          completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
-
-                                                              NSString *downloadedDatabaseName = [[[response URL] path] lastPathComponent];
-                                                              
-                                                              if(!error) {
-                                                                  
-                                                                  NSError *writeError = nil;
-                                                                  //Save the GZipped compressed file
-                                                                  NSString *compressedFilenamePath = [QuineImageManager getDatabasePathForDatabase:downloadedDatabaseName withExt:@""];
-                                                                  [data writeToFile:compressedFilenamePath options:NSDataWritingAtomic error:&writeError];
-                                                                  
-                                                                  if(writeError) {
-                                                                      if(_verbose) {
-                                                                          NSLog(@"[Syncing ERROR]: %@\n", [writeError description]);
-                                                                      }
-                                                                  }
-                                                                  else {
-                                                                      if(_verbose) {
-                                                                          NSLog(@"[Syncing COMPLETE]\n");
-                                                                      }
-                                                                  }
-                                                              }
-                                                              else {
-                                                                  if(_verbose) {
-                                                                      NSLog(@"[Syncing ERROR]: %@\n", [error description]);
-                                                                  }
-                                                              }
-                                                              
-                                                              // Call the completion block
-                                                              if (self.syncCompletetionBlock) {
-                                                                  self.syncCompletetionBlock(self, error);
-                                                              }
-                                                              
-                                                          }];
                                 }
 
                            }];
 }
 
 
+/* ************************************************************************* */
+/*!
+ * @brief Downloads a whole database and installs it in place of the
+ *        local copy, at the given version.
+ *
+ * @return (void)
+ */
+-(void)downloadDatabase:(NSString *)databaseName
+                fromURL:(NSString *)url
+                version:(uint64_t)version
+                  queue:(NSOperationQueue *)queue {
+    
+    NSURLRequest *req = [NSURLRequest requestWithURL:[NSURL URLWithString:url]];
+    [NSURLConnection sendAsynchronousRequest:req
+                                       queue:queue
+                           completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
+                               
+                               if(!error) {
+                                   
+                                   // Save the GZipped compressed file next to the database, then swap it in
+                                   NSString *databasePath = [QuineImageManager getDatabasePathForDatabase:databaseName withExt:@""];
+                                   NSString *downloadPath = [databasePath stringByAppendingString:@".download"];
+                                   NSError *writeError = nil;
+                                   [data writeToFile:downloadPath options:NSDataWritingAtomic error:&writeError];
+                                   
+                                   QuineDatabaseOperations database_op = QuineDatabaseOperations();
+                                   if(writeError) {
+                                       error = writeError;
+                                   }
+                                   else if(!database_op.install_database([downloadPath cStringUsingEncoding: NSASCIIStringEncoding],
+                                                                         [databasePath cStringUsingEncoding: NSASCIIStringEncoding],
+                                                                         version)) {
+                                       NSDictionary *userInfo = @{
+                                                                  NSLocalizedDescriptionKey: NSLocalizedString(@"Database could not be installed.", nil)
+                                                                  };
+                                       error = [NSError errorWithDomain:@"com.quinevision" code:101 userInfo:userInfo];
+                                   }
+                               }
+                               
+                               if(_verbose) {
+                                   if(error) {
+                                       NSLog(@"[Syncing ERROR]: %@\n", [error description]);
+                                   }
+                                   else {
+                                       NSLog(@"[Syncing COMPLETE]: %@ (%lu bytes)\n", databaseName, (unsigned long)[data length]);
+                                   }
+                               }
+                               
+                               // Call the completion block
+                               if (self.syncCompletetionBlock) {
+                                   self.syncCompletetionBlock(self, error);
+                               }
+                           }];
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Downloads the delta from the local version of a database and
+ *        applies it in place. Falls back to downloading the whole database
+ *        if the delta can't be fetched or applied.
+ *
+ * @return (void)
+ */
+-(void)downloadDelta:(NSString *)deltaUrl
+         forDatabase:(NSString *)databaseName
+             fromURL:(NSString *)url
+             version:(uint64_t)version
+               queue:(NSOperationQueue *)queue {
+    
+    NSURLRequest *req = [NSURLRequest requestWithURL:[NSURL URLWithString:deltaUrl]];
+    [NSURLConnection sendAsynchronousRequest:req
+                                       queue:queue
+                           completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
+                               
+                               NSString *databasePath = [QuineImageManager getDatabasePathForDatabase:databaseName withExt:@""];
+                               NSString *deltaPath = [databasePath stringByAppendingString:@".delta"];
+                               
+                               BOOL applied = NO;
+                               if(!error && [data writeToFile:deltaPath options:NSDataWritingAtomic error:nil]) {
+                                   QuineDatabaseOperations database_op = QuineDatabaseOperations();
+                                   applied = database_op.apply_delta([deltaPath cStringUsingEncoding: NSASCIIStringEncoding],
+                                                                     [databasePath cStringUsingEncoding: NSASCIIStringEncoding]);
+                                   [[NSFileManager defaultManager] removeItemAtPath:deltaPath error:nil];
+                               }
+                               
+                               if(!applied) {
+                                   if(_verbose) {
+                                       NSLog(@"[Syncing WARNING]: Delta for %@ failed, downloading the whole database\n", databaseName);
+                                   }
+                                   [self downloadDatabase:databaseName fromURL:url version:version queue:queue];
+                                   return;
+                               }
+                               
+                               if(_verbose) {
+                                   NSLog(@"[Syncing COMPLETE]: %@ (delta, %lu bytes)\n", databaseName, (unsigned long)[data length]);
+                               }
+                               if (self.syncCompletetionBlock) {
+                                   self.syncCompletetionBlock(self, nil);
+                               }
+                           }];
+}
+
+
 #pragma mark -
 #pragma mark Sync - Tracking methods
 /* ************************************************************************* */
@@ -267,7 +384,7 @@ void createMatFromUIImage(const UIImage* image, cv::Mat& m, bool alphaExist);
     NSOperationQueue *queue = [NSOperationQueue mainQueue];
     [queue setMaxConcurrentOperationCount:1];
     
-    NSString *syncEndpoint = [NSString stringWithFormat:@"%@/api/database/tracking/connect", kApiEndpoint];
+    NSString *syncEndpoint = [NSString stringWithFormat:@"%@/api/database/tracking/connect", _endpoint];
     if(_verbose) {
         NSLog(@"[Sync Tracking STARTING]: %@", syncEndpoint);
     }
@@ -392,6 +509,64 @@ void createMatFromUIImage(const UIImage* image, cv::Mat& m, bool alphaExist);
 }
 
 
+/* ************************************************************************* */
+/*!
+ *  @brief Removes a local image from a database.
+ *
+ *  @param metadata     Metadata the image was added with.
+ *  @param databaseName Name of the database holding the image.
+ *  @return BOOL
+ */
+-(BOOL)removeImageWithMetadata:(NSString *)metadata
+                  fromDatabase:(NSString *)databaseName {
+    
+    NSString *databasePath = [QuineImageManager getDatabasePathForDatabase:databaseName withExt:@"bin"];
+    QuineDatabaseOperations database_op = QuineDatabaseOperations();
+    
+    bool removed = database_op.delete_image([metadata cStringUsingEncoding: NSASCIIStringEncoding],
+                                            [databasePath cStringUsingEncoding: NSASCIIStringEncoding]);
+    
+    //Cleanup
+    database_op.~QuineDatabaseOperations();
+    return removed;
+}
+
+
+/* ************************************************************************* */
+/*!
+ *  @brief Replaces a local image in a database.
+ *
+ *  @param metadata     Metadata the replaced image was added with.
+ *  @param image        New image.
+ *  @param databaseName Name of the database holding the image.
+ *  @return BOOL
+ */
+-(BOOL)replaceImageWithMetadata:(NSString *)metadata
+                      withImage:(UIImage *)image
+                     inDatabase:(NSString *)databaseName {
+    
+    //Compute the hash of the image
+    NSString *hash = [self imageHash:image];
+    
+    // Convert the image from a UIImage to cv::Mat
+    cv::Mat mat;
+    createMatFromUIImage(image, mat, true);
+    
+    NSString *databasePath = [QuineImageManager getDatabasePathForDatabase:databaseName withExt:@"bin"];
+    QuineDatabaseOperations database_op = QuineDatabaseOperations();
+    
+    bool replaced = database_op.replace_image(mat,
+                                              [hash cStringUsingEncoding: NSASCIIStringEncoding],
+                                              [metadata cStringUsingEncoding: NSASCIIStringEncoding],
+                                              [databasePath cStringUsingEncoding: NSASCIIStringEncoding]);
+    
+    //Cleanup
+    mat.release();
+    database_op.~QuineDatabaseOperations();
+    return replaced;
+}
+
+
 #pragma mark -
 #pragma Private internal methods
 /* ************************************************************************* */
@@ -528,7 +703,7 @@ void createMatFromUIImage(const UIImage* image, cv::Mat& m, bool alphaExist) {
  */
 - (BOOL)isApiReachable {
     
-    NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"%@/api/reachable/connected", kApiEndpoint]];
+    NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"%@/api/reachable/connected", _endpoint]];
     NSData *data = [NSData dataWithContentsOfURL:url];
     NSString *str = [[NSString alloc] initWithData:data encoding:NSASCIIStringEncoding];
     if (str && [str isEqualToString:@"\"Reachable OK\""]) {
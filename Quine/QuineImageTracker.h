@@ -7,8 +7,67 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
 
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineImageTracker
+ *
+ *  @abstract   Follows a recognized image through the following frames.
+ *
+ *  @discussion Once an image is recognized, tracking its matched keypoints
+ *              with optical flow costs a few milliseconds a frame, instead
+ *              of describing every frame and matching it against the loaded
+ *              databases again. Recognize again when @c trackFrame: returns
+ *              NO. QuineCompare's pipeline does this by itself; this class
+ *              is for callers that handle frames on their own.
+ *
+ *              Frames are the resized grayscale frames keypoints were found
+ *              in, all of the same size.
+ */
 @interface QuineImageTracker : NSObject
 
 
+/* ************************************************************************* */
+/*!
+ *  @protected
+ *  @brief Starts tracking a recognized image.
+ *
+ *  @param frame (cv::Mat&) Grayscale frame the image was recognized in.
+ *  @param keypoints Keypoints of the frame that matched the image.
+ *
+ *  @returns (BOOL) NO if there are too few keypoints to track.
+ */
+-(BOOL)startWithFrame:(cv::Mat&)frame keypoints:(const std::vector<cv::KeyPoint>&)keypoints;
+
+
+/* ************************************************************************* */
+/*!
+ *  @protected
+ *  @brief Tracks the image into the next frame.
+ *
+ *  @returns (BOOL) NO once tracking is lost.
+ */
+-(BOOL)trackFrame:(cv::Mat&)frame;
+
+
+-(void)reset;
+
+
+/*!
+ *  YES between a successful start and losing the image
+ */
+@property (nonatomic, readonly) BOOL isTracking;
+
+/*!
+ *  Fraction [0:1] of the starting keypoints still tracked
+ */
+@property (nonatomic, readonly) CGFloat quality;
+
+/*!
+ *  Bounding box of the tracked keypoints, in frame coordinates
+ */
+@property (nonatomic, readonly) CGRect trackedRegion;
+
 @end
@@ -1,13 +0,0 @@
-//
-//  QuineImageTracker.m
-//  Quine
-//
-//  Created by Brett Spurrier  on 5/12/15.
-//  Copyright (c) 2015 Spurrier. All rights reserved.
-//
-
-#import "QuineImageTracker.h"
-
-@implementation QuineImageTracker
-
-@end
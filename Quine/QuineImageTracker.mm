@@ -0,0 +1,69 @@
+//
+//  QuineImageTracker.m
+//  Quine
+//
+//  Created by Brett Spurrier  on 5/12/15.
+//  Copyright (c) 2015 Spurrier. All rights reserved.
+//
+
+#import "QuineImageTracker.h"
+
+// C++ includes
+#include "QuineFeatureTracker.h"
+
+
+@interface QuineImageTracker () {
+    QuineFeatureTracker *_tracker;
+}
+@end
+
+
+@implementation QuineImageTracker
+
+-(id)init {
+    self = [super init];
+    if(self) {
+        _tracker = new QuineFeatureTracker();
+    }
+    return self;
+}
+
+
+-(void)dealloc {
+    delete _tracker;
+}
+
+
+-(BOOL)startWithFrame:(cv::Mat&)frame keypoints:(const std::vector<cv::KeyPoint>&)keypoints {
+    std::vector<cv::Point2f> points;
+    cv::KeyPoint::convert(keypoints, points);
+    return _tracker->start(frame, points);
+}
+
+
+-(BOOL)trackFrame:(cv::Mat&)frame {
+    return _tracker->track(frame);
+}
+
+
+-(void)reset {
+    _tracker->reset();
+}
+
+
+-(BOOL)isTracking {
+    return _tracker->is_tracking();
+}
+
+
+-(CGFloat)quality {
+    return _tracker->quality();
+}
+
+
+-(CGRect)trackedRegion {
+    cv::Rect region = _tracker->region();
+    return CGRectMake(region.x, region.y, region.width, region.height);
+}
+
+@end
@@ -0,0 +1,252 @@
+//
+//  QuineLatency.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineLatency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <mutex>
+
+
+#pragma mark -
+#pragma mark QuineLatencyHistogram
+QuineLatencyHistogram::QuineLatencyHistogram()
+{
+    reset();
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Bucket of a latency: the value itself below 2^(SUB_BITS+1), then
+ *        its SUB_BITS + 1 leading bits, offset by its magnitude.
+ *
+ * @return (int)
+ */
+int QuineLatencyHistogram::bucket(uint64_t us)
+{
+    const uint64_t sub_buckets = 1ULL << QUINE_LATENCY_SUB_BITS;
+    us = std::min(us, ((uint64_t)1 << QUINE_LATENCY_MAX_BITS) - 1);
+    if(us < 2 * sub_buckets) {
+        return (int)us;
+    }
+
+    int magnitude = 63 - __builtin_clzll(us);
+    int shift = magnitude - QUINE_LATENCY_SUB_BITS;
+    return (int)((uint64_t)shift * sub_buckets + (us >> shift));
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Middle of the range of latencies a bucket holds (us).
+ *
+ * @return (double)
+ */
+double QuineLatencyHistogram::bucket_value(int bucket)
+{
+    const int sub_buckets = 1 << QUINE_LATENCY_SUB_BITS;
+    if(bucket < 2 * sub_buckets) {
+        return bucket;
+    }
+
+    int shift = bucket / sub_buckets - 1;
+    uint64_t low = (uint64_t)(bucket % sub_buckets + sub_buckets) << shift;
+    return low + (((uint64_t)1 << shift) - 1) / 2.0;
+}
+
+
+void QuineLatencyHistogram::record_us(uint64_t us)
+{
+    m_counts[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+    m_total_us.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t max = m_max_us.load(std::memory_order_relaxed);
+    while(us > max && !m_max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) { }
+}
+
+
+void QuineLatencyHistogram::record_ticks(int64_t ticks)
+{
+    double us = 1e6 * (double)std::max((int64_t)0, ticks) / cv::getTickFrequency();
+    record_us((uint64_t)(us + 0.5));
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief The count is taken from the buckets themselves, so the percentiles
+ *        are consistent with it even while others record.
+ *
+ * @return (void)
+ */
+void QuineLatencyHistogram::summary(quine_latency_summary_t &summary) const
+{
+    uint64_t counts[QUINE_LATENCY_BUCKETS];
+    uint64_t count = 0;
+    for(int b = 0; b < QUINE_LATENCY_BUCKETS; b++) {
+        counts[b] = m_counts[b].load(std::memory_order_relaxed);
+        count += counts[b];
+    }
+
+    summary.count = count;
+    summary.mean_ms = summary.p50_ms = summary.p95_ms = summary.p99_ms = summary.max_ms = 0.0;
+    if(count == 0) {
+        return;
+    }
+
+    double max_us = (double)m_max_us.load(std::memory_order_relaxed);
+    summary.mean_ms = m_total_us.load(std::memory_order_relaxed) / 1000.0 / count;
+    summary.max_ms = max_us / 1000.0;
+
+    const double percentiles[3] = { 0.50, 0.95, 0.99 };
+    double *values[3] = { &summary.p50_ms, &summary.p95_ms, &summary.p99_ms };
+    uint64_t seen = 0;
+    int p = 0;
+    for(int b = 0; b < QUINE_LATENCY_BUCKETS && p < 3; b++) {
+        seen += counts[b];
+        while(p < 3 && seen >= (uint64_t)std::ceil(percentiles[p] * count)) {
+            *values[p] = std::min(bucket_value(b), max_us) / 1000.0;
+            p++;
+        }
+    }
+}
+
+
+void QuineLatencyHistogram::reset()
+{
+    for(int b = 0; b < QUINE_LATENCY_BUCKETS; b++) {
+        m_counts[b].store(0, std::memory_order_relaxed);
+    }
+    m_total_us.store(0, std::memory_order_relaxed);
+    m_max_us.store(0, std::memory_order_relaxed);
+}
+
+
+#pragma mark -
+#pragma mark QuineLatency
+QuineLatency* QuineLatency::instance()
+{
+    static QuineLatency *s_latency = NULL;
+    static std::once_flag once;
+    std::call_once(once, []() {
+        s_latency = new QuineLatency();
+    });
+    return s_latency;
+}
+
+
+QuineLatency::QuineLatency()
+: m_enabled(true)
+{
+    for(int d = 0; d < QUINE_LATENCY_DATABASES; d++) {
+        m_databases[d].key.store(0, std::memory_order_relaxed);
+        m_databases[d].named.store(false, std::memory_order_relaxed);
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Open addressing on the hash of the path. A free slot is claimed
+ *        with a compare-and-swap on its key; the name is only compared
+ *        once its writer has published it.
+ *
+ * @return (QuineLatencyHistogram &)
+ */
+QuineLatencyHistogram &QuineLatency::matching(const std::string &database_path)
+{
+    size_t key = std::max((size_t)1, std::hash<std::string>()(database_path));
+
+    for(int probe = 0; probe < QUINE_LATENCY_DATABASES; probe++) {
+        database_histogram_t &slot = m_databases[(key + probe) % QUINE_LATENCY_DATABASES];
+
+        size_t current = slot.key.load(std::memory_order_acquire);
+        if(current == 0) {
+            if(slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                slot.name = database_path;
+                slot.named.store(true, std::memory_order_release);
+                return slot.histogram;
+            }
+        }
+        if(current != key) {
+            continue;
+        }
+
+        // Claimed for this key by another thread, which is writing the name
+        if(!slot.named.load(std::memory_order_acquire) || slot.name == database_path) {
+            return slot.histogram;
+        }
+    }
+
+    return m_other_databases;
+}
+
+
+void QuineLatency::snapshot(std::vector<quine_latency_summary_t> &summaries) const
+{
+    summaries.clear();
+    for(int s = 0; s < QUINE_LATENCY_STAGES; s++) {
+        quine_latency_summary_t summary;
+        m_stages[s].summary(summary);
+        summary.name = stage_name((quine_latency_stage_t)s);
+        summaries.push_back(summary);
+    }
+
+    for(int d = 0; d < QUINE_LATENCY_DATABASES; d++) {
+        if(!m_databases[d].named.load(std::memory_order_acquire)) {
+            continue;
+        }
+        quine_latency_summary_t summary;
+        m_databases[d].histogram.summary(summary);
+        summary.name = std::string("matching:") + m_databases[d].name;
+        summaries.push_back(summary);
+    }
+
+    quine_latency_summary_t other;
+    m_other_databases.summary(other);
+    if(other.count > 0) {
+        other.name = "matching:*";
+        summaries.push_back(other);
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Empties every histogram. Databases keep their slots.
+ *
+ * @return (void)
+ */
+void QuineLatency::reset()
+{
+    for(int s = 0; s < QUINE_LATENCY_STAGES; s++) {
+        m_stages[s].reset();
+    }
+    for(int d = 0; d < QUINE_LATENCY_DATABASES; d++) {
+        m_databases[d].histogram.reset();
+    }
+    m_other_databases.reset();
+}
+
+
+const char *QuineLatency::stage_name(quine_latency_stage_t stage)
+{
+    switch(stage) {
+        case QUINE_LATENCY_PREPROCESS:  return "preprocess";
+        case QUINE_LATENCY_SCALE_SPACE: return "scale_space";
+        case QUINE_LATENCY_DETECTION:   return "detection";
+        case QUINE_LATENCY_DESCRIPTION: return "description";
+        case QUINE_LATENCY_MATCHING:    return "matching";
+        case QUINE_LATENCY_VOTE:        return "vote";
+        case QUINE_LATENCY_LOAD:        return "load";
+        case QUINE_LATENCY_SAVE:        return "save";
+        default:                        return "unknown";
+    }
+}
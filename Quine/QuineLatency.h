@@ -0,0 +1,202 @@
+//
+//  QuineLatency.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineLatency__
+#define __Quine__QuineLatency__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+// Sub-buckets per power of two (2^5): a recorded latency is off by at most
+//   1/32 (3%) of its value
+#define QUINE_LATENCY_SUB_BITS      5
+
+// Latencies are told apart up to 2^32 us (71 minutes); longer ones count as that
+#define QUINE_LATENCY_MAX_BITS      32
+
+#define QUINE_LATENCY_BUCKETS       ((QUINE_LATENCY_MAX_BITS - QUINE_LATENCY_SUB_BITS + 1) << QUINE_LATENCY_SUB_BITS)
+
+// Databases matching is timed for separately; matches against any further
+//   databases share one more histogram
+#define QUINE_LATENCY_DATABASES     32
+
+
+typedef enum {
+    QUINE_LATENCY_PREPROCESS = 0,   // resize and gray
+    QUINE_LATENCY_SCALE_SPACE,      // AKAZE nonlinear scale space
+    QUINE_LATENCY_DETECTION,        // AKAZE keypoints
+    QUINE_LATENCY_DESCRIPTION,      // AKAZE descriptors
+    QUINE_LATENCY_MATCHING,         // one database (every database's matches)
+    QUINE_LATENCY_VOTE,             // picking the image with the most votes
+    QUINE_LATENCY_LOAD,             // one database loaded, all its shards and log
+    QUINE_LATENCY_SAVE,             // one database or shard file written
+    QUINE_LATENCY_STAGES
+} quine_latency_stage_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Latency percentiles of a stage, from its histogram.
+ */
+typedef struct quine_latency_summary {
+
+    /*!
+     * Stage name, "matching:<database path>" for one database's matching
+     */
+    std::string name;
+
+    uint64_t count;
+    double mean_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+
+} quine_latency_summary_t;
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineLatencyHistogram
+ *
+ *  @abstract   Log-linear (HDR-style) histogram of latencies in microseconds.
+ *
+ *  @discussion Values below 2^(QUINE_LATENCY_SUB_BITS + 1) us have a bucket
+ *              each; above, every power of two is split into
+ *              2^QUINE_LATENCY_SUB_BITS buckets, so
+ *              the precision is relative rather than absolute and a
+ *              histogram covers microseconds to minutes in a few KB.
+ *
+ *              Recording is a couple of relaxed atomic adds, from any
+ *              number of threads at once, with no lock. A summary read
+ *              while others record may miss their latest values.
+ */
+class QuineLatencyHistogram {
+public:
+
+    QuineLatencyHistogram();
+
+    void record_us(uint64_t us);
+
+    /*!
+     * Records a cv::getTickCount() interval
+     */
+    void record_ticks(int64_t ticks);
+
+    void summary(quine_latency_summary_t &summary) const;
+
+    void reset();
+
+private:
+
+    static int bucket(uint64_t us);
+    static double bucket_value(int bucket);
+
+    std::atomic<uint64_t> m_counts[QUINE_LATENCY_BUCKETS];
+    std::atomic<uint64_t> m_total_us;
+    std::atomic<uint64_t> m_max_us;
+};
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineLatency
+ *
+ *  @abstract   Latency histograms of each stage of a query, process-wide.
+ *
+ *  @discussion Time a stage with a QuineLatencyTimer on its histogram.
+ *              Matching is kept per database as well as in total; a
+ *              database's histogram is found, or claimed, without a lock.
+ *              Recording can be turned off, which leaves the timers a
+ *              single flag test.
+ */
+class QuineLatency {
+public:
+
+    static QuineLatency* instance();
+
+    QuineLatencyHistogram &stage(quine_latency_stage_t stage) { return m_stages[stage]; }
+
+    /* ************************************************************************* */
+    /*!
+     * @brief The matching histogram of one database.
+     *
+     * @return (QuineLatencyHistogram &)
+     */
+    QuineLatencyHistogram &matching(const std::string &database_path);
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    void set_enabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+    /* ************************************************************************* */
+    /*!
+     * @brief p50, p95 and p99 of every stage, in quine_latency_stage_t
+     *        order, then of every database matched so far.
+     *
+     * @return (void)
+     */
+    void snapshot(std::vector<quine_latency_summary_t> &summaries) const;
+
+    void reset();
+
+    static const char *stage_name(quine_latency_stage_t stage);
+
+private:
+
+    QuineLatency();
+
+    typedef struct database_histogram {
+        std::atomic<size_t> key;        // hash of the path, 0 while the slot is free
+        std::atomic<bool> named;        // name written
+        std::string name;
+        QuineLatencyHistogram histogram;
+    } database_histogram_t;
+
+    std::atomic<bool> m_enabled;
+    QuineLatencyHistogram m_stages[QUINE_LATENCY_STAGES];
+    database_histogram_t m_databases[QUINE_LATENCY_DATABASES];
+    QuineLatencyHistogram m_other_databases;
+};
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineLatencyTimer
+ *
+ *  @abstract   Records the time from its construction to stop(), or to its
+ *              destruction, in a histogram.
+ */
+class QuineLatencyTimer {
+public:
+
+    explicit QuineLatencyTimer(QuineLatencyHistogram &histogram)
+    : m_histogram(QuineLatency::instance()->enabled() ? &histogram : NULL),
+      m_start(m_histogram ? cv::getTickCount() : 0) { }
+
+    ~QuineLatencyTimer() { stop(); }
+
+    void stop() {
+        if(m_histogram) {
+            m_histogram->record_ticks(cv::getTickCount() - m_start);
+            m_histogram = NULL;
+        }
+    }
+
+private:
+
+    QuineLatencyHistogram *m_histogram;
+    int64_t m_start;
+};
+
+
+#endif /* defined(__Quine__QuineLatency__) */
@@ -0,0 +1,632 @@
+//
+//  QuineMappedDatabase.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineMappedDatabase.h"
+#include "QuineGzip.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+
+#pragma mark -
+#pragma mark QuineMappedFile
+/* ************************************************************************* */
+/*!
+ * @brief Initializes an empty (unmapped) QuineMappedFile
+ *
+ * @return (QuineMappedFile)
+ */
+QuineMappedFile::QuineMappedFile() : m_addr(NULL), m_size(0), m_writable(false)
+{
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Unmaps the file
+ *
+ * @return (void)
+ */
+QuineMappedFile::~QuineMappedFile()
+{
+    close();
+}
+
+
+bool QuineMappedFile::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // The descriptor can be closed as soon as the mapping exists
+    void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if(addr == MAP_FAILED) {
+        return false;
+    }
+
+    m_addr = addr;
+    m_size = (size_t)st.st_size;
+    m_writable = false;
+    return true;
+}
+
+
+bool QuineMappedFile::allocate(size_t bytes)
+{
+    close();
+
+    if(bytes == 0) {
+        return false;
+    }
+
+    void *addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if(addr == MAP_FAILED) {
+        return false;
+    }
+
+    m_addr = addr;
+    m_size = bytes;
+    m_writable = true;
+    return true;
+}
+
+
+void QuineMappedFile::close()
+{
+    if(m_addr) {
+        munmap(m_addr, m_size);
+        m_addr = NULL;
+        m_size = 0;
+        m_writable = false;
+    }
+}
+
+
+void QuineMappedFile::advise(size_t offset, size_t bytes, int advice) const
+{
+    if(!m_addr || offset >= m_size) {
+        return;
+    }
+
+    // madvise() requires a page aligned start address
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = offset - (offset % page);
+    size_t end = std::min(offset + bytes, m_size);
+
+    madvise((char *)m_addr + begin, end - begin, advice);
+}
+
+
+#pragma mark -
+#pragma mark Raw database helpers
+/* ************************************************************************* */
+/*!
+ * @brief Looks up a section in a .qdb header
+ *
+ * @return (const quine_db_section_t*) NULL if the section is not present
+ *         or does not fit inside the file.
+ */
+static const quine_db_section_t* find_section(const quine_db_header_t *header,
+                                              uint32_t id,
+                                              size_t file_size)
+{
+    uint32_t count = std::min<uint32_t>(header->section_count, QUINE_DB_MAX_SECTIONS);
+    for(uint32_t i = 0; i < count; i++) {
+        const quine_db_section_t *section = &header->sections[i];
+        if(section->id == id) {
+            if(section->offset + section->bytes > file_size) {
+                return NULL;
+            }
+            return section;
+        }
+    }
+    return NULL;
+}
+
+
+static uint64_t align_offset(uint64_t offset)
+{
+    return (offset + QUINE_DB_ALIGNMENT - 1) & ~(uint64_t)(QUINE_DB_ALIGNMENT - 1);
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief String table sections (metadata, hashes):
+ *        uint32 count, uint32 offsets[count + 1], then the string bytes.
+ */
+static void build_string_table(const QuineStringTable &strings, std::vector<uint32_t> &table, uint64_t &bytes)
+{
+    table.clear();
+    table.reserve(strings.size() + 2);
+    table.push_back((uint32_t)strings.size());
+
+    uint32_t offset = 0;
+    table.push_back(offset);
+    for(size_t i = 0; i < strings.size(); i++) {
+        size_t length = 0;
+        strings.data(i, length);
+        offset += (uint32_t)length;
+        table.push_back(offset);
+    }
+
+    bytes = table.size() * sizeof(uint32_t) + offset;
+}
+
+
+static bool write_string_table(FILE *f, const QuineStringTable &strings, const std::vector<uint32_t> &table)
+{
+    bool ok = fwrite(&table[0], sizeof(uint32_t), table.size(), f) == table.size();
+    for(size_t i = 0; ok && i < strings.size(); i++) {
+        size_t length = 0;
+        const char *s = strings.data(i, length);
+        ok = fwrite(s, 1, length, f) == length;
+    }
+    return ok;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Points a string table at a string table section, in place. The
+ *        offsets are checked once here so lookups never have to.
+ *
+ * @return (bool) false if the section is truncated
+ */
+static bool read_string_table(const char *base,
+                              const quine_db_section_t *section,
+                              const std::shared_ptr<void> &owner,
+                              QuineStringTable &strings)
+{
+    const uint32_t *table = (const uint32_t *)(base + section->offset);
+    uint32_t count = section->bytes >= sizeof(uint32_t) ? table[0] : 0;
+    size_t table_bytes = sizeof(uint32_t) * (2 + (size_t)count);
+    if(table_bytes > section->bytes) {
+        return false;
+    }
+
+    const uint32_t *offsets = table + 1;
+    const char *bytes = base + section->offset + table_bytes;
+    size_t bytes_size = section->bytes - table_bytes;
+
+    if(offsets[0] != 0) {
+        return false;
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        if(offsets[i] > offsets[i + 1] || offsets[i + 1] > bytes_size) {
+            return false;
+        }
+    }
+
+    strings.adopt(bytes, offsets, count, owner);
+    return true;
+}
+
+
+bool is_mapped_database(const std::string &path)
+{
+    char magic[4] = { 0 };
+    FILE *f = fopen(path.c_str(), "rb");
+    if(!f) {
+        return false;
+    }
+    size_t n = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+
+    return n == sizeof(magic) && memcmp(magic, QUINE_DB_MAGIC, sizeof(magic)) == 0;
+}
+
+
+#pragma mark -
+#pragma mark Raw database Read/Write
+/* ************************************************************************* */
+/*!
+ * @brief Maps a .qdb database and points source, filter and metadata at it.
+ *
+ * @param path (const std::string)
+ *        Full path to the .qdb database
+ *
+ * @param mapping (QuineMappedFile)
+ *        Receives the mapping. It must outlive source and filter.
+ *
+ * @return (bool)
+ */
+bool load_mapped_database(const std::string &path,
+                          const std::shared_ptr<QuineMappedFile> &mapping,
+                          cv::Mat &source,
+                          cv::Mat &filter,
+                          QuineStringTable &meta,
+                          cv::vector<std::string> &hashtable)
+{
+    if(!mapping->open(path)) {
+        return false;
+    }
+
+    return load_database_mapping(path, mapping, source, filter, meta, hashtable);
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Points source, filter and metadata at a .qdb database in memory.
+ *
+ * @return (bool)
+ */
+bool load_database_mapping(const std::string &path,
+                           const std::shared_ptr<QuineMappedFile> &mapping,
+                           cv::Mat &source,
+                           cv::Mat &filter,
+                           QuineStringTable &meta,
+                           cv::vector<std::string> &hashtable)
+{
+    // Validate the header before trusting any of the offsets in it
+    const quine_db_header_t *header = (const quine_db_header_t *)mapping->data();
+    if(mapping->size() < sizeof(quine_db_header_t) ||
+       memcmp(header->magic, QUINE_DB_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version > QUINE_DB_VERSION ||
+       header->desc_type != CV_32FC1) {
+        std::cout << "[Quine: Error]: Not a valid database: " << path << std::endl;
+        mapping->close();
+        return false;
+    }
+
+    const quine_db_section_t *desc = find_section(header, QUINE_DB_SECTION_DESC, mapping->size());
+    const quine_db_section_t *cls = find_section(header, QUINE_DB_SECTION_FILTER, mapping->size());
+    const quine_db_section_t *idx = find_section(header, QUINE_DB_SECTION_META, mapping->size());
+    const quine_db_section_t *hashes = find_section(header, QUINE_DB_SECTION_HASH, mapping->size());
+
+    size_t desc_bytes = (size_t)header->desc_rows * header->desc_cols * sizeof(float);
+    if(!desc || !cls || !idx || desc->bytes < desc_bytes || cls->bytes < header->desc_rows) {
+        std::cout << "[Quine: Error]: Database is truncated: " << path << std::endl;
+        mapping->close();
+        return false;
+    }
+
+    // The matcher scans the descriptors front to back on every query, while
+    //   the filter and metadata are small and needed all at once.
+    mapping->advise(desc->offset, desc->bytes, MADV_SEQUENTIAL);
+    mapping->advise(cls->offset, cls->bytes, MADV_WILLNEED);
+    mapping->advise(idx->offset, idx->bytes, MADV_WILLNEED);
+
+    // cv::Mat headers over the mapped pages. The mapping is PROT_READ, which is
+    //   fine since the database is only ever grown in new chunks of its
+    //   descriptor store and never written in place.
+    char *base = (char *)mapping->data();
+    source = cv::Mat(header->desc_rows, header->desc_cols, CV_32FC1, base + desc->offset);
+    filter = cv::Mat(header->desc_rows, 1, CV_8UC1, base + cls->offset);
+
+    if(!read_string_table(base, idx, mapping, meta)) {
+        std::cout << "[Quine: Error]: Database index is truncated: " << path << std::endl;
+        source.release();
+        filter.release();
+        mapping->close();
+        return false;
+    }
+
+    // Content hashes are optional; databases written before them have none
+    hashtable.clear();
+    QuineStringTable hash_strings;
+    if(hashes && read_string_table(base, hashes, mapping, hash_strings)) {
+        hash_strings.to_vector(hashtable);
+    }
+
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Loads a block gzipped .qdb database, inflating it in parallel
+ *        into an anonymous mapping.
+ *
+ * @return (bool)
+ */
+bool inflate_mapped_database(const std::string &path,
+                             const std::shared_ptr<QuineMappedFile> &mapping,
+                             cv::Mat &source,
+                             cv::Mat &filter,
+                             QuineStringTable &meta,
+                             cv::vector<std::string> &hashtable)
+{
+    QuineMappedFile compressed;
+    if(!compressed.open(path)) {
+        return false;
+    }
+
+    std::vector<gzip_block_t> blocks;
+    if(!gzip_block_index(compressed.data(), compressed.size(), blocks)) {
+        return false;
+    }
+
+    // Only raw databases are inflated this way; YAML payloads are parsed
+    char magic[4] = { 0 };
+    if(gzip_block_peek(compressed.data(), blocks[0], magic, sizeof(magic)) != sizeof(magic) ||
+       memcmp(magic, QUINE_DB_MAGIC, sizeof(magic)) != 0) {
+        return false;
+    }
+
+    compressed.advise(0, compressed.size(), MADV_WILLNEED);
+    if(!mapping->allocate(gzip_block_raw_size(blocks)) ||
+       !gzip_inflate_blocks(compressed.data(), blocks, mapping->mutable_data())) {
+        std::cout << "[Quine: Error]: Could not decompress database: " << path << std::endl;
+        mapping->close();
+        return false;
+    }
+
+    return load_database_mapping(path, mapping, source, filter, meta, hashtable);
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief A database laid out as a .qdb file: the header, and the inputs
+ *        each section is written from.
+ */
+typedef struct mapped_layout {
+    quine_db_header_t header;
+    cv::Mat desc;
+    cv::Mat cls;
+    const QuineStringTable *meta;
+    QuineStringTable hash_strings;
+    std::vector<uint32_t> meta_table;
+    std::vector<uint32_t> hash_table;
+    uint64_t size;
+} mapped_layout_t;
+
+
+static void build_layout(const cv::Mat &source,
+                         const cv::Mat &filter,
+                         const QuineStringTable &meta,
+                         const cv::vector<std::string> &hashtable,
+                         uint32_t log_segment,
+                         mapped_layout_t &layout)
+{
+    // The on-disk layout is the in-memory layout, so normalize the inputs first
+    layout.desc = source;
+    if(layout.desc.type() != CV_32FC1) {
+        source.convertTo(layout.desc, CV_32FC1);
+    }
+    if(!layout.desc.isContinuous()) {
+        layout.desc = layout.desc.clone();
+    }
+
+    layout.cls = filter;
+    if(layout.cls.type() != CV_8UC1) {
+        filter.convertTo(layout.cls, CV_8UC1);
+    }
+    if(!layout.cls.isContinuous()) {
+        layout.cls = layout.cls.clone();
+    }
+
+    // Build the metadata and hash tables
+    layout.meta = &meta;
+    layout.hash_strings.assign(hashtable);
+    uint64_t meta_bytes = 0, hash_bytes = 0;
+    build_string_table(meta, layout.meta_table, meta_bytes);
+    build_string_table(layout.hash_strings, layout.hash_table, hash_bytes);
+
+    // Lay out the header and sections
+    quine_db_header_t &header = layout.header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, QUINE_DB_MAGIC, sizeof(header.magic));
+    header.version = QUINE_DB_VERSION;
+    header.image_count = (uint32_t)meta.size();
+    header.desc_rows = (uint32_t)layout.desc.rows;
+    header.desc_cols = (uint32_t)layout.desc.cols;
+    header.desc_type = CV_32FC1;
+    header.section_count = 4;
+    header.log_segment = log_segment;
+
+    uint64_t cursor = align_offset(sizeof(header));
+    header.sections[0].id = QUINE_DB_SECTION_DESC;
+    header.sections[0].offset = cursor;
+    header.sections[0].bytes = (uint64_t)layout.desc.total() * layout.desc.elemSize();
+
+    cursor = align_offset(cursor + header.sections[0].bytes);
+    header.sections[1].id = QUINE_DB_SECTION_FILTER;
+    header.sections[1].offset = cursor;
+    header.sections[1].bytes = (uint64_t)layout.cls.total() * layout.cls.elemSize();
+
+    cursor = align_offset(cursor + header.sections[1].bytes);
+    header.sections[2].id = QUINE_DB_SECTION_META;
+    header.sections[2].offset = cursor;
+    header.sections[2].bytes = meta_bytes;
+
+    cursor = align_offset(cursor + header.sections[2].bytes);
+    header.sections[3].id = QUINE_DB_SECTION_HASH;
+    header.sections[3].offset = cursor;
+    header.sections[3].bytes = hash_bytes;
+
+    layout.size = cursor + hash_bytes;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Copies bytes [offset, offset + bytes) of a string table section.
+ *        The strings a range starts in is found by bisecting the offsets.
+ *
+ * @return (void)
+ */
+static void read_string_table_range(const QuineStringTable &strings,
+                                    const std::vector<uint32_t> &table,
+                                    uint64_t offset,
+                                    size_t bytes,
+                                    char *out)
+{
+    uint64_t table_bytes = table.size() * sizeof(uint32_t);
+    while(bytes > 0 && offset < table_bytes) {
+        size_t n = (size_t)std::min<uint64_t>(bytes, table_bytes - offset);
+        memcpy(out, (const char *)&table[0] + offset, n);
+        offset += n;
+        out += n;
+        bytes -= n;
+    }
+    if(bytes == 0) {
+        return;
+    }
+
+    // table[1 + i] is where string i starts in the string bytes
+    uint64_t position = offset - table_bytes;
+    std::vector<uint32_t>::const_iterator it = std::upper_bound(table.begin() + 1, table.end(), (uint32_t)position);
+    size_t i = (size_t)(it - (table.begin() + 1)) - 1;
+    for(; bytes > 0 && i < strings.size(); i++) {
+        size_t length = 0;
+        const char *s = strings.data(i, length);
+        size_t skip = (size_t)(position - table[1 + i]);
+        size_t n = std::min(bytes, length - skip);
+        memcpy(out, s + skip, n);
+        position += n;
+        out += n;
+        bytes -= n;
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Copies bytes [offset, offset + bytes) of the file a layout
+ *        describes: the header, the sections, and zeros in between.
+ *
+ * @return (void)
+ */
+static void read_layout(const mapped_layout_t &layout, uint64_t offset, size_t bytes, char *out)
+{
+    memset(out, 0, bytes);
+    uint64_t end = offset + bytes;
+
+    if(offset < sizeof(layout.header)) {
+        size_t n = (size_t)std::min<uint64_t>(end, sizeof(layout.header)) - (size_t)offset;
+        memcpy(out, (const char *)&layout.header + offset, n);
+    }
+
+    for(uint32_t i = 0; i < layout.header.section_count; i++) {
+        const quine_db_section_t &section = layout.header.sections[i];
+        uint64_t begin = std::max(offset, section.offset);
+        uint64_t stop = std::min(end, section.offset + section.bytes);
+        if(begin >= stop) {
+            continue;
+        }
+
+        char *dst = out + (begin - offset);
+        uint64_t within = begin - section.offset;
+        size_t n = (size_t)(stop - begin);
+        if(section.id == QUINE_DB_SECTION_DESC) {
+            memcpy(dst, (const char *)layout.desc.data + within, n);
+        }
+        else if(section.id == QUINE_DB_SECTION_FILTER) {
+            memcpy(dst, (const char *)layout.cls.data + within, n);
+        }
+        else if(section.id == QUINE_DB_SECTION_META) {
+            read_string_table_range(*layout.meta, layout.meta_table, within, n, dst);
+        }
+        else if(section.id == QUINE_DB_SECTION_HASH) {
+            read_string_table_range(layout.hash_strings, layout.hash_table, within, n, dst);
+        }
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes a database in the .qdb layout, via a temporary file that is
+ *        renamed into place once it is complete.
+ *
+ * @return (bool)
+ */
+bool save_mapped_database(const std::string &path,
+                          const cv::Mat &source,
+                          const cv::Mat &filter,
+                          const QuineStringTable &meta,
+                          const cv::vector<std::string> &hashtable,
+                          uint32_t log_segment)
+{
+    mapped_layout_t layout;
+    build_layout(source, filter, meta, hashtable, log_segment, layout);
+    const quine_db_header_t &header = layout.header;
+    const cv::Mat &desc = layout.desc;
+    const cv::Mat &cls = layout.cls;
+
+    // Write to a temporary file and rename it over the destination
+    std::string tmp_path = path + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if(!f) {
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for(uint32_t i = 0; ok && i < header.section_count; i++) {
+        ok = fseek(f, (long)header.sections[i].offset, SEEK_SET) == 0;
+
+        if(ok && header.sections[i].id == QUINE_DB_SECTION_DESC && desc.total() > 0) {
+            ok = fwrite(desc.data, desc.elemSize(), desc.total(), f) == desc.total();
+        }
+        else if(ok && header.sections[i].id == QUINE_DB_SECTION_FILTER && cls.total() > 0) {
+            ok = fwrite(cls.data, cls.elemSize(), cls.total(), f) == cls.total();
+        }
+        else if(ok && header.sections[i].id == QUINE_DB_SECTION_META) {
+            ok = write_string_table(f, meta, layout.meta_table);
+        }
+        else if(ok && header.sections[i].id == QUINE_DB_SECTION_HASH) {
+            ok = write_string_table(f, layout.hash_strings, layout.hash_table);
+        }
+    }
+
+    ok = (fflush(f) == 0) && ok;
+    ok = (fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+
+    if(!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Block gzips the .qdb layout as it is laid out: every block is
+ *        read from the database's own buffers, so no uncompressed copy of
+ *        the file is ever made.
+ *
+ * @return (bool)
+ */
+bool save_compressed_mapped_database(const std::string &path,
+                                     const cv::Mat &source,
+                                     const cv::Mat &filter,
+                                     const QuineStringTable &meta,
+                                     const cv::vector<std::string> &hashtable,
+                                     uint32_t log_segment)
+{
+    mapped_layout_t layout;
+    build_layout(source, filter, meta, hashtable, log_segment, layout);
+
+    return gzip_compress_stream((size_t)layout.size, [&layout](size_t offset, size_t bytes, char *out) {
+        read_layout(layout, offset, bytes, out);
+    }, path);
+}
@@ -0,0 +1,271 @@
+//
+//  QuineMappedDatabase.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineMappedDatabase__
+#define __Quine__QuineMappedDatabase__
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "QuineStringTable.h"
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Layout of the raw (.qdb) database file.
+ *
+ *        The file is a fixed size header followed by page aligned sections.
+ *        Every section is stored exactly as it is used in memory, so a
+ *        database can be opened with mmap and handed to the matcher
+ *        without parsing or copying anything.
+ *
+ *        QUINE_DB_SECTION_DESC   -> desc_rows x desc_cols CV_32FC1 descriptors
+ *        QUINE_DB_SECTION_FILTER -> desc_rows x 1 CV_8UC1 keypoint class ids
+ *        QUINE_DB_SECTION_META   -> uint32 count, uint32 offsets[count + 1],
+ *                                   then the concatenated metadata strings
+ *        QUINE_DB_SECTION_HASH   -> content hash of every image, laid out
+ *                                   like QUINE_DB_SECTION_META (optional)
+ *
+ *        A .qdbz file is this layout compressed as block gzip. The .bin
+ *        extension is kept for gzipped YAML databases.
+ */
+#define QUINE_DB_MAGIC              "QDB1"
+#define QUINE_DB_VERSION            1
+#define QUINE_DB_ALIGNMENT          4096
+#define QUINE_DB_MAX_SECTIONS       8
+
+#define QUINE_DB_SECTION_DESC       1
+#define QUINE_DB_SECTION_FILTER     2
+#define QUINE_DB_SECTION_META       3
+#define QUINE_DB_SECTION_HASH       4
+
+
+typedef struct quine_db_section {
+
+    /*!
+     * One of the QUINE_DB_SECTION_* identifiers. Zero marks an unused entry.
+     */
+    uint32_t id;
+    uint32_t reserved;
+
+    /*!
+     * Byte offset of the section from the start of the file
+     */
+    uint64_t offset;
+
+    /*!
+     * Length of the section in bytes
+     */
+    uint64_t bytes;
+
+} quine_db_section_t;
+
+
+typedef struct quine_db_header {
+
+    char     magic[4];
+    uint32_t version;
+    uint32_t image_count;
+    uint32_t desc_rows;
+    uint32_t desc_cols;
+    uint32_t desc_type;
+    uint32_t section_count;
+    uint32_t log_segment;   // last log segment folded into this file
+    quine_db_section_t sections[QUINE_DB_MAX_SECTIONS];
+
+} quine_db_header_t;
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineMappedFile
+ *
+ *  @abstract   Memory mapping that backs a loaded database.
+ *
+ *  @discussion File mappings are read-only and shared, so every process that
+ *              opens the same database shares one copy of it in the page cache.
+ *              Any cv::Mat
+ *              header created over the mapping is only valid for as long
+ *              as the QuineMappedFile is alive.
+ */
+class QuineMappedFile {
+public:
+
+    QuineMappedFile();
+    ~QuineMappedFile();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Maps the whole file at the path into memory (read-only).
+     *
+     * @return (bool) true if the file was mapped
+     */
+    bool open(const std::string &path);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Creates an anonymous, writable mapping of the given size instead
+     *        of mapping a file. Used to hold databases that were inflated from
+     *        a compressed file, so that they are owned the same way as a
+     *        mapped one. Pages are only committed once they are written.
+     *
+     * @return (bool) true if the memory was mapped
+     */
+    bool allocate(size_t bytes);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Unmaps the file. Called by the destructor.
+     *
+     * @return (void)
+     */
+    void close();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Passes an madvise() hint for a byte range of the mapping.
+     *        The range is widened to page boundaries.
+     *
+     * @param offset (size_t) Start of the range, relative to data()
+     * @param bytes (size_t)  Length of the range
+     * @param advice (int)    MADV_SEQUENTIAL, MADV_WILLNEED, MADV_DONTNEED, ...
+     *
+     * @return (void)
+     */
+    void advise(size_t offset, size_t bytes, int advice) const;
+
+
+    const char* data() const { return (const char *)m_addr; }
+    char* mutable_data() { return m_writable ? (char *)m_addr : NULL; }
+    size_t size() const { return m_size; }
+    bool is_open() const { return m_addr != NULL; }
+
+private:
+
+    QuineMappedFile(const QuineMappedFile &);
+    QuineMappedFile& operator=(const QuineMappedFile &);
+
+    void *m_addr;
+    size_t m_size;
+    bool m_writable;
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Checks whether the file at the path starts with the .qdb magic.
+ *
+ * @return (bool)
+ */
+bool is_mapped_database(const std::string &path);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Maps a .qdb database and points source, filter and metadata at it.
+ *
+ *        source and filter are cv::Mat headers over the mapped pages; no
+ *        descriptor data is copied. The descriptor section is advised for
+ *        sequential access since the matcher always scans it front to back.
+ *
+ * @param path (const std::string)
+ *        Full path to the .qdb database
+ *
+ * @param mapping (QuineMappedFile)
+ *        Receives the mapping. It must outlive source and filter; meta
+ *        holds a reference to it, since its strings stay in the mapping.
+ *
+ * @return (bool) false if the file is missing or is not a valid .qdb file
+ */
+bool load_mapped_database(const std::string &path,
+                          const std::shared_ptr<QuineMappedFile> &mapping,
+                          cv::Mat &source,
+                          cv::Mat &filter,
+                          QuineStringTable &meta,
+                          cv::vector<std::string> &hashtable);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Points source, filter and metadata at a .qdb database that is
+ *        already in memory (mapped or allocated).
+ *
+ * @return (bool) false if the mapping does not hold a valid .qdb database
+ */
+bool load_database_mapping(const std::string &path,
+                           const std::shared_ptr<QuineMappedFile> &mapping,
+                           cv::Mat &source,
+                           cv::Mat &filter,
+                           QuineStringTable &meta,
+                           cv::vector<std::string> &hashtable);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Loads a .qdb database that was compressed as block gzip (.qdbz).
+ *
+ *        The blocks are inflated in parallel straight into an anonymous
+ *        mapping, which then backs source and filter exactly as a mapped
+ *        file would. Peak memory is the size of the database.
+ *
+ * @return (bool) false if the file is not a block gzipped .qdb database.
+ *         Gzipped YAML (.bin) is read through gzip_uncompress() instead.
+ */
+bool inflate_mapped_database(const std::string &path,
+                             const std::shared_ptr<QuineMappedFile> &mapping,
+                             cv::Mat &source,
+                             cv::Mat &filter,
+                             QuineStringTable &meta,
+                             cv::vector<std::string> &hashtable);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes a database in the .qdb layout.
+ *
+ *        The file is written next to the destination and renamed into
+ *        place, so a reader never sees a partially written database.
+ *
+ * @param log_segment (uint32_t)
+ *        Last log segment folded into the database (see QuineDatabaseLog.h)
+ *
+ * @return (bool) true on success
+ */
+bool save_mapped_database(const std::string &path,
+                          const cv::Mat &source,
+                          const cv::Mat &filter,
+                          const QuineStringTable &meta,
+                          const cv::vector<std::string> &hashtable,
+                          uint32_t log_segment = 0);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes a database in the .qdb layout, compressed as block gzip
+ *        (see QuineGzip.h), which inflate_mapped_database() loads.
+ *
+ *        The layout is compressed a few blocks at a time as it is read
+ *        from source, filter and the tables, so the uncompressed file is
+ *        never held in memory.
+ *
+ * @return (bool) true on success
+ */
+bool save_compressed_mapped_database(const std::string &path,
+                                     const cv::Mat &source,
+                                     const cv::Mat &filter,
+                                     const QuineStringTable &meta,
+                                     const cv::vector<std::string> &hashtable,
+                                     uint32_t log_segment = 0);
+
+
+#endif /* defined(__Quine__QuineMappedDatabase__) */
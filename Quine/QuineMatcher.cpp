@@ -0,0 +1,687 @@
+//
+//  QuineMatcher.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineMatcher.h"
+#include "AKAZEConfig.h"
+#include "QuineLatency.h"
+
+#ifdef __APPLE__
+#include <Accelerate/Accelerate.h>
+#endif
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+
+#pragma mark -
+#pragma mark Comparison functions
+/* ************************************************************************* */
+/*!
+ * @brief Scores query x tile (transposed) into scores, row major.
+ *
+ *        Accelerate's sgemm reads the tile transposed in place, so unlike
+ *        the old vDSP_mtrans + vDSP_mmul pair no transposed copy is made.
+ *
+ * @return (void)
+ */
+static void score_tile(const cv::Mat &query, const cv::Mat &tile, cv::Mat &scores)
+{
+#ifdef __APPLE__
+    scores.create(query.rows, tile.rows, CV_32FC1);
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans,
+                query.rows, tile.rows, query.cols,
+                1.0f, (const float *)query.data, (int)(query.step / sizeof(float)),
+                (const float *)tile.data, (int)(tile.step / sizeof(float)),
+                0.0f, (float *)scores.data, (int)(scores.step / sizeof(float)));
+#else
+    cv::gemm(query, tile, 1.0, cv::noArray(), 0.0, scores, cv::GEMM_2_T);
+#endif
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Bytes a comparison holds at the moment, and the most it held,
+ *        updated by every range of tiles as it allocates and frees.
+ */
+class MatchMemory {
+public:
+    MatchMemory() : m_current(0), m_peak(0) { }
+
+    void acquire(size_t bytes) {
+        size_t current = (m_current += bytes);
+        size_t peak = m_peak.load();
+        while(current > peak && !m_peak.compare_exchange_weak(peak, current)) { }
+    }
+
+    void release(size_t bytes) { m_current -= bytes; }
+
+    size_t peak() const { return m_peak.load(); }
+
+private:
+    std::atomic<size_t> m_current;
+    std::atomic<size_t> m_peak;
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Vote and score buffers of one range of tiles.
+ */
+typedef struct match_scratch {
+    std::vector<int> votes;
+    std::vector<float> scores;
+} match_scratch_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Scratch buffers handed from one comparison to the next. A range
+ *        takes one for its run and gives it back, so buffers are sized by
+ *        the first comparisons and then only reused: memory stays at one
+ *        scratch per range running at once, however many frames go by.
+ */
+class MatchScratchPool {
+public:
+    static std::unique_ptr<match_scratch_t> take() {
+        std::lock_guard<std::mutex> guard(lock());
+        std::vector<std::unique_ptr<match_scratch_t> > &free_list = pool();
+        if(free_list.empty()) {
+            return std::unique_ptr<match_scratch_t>(new match_scratch_t());
+        }
+        std::unique_ptr<match_scratch_t> scratch = std::move(free_list.back());
+        free_list.pop_back();
+        return scratch;
+    }
+
+    static void give(std::unique_ptr<match_scratch_t> scratch) {
+        std::lock_guard<std::mutex> guard(lock());
+        // Beyond the threads of a few concurrent comparisons, let it go
+        if(pool().size() < (size_t)std::max(1, cv::getNumThreads()) * 2) {
+            pool().push_back(std::move(scratch));
+        }
+    }
+
+private:
+    static std::mutex &lock() {
+        static std::mutex s_lock;
+        return s_lock;
+    }
+
+    static std::vector<std::unique_ptr<match_scratch_t> > &pool() {
+        static std::vector<std::unique_ptr<match_scratch_t> > s_pool;
+        return s_pool;
+    }
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief One tile of source rows: rows [start, end) of a chunk.
+ */
+typedef struct match_tile {
+    size_t chunk;
+    int start;
+    int end;
+} match_tile_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief cv::parallel_for_ body that scores a range of tiles and adds the
+ *        votes of their matched features to the shared vote counts. With
+ *        owners, the query rows belong to several queries, and each query
+ *        counts its own votes.
+ *
+ *        Its buffers come from MatchScratchPool rather than the frame
+ *        arena: ranges run once per thread and per frame, and an arena
+ *        would keep every one of them until its reset.
+ */
+class MatchTileBody : public cv::ParallelLoopBody {
+public:
+    MatchTileBody(const cv::Mat &query_desc,
+                  const cv::Mat &query_class,
+                  const int *owners,
+                  size_t owner_count,
+                  const std::vector<quine_store_chunk_t> &source,
+                  const match_tile_t *tiles,
+                  const uchar *dead,
+                  float dratio,
+                  int *votes,
+                  size_t images,
+                  std::mutex &votes_lock,
+                  MatchMemory &memory)
+    : m_query_desc(query_desc), m_query_class(query_class), m_owners(owners), m_owner_count(owner_count),
+      m_source(source), m_tiles(tiles), m_dead(dead), m_dratio(dratio), m_votes(votes), m_images(images),
+      m_votes_lock(votes_lock), m_memory(memory) { }
+
+    void operator()(const cv::Range &range) const {
+
+        // The score buffer fits the largest tile of the range, and the
+        //   votes the images its tiles hold: with a stripe per thread, each
+        //   counts and merges its share of the images, not all of them
+        const size_t K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+        int tile_rows_max = 0;
+        size_t first_image = m_images, last_image = 0;
+        for(int t = range.start; t < range.end; t++) {
+            const match_tile_t &tile_rows = m_tiles[t];
+            size_t first_row = m_source[tile_rows.chunk].first_row;
+            tile_rows_max = std::max(tile_rows_max, tile_rows.end - tile_rows.start);
+            first_image = std::min(first_image, (first_row + tile_rows.start) / K);
+            last_image = std::max(last_image, (first_row + tile_rows.end - 1) / K);
+        }
+        last_image = std::min(last_image, m_images - 1);
+        if(first_image > last_image) {
+            return;
+        }
+        size_t span = last_image - first_image + 1;
+        size_t score_bytes = (size_t)m_query_desc.rows * tile_rows_max * sizeof(float);
+        size_t vote_count = m_owner_count * span;
+        size_t bytes = vote_count * sizeof(int) + score_bytes;
+        m_memory.acquire(bytes);
+
+        // Votes are counted locally and merged once per range
+        std::unique_ptr<match_scratch_t> scratch = MatchScratchPool::take();
+        if(scratch->votes.size() < vote_count) {
+            scratch->votes.resize(vote_count);
+        }
+        if(scratch->scores.size() < score_bytes / sizeof(float)) {
+            scratch->scores.resize(score_bytes / sizeof(float));
+        }
+        int *votes = scratch->votes.data();
+        float *score_data = scratch->scores.data();
+        std::fill(votes, votes + vote_count, 0);
+
+        for(int t = range.start; t < range.end; t++) {
+            const match_tile_t &tile_rows = m_tiles[t];
+            const quine_store_chunk_t &chunk = m_source[tile_rows.chunk];
+            cv::Mat tile = chunk.desc.rowRange(tile_rows.start, tile_rows.end);
+
+
+            //////////////////////////////////////////////////////
+            // Q • Tile
+            // Perform the comparison by multiplication (the magic)
+
+            cv::Mat scores(m_query_desc.rows, tile.rows, CV_32FC1, score_data);
+            score_tile(m_query_desc, tile, scores);
+
+
+            //////////////////////////////////////////////////////
+            // Count the matched features
+
+            for(int q = 0; q < scores.rows; q++) {
+                const float *row = scores.ptr<float>(q);
+                uchar q_class = q < m_query_class.rows ? m_query_class.at<uchar>(q) : 0;
+                int *query_votes = m_owners ? votes + m_owners[q] * span : votes;
+
+                for(int s = 0; s < scores.cols; s++) {
+                    if(row[s] <= m_dratio) {
+                        continue;
+                    }
+
+                    int chunk_row = tile_rows.start + s;
+#if USE_FILTER
+                    if(chunk.filter.at<uchar>(chunk_row) != q_class) {
+                        continue;
+                    }
+#endif
+                    size_t image_idx = (chunk.first_row + chunk_row) / K;
+                    if(image_idx <= last_image && !m_dead[image_idx]) {
+                        query_votes[image_idx - first_image]++;
+                    }
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(m_votes_lock);
+            for(size_t o = 0; o < m_owner_count; o++) {
+                int *total = m_votes + o * m_images + first_image;
+                const int *local = votes + o * span;
+                for(size_t i = 0; i < span; i++) {
+                    total[i] += local[i];
+                }
+            }
+        }
+        MatchScratchPool::give(std::move(scratch));
+        m_memory.release(bytes);
+    }
+
+private:
+    const cv::Mat &m_query_desc;
+    const cv::Mat &m_query_class;
+    const int *m_owners;
+    size_t m_owner_count;
+    const std::vector<quine_store_chunk_t> &m_source;
+    const match_tile_t *m_tiles;
+    const uchar *m_dead;
+    float m_dratio;
+    int *m_votes;
+    size_t m_images;
+    std::mutex &m_votes_lock;
+    MatchMemory &m_memory;
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Scores every tile of the source against the query rows and adds
+ *        the votes of matched features to votes (owner_count * images).
+ *
+ * @return (void)
+ */
+static void score_tiles(const cv::Mat &query_desc,
+                        const cv::Mat &query_class,
+                        const int *owners,
+                        size_t owner_count,
+                        int tile_rows,
+                        const std::vector<quine_store_chunk_t> &source,
+                        size_t images,
+                        const std::vector<bool> &tombstones,
+                        const float dratio,
+                        int *votes,
+                        MatchMemory &memory,
+                        QuineFrameArena *arena) {
+
+    //////////////////////////////////////////////////////////
+    // Deleted flag per image, and the tiles to score.
+    //   Deleted images can't collect any votes.
+
+    size_t tile_count = 0;
+    for(size_t c = 0; c < source.size(); c++) {
+        tile_count += (source[c].desc.rows + tile_rows - 1) / tile_rows;
+    }
+
+    std::vector<uchar> heap_dead;
+    std::vector<match_tile_t> heap_tiles;
+    uchar *dead = NULL;
+    match_tile_t *tiles = NULL;
+    if(arena) {
+        dead = (uchar *)arena->allocate(images);
+        tiles = (match_tile_t *)arena->allocate(tile_count * sizeof(match_tile_t));
+    }
+    else {
+        heap_dead.resize(images);
+        heap_tiles.resize(tile_count);
+        dead = heap_dead.data();
+        tiles = heap_tiles.data();
+    }
+    memory.acquire(images * (owner_count * sizeof(int) + 1) + tile_count * sizeof(match_tile_t));
+
+    for(size_t i = 0; i < images; i++) {
+        dead[i] = i < tombstones.size() && tombstones[i];
+    }
+
+    size_t t = 0;
+    for(size_t c = 0; c < source.size(); c++) {
+        for(int start = 0; start < source[c].desc.rows; start += tile_rows) {
+            tiles[t].chunk = c;
+            tiles[t].start = start;
+            tiles[t].end = std::min(start + tile_rows, source[c].desc.rows);
+            t++;
+        }
+    }
+
+    // One range of tiles per thread: every range zero-fills and merges a
+    //   vote count of its own, so ranges must not multiply with the tiles
+    std::mutex votes_lock;
+    cv::parallel_for_(cv::Range(0, (int)tile_count),
+                      MatchTileBody(query_desc, query_class, owners, owner_count, source, tiles, dead, dratio,
+                                    votes, images, votes_lock, memory),
+                      std::max(1, cv::getNumThreads()));
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Counts the votes of a set of query descriptors for the images of
+ *        a set of source descriptors.
+ *
+ *        The source is split into tiles of at most QUINE_MATCH_TILE_ROWS
+ *        rows, never spanning chunks, and the tiles are scored in parallel.
+ *        Every shard of a sharded database is a chunk of its own, so shards
+ *        are always matched in parallel. A feature matches when its score
+ *        passes dratio and, with USE_FILTER, its keypoint class equals the
+ *        query feature's. Each match votes for the image that owns the
+ *        source row, unless that image is dead.
+ *
+ * @return (void)
+ */
+void count_image_votes(const cv::Mat &query,
+                       const std::vector<quine_store_chunk_t> &source,
+                       const cv::Mat &query_filter,
+                       size_t images,
+                       const std::vector<bool> &tombstones,
+                       const float dratio,
+                       int *votes,
+                       quine_match_stats_t *stats,
+                       QuineFrameArena *arena) {
+
+    if(stats) {
+        stats->peak_transient_bytes = 0;
+    }
+    std::fill(votes, votes + images, 0);
+    if(query.empty() || source.empty() || images == 0) {
+        return;
+    }
+
+    MatchMemory memory;
+
+    cv::Mat query_desc = query;
+    if(query_desc.type() != CV_32FC1) {
+        if(arena) {
+            query_desc = arena->mat(query.rows, query.cols, CV_32FC1);
+        }
+        query.convertTo(query_desc, CV_32FC1);
+        memory.acquire(query_desc.total() * query_desc.elemSize());
+    }
+
+    cv::Mat query_class = query_filter;
+    if(query_class.type() != CV_8UC1) {
+        if(arena) {
+            query_class = arena->mat(query_filter.rows, query_filter.cols, CV_8UC1);
+        }
+        query_filter.convertTo(query_class, CV_8UC1);
+        memory.acquire(query_class.total() * query_class.elemSize());
+    }
+    query_class = query_class.reshape(1, (int)query_class.total());
+
+
+    score_tiles(query_desc, query_class, NULL, 1, QUINE_MATCH_TILE_ROWS, source, images, tombstones, dratio,
+                votes, memory, arena);
+
+    if(stats) {
+        stats->peak_transient_bytes = memory.peak();
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief The queries are stacked into one matrix, so each tile of the
+ *        source is read once and scored with a single product for the
+ *        whole batch; every query row votes for its own query. Tiles are
+ *        shortened to keep the score buffer of a large batch bounded.
+ *
+ * @return (void)
+ */
+void count_batch_votes(const std::vector<cv::Mat> &queries,
+                       const std::vector<cv::Mat> &query_filters,
+                       const std::vector<quine_store_chunk_t> &source,
+                       size_t images,
+                       const std::vector<bool> &tombstones,
+                       const float dratio,
+                       int *votes,
+                       quine_match_stats_t *stats) {
+
+    if(stats) {
+        stats->peak_transient_bytes = 0;
+    }
+    std::fill(votes, votes + queries.size() * images, 0);
+
+    int rows = 0, cols = 0;
+    for(size_t q = 0; q < queries.size(); q++) {
+        if(!queries[q].empty()) {
+            rows += queries[q].rows;
+            cols = queries[q].cols;
+        }
+    }
+    if(rows == 0 || source.empty() || images == 0) {
+        return;
+    }
+
+    MatchMemory memory;
+    cv::Mat query_desc(rows, cols, CV_32FC1);
+    cv::Mat query_class(rows, 1, CV_8UC1);
+    std::vector<int> owners(rows);
+    memory.acquire(query_desc.total() * query_desc.elemSize() + rows * (1 + sizeof(int)));
+
+    int r = 0;
+    for(size_t q = 0; q < queries.size(); q++) {
+        if(queries[q].empty()) {
+            continue;
+        }
+        int n = queries[q].rows;
+        queries[q].convertTo(query_desc.rowRange(r, r + n), CV_32FC1);
+
+        cv::Mat filter;
+        query_filters[q].convertTo(filter, CV_8UC1);
+        filter = filter.reshape(1, (int)filter.total());
+        for(int i = 0; i < n; i++) {
+            query_class.at<uchar>(r + i) = i < filter.rows ? filter.at<uchar>(i) : 0;
+            owners[r + i] = (int)q;
+        }
+        r += n;
+    }
+
+    int tile_rows = std::max(QUINE_MATCH_MIN_TILE_ROWS, std::min(QUINE_MATCH_TILE_ROWS, QUINE_MATCH_BATCH_SCORES / rows));
+    score_tiles(query_desc, query_class, owners.data(), queries.size(), tile_rows, source, images, tombstones,
+                dratio, votes, memory, NULL);
+
+    if(stats) {
+        stats->peak_transient_bytes = memory.peak();
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Picks the image with the most matched features, if it has enough.
+ *
+ * @return (int)
+ */
+int select_voted_image(const int *votes,
+                       size_t images,
+                       const int query_count,
+                       const float accept_ratio,
+                       int *frequency) {
+
+    int most = 0;
+    size_t matched_idx = 0;
+    for(size_t i = 0; i < images; i++) {
+        if(votes[i] > most) {
+            most = votes[i];
+            matched_idx = i;
+        }
+    }
+    if(frequency) {
+        *frequency = most;
+    }
+
+    float threshold = (float)most / (float)AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    if(query_count > 5 && threshold > accept_ratio) {
+        return (int)matched_idx;
+    }
+    return -1;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Partial sort of the voted images, most votes first; ties go to
+ *        the lower slot, as in select_voted_image.
+ *
+ * @return (void)
+ */
+void rank_voted_images(const int *votes,
+                       size_t images,
+                       size_t top_k,
+                       std::vector<quine_ranked_image_t> &ranked) {
+
+    ranked.clear();
+    for(size_t i = 0; i < images; i++) {
+        if(votes[i] > 0) {
+            quine_ranked_image_t image;
+            image.slot = (int)i;
+            image.votes = votes[i];
+            ranked.push_back(image);
+        }
+    }
+
+    std::vector<quine_ranked_image_t>::iterator last = ranked.begin() + std::min(top_k, ranked.size());
+    std::partial_sort(ranked.begin(), last, ranked.end(),
+                      [](const quine_ranked_image_t &a, const quine_ranked_image_t &b) {
+                          return a.votes != b.votes ? a.votes > b.votes : a.slot < b.slot;
+                      });
+    ranked.erase(last, ranked.end());
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Compares a set of query descriptors to a set of source descriptors:
+ *        count_image_votes, then select_voted_image.
+ *
+ * @return (int)
+ */
+int compare_mat_souces(const cv::Mat &query,
+                       const int query_count,
+                       const std::vector<quine_store_chunk_t> &source,
+                       const cv::Mat &query_filter,
+                       const QuineStringTable &metadata,
+                       const std::vector<bool> &tombstones,
+                       std::set<int> &results_idxs,
+                       const float dratio,
+                       const float accept_ratio,
+                       quine_match_stats_t *stats,
+                       QuineFrameArena *arena) {
+
+
+    //////////////////////////////////////////////////////////
+    // Nothing to compare
+
+    if(stats) {
+        stats->peak_transient_bytes = 0;
+    }
+    if(query.empty() || source.empty() || metadata.empty()) {
+        return -1;
+    }
+
+    size_t images = metadata.size();
+    std::vector<int> heap_votes;
+    int *votes = NULL;
+    if(arena) {
+        votes = (int *)arena->allocate(images * sizeof(int));
+    }
+    else {
+        heap_votes.resize(images);
+        votes = heap_votes.data();
+    }
+    count_image_votes(query, source, query_filter, images, tombstones, dratio, votes, stats, arena);
+
+
+    //////////////////////////////////////////////////////////
+    // Pick the image with the most matched features
+
+    QuineLatencyTimer vote_timer(QuineLatency::instance()->stage(QUINE_LATENCY_VOTE));
+    for(size_t i = 0; i < images; i++) {
+        if(votes[i] > 0) {
+            results_idxs.insert((int)i);
+        }
+    }
+
+    int frequency = 0;
+    int matched_slot = select_voted_image(votes, images, query_count, accept_ratio, &frequency);
+    vote_timer.stop();
+
+    // Debugging print statement. Uncomment for more information.
+    // printf("Frequency: %d:%f - %s\n", frequency, (float)frequency / AKAZEOptions::AKAZE_KEYPOINTCOUNT, metadata[matched_slot].c_str());
+
+    if(matched_slot >= 0) {
+        float accept = 0.0;
+        if (float(frequency) / query_count > 1) {
+            accept = 1.0f;
+        }
+        else {
+            accept = float(frequency) / (float)AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+        }
+        printf("Matched Image: %s at: %.1f%%\n", metadata[matched_slot].c_str(), accept * 100);
+    }
+
+    return matched_slot;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Scores the query against the rows of one image only, so it costs
+ *        query x AKAZE_KEYPOINTCOUNT scores in all, split in two products
+ *        when the image straddles a chunk boundary.
+ *
+ * @return (void)
+ */
+void matched_query_features(const cv::Mat &query,
+                            const cv::Mat &query_filter,
+                            const std::vector<quine_store_chunk_t> &source,
+                            int slot,
+                            const float dratio,
+                            std::vector<int> &query_rows) {
+
+    query_rows.clear();
+    if(query.empty() || slot < 0) {
+        return;
+    }
+
+    // An image's rows may straddle two chunks: every chunk holding some
+    //   of them is scored
+    size_t first = (size_t)slot * AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    size_t last = first + AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+
+    cv::Mat query_desc = query, query_class = query_filter;
+    if(query_desc.type() != CV_32FC1) {
+        query.convertTo(query_desc, CV_32FC1);
+    }
+    if(query_class.type() != CV_8UC1) {
+        query_filter.convertTo(query_class, CV_8UC1);
+    }
+    query_class = query_class.reshape(1, (int)query_class.total());
+
+    std::vector<bool> matched(query_desc.rows, false);
+    for(size_t c = 0; c < source.size(); c++) {
+        const quine_store_chunk_t &chunk = source[c];
+        size_t chunk_end = chunk.first_row + chunk.desc.rows;
+        if(last <= chunk.first_row || first >= chunk_end) {
+            continue;
+        }
+
+        int start = (int)(std::max(first, chunk.first_row) - chunk.first_row);
+        int end = (int)(std::min(last, chunk_end) - chunk.first_row);
+        cv::Mat tile = chunk.desc.rowRange(start, end), scores;
+        score_tile(query_desc, tile, scores);
+
+        for(int q = 0; q < scores.rows; q++) {
+            if(matched[q]) {
+                continue;
+            }
+            const float *row = scores.ptr<float>(q);
+            uchar q_class = q < query_class.rows ? query_class.at<uchar>(q) : 0;
+
+            for(int s = 0; s < scores.cols; s++) {
+                if(row[s] <= dratio) {
+                    continue;
+                }
+#if USE_FILTER
+                if(chunk.filter.at<uchar>(start + s) != q_class) {
+                    continue;
+                }
+#endif
+                matched[q] = true;
+                break;
+            }
+        }
+    }
+
+    for(int q = 0; q < (int)matched.size(); q++) {
+        if(matched[q]) {
+            query_rows.push_back(q);
+        }
+    }
+}
@@ -0,0 +1,222 @@
+//
+//  QuineMatcher.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineMatcher__
+#define __Quine__QuineMatcher__
+
+#include <stddef.h>
+#include <set>
+#include <string>
+#include <vector>
+#include "QuineDescriptorStore.h"
+#include "QuineFrameArena.h"
+#include "QuineStringTable.h"
+
+
+// Only features of the same keypoint class can match
+#define USE_FILTER 1
+
+// Source rows scored per matrix multiplication. Bounds the score buffer
+//   to query rows x QUINE_MATCH_TILE_ROWS floats, however large a chunk is.
+#define QUINE_MATCH_TILE_ROWS 4096
+
+// Score buffer of a batched pass, in floats (16 MB per thread): tiles are
+//   cut shorter as the batch grows, down to QUINE_MATCH_MIN_TILE_ROWS
+#define QUINE_MATCH_BATCH_SCORES    (1 << 22)
+#define QUINE_MATCH_MIN_TILE_ROWS   256
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Memory one comparison used, beyond its inputs.
+ */
+typedef struct quine_match_stats {
+
+    /*!
+     * Most bytes the comparison held at once: vote counts, deleted flags,
+     *   tiles, converted query rows, and the votes and score buffer of
+     *   every tile range being scored in parallel
+     */
+    size_t peak_transient_bytes;
+
+} quine_match_stats_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief An image of a source and the votes it collected.
+ */
+typedef struct quine_ranked_image {
+
+    int slot;
+    int votes;
+
+} quine_ranked_image_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Compares a set of query descriptors to a set of source descriptors.
+ *          In an ideal world, this method will be completed stupidly fast.
+ *          It's getting there.
+ *
+ * @param query (const cv::Mat) <CV_32F>
+ *          Input matrix contining the query descriptors.
+ *          This should only represent a single image.
+ *
+ * @param source (const std::vector<quine_store_chunk_t>)
+ *          Snapshot of the database descriptors and their class ids, which
+ *          are scored in parallel, tile by tile. Every image occupies
+ *          AKAZEOptions::AKAZE_KEYPOINTCOUNT consecutive rows.
+ *
+ * @param query_filter (const cv::Mat) <CV_8U>
+ *          Class Id data for each feature in query. The size will be query.rows() x 1 (i.e., vertical).
+ *
+ * @param metadata (const QuineStringTable)
+ *          Metadata for each image of the database, in row order.
+ *
+ * @param tombstones (const std::vector<bool>)
+ *          Flags of deleted images, in the order of metadata. Deleted images
+ *          are never matched. May be empty.
+ *
+ * @param results_idxs (std::set) <int>
+ *          Receives the indicies of every image with at least one matched feature.
+ *
+ * @param dratio (const float)
+ *          Float value for the threshold percentage of a matched feature.
+ *
+ * @param accept_ratio (const float)
+ *          Float value for the threshold matched feature percentage for an accepted image match.
+ *
+ * @param stats (quine_match_stats_t*)
+ *          Receives the memory the comparison used. May be NULL.
+ *
+ * @param arena (QuineFrameArena*)
+ *          Frame arena the votes and tiles of the frame are allocated
+ *          from, or NULL for the heap. The per-thread vote and score
+ *          buffers are pooled across frames instead.
+ *
+ * @return (int) slot of the matched image (its index in metadata), or -1
+ *          if none was accepted
+ */
+int compare_mat_souces(const cv::Mat &query,
+                               const int query_count,
+                               const std::vector<quine_store_chunk_t> &source,
+                               const cv::Mat &query_filter,
+                               const QuineStringTable &metadata,
+                               const std::vector<bool> &tombstones,
+                               std::set<int> &results_idxs,
+                               const float dratio,
+                               const float accept_ratio,
+                               quine_match_stats_t *stats = NULL,
+                               QuineFrameArena *arena = NULL);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief The vote counting of compare_mat_souces on its own: the matched
+ *        features of every image, without picking one. Evaluation tools
+ *        count once and try several accept ratios on the counts.
+ *
+ * @param images (size_t)
+ *        Images of the source.
+ *
+ * @param votes (int*)
+ *        Receives the matched features of each image; holds images ints.
+ *
+ * @return (void)
+ */
+void count_image_votes(const cv::Mat &query,
+                       const std::vector<quine_store_chunk_t> &source,
+                       const cv::Mat &query_filter,
+                       size_t images,
+                       const std::vector<bool> &tombstones,
+                       const float dratio,
+                       int *votes,
+                       quine_match_stats_t *stats = NULL,
+                       QuineFrameArena *arena = NULL);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief count_image_votes for several queries in one pass over the source.
+ *
+ * @param queries (std::vector<cv::Mat>)
+ *        Descriptors of each query; an empty query gets no votes.
+ *
+ * @param votes (int*)
+ *        Receives the votes of query q for image i at q * images + i; holds
+ *        queries.size() * images ints.
+ *
+ * @return (void)
+ */
+void count_batch_votes(const std::vector<cv::Mat> &queries,
+                       const std::vector<cv::Mat> &query_filters,
+                       const std::vector<quine_store_chunk_t> &source,
+                       size_t images,
+                       const std::vector<bool> &tombstones,
+                       const float dratio,
+                       int *votes,
+                       quine_match_stats_t *stats = NULL);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief The image with the most votes, if the query has more than 5
+ *        keypoints and the image's votes pass accept_ratio of
+ *        AKAZE_KEYPOINTCOUNT, as compare_mat_souces accepts it.
+ *
+ * @param frequency (int*)
+ *        Receives the votes of the image with the most. May be NULL.
+ *
+ * @return (int) slot of the image, or -1 if none was accepted
+ */
+int select_voted_image(const int *votes,
+                       size_t images,
+                       const int query_count,
+                       const float accept_ratio,
+                       int *frequency = NULL);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief The top_k images with the most votes, most first. Images without
+ *        votes are left out.
+ *
+ * @return (void)
+ */
+void rank_voted_images(const int *votes,
+                       size_t images,
+                       size_t top_k,
+                       std::vector<quine_ranked_image_t> &ranked);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Finds the query features that match one image of the source, the
+ *        same way compare_mat_souces votes for it. Used once an image is
+ *        accepted, to know which query keypoints lie on it.
+ *
+ * @param slot (int)
+ *        Image slot, as returned by compare_mat_souces.
+ *
+ * @param query_rows (std::vector<int>)
+ *        Receives the query rows (keypoint indices) with at least one match,
+ *        in increasing order.
+ *
+ * @return (void)
+ */
+void matched_query_features(const cv::Mat &query,
+                            const cv::Mat &query_filter,
+                            const std::vector<quine_store_chunk_t> &source,
+                            int slot,
+                            const float dratio,
+                            std::vector<int> &query_rows);
+
+
+#endif /* defined(__Quine__QuineMatcher__) */
@@ -7,6 +7,8 @@
 //
 
 #include "QuineMemoryDatabase.h"
+#include "QuineGzip.h"
+#include "QuineLatency.h"
 
 
 #include <zlib.h>
@@ -24,56 +26,8 @@
 #include <vector>
 #include <algorithm>
 #include <iterator>
-
-
-#pragma mark -
-#pragma mark GZip compression routines
-/* ************************************************************************* */
-/*!
- * @brief Decompresses a Quine database file to a std::string, 
- *        and then loads the database source matrix and images indices.
- *
- * @param compressed_file_path (std::string)
- *        Full path to the gzipped binary database.
- *
- * @return (void)
- */
-std::vector<char> gzip_uncompress(const std::string &compressed_file_path)
-{
-    char outbuffer[1024*16];
-    gzFile infile = (gzFile)gzopen(compressed_file_path.c_str(), "rb");
-    std::vector<char> outfile;
-    gzrewind(infile);
-    while(!gzeof(infile))
-    {
-        int len = gzread(infile, outbuffer, sizeof(outbuffer));
-        outfile.insert(outfile.end(), outbuffer, outbuffer+len);
-    }
-    gzclose(infile);
-    return outfile;
-}
-
-
-/*
-bool gzip_compress(std::string &uncompressed_file_path, std::string  &compressed_file_path)
-{
-	FILE *infile = fopen(uncompressed_file_path, "rb");
-	gzFile outfile = gzopen(compressed_file_path, "wb");
-	if (!infile || !outfile)
-		return -1;
-	char inbuffer[128];
-	int num_read = 0;
-	unsigned long total_read = 0, total_wrote = 0;
-	while ((num_read = fread(inbuffer, 1, sizeof(inbuffer), infile)) > 0)
-	{
-		total_read += num_read;
-		gzwrite(outfile, inbuffer, num_read);
-	}
-	fclose(infile);
-	gzclose(outfile);
-	return true;
-}
-*/
+#include <atomic>
+#include <unistd.h>
 
 
 template<class ReturnType>
@@ -188,58 +142,202 @@ void get_file_extension(std::string &filename, std::string &ext) {
 }
 
 
+#pragma mark -
+#pragma mark QuineMemory | Singleton
+// Defined here rather than in the header, which several files include
+bool QuineMemory::instance_flag = false;
+QuineMemory* QuineMemory::s_instance = NULL;
+QuineMemory* QuineMemory::database()
+{
+    // Created exactly once, however many threads ask for it first
+    static std::once_flag once;
+    std::call_once(once, []() {
+        s_instance = new QuineMemory();
+        instance_flag = true;
+    });
+    return s_instance;
+}
+
+void QuineMemory::method()
+{
+    std::cout << "Method of the singleton class" << std::endl;
+}
+
+
 #pragma mark -
 #pragma mark QuineDatabaseOperations | Database Read/Write
 /* ************************************************************************* */
 /*!
  * @brief Reads the desciptors for a set of images in a .yaml.comp 
  *        gzipped compressed file. Also reads the index information 
- *        for the list of images as a comma separated string.
+ *        for the list of images into a string table.
  *
  * @param database_path (std::string)
  *        Full path to the binary database. This value will
  *        be used for both the .bin and .idx files.
  *
- * @param source (cv::Mat)
- *        OpenCV matrix containing the descriptor information for the dataset
- *        Initially this is unset.
+ * @param store (QuineDescriptorStore)
+ *        Store receiving the descriptor information for the dataset.
+ *        Initially this is empty.
  *
- * @param meta_json (std::string)
- *        JSON string containing index and meta information for the images
- *        contained in the array. Initially, this is unset
+ * @param meta_json (QuineStringTable)
+ *        Receives the index and meta information of each image contained
+ *        in the array. Initially, this is empty
+ *
+ * @param hashtable (cv::vector<std::string>)
+ *        Receives the content hash of each image, "" where none was saved.
+ *
+ * @param tombstones (std::vector<bool>)
+ *        Receives a flag per image, set for images deleted since the
+ *        file was written.
  *
  * @return (void)
  */
 void QuineMemory::load_database_from_file(const std::string &database_path,
-                                          cv::Mat &source,
-                                          cv::Mat &filter,
-                                          cv::vector<std::string> &meta_json)
+                                          QuineDescriptorStore &store,
+                                          QuineStringTable &meta_json,
+                                          cv::vector<std::string> &hashtable,
+                                          std::vector<bool> &tombstones)
 {
+    
+    // Let a running compaction finish replacing the files first
+    database_log(database_path)->wait();
+    
+    QuineLatencyTimer timer(QuineLatency::instance()->stage(QUINE_LATENCY_LOAD));
+    uint32_t log_segment = 0;
+    read_database_file(database_path, store, meta_json, hashtable, log_segment);
+    
+    // Databases written before hashes were saved have none; keep the
+    //   hashes aligned with the images either way
+    if(hashtable.size() != meta_json.size()) {
+        hashtable.resize(meta_json.size(), "");
+    }
+    
+    // Replay the images that were logged since the file was last written
+    std::vector<quine_log_entry_t> entries;
+    if(!database_log(database_path)->read(log_segment, entries)) {
+        std::cout << "[Quine: Error]: Could not read the log of database: " << database_path << std::endl;
+    }
+    
+    // The file holds no dead images; only logged deletions make tombstones
+    tombstones.assign(meta_json.size(), false);
+    if(entries.empty()) {
+        return;
+    }
+    
+    quine_image_slots_t images;
+    build_image_slots(meta_json, tombstones, images);
+    for(size_t i = 0; i < entries.size(); i++) {
+        apply_log_entry(entries[i], store, meta_json, hashtable, tombstones, images);
+    }
+    tombstones.resize(meta_json.size(), false);
+}
+
 
+/* ************************************************************************* */
+/*!
+ * @brief Hands the descriptors of a database file to the store. A file
+ *        whose descriptors do not line up is dropped as a whole.
+ *
+ * @return (bool) false if the store refused the descriptors
+ */
+static bool adopt_database(const std::string &database_path,
+                           const cv::Mat &source,
+                           const cv::Mat &filter,
+                           const std::shared_ptr<void> &owner,
+                           QuineDescriptorStore &store,
+                           QuineStringTable &meta_json,
+                           cv::vector<std::string> &hashtable)
+{
+    if(store.adopt(source, filter, owner)) {
+        return true;
+    }
+    
+    std::cout << "[Quine: Error]: Database descriptors do not match: " << database_path << std::endl;
+    meta_json.clear();
+    hashtable.clear();
+    return false;
+}
+
+
+void QuineMemory::read_database_file(const std::string &database_path,
+                                     QuineDescriptorStore &store,
+                                     QuineStringTable &meta_json,
+                                     cv::vector<std::string> &hashtable,
+                                     uint32_t &log_segment)
+{
+
+    cv::Mat source;
+    cv::Mat filter;
     std::string file_data;
     std::string yaml_path = database_path;
     std::string meta_string;
+    
+    // Sharded databases are a manifest listing their shards
+    quine_manifest_t manifest;
+    if(read_manifest(database_path, manifest)) {
+        if(read_sharded_database(database_path, manifest, store, meta_json, hashtable)) {
+            log_segment = manifest.log_segment;
+            std::lock_guard<std::mutex> guard(m_manifest_lock);
+            m_manifests.update(database_path, manifest);
+        }
+        return;
+    }
+    
+    // Raw databases are mapped in place; no decompression or parsing needed
+    if(is_mapped_database(database_path)) {
+        std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+        if(load_mapped_database(database_path, mapping, source, filter, meta_json, hashtable)) {
+            if(!adopt_database(database_path, source, filter, mapping, store, meta_json, hashtable)) {
+                return;
+            }
+            log_segment = ((const quine_db_header_t *)mapping->data())->log_segment;
+        }
+        return;
+    }
+    
     if(database_exists(yaml_path)) {
         
         std::string file_ext;
         get_file_extension(yaml_path, file_ext);
         
-        // Decomrpess the file data
-        std::vector<char> decompressed_buffer;
+        // Decompress the file data straight into the string handed to cv::FileStorage
+        std::string decompressed;
+        bool read_ok = false;
+        if (file_ext == "qdbz") {
+            
+            // Block gzipped raw databases are inflated (in parallel) into their final buffer
+            std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+            if(inflate_mapped_database(database_path, mapping, source, filter, meta_json, hashtable)) {
+                if(!adopt_database(database_path, source, filter, mapping, store, meta_json, hashtable)) {
+                    return;
+                }
+                log_segment = ((const quine_db_header_t *)mapping->data())->log_segment;
+            }
+            else {
+                std::cout << "[Quine: Error]: Could not inflate database: " << database_path << std::endl;
+            }
+            return;
+        }
+        
         if (file_ext == "bin") {
-            decompressed_buffer = gzip_uncompress(database_path);
+            
+            // .bin databases are gzipped YAML
+            read_ok = gzip_uncompress(database_path, decompressed);
         }
         else {
-            
             std::ifstream testFile(database_path, std::ios::binary);
-            std::vector<char> fileContents((std::istreambuf_iterator<char>(testFile)),
-                                           std::istreambuf_iterator<char>());
+            testFile.seekg(0, std::ios::end);
+            std::streamoff length = testFile.tellg();
+            testFile.seekg(0, std::ios::beg);
             
-            decompressed_buffer = fileContents;
+            if(length > 0) {
+                decompressed.resize((size_t)length);
+                read_ok = (bool)testFile.read(&decompressed[0], length);
+            }
         }
         
-        std::string decompressed( decompressed_buffer.begin(), decompressed_buffer.end() );
-        if (decompressed_buffer.size() == 0) {
+        if (!read_ok || decompressed.size() == 0) {
             printf( "Error decompressing file." );
             return;
         }
@@ -249,54 +347,32 @@ void QuineMemory::load_database_from_file(const std::string &database_path,
             cv::FileStorage storage(decompressed, cv::FileStorage::READ + cv::FileStorage::MEMORY);
             if(storage.isOpened()) {
                 
-                std::string meta_json_joined;
+                cv::vector<std::string> metadata;
+                int folded = 0;
                 
-                // Read the data
+                // Read the data. "idx" is a sequence with one entry per
+                //   image; very old databases joined it into one string.
                 storage["data"] >> source;
-                storage["idx"] >> meta_json_joined;
-                storage["class"] >> filter;
-                storage.release();
-             
-                // TEMPORARY DEBUGGING CODE
-                cv::Mat image1_row1 = source.row(0);
-                for (int n=0; n<64; n++) {
-                    printf("%f ", image1_row1.at<float>(0, n));
-                }
-                printf("\n-\n");
-                cv::Mat image1_row2 = source.row(1);
-                for (int n=0; n<64; n++) {
-                    printf("%f ", image1_row2.at<float>(0, n));
-                }
-                printf("\n\n");
-                
-                cv::Mat image2_row1 = source.row(50);
-                for (int n=0; n<64; n++) {
-                    printf("%f ", image2_row1.at<float>(0, n));
-                }
-                printf("\n-\n");
-                cv::Mat image2_row2 = source.row(51);
-                for (int n=0; n<64; n++) {
-                    printf("%f ", image2_row2.at<float>(0, n));
-                }
-                printf("\n\n");
-                
-                cv::Mat image3_row1 = source.row(100);
-                for (int n=0; n<64; n++) {
-                    printf("%f ", image3_row1.at<float>(0, n));
+                cv::FileNode idx = storage["idx"];
+                if(idx.isString()) {
+                    std::string meta_json_joined;
+                    idx >> meta_json_joined;
+                    std::istringstream iss(meta_json_joined);
+                    copy(std::istream_iterator<std::string>(iss),
+                         std::istream_iterator<std::string>(),
+                         std::back_inserter<cv::vector<std::string> >(metadata));
                 }
-                printf("\n-\n");
-                cv::Mat image3_row2 = source.row(101);
-                for (int n=0; n<64; n++) {
-                    printf("%f ", image3_row2.at<float>(0, n));
+                else {
+                    idx >> metadata;
                 }
-                printf("\n\n");
-                
-                // END TEMPORARY DEBUGGING CODE
+                storage["hash"] >> hashtable;
+                storage["class"] >> filter;
+                storage["log_segment"] >> folded;
+                storage.release();
                 
-                std::istringstream iss(meta_json_joined);
-                copy(std::istream_iterator<std::string>(iss),
-                     std::istream_iterator<std::string>(),
-                     std::back_inserter<cv::vector<std::string> >(meta_json));
+                log_segment = (uint32_t)folded;
+                meta_json.assign(metadata);
+                adopt_database(database_path, source, filter, std::shared_ptr<void>(), store, meta_json, hashtable);
                 
             }
             else {
@@ -307,6 +383,263 @@ void QuineMemory::load_database_from_file(const std::string &database_path,
 }
 
 
+#pragma mark -
+#pragma mark QuineDatabaseOperations | Sharded databases
+/* ************************************************************************* */
+/*!
+ * @brief cv::parallel_for_ body that reads a range of shards
+ */
+class QuineShardReadBody : public cv::ParallelLoopBody {
+public:
+    
+    typedef struct shard_contents {
+        std::shared_ptr<QuineDescriptorStore> store;
+        QuineStringTable meta;
+        cv::vector<std::string> hashtable;
+    } shard_contents_t;
+    
+    QuineShardReadBody(QuineMemory *memory,
+                       const std::string &database_path,
+                       const quine_manifest_t &manifest,
+                       std::vector<shard_contents_t> &contents,
+                       std::atomic<bool> *failed)
+    : m_memory(memory), m_path(database_path), m_manifest(manifest), m_contents(contents), m_failed(failed) { }
+    
+    void operator()(const cv::Range &range) const {
+        for(int i = range.start; i < range.end && !m_failed->load(); i++) {
+            const quine_shard_t &shard = m_manifest.shards[i];
+            std::string path = shard_path(m_path, shard.id);
+            
+            uint32_t crc = 0;
+            if(!file_crc32(path, crc) || crc != shard.crc) {
+                std::cout << "[Quine: Error]: Shard is missing or corrupt: " << path << std::endl;
+                m_failed->store(true);
+                continue;
+            }
+            
+            uint32_t folded = 0;
+            shard_contents_t &contents = m_contents[i];
+            contents.store.reset(new QuineDescriptorStore());
+            m_memory->read_database_file(path, *contents.store, contents.meta, contents.hashtable, folded);
+            
+            if(contents.meta.size() != shard.image_count) {
+                std::cout << "[Quine: Error]: Shard does not match the manifest: " << path << std::endl;
+                m_failed->store(true);
+            }
+        }
+    }
+    
+private:
+    QuineMemory *m_memory;
+    const std::string &m_path;
+    const quine_manifest_t &m_manifest;
+    std::vector<shard_contents_t> &m_contents;
+    std::atomic<bool> *m_failed;
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads every shard of a database in parallel, then chains them into
+ *        one database. The shards' descriptors and metadata are adopted as
+ *        they are; nothing is copied.
+ *
+ * @return (bool)
+ */
+bool QuineMemory::read_sharded_database(const std::string &database_path,
+                                        const quine_manifest_t &manifest,
+                                        QuineDescriptorStore &store,
+                                        QuineStringTable &meta_json,
+                                        cv::vector<std::string> &hashtable)
+{
+    std::vector<QuineShardReadBody::shard_contents_t> contents(manifest.shards.size());
+    std::atomic<bool> failed(false);
+    cv::parallel_for_(cv::Range(0, (int)manifest.shards.size()),
+                      QuineShardReadBody(this, database_path, manifest, contents, &failed));
+    
+    if(failed.load()) {
+        std::cout << "[Quine: Error]: Could not open database." << std::endl;
+        return false;
+    }
+    
+    for(size_t i = 0; i < contents.size(); i++) {
+        std::vector<quine_store_chunk_t> chunks;
+        contents[i].store->snapshot(chunks);
+        for(size_t c = 0; c < chunks.size(); c++) {
+            if(!store.adopt(chunks[c].desc, chunks[c].filter, chunks[c].owner)) {
+                std::cout << "[Quine: Error]: Shard descriptors do not match the database: "
+                          << shard_path(database_path, manifest.shards[i].id) << std::endl;
+                return false;
+            }
+        }
+        
+        meta_json.append(contents[i].meta);
+        contents[i].hashtable.resize(contents[i].meta.size(), "");
+        hashtable.insert(hashtable.end(), contents[i].hashtable.begin(), contents[i].hashtable.end());
+    }
+    
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes the live images of a shard's slot range to its file, and
+ *        records their count and the file's crc in the shard.
+ *
+ * @return (bool)
+ */
+bool QuineMemory::save_shard(const std::string &db,
+                             const std::vector<quine_store_chunk_t> &chunks,
+                             const QuineStringTable &metadata,
+                             const cv::vector<std::string> &hashtable,
+                             const std::vector<bool> &tombstones,
+                             quine_shard_t &shard)
+{
+    // Everything outside the shard counts as dead
+    std::vector<bool> dead(tombstones);
+    dead.resize(metadata.size(), false);
+    for(size_t i = 0; i < dead.size(); i++) {
+        if(i < shard.first_slot || i >= shard.end_slot) {
+            dead[i] = true;
+        }
+    }
+    
+    cv::Mat source, filter;
+    QuineDescriptorStore::gather(chunks, source, filter, &dead, AKAZEOptions::AKAZE_KEYPOINTCOUNT);
+    
+    QuineStringTable live_metadata;
+    cv::vector<std::string> live_hashtable;
+    for(size_t i = shard.first_slot; i < shard.end_slot && i < dead.size(); i++) {
+        if(dead[i]) {
+            continue;
+        }
+        live_metadata.push_back(metadata[i]);
+        live_hashtable.push_back(i < hashtable.size() ? hashtable[i] : "");
+    }
+    shard.image_count = (uint32_t)live_metadata.size();
+    
+    std::string path = shard_path(db, shard.id);
+    std::string file_ext = path.substr(path.find_last_of('.') + 1);
+    if(!save_database_to_file(path, source, filter, live_metadata, live_hashtable, file_ext == "bin", 0) ||
+       !file_crc32(path, shard.crc)) {
+        std::cout << "[Quine: Error]: Could not write shard: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes the changed shards of a database, then the manifest, then
+ *        deletes the shards it no longer lists. Until the manifest is
+ *        replaced, the previous shards are all still in place.
+ *
+ * @return (bool)
+ */
+bool QuineMemory::save_sharded_snapshot(const std::string &db,
+                                        const std::vector<quine_store_chunk_t> &chunks,
+                                        const QuineStringTable &metadata,
+                                        const cv::vector<std::string> &hashtable,
+                                        const std::vector<bool> &tombstones,
+                                        uint32_t log_segment)
+{
+    quine_manifest_t previous;
+    previous.log_segment = 0;
+    previous.next_id = 0;
+    bool was_sharded = false;
+    {
+        std::lock_guard<std::mutex> guard(m_manifest_lock);
+        if(m_manifests.dictionary.find(db) != m_manifests.dictionary.end()) {
+            previous = m_manifests.dictionary[db];
+            was_sharded = true;
+        }
+    }
+    
+    size_t slots = metadata.size();
+    quine_manifest_t manifest;
+    manifest.log_segment = log_segment;
+    manifest.next_id = previous.next_id;
+    
+    std::vector<uint32_t> stale;
+    size_t added = previous.shards.empty() ? 0 : previous.shards.back().end_slot;
+    
+    for(size_t s = 0; s < previous.shards.size(); s++) {
+        const quine_shard_t &old = previous.shards[s];
+        
+        // The last shard takes in the added images while it has room
+        if(s + 1 == previous.shards.size() && added < slots && old.image_count < QUINE_SHARD_IMAGES) {
+            added = old.first_slot;
+            stale.push_back(old.id);
+            break;
+        }
+        
+        // Slots only ever die, so an unchanged live count means an unchanged shard
+        size_t live = 0;
+        for(size_t i = old.first_slot; i < old.end_slot; i++) {
+            live += i >= tombstones.size() || !tombstones[i];
+        }
+        if(live == old.image_count) {
+            manifest.shards.push_back(old);
+            continue;
+        }
+        
+        stale.push_back(old.id);
+        if(live == 0) {
+            continue;
+        }
+        
+        quine_shard_t shard = old;
+        shard.id = manifest.next_id++;
+        if(!save_shard(db, chunks, metadata, hashtable, tombstones, shard)) {
+            return false;
+        }
+        manifest.shards.push_back(shard);
+    }
+    
+    // Added images go to new shards of up to QUINE_SHARD_IMAGES images
+    size_t first = added;
+    while(first < slots) {
+        size_t end = first;
+        size_t live = 0;
+        while(end < slots && live < QUINE_SHARD_IMAGES) {
+            live += end >= tombstones.size() || !tombstones[end];
+            end++;
+        }
+        
+        if(live > 0) {
+            quine_shard_t shard;
+            shard.id = manifest.next_id++;
+            shard.first_slot = first;
+            shard.end_slot = end;
+            if(!save_shard(db, chunks, metadata, hashtable, tombstones, shard)) {
+                return false;
+            }
+            manifest.shards.push_back(shard);
+        }
+        first = end;
+    }
+    
+    if(!write_manifest(db, manifest)) {
+        std::cout << "[Quine: Error]: Could not write manifest: " << manifest_path(db) << std::endl;
+        return false;
+    }
+    
+    // The manifest now decides; drop what it no longer lists
+    if(!was_sharded) {
+        unlink(db.c_str());
+    }
+    for(size_t i = 0; i < stale.size(); i++) {
+        unlink(shard_path(db, stale[i]).c_str());
+    }
+    
+    std::lock_guard<std::mutex> guard(m_manifest_lock);
+    m_manifests.update(db, manifest);
+    return true;
+}
+
+
 /* ************************************************************************* */
 /*!
  * @brief Saves images to a local database at the specified path into memory.
@@ -328,40 +661,60 @@ void QuineMemory::load_database_from_file(const std::string &database_path,
 bool QuineMemory::save_database_to_file(const std::string &database_path,
                                         const cv::Mat &source,
                                         const cv::Mat &filter,
-                                        const cv::vector<std::string> &meta_json,
+                                        const QuineStringTable &meta_json,
                                         const cv::vector<std::string> &hashtable,
-                                        bool should_compress=true)
+                                        bool should_compress,
+                                        uint32_t log_segment)
 {
 
-    // Initialize variables
-    std::ostringstream oss;
-    std::string compressed_extention = ".comp";
-    cv::Mat c;
-    
-    //Store the descriptors and data in the database file
-    std::string yaml_path = database_path;
-    cv::FileStorage storage(yaml_path, cv::FileStorage::WRITE);
+    QuineLatencyTimer timer(QuineLatency::instance()->stage(QUINE_LATENCY_SAVE));
+
+    std::string file_ext;
+    std::string ext_path = database_path;
+    get_file_extension(ext_path, file_ext);
     
-    cv::Mat filter_converted;
-    //filter.convertTo(filter_converted, CV_8U);
+    // .qdbz is the block gzipped mappable layout, inflated straight into place
+    if(file_ext == "qdbz") {
+        return save_compressed_mapped_database(database_path, source, filter, meta_json, hashtable, log_segment);
+    }
     
-    // Add the data
-    storage << "data" << source << "idx" << meta_json << "hash" << hashtable << "class" << filter;
+    // .bin stays gzipped YAML, so older readers can still load it; every
+    //   other extension but .yaml is the raw layout, mapped in place
+    if(file_ext != "yaml" && file_ext != "yml" && file_ext != "bin") {
+        return save_mapped_database(database_path, source, filter, meta_json, hashtable, log_segment);
+    }
     
-    // Release the cv::FileStorage variable
-    storage.release();
+    cv::vector<std::string> metadata;
+    meta_json.to_vector(metadata);
     
     if(should_compress) {
         
-        // Set the compressed file path name
-        std::string compressed_path = database_path;
-        //compressed_path = substr_replace(compressed_path, database_extention, compressed_extention);
-        
-        // Compress the file to binary
-        throw 130; // NOT YET IMPLEMENTED
+        // The YAML is compressed a few blocks at a time, so only it is held in full
+        cv::FileStorage storage(".yml", cv::FileStorage::WRITE + cv::FileStorage::MEMORY);
+        storage << "data" << source << "idx" << metadata << "hash" << hashtable << "class" << filter;
+        storage << "log_segment" << (int)log_segment;
+        std::string yaml = storage.releaseAndGetString();
+        return gzip_compress(yaml.data(), yaml.size(), database_path);
+    }
+    
+    //Store the descriptors and data in the database file, then replace it in one step
+    std::string tmp_path = database_path + ".tmp." + file_ext;
+    cv::FileStorage storage(tmp_path, cv::FileStorage::WRITE);
+    if(!storage.isOpened()) {
+        std::cout << "[Quine: Error]: Could not write database: " << database_path << std::endl;
+        return false;
+    }
+    storage << "data" << source << "idx" << metadata << "hash" << hashtable << "class" << filter;
+    storage << "log_segment" << (int)log_segment;
+    storage.release();
+    
+    if(rename(tmp_path.c_str(), database_path.c_str()) != 0) {
+        std::cout << "[Quine: Error]: Could not write database: " << database_path << std::endl;
+        unlink(tmp_path.c_str());
+        return false;
     }
     
-    return database_exists(yaml_path);
+    return database_exists(database_path);
 }
 
 
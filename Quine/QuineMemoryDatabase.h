@@ -9,27 +9,610 @@
 #ifndef __Quine__QuineMemoryDatabase__
 #define __Quine__QuineMemoryDatabase__
 
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "QuineDictionary.h"
+#include "QuineMappedDatabase.h"
+#include "QuineDatabaseLog.h"
+#include "QuineDatabaseDelta.h"
+#include "QuineDescriptorStore.h"
+#include "QuineDatabaseSnapshot.h"
+#include "QuineDatabaseHandle.h"
+#include "QuineHashIndex.h"
+#include "QuineStringTable.h"
+#include "QuineShardManifest.h"
+#include "AKAZEConfig.h"
 
 
 class QuineMemory
 {
 private:
     
-    Dict<std::string, cv::Mat> m_sources;
-    Dict<std::string, cv::Mat> m_filter;
-    Dict<std::string, cv::vector<std::string> > m_indicies;
+    // Descriptors and class filter of each database. A store owns (or holds
+    //   the mapping behind) its descriptors, so dropping it frees them.
+    Dict<std::string, std::shared_ptr<QuineDescriptorStore> > m_sources;
+    Dict<std::string, QuineStringTable> m_indicies;
     Dict<std::string, cv::vector<std::string> > m_hashtable;
     
+    // Content hash to image slot, and metadata (image id) to image slots, of
+    //   each database, so neither lookup scans the database. Only live
+    //   images are indexed. Logged changes keep the image slots up to date
+    //   as they are applied (see apply_log_entry()).
+    Dict<std::string, std::shared_ptr<QuineHashIndex> > m_hash_index;
+    Dict<std::string, std::shared_ptr<quine_image_slots_t> > m_image_index;
+    
+    // Flags of the images that were deleted or replaced. Dead images stay
+    //   in place (and are skipped by the matcher) until compaction leaves
+    //   them out of the database file. Slots past the end are live, so
+    //   appending never touches the flags and published snapshots share
+    //   them until the next deletion.
+    Dict<std::string, std::shared_ptr<std::vector<bool> > > m_tombstones;
+    
+    // Heap bytes of the hashes of each resident database, counted as
+    //   images are added so stats never walk the hashes again
+    Dict<std::string, size_t> m_hash_bytes;
+    
+    // Shards of each sharded database, with the image slots they cover.
+    //   Compaction (on its own thread) replaces them, hence the lock.
+    Dict<std::string, quine_manifest_t> m_manifests;
+    std::mutex m_manifest_lock;
+    
+    // Write-ahead logs that new images are appended to
+    Dict<std::string, std::shared_ptr<QuineDatabaseLog> > m_logs;
+    
+    // Snapshot of each resident database that queries pin (see
+    //   QuineDatabaseSnapshot.h). Writers publish a new registry with
+    //   std::atomic_store and queries read it with std::atomic_load, so
+    //   the query path takes no lock; queries in flight keep what they pinned.
+    std::shared_ptr<const quine_snapshot_registry_t> m_registry;
+    uint64_t m_generation;
+    
+    // Paths of every loaded database, resident or not, published the same
+    //   way so queries can list them without a lock or a copy
+    std::shared_ptr<const std::vector<std::string> > m_loaded;
+    
+    // Query counters of each database, kept across snapshots and evictions
+    Dict<std::string, std::shared_ptr<quine_database_usage_t> > m_usage;
+    
+    // Serializes changes to the dictionaries (loads, logged changes,
+    //   evictions, reloads) and every reader other than pin_database().
+    //   Recursive, since changes build on one another.
+    std::recursive_mutex m_write_lock;
+    
+    // Every database that was loaded, resident or not, with its counters.
+    //   Databases are (re)loaded on their first query and evicted least
+    //   recently used first once the resident ones exceed m_memory_budget.
+    Dict<std::string, quine_database_stats_t> m_stats;
+    size_t m_memory_budget;
+    std::atomic<uint64_t> m_clock;
+    
+    // Reads shards in parallel through read_database_file()
+    friend class QuineShardReadBody;
+    
     static bool instance_flag;
     static QuineMemory *s_instance;
-    QuineMemory() { }
+    QuineMemory() : m_registry(new quine_snapshot_registry_t()), m_generation(0),
+                    m_loaded(new std::vector<std::string>()), m_memory_budget(0), m_clock(0) { }
     
     virtual std::string substr_replace(std::string &s,
                                        std::string toReplace,
                                        std::string replaceWith);
     
     
+    /* ************************************************************************* */
+    /*!
+     * @brief Reads the database file itself, without replaying its log.
+     *
+     * @param log_segment (uint32_t)
+     *        Receives the last log segment folded into the file.
+     *
+     * @return (void)
+     */
+    virtual void read_database_file(const std::string &database_path,
+                                    QuineDescriptorStore &store,
+                                    QuineStringTable &meta_json,
+                                    cv::vector<std::string> &hashtable,
+                                    uint32_t &log_segment);
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Reads the shards of a sharded database in parallel, checking
+     *        each one against its crc in the manifest.
+     *
+     * @return (bool) false if a shard is missing or corrupt
+     */
+    virtual bool read_sharded_database(const std::string &database_path,
+                                       const quine_manifest_t &manifest,
+                                       QuineDescriptorStore &store,
+                                       QuineStringTable &meta_json,
+                                       cv::vector<std::string> &hashtable);
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Writes a snapshot of a sharded database. Only shards that lost
+     *        images, and the last shard if images were added, are rewritten;
+     *        added images beyond QUINE_SHARD_IMAGES go to new shards.
+     *
+     * @return (bool)
+     */
+    virtual bool save_sharded_snapshot(const std::string &db,
+                                       const std::vector<quine_store_chunk_t> &chunks,
+                                       const QuineStringTable &metadata,
+                                       const cv::vector<std::string> &hashtable,
+                                       const std::vector<bool> &tombstones,
+                                       uint32_t log_segment);
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Writes the live images of slots [first, end) as one shard.
+     *
+     * @return (bool)
+     */
+    bool save_shard(const std::string &db,
+                    const std::vector<quine_store_chunk_t> &chunks,
+                    const QuineStringTable &metadata,
+                    const cv::vector<std::string> &hashtable,
+                    const std::vector<bool> &tombstones,
+                    quine_shard_t &shard);
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Publishes the current state of a resident database as a new
+     *        snapshot, replacing the previous one in a single step.
+     *
+     * @return (void)
+     */
+    void publish_snapshot(const std::string &db) {
+        
+        if(m_sources.dictionary.find(db) == m_sources.dictionary.end()) {
+            retire_snapshot(db);
+            return;
+        }
+        
+        // Metadata and tombstones are shared, not copied (see QuineDatabaseSnapshot.h)
+        std::shared_ptr<quine_database_snapshot_t> snapshot(new quine_database_snapshot_t());
+        m_sources.dictionary[db]->snapshot(snapshot->chunks);
+        snapshot->metadata = m_indicies.dictionary[db];
+        snapshot->tombstones = database_tombstones(db);
+        snapshot->generation = ++m_generation;
+        
+        std::shared_ptr<quine_snapshot_registry_t> registry(new quine_snapshot_registry_t(*std::atomic_load(&m_registry)));
+        (*registry)[db].snapshot = snapshot;
+        (*registry)[db].usage = database_usage(db);
+        std::atomic_store(&m_registry, std::shared_ptr<const quine_snapshot_registry_t>(registry));
+    }
+    
+    
+    void retire_snapshot(const std::string &db) {
+        std::shared_ptr<const quine_snapshot_registry_t> current = std::atomic_load(&m_registry);
+        if(current->find(db) == current->end()) {
+            return;
+        }
+        std::shared_ptr<quine_snapshot_registry_t> registry(new quine_snapshot_registry_t(*current));
+        registry->erase(db);
+        std::atomic_store(&m_registry, std::shared_ptr<const quine_snapshot_registry_t>(registry));
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Currently published snapshot of a database, without loading it.
+     *
+     * @return (std::shared_ptr<const quine_database_snapshot_t>) empty if
+     *         the database isn't resident
+     */
+    std::shared_ptr<const quine_database_snapshot_t> published_snapshot(const std::string &db) {
+        std::shared_ptr<const quine_snapshot_registry_t> registry = std::atomic_load(&m_registry);
+        quine_snapshot_registry_t::const_iterator it = registry->find(db);
+        if(it == registry->end()) {
+            return std::shared_ptr<const quine_database_snapshot_t>();
+        }
+        return it->second.snapshot;
+    }
+    
+    
+    uint64_t snapshot_generation(const std::string &db) {
+        std::shared_ptr<const quine_database_snapshot_t> snapshot = published_snapshot(db);
+        return snapshot ? snapshot->generation : 0;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Makes a database just read from disk the resident copy and
+     *        publishes it. Empty databases are not kept.
+     *
+     * @return (void)
+     */
+    void install_loaded_database(const std::string &db,
+                                 const std::shared_ptr<QuineDescriptorStore> &store,
+                                 const QuineStringTable &metadata,
+                                 const cv::vector<std::string> &hashtable,
+                                 const std::vector<bool> &tombstones) {
+        
+        if(store->empty()) {
+            return;
+        }
+        
+        m_sources.update(db, store);
+        m_indicies.update(db, metadata);
+        m_hashtable.update(db, hashtable);
+        m_tombstones.update(db, std::shared_ptr<std::vector<bool> >(new std::vector<bool>(tombstones)));
+        build_indices(db, metadata, hashtable, tombstones);
+        publish_snapshot(db);
+        database_stats(db).misses++;
+        measure_database(db);
+        touch_database(db);
+        enforce_memory_budget(db);
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Marks a database as just used.
+     *
+     * @return (void)
+     */
+    void touch_database(const std::string &db) {
+        
+        quine_database_stats_t &stats = database_stats(db);
+        database_usage(db)->touch(++m_clock);
+        
+        stats.resident = m_sources.dictionary.find(db) != m_sources.dictionary.end();
+        stats.resident_bytes = stats.resident ? stats.footprint.total : 0;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Measures every section of a resident database, after it was
+     *        loaded or changed. Hashes never change once added, so only
+     *        those from slot first_unmeasured on are walked.
+     *
+     * @return (void)
+     */
+    void measure_database(const std::string &db, size_t first_unmeasured = 0) {
+        
+        quine_database_stats_t &stats = database_stats(db);
+        if(m_sources.dictionary.find(db) == m_sources.dictionary.end()) {
+            return;
+        }
+        
+        quine_database_footprint_t footprint;
+        memset(&footprint, 0, sizeof(footprint));
+        m_sources.dictionary[db]->footprint(footprint.descriptors, footprint.filter);
+        footprint.metadata = m_indicies.dictionary[db].memory_bytes();
+        
+        const cv::vector<std::string> &hashtable = m_hashtable.dictionary[db];
+        size_t &hash_bytes = m_hash_bytes.dictionary[db];
+        if(first_unmeasured == 0) {
+            hash_bytes = 0;
+        }
+        for(size_t i = first_unmeasured; i < hashtable.size(); i++) {
+            // Short hashes live inside the std::string itself
+            if(hashtable[i].capacity() >= sizeof(std::string)) {
+                hash_bytes += hashtable[i].capacity() + 1;
+            }
+        }
+        footprint.hashes = hashtable.capacity() * sizeof(std::string) + hash_bytes;
+        
+        if(m_hash_index.dictionary.find(db) != m_hash_index.dictionary.end()) {
+            footprint.indexes += m_hash_index.dictionary[db]->bytes();
+        }
+        if(m_image_index.dictionary.find(db) != m_image_index.dictionary.end()) {
+            footprint.indexes += m_image_index.dictionary[db]->bytes();
+        }
+        std::shared_ptr<std::vector<bool> > tombstones = database_tombstones(db);
+        footprint.tombstones = (tombstones->capacity() + 7) / 8;
+        
+        // A snapshot shares the metadata, and the tombstones unless a deletion followed it
+        std::shared_ptr<const quine_database_snapshot_t> snapshot = published_snapshot(db);
+        if(snapshot) {
+            footprint.snapshot = snapshot->chunks.capacity() * sizeof(quine_store_chunk_t);
+            if(snapshot->tombstones != tombstones) {
+                footprint.snapshot += (snapshot->tombstones->capacity() + 7) / 8;
+            }
+        }
+        
+        footprint.total = footprint.descriptors + footprint.filter + footprint.metadata + footprint.hashes +
+                          footprint.indexes + footprint.tombstones + footprint.snapshot;
+        stats.footprint = footprint;
+        stats.resident_bytes = footprint.total;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Evicts least recently used databases until a database about to
+     *        be loaded fits in the memory budget, so loading it never
+     *        overshoots. Its size is the footprint it had when last resident
+     *        or, the first time, the size of its file, plus room for the
+     *        largest query seen so far.
+     *
+     * @return (void)
+     */
+    void admit_database(const std::string &db) {
+        
+        if(m_memory_budget == 0) {
+            return;
+        }
+        
+        size_t incoming = 0;
+        if(m_stats.dictionary.find(db) != m_stats.dictionary.end()) {
+            incoming = m_stats.dictionary[db].footprint.total;
+        }
+        if(incoming == 0) {
+            struct stat info;
+            if(stat(db.c_str(), &info) == 0) {
+                incoming = (size_t)info.st_size;
+            }
+        }
+        
+        size_t query_bytes = 0;
+        for(std::map<std::string, std::shared_ptr<quine_database_usage_t> >::iterator it = m_usage.dictionary.begin();
+            it != m_usage.dictionary.end(); ++it) {
+            query_bytes = std::max(query_bytes, (size_t)it->second->peak_query_bytes);
+        }
+        
+        enforce_memory_budget(db, incoming + query_bytes);
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Evicts least recently used databases (other than keep) until the
+     *        resident databases, and reserved bytes more, fit in the memory
+     *        budget.
+     *
+     * @return (void)
+     */
+    void enforce_memory_budget(const std::string &keep, size_t reserved = 0) {
+        
+        if(m_memory_budget == 0) {
+            return;
+        }
+        
+        while(true) {
+            size_t resident_bytes = 0;
+            std::string lru;
+            uint64_t lru_time = std::numeric_limits<uint64_t>::max();
+            
+            for(std::map<std::string, quine_database_stats_t>::iterator it = m_stats.dictionary.begin();
+                it != m_stats.dictionary.end(); ++it) {
+                if(!it->second.resident) {
+                    continue;
+                }
+                resident_bytes += it->second.resident_bytes;
+                uint64_t last_used = database_usage(it->first)->last_used;
+                if(it->first != keep && last_used < lru_time) {
+                    lru = it->first;
+                    lru_time = last_used;
+                }
+            }
+            
+            if(resident_bytes + reserved <= m_memory_budget || lru.empty()) {
+                return;
+            }
+            
+            // Everything is on disk (file + log), so dropping it loses nothing.
+            //   Queries that pinned its snapshot keep the memory until they finish.
+            retire_snapshot(lru);
+            m_sources.pop(lru);
+            m_indicies.pop(lru);
+            m_hashtable.pop(lru);
+            m_hash_index.pop(lru);
+            m_image_index.pop(lru);
+            forget_manifest(lru);
+            m_tombstones.pop(lru);
+            m_hash_bytes.pop(lru);
+            m_stats.dictionary[lru].resident = false;
+            m_stats.dictionary[lru].resident_bytes = 0;
+            m_stats.dictionary[lru].evictions++;
+        }
+    }
+    
+    
+    quine_database_stats_t &database_stats(const std::string &db) {
+        if(m_stats.dictionary.find(db) == m_stats.dictionary.end()) {
+            quine_database_stats_t stats;
+            memset(&stats, 0, sizeof(stats));
+            m_stats.update(db, stats);
+            publish_loaded();
+        }
+        return m_stats.dictionary[db];
+    }
+    
+    
+    void publish_loaded() {
+        std::shared_ptr<const std::vector<std::string> > loaded(new std::vector<std::string>(m_stats.keys()));
+        std::atomic_store(&m_loaded, loaded);
+    }
+    
+    
+    std::shared_ptr<quine_database_usage_t> database_usage(const std::string &db) {
+        if(m_usage.dictionary.find(db) == m_usage.dictionary.end()) {
+            m_usage.update(db, std::shared_ptr<quine_database_usage_t>(new quine_database_usage_t()));
+        }
+        return m_usage.dictionary[db];
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Writes a snapshot of a database, leaving out its dead images.
+     *
+     * @return (bool)
+     */
+    bool save_database_snapshot(const std::string &db,
+                                const std::vector<quine_store_chunk_t> &chunks,
+                                const QuineStringTable &metadata,
+                                const cv::vector<std::string> &hashtable,
+                                const std::vector<bool> &tombstones,
+                                uint32_t log_segment) {
+        
+        // Large databases (and any that already are) are written as shards
+        size_t live = metadata.size();
+        for(size_t i = 0; i < tombstones.size() && i < metadata.size(); i++) {
+            live -= tombstones[i];
+        }
+        if(is_sharded(db) || live > QUINE_SHARD_IMAGES) {
+            return save_sharded_snapshot(db, chunks, metadata, hashtable, tombstones, log_segment);
+        }
+        
+        cv::Mat source, filter;
+        QuineDescriptorStore::gather(chunks, source, filter, &tombstones, AKAZEOptions::AKAZE_KEYPOINTCOUNT);
+        
+        QuineStringTable live_metadata;
+        cv::vector<std::string> live_hashtable;
+        live_metadata.reserve(metadata.size(), metadata.bytes());
+        for(size_t i = 0; i < metadata.size(); i++) {
+            if(i < tombstones.size() && tombstones[i]) {
+                continue;
+            }
+            live_metadata.push_back(metadata[i]);
+            if(hashtable.size() == metadata.size()) {
+                live_hashtable.push_back(hashtable[i]);
+            }
+        }
+        
+        std::string file_ext = db.substr(db.find_last_of('.') + 1);
+        return save_database_to_file(db, source, filter, live_metadata, live_hashtable, file_ext == "bin", log_segment);
+    }
+    
+    
+    bool is_sharded(const std::string &db) {
+        std::lock_guard<std::mutex> guard(m_manifest_lock);
+        return m_manifests.dictionary.find(db) != m_manifests.dictionary.end();
+    }
+    
+    
+    void forget_manifest(const std::string &db) {
+        std::lock_guard<std::mutex> guard(m_manifest_lock);
+        m_manifests.pop(db);
+    }
+    
+    
+    std::shared_ptr<QuineDatabaseLog> database_log(const std::string &db) {
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        if(m_logs.dictionary.find(db) == m_logs.dictionary.end()) {
+            m_logs.update(db, std::shared_ptr<QuineDatabaseLog>(new QuineDatabaseLog(db)));
+        }
+        return m_logs.dictionary[db];
+    }
+    
+    
+    std::shared_ptr<std::vector<bool> > &database_tombstones(const std::string &db) {
+        std::shared_ptr<std::vector<bool> > &tombstones = m_tombstones.dictionary[db];
+        if(!tombstones) {
+            tombstones.reset(new std::vector<bool>());
+        }
+        return tombstones;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Rebuilds the hash and image id indices of a database.
+     *
+     * @return (void)
+     */
+    void build_indices(const std::string &db,
+                       const QuineStringTable &metadata,
+                       const cv::vector<std::string> &hashtable,
+                       const std::vector<bool> &tombstones) {
+        
+        std::shared_ptr<QuineHashIndex> hashes(new QuineHashIndex());
+        hashes->build(hashtable, tombstones);
+        
+        // Indexed in place; no string is copied out of the table
+        std::shared_ptr<quine_image_slots_t> images(new quine_image_slots_t());
+        build_image_slots(metadata, tombstones, *images);
+        
+        m_hash_index.update(db, hashes);
+        m_image_index.update(db, images);
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Brings the hash index of a database up to date with a change:
+     *        drops the images that just died, then adds the live slots from
+     *        first_new on. The image slots were updated by the change itself.
+     *
+     * @param killed (std::vector<uint32_t>)
+     *        Slots the change tombstoned (see apply_log_entry()).
+     *
+     * @return (void)
+     */
+    void update_indices(const std::string &db,
+                        size_t first_new,
+                        const std::vector<uint32_t> &killed,
+                        const cv::vector<std::string> &hashtable) {
+        
+        const std::vector<bool> &tombstones = *database_tombstones(db);
+        std::shared_ptr<QuineHashIndex> hashes = m_hash_index.dictionary[db];
+        
+        // An entry is only dropped if it still points at the dead slot
+        for(size_t k = 0; k < killed.size(); k++) {
+            uint32_t i = killed[k], slot = 0;
+            if(i < hashtable.size() && hashes->find(hashtable[i], slot) && slot == i) {
+                hashes->erase(hashtable[i]);
+            }
+        }
+        
+        for(size_t i = first_new; i < hashtable.size(); i++) {
+            if(i >= tombstones.size() || !tombstones[i]) {
+                hashes->insert(hashtable[i], (uint32_t)i);
+            }
+        }
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Reads a database from disk unless it is in memory, without
+     *        copying anything out of it.
+     *
+     * @return (void)
+     */
+    void make_resident(const std::string &db, bool force) {
+        
+        // Check if the database is in memory
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        if(m_sources.dictionary.find(db) != m_sources.dictionary.end() && !force) {
+            database_usage(db)->hits++;
+            touch_database(db);
+            return;
+        }
+        
+        //Not found (or evicted), so load the database from the disk.
+        //  Queries keep matching the previous snapshot until the new one is published.
+        if(m_sources.dictionary.find(db) == m_sources.dictionary.end()) {
+            admit_database(db);
+        }
+        std::shared_ptr<QuineDescriptorStore> store(new QuineDescriptorStore());
+        QuineStringTable metadata;
+        cv::vector<std::string> hashtable;
+        std::vector<bool> tombstones;
+        load_database_from_file(db, *store, metadata, hashtable, tombstones);
+        
+        // Add the information to the singleton sources,
+        //   so long as the database info is correct (i.e., not empty).
+        install_loaded_database(db, store, metadata, hashtable, tombstones);
+    }
+    
+    
 public:
     static QuineMemory* database();
     void method();
@@ -40,13 +623,15 @@ public:
     
     std::vector<std::string> get_database_paths() {
         
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        
         //Make sure that the same number of keys exist for both m_sources and m_indicies.
         //  By having the same number of keys, the assumption is that the keys themselves are the same.
         //  Might not be the best logic, but hey, it works so go with it.
         assert(m_sources.keys().size() == m_indicies.keys().size());
         
-        //Send back the keys for m_sources (and assumed m_indicies)
-        return m_sources.keys();
+        //Send back every loaded database, including those currently evicted
+        return m_stats.keys();
     }
     
     std::vector<std::string> list_loaded_databases() {
@@ -54,29 +639,35 @@ public:
     }
     
     
+    /* ************************************************************************* */
+    /*!
+     * @brief Paths of every loaded database, resident or not, without a lock
+     *        or a copy. The list is immutable; a later load publishes a new one.
+     *
+     * @return (std::shared_ptr<const std::vector<std::string> >)
+     */
+    std::shared_ptr<const std::vector<std::string> > loaded_databases() {
+        return std::atomic_load(&m_loaded);
+    }
+    
+    
     
     void load_database(const std::string &db, bool force) {
         
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        
         //Initial declarations
-        cv::Mat source;
-        cv::Mat filter;
-        cv::vector<std::string> metadata;
+        std::shared_ptr<QuineDescriptorStore> store;
+        QuineStringTable metadata;
+        cv::vector<std::string> hashtable;
         
-        // Check if the database has been read from the disk
-        std::vector<std::string> keys = get_database_paths();
-        if(std::find(keys.begin(), keys.end(), db) == keys.end() || force) {
-            
-            //Not found, so load the database from the disk
-            load_database_from_file(db, source, filter, metadata);
-            source.convertTo(source, CV_32FC1);
-            
-            //Check to see if a database was loaded. If not, this is the first use of the database
-            if(!source.empty()) {
-                m_sources.update(db, source);
-                m_filter.update(db, filter);
-                m_indicies.update(db, metadata);
-            }
+        // With a memory budget, the database is only read on its first query
+        if(m_memory_budget > 0 && !force) {
+            database_stats(db);
+            return;
         }
+        
+        get_database(db, store, metadata, hashtable, force);
     }
     
     
@@ -86,70 +677,620 @@ public:
     
     
     void load_images(const std::string &db, std::vector<std::string> &images) {
-        images = m_indicies.get(db);
+        std::shared_ptr<QuineDescriptorStore> store;
+        QuineStringTable metadata;
+        cv::vector<std::string> hashtable;
+        get_database(db, store, metadata, hashtable, false);
+        metadata.to_vector(images);
     }
     
     
     void unload_database(const std::string &db) {
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        retire_snapshot(db);
         m_sources.pop(db);
         m_indicies.pop(db);
+        m_hashtable.pop(db);
+        m_hash_index.pop(db);
+        m_image_index.pop(db);
+        forget_manifest(db);
+        m_tombstones.pop(db);
+        m_hash_bytes.pop(db);
+        m_stats.pop(db);
+        m_usage.pop(db);
+        publish_loaded();
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Sets how many bytes the resident databases may take in total.
+     *        Least recently queried databases are evicted beyond it, and
+     *        reloaded on their next query. 0 (the default) means no limit.
+     *
+     * @return (void)
+     */
+    void set_memory_budget(size_t bytes) {
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        m_memory_budget = bytes;
+        enforce_memory_budget("");
+    }
+    
+    
+    size_t get_memory_budget() {
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        return m_memory_budget;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Residency and hit/miss counters of a loaded database.
+     *
+     * @return (bool) false if the database was never loaded
+     */
+    bool get_database_stats(const std::string &db, quine_database_stats_t &stats) {
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        if(m_stats.dictionary.find(db) == m_stats.dictionary.end()) {
+            return false;
+        }
+        stats = m_stats.dictionary[db];
+        stats.hits = database_usage(db)->hits;
+        stats.last_used = database_usage(db)->last_used;
+        stats.peak_query_bytes = database_usage(db)->peak_query_bytes;
+        return true;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Bytes taken by every resident database.
+     *
+     * @return (size_t)
+     */
+    size_t get_resident_bytes() {
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        size_t total = 0;
+        for(std::map<std::string, quine_database_stats_t>::iterator it = m_stats.dictionary.begin();
+            it != m_stats.dictionary.end(); ++it) {
+            if(it->second.resident) {
+                total += it->second.resident_bytes;
+            }
+        }
+        return total;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Records the transient bytes a query against a database used
+     *        (see quine_match_stats_t). Lock free, for query threads.
+     *
+     * @return (void)
+     */
+    void record_query_bytes(const std::string &db, size_t bytes) {
+        std::shared_ptr<const quine_snapshot_registry_t> registry = std::atomic_load(&m_registry);
+        quine_snapshot_registry_t::const_iterator it = registry->find(db);
+        if(it == registry->end()) {
+            return;
+        }
+        std::atomic<size_t> &peak = it->second.usage->peak_query_bytes;
+        size_t current = peak.load();
+        while(bytes > current && !peak.compare_exchange_weak(current, bytes)) { }
     }
     
     
     void get_database(const std::string &db,
-                      cv::Mat &source,
-                      cv::Mat &filter,
-                      cv::vector<std::string> &metadata,
+                      std::shared_ptr<QuineDescriptorStore> &store,
+                      QuineStringTable &metadata,
                       cv::vector<std::string> &hashtable,
                       bool force)
     {
-
-        // Check if the database has been read from the disk
-        std::vector<std::string> keys = get_database_paths();
-        if(std::find(keys.begin(), keys.end(), db) == keys.end() || force) {
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        make_resident(db, force);
+        
+        // Copies of the database as it is now; an empty store if it couldn't be loaded
+        if(m_sources.dictionary.find(db) == m_sources.dictionary.end()) {
+            store.reset(new QuineDescriptorStore());
+            metadata.clear();
+            hashtable.clear();
+            return;
+        }
+        store = m_sources.dictionary[db];
+        metadata = m_indicies.dictionary[db];
+        hashtable = m_hashtable.dictionary[db];
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Pins the current snapshot of a database for a query, loading the
+     *        database if it isn't resident. The snapshot never changes, so the
+     *        query can use it without any lock for as long as it holds it.
+     *
+     * @return (std::shared_ptr<const quine_database_snapshot_t>) empty if the
+     *         database can't be loaded
+     */
+    std::shared_ptr<const quine_database_snapshot_t> pin_database(const std::string &db)
+    {
+        // Lock free: any number of query threads pin concurrently
+        {
+            std::shared_ptr<const quine_snapshot_registry_t> registry = std::atomic_load(&m_registry);
+            quine_snapshot_registry_t::const_iterator it = registry->find(db);
+            if(it != registry->end()) {
+                it->second.usage->hits++;
+                it->second.usage->touch(++m_clock);
+                return it->second.snapshot;
+            }
+        }
+        
+        // Not resident; the first thread to get here loads it, the others
+        //   find it loaded once they get the lock
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        std::shared_ptr<QuineDescriptorStore> store;
+        QuineStringTable metadata;
+        cv::vector<std::string> hashtable;
+        get_database(db, store, metadata, hashtable, false);
+        return published_snapshot(db);
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Opens a read-only handle on a database for a query (see
+     *        QuineDatabaseHandle.h), loading the database if it isn't resident.
+     *
+     * @return (QuineDatabaseHandle) invalid if the database can't be loaded
+     */
+    QuineDatabaseHandle open_database(const std::string &db)
+    {
+        return QuineDatabaseHandle(pin_database(db));
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Reloads a database from disk and swaps the new copy in. The
+     *        files are read without holding up queries or changes; if the
+     *        database changes meanwhile, the copy may be missing the change
+     *        and is read again.
+     *
+     * @return (bool) true if the database was loaded
+     */
+    bool reload_database(const std::string &db)
+    {
+        for(int attempt = 0; attempt < 3; attempt++) {
+            uint64_t generation = snapshot_generation(db);
             
-            //Not found, so load the database from the disk
-            load_database_from_file(db, source, filter, metadata);
+            std::shared_ptr<QuineDescriptorStore> store(new QuineDescriptorStore());
+            QuineStringTable metadata;
+            cv::vector<std::string> hashtable;
+            std::vector<bool> tombstones;
+            load_database_from_file(db, *store, metadata, hashtable, tombstones);
             
-            // Add the information to the singleton sources,
-            //   so long as the database info is correct (i.e., not empty).
-            if(!source.empty()) {
-                m_sources.update(db, source);
-                m_filter.update(db, filter);
-                m_indicies.update(db, metadata);
+            std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+            if(snapshot_generation(db) != generation) {
+                continue;
             }
-            
+            install_loaded_database(db, store, metadata, hashtable, tombstones);
+            return !store->empty();
         }
         
-        else {
-            // Database is currently loaded, so grab the dictionary
-            source = m_sources.dictionary[db];
-            filter = m_filter.dictionary[db];
-            metadata = m_indicies.dictionary[db];
+        // Still changing; read it while holding changes off
+        std::shared_ptr<QuineDescriptorStore> store;
+        QuineStringTable metadata;
+        cv::vector<std::string> hashtable;
+        get_database(db, store, metadata, hashtable, true);
+        return store && !store->empty();
+    }
+    
+    
+    std::future<bool> reload_database_async(const std::string &db)
+    {
+        return std::async(std::launch::async, [this, db]() { return reload_database(db); });
+    }
+    
+    
+    QuineStringTable get_indices(const std::string &db)
+    {
+        std::shared_ptr<const quine_database_snapshot_t> snapshot = published_snapshot(db);
+        return snapshot ? snapshot->metadata : QuineStringTable();
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Flags of the deleted (or replaced) images of a loaded database,
+     *        one per image, in the order of get_indices().
+     *
+     * @return (std::vector<bool>)
+     */
+    std::vector<bool> get_tombstones(const std::string &db)
+    {
+        std::shared_ptr<const quine_database_snapshot_t> snapshot = published_snapshot(db);
+        if(!snapshot) {
+            return std::vector<bool>();
         }
+        std::vector<bool> tombstones = *snapshot->tombstones;
+        tombstones.resize(snapshot->metadata.size(), false);
+        return tombstones;
     }
     
     
-    cv::vector<std::string> get_indices(const std::string &db)
+    /* ************************************************************************* */
+    /*!
+     * @brief Checks whether a live image with the given content hash is
+     *        already in a database, loading the database if needed.
+     *
+     * @return (bool)
+     */
+    bool contains_image(const std::string &db, const std::string &hash)
     {
-        return m_indicies.dictionary[db];
+        if(hash.empty()) {
+            return false;
+        }
+        
+        // Looked up in place; nothing is copied out of the database
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        make_resident(db, false);
+        if(m_hash_index.dictionary.find(db) == m_hash_index.dictionary.end()) {
+            return false;
+        }
+        
+        // The index holds fingerprints, so confirm against the hash itself
+        uint32_t slot = 0;
+        if(!m_hash_index.dictionary[db]->find(hash, slot)) {
+            return false;
+        }
+        const cv::vector<std::string> &hashtable = m_hashtable.dictionary[db];
+        return slot < hashtable.size() && hashtable[slot] == hash;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Finds the slot of the live image with the given metadata (the
+     *        most recently added one, if several share it).
+     *
+     * @return (bool) false if no live image has this metadata
+     */
+    bool find_image(const std::string &db, const std::string &meta, uint32_t &slot)
+    {
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        if(m_image_index.dictionary.find(db) == m_image_index.dictionary.end()) {
+            return false;
+        }
+        
+        const QuineStringTable &metadata = m_indicies.dictionary[db];
+        return m_image_index.dictionary[db]->latest.find(meta, slot) &&
+               slot < metadata.size() && metadata.equals(slot, meta);
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Logs changes to a database and applies them in memory.
+     *
+     *        The changes are appended to the database's write-ahead log, so
+     *        the cost on disk is the size of the changes rather than the size
+     *        of the database. Once enough records have accumulated the log is
+     *        compacted in the background. The in-memory database is changed
+     *        in place rather than copied out and back.
+     *
+     * @return (bool) true if the changes were persisted
+     */
+    bool log_database_changes(const std::string &db, const std::vector<quine_log_entry_t> &entries) {
+        
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        make_resident(db, false);
+        
+        // Log first; a change is only made once it is durable
+        std::shared_ptr<QuineDatabaseLog> log = database_log(db);
+        if(!log->append(entries)) {
+            return false;
+        }
+        
+        // A new (or empty) database starts out empty in memory
+        if(m_sources.dictionary.find(db) == m_sources.dictionary.end()) {
+            m_sources.update(db, std::shared_ptr<QuineDescriptorStore>(new QuineDescriptorStore()));
+            m_indicies.update(db, QuineStringTable());
+            m_hashtable.update(db, cv::vector<std::string>());
+            m_tombstones.pop(db);
+        }
+        
+        // The change is made in place. Published snapshots only see the
+        //   rows and metadata they were published with, and appending never
+        //   touches those; the tombstones are copied first if a snapshot
+        //   still shares them and the change deletes anything.
+        QuineDescriptorStore &store = *m_sources.dictionary[db];
+        QuineStringTable &metadata = m_indicies.dictionary[db];
+        cv::vector<std::string> &hashtable = m_hashtable.dictionary[db];
+        std::shared_ptr<std::vector<bool> > &tombstones = database_tombstones(db);
+        if(m_hash_index.dictionary.find(db) == m_hash_index.dictionary.end() ||
+           m_image_index.dictionary.find(db) == m_image_index.dictionary.end()) {
+            build_indices(db, metadata, hashtable, *tombstones);
+        }
+        for(size_t i = 0; i < entries.size(); i++) {
+            if(entries[i].type != QUINE_LOG_ADD_IMAGE && tombstones.use_count() > 1) {
+                tombstones.reset(new std::vector<bool>(*tombstones));
+                break;
+            }
+        }
+        
+        size_t slots = metadata.size();
+        std::vector<uint32_t> killed;
+        for(size_t i = 0; i < entries.size(); i++) {
+            apply_log_entry(entries[i], store, metadata, hashtable, *tombstones, *m_image_index.dictionary[db], &killed);
+        }
+        update_indices(db, slots, killed, hashtable);
+        
+        publish_snapshot(db);
+        measure_database(db, slots);
+        touch_database(db);
+        enforce_memory_budget(db);
+        
+        if(log->pending_records() >= QUINE_LOG_COMPACT_RECORDS) {
+            compact_database(db);
+        }
+        return true;
+    }
+    
+    
+    bool log_database_change(const std::string &db, const quine_log_entry_t &entry) {
+        return log_database_changes(db, std::vector<quine_log_entry_t>(1, entry));
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Adds one image to a database.
+     *
+     * @return (bool) true if the image was persisted
+     */
+    bool append_image(const std::string &db,
+                      const cv::Mat &desc,
+                      const cv::Mat &desc_filter,
+                      const std::string &meta,
+                      const std::string &hash) {
+        
+        quine_log_entry_t entry;
+        entry.type = QUINE_LOG_ADD_IMAGE;
+        entry.desc = desc;
+        entry.filter = desc_filter;
+        entry.meta = meta;
+        entry.hash = hash;
+        
+        if(!log_database_change(db, entry)) {
+            std::cout << "[Quine: Error]: Image failed to add to database" << std::endl;
+            return false;
+        }
+        std::cout << "[Quine: Success]: Image was added to database" << std::endl;
+        return true;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Deletes every image with the given metadata from a database.
+     *
+     *        The images are only tombstoned: the matcher skips them right
+     *        away, and compaction leaves them out of the database file.
+     *
+     * @return (bool) true if the deletion was persisted
+     */
+    bool delete_image(const std::string &db, const std::string &meta) {
+        
+        quine_log_entry_t entry;
+        entry.type = QUINE_LOG_DELETE_IMAGE;
+        entry.meta = meta;
+        
+        if(!log_database_change(db, entry)) {
+            std::cout << "[Quine: Error]: Image failed to delete from database" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Replaces every image with the given metadata by a new image,
+     *        as one logged change.
+     *
+     * @return (bool) true if the replacement was persisted
+     */
+    bool replace_image(const std::string &db,
+                       const cv::Mat &desc,
+                       const cv::Mat &desc_filter,
+                       const std::string &meta,
+                       const std::string &hash) {
+        
+        quine_log_entry_t entry;
+        entry.type = QUINE_LOG_REPLACE_IMAGE;
+        entry.desc = desc;
+        entry.filter = desc_filter;
+        entry.meta = meta;
+        entry.hash = hash;
+        
+        if(!log_database_change(db, entry)) {
+            std::cout << "[Quine: Error]: Image failed to replace in database" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Synced version of a database (see QuineDatabaseDelta.h).
+     *
+     * @return (uint64_t) 0 if the database was never synced
+     */
+    uint64_t get_database_version(const std::string &db) {
+        return read_database_version(db);
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Brings a database to a newer version with a sync delta. The
+     *        changes are logged and applied in memory like local changes,
+     *        so neither the file nor the in-memory copy is rebuilt.
+     *
+     * @return (bool) false if the delta is unreadable or is not based on
+     *         the database's current version; the caller then downloads
+     *         the whole database instead
+     */
+    bool apply_database_delta(const std::string &db, const std::string &delta_path) {
+        
+        quine_delta_t delta;
+        if(!read_delta(delta_path, delta)) {
+            return false;
+        }
+        
+        uint64_t version = read_database_version(db);
+        if(version == delta.version) {
+            return true;
+        }
+        if(version != delta.base_version) {
+            std::cout << "[Quine: Error]: Delta is based on version " << delta.base_version
+                      << " but database is at version " << version << ": " << db << std::endl;
+            return false;
+        }
+        
+        // The version only moves once every change is durable. A crash before
+        //   that leaves the old version, and the delta is simply applied again.
+        if(!delta.entries.empty() && !log_database_changes(db, delta.entries)) {
+            std::cout << "[Quine: Error]: Could not apply delta to database: " << db << std::endl;
+            return false;
+        }
+        return write_database_version(db, delta.version);
+    }
+    
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Replaces a database by a complete downloaded copy, at the given
+     *        version. Its log, shards and in-memory copy belong to the old
+     *        file and are dropped; the database is reloaded if it was loaded.
+     *
+     * @return (bool)
+     */
+    bool install_database(const std::string &db, const std::string &downloaded_path, uint64_t version) {
+        
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        
+        // A compaction still writing the old database would overwrite the new one
+        if(!database_log(db)->discard()) {
+            std::cout << "[Quine: Error]: Could not discard the log of database: " << db << std::endl;
+            return false;
+        }
+        
+        // The manifest takes precedence over the file, so retire it and its shards
+        quine_manifest_t manifest;
+        if(read_manifest(db, manifest)) {
+            unlink(manifest_path(db).c_str());
+            for(size_t i = 0; i < manifest.shards.size(); i++) {
+                unlink(shard_path(db, manifest.shards[i].id).c_str());
+            }
+        }
+        forget_manifest(db);
+        
+        if(rename(downloaded_path.c_str(), db.c_str()) != 0) {
+            std::cout << "[Quine: Error]: Could not install database: " << db << std::endl;
+            return false;
+        }
+        if(!write_database_version(db, version)) {
+            return false;
+        }
+        
+        bool loaded = m_sources.dictionary.find(db) != m_sources.dictionary.end();
+        retire_snapshot(db);
+        m_sources.pop(db);
+        m_indicies.pop(db);
+        m_hashtable.pop(db);
+        m_hash_index.pop(db);
+        m_image_index.pop(db);
+        m_tombstones.pop(db);
+        m_hash_bytes.pop(db);
+        if(loaded) {
+            load_database(db, true);
+        }
+        else if(m_stats.dictionary.find(db) != m_stats.dictionary.end()) {
+            m_stats.dictionary[db].resident = false;
+            m_stats.dictionary[db].resident_bytes = 0;
+        }
+        return true;
     }
     
+    
+    /* ************************************************************************* */
+    /*!
+     * @brief Folds the write-ahead log of a database into the database file.
+     *
+     *        The in-memory database (which already includes every logged
+     *        record) is written on a background thread, without its dead
+     *        images, and atomically renamed over the database file; the
+     *        folded log segments are then deleted.
+     *
+     * @return (bool) true if a compaction was started
+     */
+    bool compact_database(const std::string &db) {
+        
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        if(m_sources.dictionary.find(db) == m_sources.dictionary.end()) {
+            return false;
+        }
+        
+        // Snapshot the database as of now. The chunks are reference counted,
+        //   and later appends never write into rows the snapshot covers.
+        std::vector<quine_store_chunk_t> chunks;
+        m_sources.dictionary[db]->snapshot(chunks);
+        QuineStringTable metadata = m_indicies.dictionary[db];
+        cv::vector<std::string> hashtable = m_hashtable.dictionary[db];
+        std::shared_ptr<const std::vector<bool> > tombstones = database_tombstones(db);
+        
+        return database_log(db)->compact_async([=](uint32_t sealed) {
+            return save_database_snapshot(db, chunks, metadata, hashtable, *tombstones, sealed);
+        });
+    }
+    
+    
     void update_database(const std::string &db,
-                         cv::Mat &source,
-                         cv::Mat &filter,
-                         cv::vector<std::string> &meta,
+                         const std::shared_ptr<QuineDescriptorStore> &store,
+                         QuineStringTable &meta,
                          cv::vector<std::string> &hashtable,
                          bool save) {
         
+        std::lock_guard<std::recursive_mutex> guard(m_write_lock);
+        
         // Update the memory copies of the database
-        m_filter.update(db, filter);
-        m_sources.update(db, source);
+        m_sources.update(db, store);
         m_indicies.update(db, meta);
+        m_hashtable.update(db, hashtable);
+        publish_snapshot(db);
+        measure_database(db);
+        touch_database(db);
+        enforce_memory_budget(db);
         
-        // If specified, save the database to disk
+        // If specified, save the database to disk. .bin databases are compressed.
+        //   Any log is folded at the same time, since the file now contains it.
         if(save) {
-            if(save_database_to_file(db, source, filter, meta, hashtable, false)) {
+            std::shared_ptr<QuineDatabaseLog> log = database_log(db);
+            log->wait();
+            
+            bool saved = false;
+            if(compact_database(db)) {
+                log->wait();
+                saved = log->pending_records() == 0;
+            }
+            else {
+                std::vector<quine_store_chunk_t> chunks;
+                store->snapshot(chunks);
+                saved = save_database_snapshot(db, chunks, meta, hashtable, *database_tombstones(db), 0);
+            }
+            
+            if(saved) {
                 std::cout << "[Quine: Success]: Image was assed to database" << std::endl;
             }
             else {
@@ -163,33 +1304,59 @@ public:
     /*!
      * @brief Reads the desciptors for a set of images in a .bin file.
      *        Reads the index information for each image in a .idx (json format) file.
+     *        Raw .qdb databases are memory mapped rather than read, in which case
+     *        the store holds the mapping.
      *
      * @param database_path (std::string)
      *        Full path to the binary database. This value will
      *        be used for both the .bin and .idx files.
      *
-     * @param idx_json (std::string)
-     *        JSON string containing index and meta information for the images
-     *        contained in the array. Initially, this is unset
+     * @param meta_json (QuineStringTable)
+     *        Receives the index and meta information of each image contained
+     *        in the array. Raw databases keep it in place in the mapping.
+     *
+     * @param store (QuineDescriptorStore)
+     *        Store receiving the descriptor information for the dataset.
+     *        Initially this is empty.
      *
-     * @param source_descriptors (cv::Mat)
-     *        OpenCV matrix containing the descriptor information for the dataset
-     *        Initially this is unset.
+     * @param hashtable (cv::vector<std::string>)
+     *        Receives the content hash of each image, in the order of
+     *        meta_json. Images saved without a hash get "".
      *
      * @return (void)
      */
     virtual void load_database_from_file(const std::string &database_path,
-                                         cv::Mat &source,
-                                         cv::Mat &filter,
-                                         cv::vector<std::string> &meta_json);
+                                         QuineDescriptorStore &store,
+                                         QuineStringTable &meta_json,
+                                         cv::vector<std::string> &hashtable,
+                                         std::vector<bool> &tombstones);
     
     
+    /* ************************************************************************* */
+    /*!
+     * @brief Writes a database to disk, replacing the file atomically.
+     *
+     *        The extension picks the format:
+     *          .yaml, .yml -> YAML, gzipped when should_compress
+     *          .bin        -> YAML, gzipped when should_compress as block
+     *                         gzip, which any gzip reader still inflates
+     *          .qdbz       -> the .qdb layout as block gzip, inflated in
+     *                         parallel straight into place on load
+     *          otherwise   -> the raw .qdb layout, mapped on load
+     *        (see QuineMappedDatabase.h and QuineGzip.h).
+     *
+     * @param log_segment (uint32_t)
+     *        Last write-ahead log segment contained in the database.
+     *
+     * @return (bool)
+     */
     virtual bool save_database_to_file(const std::string &database_path,
                                        const cv::Mat &source,
                                        const cv::Mat &filter,
-                                       const cv::vector<std::string> &meta_json,
+                                       const QuineStringTable &meta_json,
                                        const cv::vector<std::string> &hashtable,
-                                       bool should_compress);
+                                       bool should_compress,
+                                       uint32_t log_segment = 0);
     
     
     /* ************************************************************************* */
@@ -203,26 +1370,4 @@ public:
     
 };
 
-bool QuineMemory::instance_flag = false;
-QuineMemory* QuineMemory::s_instance = NULL;
-QuineMemory* QuineMemory::database()
-{
-    if(!instance_flag)
-    {
-        s_instance = new QuineMemory();
-        instance_flag = true;
-        return s_instance;
-    }
-    else
-    {
-        return s_instance;
-    }
-}
-
-void QuineMemory::method()
-{
-    std::cout << "Method of the singleton class" << std::endl;
-}
-
-
 #endif /* defined(__Quine__QuineMemoryDatabase__) */
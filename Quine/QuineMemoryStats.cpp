@@ -0,0 +1,45 @@
+//
+//  QuineMemoryStats.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineMemoryStats.h"
+
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+
+bool read_allocator_stats(quine_allocator_stats_t &stats)
+{
+    memset(&stats, 0, sizeof(stats));
+
+#if defined(__APPLE__)
+    malloc_statistics_t zone;
+    malloc_zone_statistics(NULL, &zone);
+    stats.in_use = zone.size_in_use;
+    stats.peak_in_use = zone.max_size_in_use;
+    stats.reserved = zone.size_allocated;
+    return true;
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    stats.in_use = info.uordblks + info.hblkhd;
+    stats.reserved = info.arena + info.hblkhd;
+    return true;
+#elif defined(__GLIBC__)
+    // Older glibc counts in int, so large heaps wrap
+    struct mallinfo info = mallinfo();
+    stats.in_use = (size_t)(unsigned int)info.uordblks + (size_t)(unsigned int)info.hblkhd;
+    stats.reserved = (size_t)(unsigned int)info.arena + (size_t)(unsigned int)info.hblkhd;
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,49 @@
+//
+//  QuineMemoryStats.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineMemoryStats__
+#define __Quine__QuineMemoryStats__
+
+#include <stddef.h>
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Process-wide heap counters, as the system allocator reports them.
+ */
+typedef struct quine_allocator_stats {
+
+    /*!
+     * Bytes handed out by malloc and not freed yet
+     */
+    size_t in_use;
+
+    /*!
+     * Most bytes ever in use at once, where the allocator keeps track (0 otherwise)
+     */
+    size_t peak_in_use;
+
+    /*!
+     * Bytes the allocator holds from the system, in use or free
+     */
+    size_t reserved;
+
+} quine_allocator_stats_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads the heap counters of the default malloc zone (Apple) or of
+ *        the glibc arenas.
+ *
+ * @return (bool) false if the platform doesn't report them
+ */
+bool read_allocator_stats(quine_allocator_stats_t &stats);
+
+
+#endif /* defined(__Quine__QuineMemoryStats__) */
@@ -0,0 +1,96 @@
+//
+//  QuineSPSCQueue.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineSPSCQueue__
+#define __Quine__QuineSPSCQueue__
+
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineSPSCQueue
+ *
+ *  @abstract   Bounded, lock-free queue between one producer thread and
+ *              one consumer thread.
+ *
+ *  @discussion A ring of capacity + 1 slots: the producer only writes the
+ *              tail and the consumer only writes the head, so neither ever
+ *              waits on the other. Items are moved in and out. A full
+ *              queue refuses the push; what to do then (drop, retry) is up
+ *              to the producer.
+ */
+template <class T>
+class QuineSPSCQueue {
+public:
+
+    explicit QuineSPSCQueue(size_t capacity)
+    : m_slots(capacity + 1), m_head(0), m_tail(0) { }
+
+
+    /*!
+     * Producer only. Leaves item untouched if the queue is full.
+     */
+    bool try_push(T &item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = increment(tail);
+        if(next == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        m_slots[tail] = std::move(item);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+
+    /*!
+     * Consumer only
+     */
+    bool try_pop(T &item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(m_slots[head]);
+        m_slots[head] = T();
+        m_head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+
+    /*!
+     * Items queued; only exact when neither side is busy
+     */
+    size_t size() const {
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : tail + m_slots.size() - head;
+    }
+
+    size_t capacity() const { return m_slots.size() - 1; }
+
+private:
+
+    size_t increment(size_t index) const { return index + 1 == m_slots.size() ? 0 : index + 1; }
+
+    std::vector<T> m_slots;
+
+    // Head and tail on cache lines of their own, so the two threads
+    //   don't invalidate each other's line on every operation
+    char m_pad0[64];
+    std::atomic<size_t> m_head;
+    char m_pad1[64];
+    std::atomic<size_t> m_tail;
+    char m_pad2[64];
+};
+
+
+#endif /* defined(__Quine__QuineSPSCQueue__) */
@@ -0,0 +1,155 @@
+//
+//  QuineShardManifest.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineShardManifest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+
+std::string manifest_path(const std::string &database_path)
+{
+    return database_path + ".manifest";
+}
+
+
+std::string shard_path(const std::string &database_path, uint32_t id)
+{
+    std::ostringstream name;
+    size_t slash = database_path.find_last_of('/');
+    size_t dot = database_path.find_last_of('.');
+
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        name << database_path << ".shard" << id;
+    }
+    else {
+        name << database_path.substr(0, dot) << ".shard" << id << database_path.substr(dot);
+    }
+    return name.str();
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads the manifest of a database.
+ *
+ * @return (bool)
+ */
+bool read_manifest(const std::string &database_path, quine_manifest_t &manifest)
+{
+    std::ifstream in(manifest_path(database_path).c_str());
+    if(!in.good()) {
+        return false;
+    }
+
+    std::string magic;
+    int version = 0;
+    if(!(in >> magic >> version) || magic != "quine-manifest" || version > QUINE_MANIFEST_VERSION) {
+        std::cout << "[Quine: Error]: Not a valid manifest: " << manifest_path(database_path) << std::endl;
+        return false;
+    }
+
+    manifest.log_segment = 0;
+    manifest.next_id = 0;
+    manifest.shards.clear();
+
+    std::string key;
+    size_t slot = 0;
+    while(in >> key) {
+        if(key == "log_segment") {
+            in >> manifest.log_segment;
+        }
+        else if(key == "next_shard") {
+            in >> manifest.next_id;
+        }
+        else if(key == "shard") {
+            quine_shard_t shard;
+            in >> shard.id >> shard.image_count >> std::hex >> shard.crc >> std::dec;
+            shard.first_slot = slot;
+            shard.end_slot = slot + shard.image_count;
+            slot = shard.end_slot;
+            manifest.shards.push_back(shard);
+        }
+        else {
+            std::string ignored;
+            std::getline(in, ignored);
+        }
+
+        if(in.fail()) {
+            std::cout << "[Quine: Error]: Manifest is truncated: " << manifest_path(database_path) << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes the manifest next to its destination, syncs it, and renames
+ *        it into place.
+ *
+ * @return (bool)
+ */
+bool write_manifest(const std::string &database_path, const quine_manifest_t &manifest)
+{
+    std::ostringstream out;
+    out << "quine-manifest " << QUINE_MANIFEST_VERSION << "\n";
+    out << "log_segment " << manifest.log_segment << "\n";
+    out << "next_shard " << manifest.next_id << "\n";
+    for(size_t i = 0; i < manifest.shards.size(); i++) {
+        const quine_shard_t &shard = manifest.shards[i];
+        out << "shard " << shard.id << " " << shard.image_count << " " << std::hex << shard.crc << std::dec << "\n";
+    }
+    std::string text = out.str();
+
+    std::string path = manifest_path(database_path);
+    std::string tmp_path = path + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if(!f) {
+        return false;
+    }
+
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok = (fflush(f) == 0) && ok;
+    ok = (fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+
+    if(!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool file_crc32(const std::string &path, uint32_t &crc)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if(!f) {
+        return false;
+    }
+
+    std::vector<char> buffer(1 << 20);
+    uLong sum = crc32(0L, Z_NULL, 0);
+    size_t n = 0;
+    while((n = fread(&buffer[0], 1, buffer.size(), f)) > 0) {
+        sum = crc32(sum, (const Bytef *)&buffer[0], (uInt)n);
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    crc = (uint32_t)sum;
+    return ok;
+}
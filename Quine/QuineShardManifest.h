@@ -0,0 +1,115 @@
+//
+//  QuineShardManifest.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineShardManifest__
+#define __Quine__QuineShardManifest__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Sharded databases.
+ *
+ *        A large database is split into shards of at most QUINE_SHARD_IMAGES
+ *        images. Each shard is an ordinary database file in the database's
+ *        own format, named <name>.shard<id>.<ext> next to it, and the
+ *        database itself is the manifest <database>.manifest listing them:
+ *
+ *          quine-manifest 1
+ *          log_segment <last log segment folded into the shards>
+ *          next_shard <id of the next shard to be written>
+ *          shard <id> <image count> <crc32 of the shard file, hex>
+ *          ...
+ *
+ *        Shards load (and are matched) in parallel, and compaction only
+ *        rewrites the shards whose images changed. The manifest is replaced
+ *        atomically, so readers see either the old or the new set of shards.
+ */
+#define QUINE_SHARD_IMAGES          4096
+#define QUINE_MANIFEST_VERSION      1
+
+
+typedef struct quine_shard {
+
+    /*!
+     * Shard file id, see shard_path()
+     */
+    uint32_t id;
+
+    /*!
+     * Images in the shard file and crc32 of the file
+     */
+    uint32_t image_count;
+    uint32_t crc;
+
+    /*!
+     * Image slots of the in-memory database the shard covers, [first, end).
+     *   Images deleted after the shard was written keep their slot (as
+     *   tombstones) until the database is reloaded.
+     */
+    size_t first_slot;
+    size_t end_slot;
+
+} quine_shard_t;
+
+
+typedef struct quine_manifest {
+
+    uint32_t log_segment;
+    uint32_t next_id;
+    std::vector<quine_shard_t> shards;
+
+} quine_manifest_t;
+
+
+std::string manifest_path(const std::string &database_path);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Path of a shard file: the database path with .shard<id> inserted
+ *        before its extension, so the shard keeps the database's format.
+ *
+ * @return (std::string)
+ */
+std::string shard_path(const std::string &database_path, uint32_t id);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads the manifest of a database. The slot ranges are laid out
+ *        back to back from the image counts.
+ *
+ * @return (bool) false if the database is not sharded or the manifest
+ *         can't be parsed
+ */
+bool read_manifest(const std::string &database_path, quine_manifest_t &manifest);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Replaces the manifest of a database atomically.
+ *
+ * @return (bool)
+ */
+bool write_manifest(const std::string &database_path, const quine_manifest_t &manifest);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief crc32 of a whole file.
+ *
+ * @return (bool) false if the file can't be read
+ */
+bool file_crc32(const std::string &path, uint32_t &crc);
+
+
+#endif /* defined(__Quine__QuineShardManifest__) */
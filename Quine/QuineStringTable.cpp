@@ -0,0 +1,284 @@
+//
+//  QuineStringTable.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineStringTable.h"
+
+#include <string.h>
+#include <algorithm>
+
+
+// References in the first run of an arena (as a power of 2)
+#define QUINE_STRING_TABLE_FIRST_RUN_BITS   8
+
+// Smallest and largest block an arena packs strings into
+#define QUINE_STRING_TABLE_MIN_BLOCK        (4*1024)
+#define QUINE_STRING_TABLE_MAX_BLOCK        (1024*1024)
+
+
+QuineStringTable::QuineStringTable()
+: m_base_count(0), m_count(0), m_bytes(0)
+{
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reference to string i of an arena. Run k holds references
+ *        [2^(k+b) - 2^b, 2^(k+b+1) - 2^b), b = QUINE_STRING_TABLE_FIRST_RUN_BITS.
+ *
+ * @return (const string_ref_t&)
+ */
+const QuineStringTable::string_ref_t &QuineStringTable::find_ref(const string_arena_t &arena, size_t i)
+{
+    uint64_t v = (uint64_t)i + (1ULL << QUINE_STRING_TABLE_FIRST_RUN_BITS);
+    int top = 63 - __builtin_clzll(v);
+    return arena.runs[top - QUINE_STRING_TABLE_FIRST_RUN_BITS][v - (1ULL << top)];
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Copies a string into the arena as string i. Only the copy that
+ *        claimed slot i calls this, so nothing else writes the arena.
+ *
+ * @return (void)
+ */
+void QuineStringTable::store_string(string_arena_t &arena, size_t i, const char *s, size_t length)
+{
+    if(length > arena.block_left) {
+        arena.block_bytes = std::min(std::max(arena.block_bytes * 2, (size_t)QUINE_STRING_TABLE_MIN_BLOCK),
+                                     (size_t)QUINE_STRING_TABLE_MAX_BLOCK);
+        size_t bytes = std::max(arena.block_bytes, length);
+        arena.blocks.push_back(std::unique_ptr<char[]>(new char[bytes]));
+        arena.block = arena.blocks.back().get();
+        arena.block_left = bytes;
+        arena.allocated += bytes;
+    }
+
+    string_ref_t ref;
+    ref.bytes = "";
+    ref.length = (uint32_t)length;
+    if(length > 0) {
+        ref.bytes = arena.block;
+        memcpy(arena.block, s, length);
+        arena.block += length;
+        arena.block_left -= length;
+    }
+
+    uint64_t v = (uint64_t)i + (1ULL << QUINE_STRING_TABLE_FIRST_RUN_BITS);
+    int top = 63 - __builtin_clzll(v);
+    std::unique_ptr<string_ref_t[]> &run = arena.runs[top - QUINE_STRING_TABLE_FIRST_RUN_BITS];
+    if(!run) {
+        run.reset(new string_ref_t[(size_t)1 << top]);
+        arena.allocated += ((size_t)1 << top) * sizeof(string_ref_t);
+    }
+    run[v - (1ULL << top)] = ref;
+}
+
+
+void QuineStringTable::append_string(const char *s, size_t length)
+{
+    // Claim the next slot of the arena. If another copy already took it,
+    //   this copy carries on with its strings in an arena of its own.
+    size_t expected = m_count;
+    if(!m_arena || !m_arena->count.compare_exchange_strong(expected, m_count + 1)) {
+        std::shared_ptr<string_arena_t> arena(new string_arena_t());
+        for(size_t i = 0; i < m_count; i++) {
+            const string_ref_t &ref = find_ref(*m_arena, i);
+            store_string(*arena, i, ref.bytes, ref.length);
+        }
+        arena->count = m_count + 1;
+        m_arena = arena;
+    }
+
+    store_string(*m_arena, m_count, s, length);
+    m_count++;
+    m_bytes += length;
+}
+
+
+void QuineStringTable::adopt(const char *bytes,
+                             const uint32_t *offsets,
+                             size_t count,
+                             const std::shared_ptr<void> &owner)
+{
+    clear();
+    if(count == 0) {
+        return;
+    }
+
+    segment_t segment;
+    segment.bytes = bytes;
+    segment.offsets = offsets;
+    segment.first = 0;
+    segment.count = count;
+    segment.owner = owner;
+    m_segments.push_back(segment);
+    m_base_count = count;
+}
+
+
+void QuineStringTable::assign(const std::vector<std::string> &strings)
+{
+    size_t total = 0;
+    for(size_t i = 0; i < strings.size(); i++) {
+        total += strings[i].size();
+    }
+
+    clear();
+    reserve(strings.size(), total);
+    for(size_t i = 0; i < strings.size(); i++) {
+        push_back(strings[i]);
+    }
+}
+
+
+void QuineStringTable::append(const QuineStringTable &other)
+{
+    size_t i = 0;
+
+    // Runs, and the arena, can only be shared in front of the strings owned by the table
+    if(m_count == 0) {
+        for(size_t s = 0; s < other.m_segments.size(); s++) {
+            segment_t segment = other.m_segments[s];
+            segment.first = m_base_count;
+            m_segments.push_back(segment);
+            m_base_count += segment.count;
+        }
+        m_arena = other.m_arena;
+        m_count = other.m_count;
+        m_bytes = other.m_bytes;
+        i = other.size();
+    }
+
+    for(; i < other.size(); i++) {
+        size_t length = 0;
+        const char *s = other.data(i, length);
+        append_string(s, length);
+    }
+}
+
+
+void QuineStringTable::push_back(const std::string &s)
+{
+    append_string(s.data(), s.size());
+}
+
+
+void QuineStringTable::clear()
+{
+    m_segments.clear();
+    m_base_count = 0;
+
+    m_arena.reset();
+    m_count = 0;
+    m_bytes = 0;
+}
+
+
+void QuineStringTable::reserve(size_t count, size_t bytes)
+{
+    // Only a table with no strings of its own starts a fresh arena
+    if(m_count > 0 || (count == 0 && bytes == 0)) {
+        return;
+    }
+
+    m_arena.reset(new string_arena_t());
+    if(bytes > 0) {
+        m_arena->blocks.push_back(std::unique_ptr<char[]>(new char[bytes]));
+        m_arena->block = m_arena->blocks.back().get();
+        m_arena->block_left = bytes;
+        m_arena->block_bytes = std::min(bytes, (size_t)QUINE_STRING_TABLE_MAX_BLOCK);
+        m_arena->allocated = bytes;
+    }
+}
+
+
+const char *QuineStringTable::data(size_t i, size_t &length) const
+{
+    if(i < m_base_count) {
+
+        // Almost always a single run; otherwise find the last run starting at or before i
+        size_t s = m_segments.size() - 1;
+        if(s > 0) {
+            size_t lo = 0, hi = s;
+            while(lo < hi) {
+                size_t mid = (lo + hi + 1) / 2;
+                if(m_segments[mid].first <= i) {
+                    lo = mid;
+                }
+                else {
+                    hi = mid - 1;
+                }
+            }
+            s = lo;
+        }
+
+        const segment_t &segment = m_segments[s];
+        size_t j = i - segment.first;
+        length = segment.offsets[j + 1] - segment.offsets[j];
+        return segment.bytes + segment.offsets[j];
+    }
+
+    const string_ref_t &ref = find_ref(*m_arena, i - m_base_count);
+    length = ref.length;
+    return ref.bytes;
+}
+
+
+std::string QuineStringTable::operator[](size_t i) const
+{
+    size_t length = 0;
+    const char *s = data(i, length);
+    return std::string(s, length);
+}
+
+
+bool QuineStringTable::equals(size_t i, const std::string &s) const
+{
+    size_t length = 0;
+    const char *d = data(i, length);
+    return length == s.size() && memcmp(d, s.data(), length) == 0;
+}
+
+
+size_t QuineStringTable::bytes() const
+{
+    size_t total = m_bytes;
+    for(size_t s = 0; s < m_segments.size(); s++) {
+        total += m_segments[s].offsets[m_segments[s].count] - m_segments[s].offsets[0];
+    }
+    return total;
+}
+
+
+size_t QuineStringTable::memory_bytes() const
+{
+    size_t total = arena_bytes();
+    for(size_t s = 0; s < m_segments.size(); s++) {
+        total += m_segments[s].offsets[m_segments[s].count] - m_segments[s].offsets[0];
+        total += (m_segments[s].count + 1) * sizeof(uint32_t);
+    }
+    return total;
+}
+
+
+size_t QuineStringTable::arena_bytes() const
+{
+    return (m_arena ? m_arena->allocated.load() : 0) + m_segments.capacity() * sizeof(segment_t);
+}
+
+
+void QuineStringTable::to_vector(std::vector<std::string> &strings) const
+{
+    strings.clear();
+    strings.reserve(size());
+    for(size_t i = 0; i < size(); i++) {
+        strings.push_back((*this)[i]);
+    }
+}
@@ -0,0 +1,184 @@
+//
+//  QuineStringTable.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineStringTable__
+#define __Quine__QuineStringTable__
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+// Runs of string references an arena can have; run k holds twice as many
+//   as run k - 1, so this bounds nothing in practice
+#define QUINE_STRING_TABLE_RUNS 40
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineStringTable
+ *
+ *  @abstract   Metadata strings of a database, one per image slot.
+ *
+ *  @discussion A table loaded from a .qdb file adopts the file's META
+ *              section in place (see QuineMappedDatabase.h), and a sharded
+ *              database adopts one such section per shard. Strings appended
+ *              after loading go to an append-only arena, where they are
+ *              packed into a few large blocks and never move.
+ *
+ *              Copying a table copies nothing but a reference to the arena
+ *              and the number of its strings the copy sees. Appending to
+ *              the copy that ends where the arena ends writes in place,
+ *              past what every other copy reads, so a published copy stays
+ *              valid (and readable from other threads) while the original
+ *              keeps growing. Appending to any other copy first moves its
+ *              strings to an arena of its own.
+ */
+class QuineStringTable {
+public:
+
+    QuineStringTable();
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Replaces the table by count strings that are already laid out
+     *        as offsets[count + 1] into bytes, without copying them.
+     *
+     * @param owner (std::shared_ptr<void>)
+     *        Object that owns bytes and offsets (e.g. a mapped file).
+     *
+     * @return (void)
+     */
+    void adopt(const char *bytes,
+               const uint32_t *offsets,
+               size_t count,
+               const std::shared_ptr<void> &owner);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Replaces the table by a copy of strings.
+     *
+     * @return (void)
+     */
+    void assign(const std::vector<std::string> &strings);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Appends every string of another table. Its adopted strings are
+     *        shared rather than copied, as long as this table has no
+     *        strings of its own yet.
+     *
+     * @return (void)
+     */
+    void append(const QuineStringTable &other);
+
+
+    void push_back(const std::string &s);
+    void clear();
+    void reserve(size_t count, size_t bytes);
+
+
+    size_t size() const { return m_base_count + m_count; }
+    bool empty() const { return size() == 0; }
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Pointer to the bytes of string i (not null terminated).
+     *
+     * @return (const char*)
+     */
+    const char *data(size_t i, size_t &length) const;
+
+
+    std::string operator[](size_t i) const;
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Compares string i to s without copying it.
+     *
+     * @return (bool)
+     */
+    bool equals(size_t i, const std::string &s) const;
+
+
+    /*!
+     * Bytes of string data, adopted or not
+     */
+    size_t bytes() const;
+
+
+    /*!
+     * Bytes the table takes: string data and offsets, adopted or not
+     */
+    size_t memory_bytes() const;
+
+
+    /*!
+     * Bytes of the arena appended strings live in, which every copy of the
+     * table shares
+     */
+    size_t arena_bytes() const;
+
+
+    void to_vector(std::vector<std::string> &strings) const;
+
+private:
+
+    // Adopted strings, in runs that start at string first; never written
+    typedef struct segment {
+        const char *bytes;
+        const uint32_t *offsets;
+        size_t first;
+        size_t count;
+        std::shared_ptr<void> owner;
+    } segment_t;
+
+    std::vector<segment_t> m_segments;
+    size_t m_base_count;
+
+    typedef struct string_ref {
+        const char *bytes;
+        uint32_t length;
+    } string_ref_t;
+
+    // Appended strings of a table and its copies. References are kept in
+    //   runs of doubling size rather than one growing array, so writing a
+    //   new one never moves those other copies read.
+    typedef struct string_arena {
+        std::unique_ptr<string_ref_t[]> runs[QUINE_STRING_TABLE_RUNS];
+        std::vector<std::unique_ptr<char[]> > blocks;
+        char *block;
+        size_t block_left;
+        size_t block_bytes;
+
+        // Strings written so far, by any copy, and bytes allocated for them
+        std::atomic<size_t> count;
+        std::atomic<size_t> allocated;
+
+        string_arena() : block(NULL), block_left(0), block_bytes(0), count(0), allocated(0) { }
+    } string_arena_t;
+
+    static const string_ref_t &find_ref(const string_arena_t &arena, size_t i);
+    static void store_string(string_arena_t &arena, size_t i, const char *s, size_t length);
+    void append_string(const char *s, size_t length);
+
+    // Appended strings: the first m_count strings of m_arena
+    std::shared_ptr<string_arena_t> m_arena;
+    size_t m_count;
+    size_t m_bytes;
+};
+
+
+#endif /* defined(__Quine__QuineStringTable__) */
@@ -0,0 +1,305 @@
+//
+//  QuineSyntheticDatabase.cpp
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineSyntheticDatabase.h"
+#include "AKAZEConfig.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+
+
+/* ************************************************************************* */
+/*!
+ * @brief splitmix64 of the seed and an index: the random state of one image.
+ *
+ * @return (uint64_t)
+ */
+static uint64_t mix_seed(uint64_t seed, uint64_t index)
+{
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (index + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return z ? z : 1;
+}
+
+
+static void normalize_row(float *row, int columns)
+{
+    double norm = 0.0;
+    for(int c = 0; c < columns; c++) {
+        norm += (double)row[c] * row[c];
+    }
+    if(norm <= 0.0) {
+        return;
+    }
+    float scale = (float)(1.0 / std::sqrt(norm));
+    for(int c = 0; c < columns; c++) {
+        row[c] *= scale;
+    }
+}
+
+
+#pragma mark -
+#pragma mark Models
+void default_descriptor_model(quine_descriptor_model_t &model)
+{
+    model.columns = AKAZEOptions::AKAZE_FEATURECOUNT;
+    model.mean.assign(model.columns, 0.0f);
+    model.deviation.assign(model.columns, 0.0f);
+
+    // Each subregion sums dx, dy, |dx| and |dy|
+    for(int c = 0; c < model.columns; c++) {
+        bool absolute = c % 4 >= 2;
+        model.mean[c] = absolute ? 0.14f : 0.0f;
+        model.deviation[c] = absolute ? 0.08f : 0.12f;
+    }
+
+    model.class_weights.resize(QUINE_SYNTHETIC_CLASSES);
+    for(int c = 0; c < QUINE_SYNTHETIC_CLASSES; c++) {
+        model.class_weights[c] = std::pow(0.8, c);
+    }
+
+    model.short_images = 0.10;
+    model.short_fill = 0.60;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Images are sampled at an even stride, and all rows of a sampled
+ *        image are read, so the padding of short images is seen too.
+ *
+ * @return (bool)
+ */
+bool fit_descriptor_model(const std::vector<quine_store_chunk_t> &chunks,
+                          const std::vector<bool> &tombstones,
+                          size_t images,
+                          quine_descriptor_model_t &model)
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    if(chunks.empty() || chunks[0].desc.empty() || images == 0) {
+        return false;
+    }
+
+    int columns = chunks[0].desc.cols;
+    size_t stride = std::max((size_t)1, images * K / QUINE_SYNTHETIC_FIT_ROWS);
+
+    std::vector<double> sum(columns, 0.0), squares(columns, 0.0);
+    std::vector<double> classes;
+    size_t rows = 0, sampled = 0, short_images = 0, short_rows = 0;
+    size_t chunk = 0;
+
+    for(size_t image = 0; image < images; image += stride) {
+        if(image < tombstones.size() && tombstones[image]) {
+            continue;
+        }
+
+        size_t kept = 0;
+        for(int k = 0; k < K; k++) {
+            size_t global = image * K + k;
+            while(chunk < chunks.size() && global >= chunks[chunk].first_row + chunks[chunk].desc.rows) {
+                chunk++;
+            }
+            if(chunk == chunks.size() || global < chunks[chunk].first_row) {
+                break;
+            }
+
+            int r = (int)(global - chunks[chunk].first_row);
+            const float *row = chunks[chunk].desc.ptr<float>(r);
+            double norm = 0.0;
+            for(int c = 0; c < columns; c++) {
+                norm += (double)row[c] * row[c];
+            }
+            if(norm <= 0.0) {
+                continue;
+            }
+
+            for(int c = 0; c < columns; c++) {
+                sum[c] += row[c];
+                squares[c] += (double)row[c] * row[c];
+            }
+            int class_id = chunks[chunk].filter.at<uchar>(r);
+            if(class_id != QUINE_SYNTHETIC_NO_CLASS) {
+                if((size_t)class_id >= classes.size()) {
+                    classes.resize(class_id + 1, 0.0);
+                }
+                classes[class_id]++;
+            }
+            kept++;
+            rows++;
+        }
+
+        sampled++;
+        if(kept < (size_t)K) {
+            short_images++;
+            short_rows += kept;
+        }
+    }
+
+    if(rows == 0) {
+        return false;
+    }
+
+    model.columns = columns;
+    model.mean.resize(columns);
+    model.deviation.resize(columns);
+    for(int c = 0; c < columns; c++) {
+        double mean = sum[c] / rows;
+        model.mean[c] = (float)mean;
+        model.deviation[c] = (float)std::sqrt(std::max(0.0, squares[c] / rows - mean * mean));
+    }
+    model.class_weights = classes.empty() ? std::vector<double>(1, 1.0) : classes;
+    model.short_images = (double)short_images / sampled;
+    model.short_fill = short_images ? (double)short_rows / (short_images * K) : 0.0;
+    return true;
+}
+
+
+#pragma mark -
+#pragma mark QuineSyntheticDatabase
+QuineSyntheticDatabase::QuineSyntheticDatabase(const quine_descriptor_model_t &model, uint64_t seed)
+: m_model(model), m_seed(seed)
+{
+    // Words are drawn from the model itself
+    cv::RNG rng(mix_seed(m_seed, ~0ULL));
+    m_words.create(QUINE_SYNTHETIC_WORDS, m_model.columns, CV_32FC1);
+    for(int w = 0; w < m_words.rows; w++) {
+        float *word = m_words.ptr<float>(w);
+        for(int c = 0; c < m_model.columns; c++) {
+            word[c] = m_model.mean[c] + m_model.deviation[c] * (float)rng.gaussian(1.0);
+        }
+    }
+
+    double total = 0.0;
+    for(size_t c = 0; c < m_model.class_weights.size(); c++) {
+        total += m_model.class_weights[c];
+    }
+    double running = 0.0;
+    for(size_t c = 0; c < m_model.class_weights.size(); c++) {
+        running += total > 0.0 ? m_model.class_weights[c] / total : 1.0;
+        m_class_cdf.push_back(running);
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Words are picked with a skew towards the first ones, as a few
+ *        visual words are far more common than the rest.
+ *
+ * @return (void)
+ */
+void QuineSyntheticDatabase::generate_image(size_t image, cv::Mat desc, cv::Mat filter) const
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    cv::RNG rng(mix_seed(m_seed, image));
+
+    int keypoints = K;
+    if(rng.uniform(0.0, 1.0) < m_model.short_images) {
+        keypoints = (int)(K * m_model.short_fill * rng.uniform(0.5, 1.5) + 0.5);
+        keypoints = std::max(0, std::min(K, keypoints));
+    }
+
+    for(int r = 0; r < K; r++) {
+        float *row = desc.ptr<float>(r);
+        if(r >= keypoints) {
+            std::fill(row, row + m_model.columns, 0.0f);
+            filter.at<uchar>(r) = QUINE_SYNTHETIC_NO_CLASS;
+            continue;
+        }
+
+        double u = rng.uniform(0.0, 1.0);
+        const float *word = m_words.ptr<float>(std::min((int)(u * u * m_words.rows), m_words.rows - 1));
+        for(int c = 0; c < m_model.columns; c++) {
+            row[c] = word[c] + QUINE_SYNTHETIC_SPREAD * m_model.deviation[c] * (float)rng.gaussian(1.0);
+        }
+        normalize_row(row, m_model.columns);
+
+        double pick = rng.uniform(0.0, 1.0);
+        size_t class_id = std::lower_bound(m_class_cdf.begin(), m_class_cdf.end(), pick) - m_class_cdf.begin();
+        filter.at<uchar>(r) = (uchar)std::min(class_id, m_class_cdf.size() - 1);
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief cv::parallel_for_ body generating one image per index.
+ */
+class SyntheticImageBody : public cv::ParallelLoopBody {
+public:
+    SyntheticImageBody(const QuineSyntheticDatabase &generator, size_t first, cv::Mat &desc, cv::Mat &filter)
+    : m_generator(generator), m_first(first), m_desc(desc), m_filter(filter) { }
+
+    void operator()(const cv::Range &range) const {
+        const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+        for(int i = range.start; i < range.end; i++) {
+            m_generator.generate_image(m_first + i, m_desc.rowRange(i * K, (i + 1) * K),
+                                       m_filter.rowRange(i * K, (i + 1) * K));
+        }
+    }
+
+private:
+    const QuineSyntheticDatabase &m_generator;
+    size_t m_first;
+    cv::Mat &m_desc;
+    cv::Mat &m_filter;
+};
+
+
+void QuineSyntheticDatabase::generate(size_t first, size_t count, cv::Mat &desc, cv::Mat &filter) const
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    desc.create((int)(count * K), m_model.columns, CV_32FC1);
+    filter.create((int)(count * K), 1, CV_8UC1);
+    cv::parallel_for_(cv::Range(0, (int)count), SyntheticImageBody(*this, first, desc, filter));
+}
+
+
+void QuineSyntheticDatabase::make_query(size_t image, float keep, float noise, cv::Mat &desc, cv::Mat &filter) const
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    cv::Mat image_desc(K, m_model.columns, CV_32FC1), image_filter(K, 1, CV_8UC1);
+    generate_image(image, image_desc, image_filter);
+
+    std::vector<int> rows;
+    for(int r = 0; r < K; r++) {
+        if(image_filter.at<uchar>(r) != QUINE_SYNTHETIC_NO_CLASS) {
+            rows.push_back(r);
+        }
+    }
+
+    // Its own random state, so queries don't change the images
+    cv::RNG rng(mix_seed(m_seed ^ 0x5155494E45ULL, image));
+    for(size_t i = rows.size(); i > 1; i--) {
+        std::swap(rows[i - 1], rows[rng.uniform(0, (int)i)]);
+    }
+    rows.resize(std::min(rows.size(), (size_t)std::ceil(keep * rows.size())));
+
+    desc.create((int)rows.size(), m_model.columns, CV_32FC1);
+    filter.create((int)rows.size(), 1, CV_8UC1);
+    for(size_t i = 0; i < rows.size(); i++) {
+        const float *source = image_desc.ptr<float>(rows[i]);
+        float *row = desc.ptr<float>((int)i);
+        for(int c = 0; c < m_model.columns; c++) {
+            row[c] = source[c] + noise * m_model.deviation[c] * (float)rng.gaussian(1.0);
+        }
+        normalize_row(row, m_model.columns);
+        filter.at<uchar>((int)i) = image_filter.at<uchar>(rows[i]);
+    }
+}
+
+
+std::string QuineSyntheticDatabase::image_name(size_t image)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "image-%zu", image);
+    return name;
+}
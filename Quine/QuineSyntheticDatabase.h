@@ -0,0 +1,163 @@
+//
+//  QuineSyntheticDatabase.h
+//  Quine
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineSyntheticDatabase__
+#define __Quine__QuineSyntheticDatabase__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "QuineDescriptorStore.h"
+
+
+// Visual words descriptors are drawn around. Images share words, as
+//   photographs share edges and corners, so unrelated images collect a
+//   realistic number of near misses.
+#define QUINE_SYNTHETIC_WORDS       512
+
+// Spread of a descriptor around its word, in per-dimension deviations
+#define QUINE_SYNTHETIC_SPREAD      0.6f
+
+// Keypoint classes (AKAZE evolutions: 4 octaves of 4 sublevels)
+#define QUINE_SYNTHETIC_CLASSES     16
+
+// Rows of a database read when fitting a model to it
+#define QUINE_SYNTHETIC_FIT_ROWS    200000
+
+// Filter value of the rows padding an image with fewer keypoints, as
+//   compute_signature leaves them (class_id -1)
+#define QUINE_SYNTHETIC_NO_CLASS    255
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Statistics synthetic descriptors are drawn from.
+ */
+typedef struct quine_descriptor_model {
+
+    int columns;
+
+    /*!
+     * Mean and deviation of each descriptor dimension
+     */
+    std::vector<float> mean;
+    std::vector<float> deviation;
+
+    /*!
+     * Share of keypoints in each class
+     */
+    std::vector<double> class_weights;
+
+    /*!
+     * Share of images with fewer than AKAZE_KEYPOINTCOUNT keypoints, and
+     *   the mean share of their rows that hold one
+     */
+    double short_images;
+    double short_fill;
+
+} quine_descriptor_model_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Model of AKAZE's 64-float (M-SURF) descriptors of camera images:
+ *        signed and absolute gradient sums alternate, so the absolute
+ *        dimensions have a positive mean, and fine scales hold most
+ *        keypoints.
+ *
+ * @return (void)
+ */
+void default_descriptor_model(quine_descriptor_model_t &model);
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Fits a model to the live images of a real database, from at most
+ *        QUINE_SYNTHETIC_FIT_ROWS of its rows.
+ *
+ * @return (bool) false if the database has no live keypoints
+ */
+bool fit_descriptor_model(const std::vector<quine_store_chunk_t> &chunks,
+                          const std::vector<bool> &tombstones,
+                          size_t images,
+                          quine_descriptor_model_t &model);
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      QuineSyntheticDatabase
+ *
+ *  @abstract   Generates database images, and queries of them, from a
+ *              descriptor model.
+ *
+ *  @discussion Every image is generated from the seed and its index alone,
+ *              so any range of images can be generated on its own, in
+ *              parallel, and always comes out the same: a database of a
+ *              million images is written one shard at a time, and a query
+ *              of image i can be made without the database.
+ *
+ *              Images have AKAZE_KEYPOINTCOUNT rows of unit descriptors;
+ *              the rows past an image's last keypoint are zero, with
+ *              QUINE_SYNTHETIC_NO_CLASS as class, as compute_signature
+ *              pads them.
+ */
+class QuineSyntheticDatabase {
+public:
+
+    QuineSyntheticDatabase(const quine_descriptor_model_t &model, uint64_t seed);
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Descriptors (CV_32FC1) and filter (CV_8UC1) rows of images
+     *        [first, first + count).
+     *
+     * @return (void)
+     */
+    void generate(size_t first, size_t count, cv::Mat &desc, cv::Mat &filter) const;
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief A query of an image, as a camera would see it again: a share
+     *        of its keypoints, shuffled, each descriptor moved by noise.
+     *
+     * @param keep (float)
+     *        Share of the image's keypoints the query finds.
+     *
+     * @param noise (float)
+     *        Noise added to each dimension, in deviations of the dimension.
+     *
+     * @param desc (cv::Mat)
+     *        Receives the query descriptors, one row per keypoint (not padded).
+     *
+     * @return (void)
+     */
+    void make_query(size_t image, float keep, float noise, cv::Mat &desc, cv::Mat &filter) const;
+
+
+    static std::string image_name(size_t image);
+
+    const quine_descriptor_model_t &model() const { return m_model; }
+
+private:
+
+    friend class SyntheticImageBody;
+
+    void generate_image(size_t image, cv::Mat desc, cv::Mat filter) const;
+
+    quine_descriptor_model_t m_model;
+    uint64_t m_seed;
+    cv::Mat m_words;
+    std::vector<double> m_class_cdf;
+};
+
+
+#endif /* defined(__Quine__QuineSyntheticDatabase__) */
@@ -57,7 +57,6 @@
 @interface QuineVideoCaptureViewController () {
     QuineImageManager *_imageManager;
     QuineCompare *_imageCompare;
-    BOOL _isProcessing;
     BOOL _isEnabled;
 }
 - (void)displayFeatures:(const std::vector<cv::KeyPoint> &)faces
@@ -94,6 +93,32 @@
             _imageCompare = [[QuineCompare alloc] init];
         }
         
+        
+        //////////////////////////////////////////////////////
+        // Frames are compared on the pipeline's threads. Send
+        //   the result off to the result block, but only if
+        //   there is a result. The controller is only retained
+        //   on the main queue, never on a pipeline thread.
+        
+        __weak QuineVideoCaptureViewController *weakSelf = self;
+        [_imageCompare startPipelineWithResult:^(NSDictionary *resultsDictionary) {
+            NSMutableDictionary *resultsDictionaryCopy = [resultsDictionary mutableCopy];
+            for (id key in resultsDictionary) {
+                if([[resultsDictionaryCopy objectForKey:key] isEqualToString:@""]) {
+                    [resultsDictionaryCopy removeObjectForKey:key];
+                }
+            }
+            
+            if([[resultsDictionaryCopy allKeys] count] > 0) {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    QuineVideoCaptureViewController *mainSelf = weakSelf;
+                    if(mainSelf && mainSelf.result) {
+                        mainSelf.result(mainSelf, resultsDictionaryCopy);
+                    }
+                });
+            }
+        }];
+        
         _isEnabled = YES;
         
     }
@@ -122,6 +147,8 @@
 -(void)dealloc {
     
     NSLog(@"Deallocating scanner\n");
+    [_imageCompare stopPipeline];
+    
     [[NSNotificationCenter defaultCenter] removeObserver:self
                                                     name:@"note_quine_scanner_start"
                                                   object:nil];
@@ -204,23 +231,25 @@
 {
     
     //////////////////////////////////////////////////////
-    // Process the current frame with no
-    //   overlapping of frames
+    // Hand the current frame to the pipeline. If it is
+    //   still busy with earlier frames, the latest one wins.
     
-    if(!_isProcessing && _isEnabled) {
-        _isProcessing = YES;
+    if(_isEnabled) {
         
         
         //////////////////////////////////////////////////////
-        // Transpose the frame
+        // Transpose the frame. The transposed frame has its own
+        //   pixels, so the capture buffer can be reused while
+        //   the pipeline still works on it.
         
-        cv::transpose(mat, mat);
+        cv::Mat frame;
+        cv::transpose(mat, frame);
         CGFloat temp = rect.size.width;
         rect.size.width = rect.size.height;
         rect.size.height = temp;
         
         if (videOrientation == AVCaptureVideoOrientationLandscapeRight) {
-            cv::flip(mat, mat, 1);
+            cv::flip(frame, frame, 1);
         }
         else {
             // Front camera output needs to be mirrored to match
@@ -232,32 +261,7 @@
         //////////////////////////////////////////////////////
         // Compare the features with the loaded database
         
-        // TODO: There is a nice size memory leak in compareMatToLoadedDatabase. Need to find that.
-        NSDictionary *resultsDictionary = [_imageCompare compareMatToLoadedDatabase:mat];
-        NSMutableDictionary *resultsDictionaryCopy = [resultsDictionary mutableCopy];
-  
-        
-        //////////////////////////////////////////////////////
-        // Send the result off to the result block, but only
-        //   if there is a result
-        
-        for (id key in resultsDictionary) {
-            if([[resultsDictionaryCopy objectForKey:key] isEqualToString:@""]) {
-                [resultsDictionaryCopy removeObjectForKey:key];
-            }
-        }
-        
-        if(self.result && [[resultsDictionaryCopy allKeys] count] > 0) {
-            dispatch_async(dispatch_get_main_queue(), ^{
-                self.result(self, resultsDictionaryCopy);
-            });
-        }
-        
-        
-        //////////////////////////////////////////////////////
-        // Reset the processing flag
-        
-        _isProcessing = NO;
+        [_imageCompare submitFrame:frame];
     }
 }
 
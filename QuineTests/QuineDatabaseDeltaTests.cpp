@@ -0,0 +1,206 @@
+//
+//  QuineDatabaseDeltaTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineDatabaseDelta.h"
+#include "QuineMemoryDatabase.h"
+#include "QuineTest.h"
+
+#include <stdio.h>
+
+
+#define ROWS_PER_IMAGE  8
+
+
+typedef struct test_database {
+    cv::Mat desc;
+    cv::Mat filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    std::vector<bool> tombstones;
+} test_database_t;
+
+
+static void make_database(const char **names, const char **hashes, int count, int seed,
+                          test_database_t &db)
+{
+    std::vector<std::string> strings(names, names + count);
+    db.meta.assign(strings);
+    db.hashtable.assign(hashes, hashes + count);
+    db.desc = quine_test_descriptors(count * ROWS_PER_IMAGE, 61, seed);
+    db.filter = quine_test_filter(count * ROWS_PER_IMAGE, seed);
+    db.tombstones.assign(count, false);
+}
+
+
+static const quine_log_entry_t *find_entry(const quine_delta_t &delta, uint32_t type, const std::string &meta)
+{
+    for(size_t i = 0; i < delta.entries.size(); i++) {
+        if(delta.entries[i].type == type && delta.entries[i].meta == meta) {
+            return &delta.entries[i];
+        }
+    }
+    return NULL;
+}
+
+
+// Base has a, b, c, d. The target keeps a, changes b, deletes c (a
+//   tombstone) and d (gone), and adds e.
+static void make_versions(test_database_t &base, test_database_t &target)
+{
+    const char *base_names[] = { "a", "b", "c", "d" };
+    const char *base_hashes[] = { "ha", "hb", "hc", "hd" };
+    make_database(base_names, base_hashes, 4, 1, base);
+
+    const char *names[] = { "a", "b", "c", "e" };
+    const char *hashes[] = { "ha", "hb2", "hc", "he" };
+    make_database(names, hashes, 4, 2, target);
+    target.tombstones[2] = true;
+}
+
+
+static void diff(const test_database_t &base, const test_database_t &target, quine_delta_t &delta)
+{
+    diff_databases(base.meta, base.hashtable, base.tombstones,
+                   target.desc, target.filter, target.meta, target.hashtable, target.tombstones,
+                   ROWS_PER_IMAGE, delta);
+}
+
+
+QUINE_TEST(test_diff)
+{
+    test_database_t base, target;
+    make_versions(base, target);
+
+    quine_delta_t delta;
+    diff(base, target, delta);
+    QUINE_CHECK(delta.entries.size() == 4);
+    QUINE_CHECK(find_entry(delta, QUINE_LOG_DELETE_IMAGE, "c") != NULL);
+    QUINE_CHECK(find_entry(delta, QUINE_LOG_DELETE_IMAGE, "d") != NULL);
+    QUINE_CHECK(find_entry(delta, QUINE_LOG_REPLACE_IMAGE, "e") != NULL);
+
+    // A changed image is sent again with the target's rows
+    const quine_log_entry_t *b = find_entry(delta, QUINE_LOG_REPLACE_IMAGE, "b");
+    QUINE_CHECK(b != NULL);
+    if(b) {
+        QUINE_CHECK(b->hash == "hb2");
+        QUINE_CHECK(quine_test_equal(b->desc, target.desc.rowRange(ROWS_PER_IMAGE, 2 * ROWS_PER_IMAGE)));
+        QUINE_CHECK(quine_test_equal(b->filter, target.filter.rowRange(ROWS_PER_IMAGE, 2 * ROWS_PER_IMAGE)));
+    }
+
+    // Identical versions need no changes
+    diff(base, base, delta);
+    QUINE_CHECK(delta.entries.empty());
+}
+
+
+QUINE_TEST(test_write_read)
+{
+    test_database_t base, target;
+    make_versions(base, target);
+
+    quine_delta_t delta;
+    diff(base, target, delta);
+    delta.base_version = 3;
+    delta.version = 4;
+    QUINE_CHECK(write_delta("images.delta", delta));
+
+    quine_delta_t read;
+    QUINE_CHECK(read_delta("images.delta", read));
+    QUINE_CHECK(read.base_version == 3 && read.version == 4);
+    QUINE_CHECK(read.entries.size() == delta.entries.size());
+    for(size_t i = 0; i < read.entries.size() && i < delta.entries.size(); i++) {
+        QUINE_CHECK(read.entries[i].type == delta.entries[i].type);
+        QUINE_CHECK(read.entries[i].meta == delta.entries[i].meta);
+        QUINE_CHECK(read.entries[i].hash == delta.entries[i].hash);
+        QUINE_CHECK(read.entries[i].desc.rows == delta.entries[i].desc.rows);
+    }
+
+    // A damaged or truncated delta is refused as a whole
+    FILE *f = fopen("images.delta", "r+b");
+    QUINE_CHECK(f != NULL);
+    fseek(f, sizeof(quine_delta_header_t) + 40, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, sizeof(quine_delta_header_t) + 40, SEEK_SET);
+    fputc(c ^ 1, f);
+    fclose(f);
+    QUINE_CHECK(!read_delta("images.delta", read));
+
+    QUINE_CHECK(write_delta("images.delta", delta));
+    QUINE_CHECK(truncate("images.delta", sizeof(quine_delta_header_t) + 10) == 0);
+    QUINE_CHECK(!read_delta("images.delta", read));
+    QUINE_CHECK(!read_delta("missing.delta", read));
+}
+
+
+QUINE_TEST(test_versions)
+{
+    QUINE_CHECK(read_database_version("images.qdb") == 0);
+    QUINE_CHECK(write_database_version("images.qdb", 42));
+    QUINE_CHECK(read_database_version("images.qdb") == 42);
+    QUINE_CHECK(write_database_version("images.qdb", 43));
+    QUINE_CHECK(read_database_version("images.qdb") == 43);
+}
+
+
+QUINE_TEST(test_apply)
+{
+    QuineMemory *memory = QuineMemory::database();
+    const std::string db = "sync.qdb";
+
+    test_database_t base, target;
+    make_versions(base, target);
+    QUINE_CHECK(memory->save_database_to_file(db, base.desc, base.filter, base.meta, base.hashtable, false));
+
+    quine_delta_t delta;
+    diff(base, target, delta);
+    delta.base_version = 0;
+    delta.version = 1;
+    QUINE_CHECK(write_delta("sync.delta", delta));
+
+    QUINE_CHECK(memory->apply_database_delta(db, "sync.delta"));
+    QUINE_CHECK(memory->get_database_version(db) == 1);
+
+    // The live images are now those of the target
+    uint32_t slot = 0;
+    QUINE_CHECK(memory->find_image(db, "a", slot) && slot == 0);
+    QUINE_CHECK(!memory->find_image(db, "c", slot));
+    QUINE_CHECK(!memory->find_image(db, "d", slot));
+    QUINE_CHECK(memory->find_image(db, "e", slot));
+    QUINE_CHECK(memory->contains_image(db, "hb2"));
+    QUINE_CHECK(!memory->contains_image(db, "hb"));
+
+    uint32_t b = 0;
+    QUINE_CHECK(memory->find_image(db, "b", b) && b >= 4);
+    std::shared_ptr<const quine_database_snapshot_t> snapshot = memory->pin_database(db);
+    cv::Mat desc, filter;
+    QuineDescriptorStore::gather(snapshot->chunks, desc, filter);
+    QUINE_CHECK(desc.rows == (int)(snapshot->metadata.size() * ROWS_PER_IMAGE));
+    if(desc.rows == (int)(snapshot->metadata.size() * ROWS_PER_IMAGE) && b < snapshot->metadata.size()) {
+        QUINE_CHECK(quine_test_equal(desc.rowRange(b * ROWS_PER_IMAGE, (b + 1) * ROWS_PER_IMAGE),
+                                     target.desc.rowRange(ROWS_PER_IMAGE, 2 * ROWS_PER_IMAGE)));
+    }
+
+    // Applying it again changes nothing; a delta for another version is refused
+    size_t slots = memory->get_indices(db).size();
+    QUINE_CHECK(memory->apply_database_delta(db, "sync.delta"));
+    QUINE_CHECK(memory->get_indices(db).size() == slots);
+
+    delta.base_version = 7;
+    delta.version = 8;
+    QUINE_CHECK(write_delta("stale.delta", delta));
+    QUINE_CHECK(!memory->apply_database_delta(db, "stale.delta"));
+    QUINE_CHECK(memory->get_database_version(db) == 1);
+
+    // The changes were logged, so they survive a reload
+    QUINE_CHECK(memory->reload_database(db));
+    QUINE_CHECK(!memory->find_image(db, "d", slot));
+    QUINE_CHECK(memory->find_image(db, "b", slot) && slot == b);
+}
+
+
+QUINE_TEST_MAIN()
@@ -0,0 +1,237 @@
+//
+//  QuineDatabaseLogTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineDatabaseLog.h"
+#include "QuineMappedDatabase.h"
+#include "QuineMemoryDatabase.h"
+#include "QuineTest.h"
+
+#include <stdio.h>
+
+
+#define ROWS_PER_IMAGE  20
+
+
+static quine_log_entry_t add_entry(int image)
+{
+    quine_log_entry_t entry;
+    entry.type = QUINE_LOG_ADD_IMAGE;
+    entry.desc = quine_test_descriptors(ROWS_PER_IMAGE, 61, image);
+    entry.filter = quine_test_filter(ROWS_PER_IMAGE, image);
+    entry.meta = "image-" + std::to_string(image);
+    entry.hash = "hash-" + std::to_string(image);
+    return entry;
+}
+
+
+static bool same_entry(const quine_log_entry_t &a, const quine_log_entry_t &b)
+{
+    return a.type == b.type && a.meta == b.meta && a.hash == b.hash &&
+           quine_test_equal(a.desc, b.desc) && quine_test_equal(a.filter, b.filter);
+}
+
+
+static bool file_exists(const std::string &path)
+{
+    return access(path.c_str(), F_OK) == 0;
+}
+
+
+QUINE_TEST(test_encode_decode)
+{
+    quine_log_entry_t entry = add_entry(3);
+    std::string record;
+    encode_log_entry(entry, record);
+
+    quine_log_entry_t decoded;
+    QUINE_CHECK(decode_log_entry(record.data(), record.size(), decoded) == record.size());
+    QUINE_CHECK(same_entry(entry, decoded));
+
+    quine_log_entry_t deletion;
+    deletion.type = QUINE_LOG_DELETE_IMAGE;
+    deletion.meta = "image-3";
+    std::string record2;
+    encode_log_entry(deletion, record2);
+    QUINE_CHECK(decode_log_entry(record2.data(), record2.size(), decoded) == record2.size());
+    QUINE_CHECK(decoded.type == QUINE_LOG_DELETE_IMAGE && decoded.meta == "image-3");
+
+    // A short or damaged record is never trusted
+    QUINE_CHECK(decode_log_entry(record.data(), record.size() - 1, decoded) == 0);
+    QUINE_CHECK(decode_log_entry(record.data(), sizeof(quine_log_record_header_t) - 1, decoded) == 0);
+    record[record.size() / 2] ^= 1;
+    QUINE_CHECK(decode_log_entry(record.data(), record.size(), decoded) == 0);
+}
+
+
+QUINE_TEST(test_append_and_read)
+{
+    std::vector<quine_log_entry_t> written;
+    {
+        QuineDatabaseLog log("images.qdb");
+        for(int i = 0; i < 5; i++) {
+            written.push_back(add_entry(i));
+            QUINE_CHECK(log.append(written.back()));
+        }
+        std::vector<quine_log_entry_t> batch;
+        batch.push_back(add_entry(5));
+        batch.push_back(add_entry(6));
+        QUINE_CHECK(log.append(batch));
+        written.insert(written.end(), batch.begin(), batch.end());
+        QUINE_CHECK(log.pending_records() == 7);
+    }
+    QUINE_CHECK(file_exists("images.qdb.log.1"));
+
+    // A new log (as after a restart) reads every record back in order
+    QuineDatabaseLog log("images.qdb");
+    std::vector<quine_log_entry_t> entries;
+    QUINE_CHECK(log.read(0, entries));
+    QUINE_CHECK(entries.size() == written.size());
+    for(size_t i = 0; i < entries.size() && i < written.size(); i++) {
+        QUINE_CHECK(same_entry(entries[i], written[i]));
+    }
+    QUINE_CHECK(log.pending_records() == 7);
+}
+
+
+QUINE_TEST(test_torn_record_is_dropped)
+{
+    {
+        QuineDatabaseLog log("images.qdb");
+        for(int i = 0; i < 3; i++) {
+            QUINE_CHECK(log.append(add_entry(i)));
+        }
+    }
+
+    // Half of a fourth record, as a crash in the middle of a write leaves it
+    std::string record;
+    encode_log_entry(add_entry(3), record);
+    FILE *f = fopen("images.qdb.log.1", "ab");
+    QUINE_CHECK(f != NULL);
+    fwrite(record.data(), 1, record.size() / 2, f);
+    fclose(f);
+
+    {
+        QuineDatabaseLog log("images.qdb");
+        std::vector<quine_log_entry_t> entries;
+        log.read(0, entries);
+        QUINE_CHECK(entries.size() == 3);
+
+        // The torn tail was cut off, so a record appended now is kept
+        QUINE_CHECK(log.append(add_entry(4)));
+    }
+
+    QuineDatabaseLog log("images.qdb");
+    std::vector<quine_log_entry_t> entries;
+    QUINE_CHECK(log.read(0, entries));
+    QUINE_CHECK(entries.size() == 4);
+    QUINE_CHECK(entries.size() == 4 && entries[3].meta == "image-4");
+}
+
+
+QUINE_TEST(test_compaction)
+{
+    QuineDatabaseLog log("images.qdb");
+    for(int i = 0; i < 4; i++) {
+        QUINE_CHECK(log.append(add_entry(i)));
+    }
+
+    // The database as of the compaction, which the fold writes out with
+    //   the sealed segment recorded in it
+    QuineDescriptorStore store;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    std::vector<bool> tombstones;
+    quine_image_slots_t images;
+    for(int i = 0; i < 4; i++) {
+        apply_log_entry(add_entry(i), store, meta, hashtable, tombstones, images);
+    }
+    std::vector<quine_store_chunk_t> chunks;
+    store.snapshot(chunks);
+    cv::Mat source, filter;
+    QuineDescriptorStore::gather(chunks, source, filter);
+
+    uint32_t folded = 0;
+    QUINE_CHECK(log.compact_async([&](uint32_t sealed) {
+        folded = sealed;
+        return QuineMemory::database()->save_database_to_file("images.qdb", source, filter, meta, hashtable, false, sealed);
+    }));
+
+    // Appends made while compacting go to a new segment
+    QUINE_CHECK(log.append(add_entry(4)));
+    log.wait();
+
+    QUINE_CHECK(folded == 1);
+    QUINE_CHECK(!file_exists("images.qdb.log.1"));
+    QUINE_CHECK(file_exists("images.qdb.log.2"));
+    QUINE_CHECK(log.pending_records() == 1);
+
+    std::vector<quine_log_entry_t> entries;
+    QUINE_CHECK(log.read(folded, entries));
+    QUINE_CHECK(entries.size() == 1 && entries[0].meta == "image-4");
+
+    // Loading replays only what the database file does not contain yet
+    QuineDescriptorStore store2;
+    QuineStringTable meta2;
+    cv::vector<std::string> hashtable2;
+    std::vector<bool> tombstones2;
+    QuineMemory::database()->load_database_from_file("images.qdb", store2, meta2, hashtable2, tombstones2);
+    QUINE_CHECK(meta2.size() == 5);
+    QUINE_CHECK(store2.rows() == 5 * ROWS_PER_IMAGE);
+    for(size_t i = 0; i < meta2.size(); i++) {
+        QUINE_CHECK(meta2[i] == "image-" + std::to_string(i));
+    }
+}
+
+
+QUINE_TEST(test_load_replays_log)
+{
+    QuineMemory *memory = QuineMemory::database();
+
+    // A base database, then images only added to the log
+    std::vector<std::string> strings;
+    cv::vector<std::string> hashtable;
+    for(int i = 0; i < 3; i++) {
+        strings.push_back("image-" + std::to_string(i));
+        hashtable.push_back("hash-" + std::to_string(i));
+    }
+    QuineStringTable meta;
+    meta.assign(strings);
+    cv::Mat source = quine_test_descriptors(3 * ROWS_PER_IMAGE, 61, 0);
+    cv::Mat filter = quine_test_filter(3 * ROWS_PER_IMAGE, 0);
+    QUINE_CHECK(memory->save_database_to_file("replay.qdb", source, filter, meta, hashtable, false));
+
+    for(int i = 3; i < 8; i++) {
+        quine_log_entry_t entry = add_entry(i);
+        QUINE_CHECK(memory->append_image("replay.qdb", entry.desc, entry.filter, entry.meta, entry.hash));
+    }
+    QUINE_CHECK(file_exists("replay.qdb.log.1"));
+
+    QuineDescriptorStore store;
+    QuineStringTable meta2;
+    cv::vector<std::string> hashtable2;
+    std::vector<bool> tombstones;
+    memory->load_database_from_file("replay.qdb", store, meta2, hashtable2, tombstones);
+    QUINE_CHECK(meta2.size() == 8);
+    QUINE_CHECK(hashtable2.size() == 8);
+    QUINE_CHECK(store.rows() == 3 * ROWS_PER_IMAGE + 5 * ROWS_PER_IMAGE);
+
+    std::vector<quine_store_chunk_t> chunks;
+    store.snapshot(chunks);
+    cv::Mat source2, filter2;
+    QuineDescriptorStore::gather(chunks, source2, filter2);
+    QUINE_CHECK(quine_test_equal(source2.rowRange(0, 3 * ROWS_PER_IMAGE), source));
+    QUINE_CHECK(quine_test_equal(source2.rowRange(7 * ROWS_PER_IMAGE, 8 * ROWS_PER_IMAGE), add_entry(7).desc));
+    QUINE_CHECK(meta2[7] == "image-7" && hashtable2[7] == "hash-7");
+
+    // The reloaded database in memory matches what was loaded
+    QUINE_CHECK(memory->reload_database("replay.qdb"));
+    QUINE_CHECK(memory->get_indices("replay.qdb").size() == 8);
+}
+
+
+QUINE_TEST_MAIN()
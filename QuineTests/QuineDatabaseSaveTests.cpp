@@ -0,0 +1,179 @@
+//
+//  QuineDatabaseSaveTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineMemoryDatabase.h"
+#include "QuineMappedDatabase.h"
+#include "QuineGzip.h"
+#include "QuineTest.h"
+
+#include <stdio.h>
+
+
+static void make_database(int images, int rows_per_image, cv::Mat &source, cv::Mat &filter,
+                          QuineStringTable &meta, cv::vector<std::string> &hashtable)
+{
+    std::vector<std::string> strings;
+    hashtable.clear();
+    for(int i = 0; i < images; i++) {
+        strings.push_back("{\"image\":" + std::to_string(i) + "}");
+        hashtable.push_back("hash-" + std::to_string(i));
+    }
+    meta.assign(strings);
+
+    source = quine_test_descriptors(images * rows_per_image, 61, 2);
+    filter = quine_test_filter(images * rows_per_image, 2);
+}
+
+
+static bool read_file(const std::string &path, std::string &out)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if(f == NULL) {
+        return false;
+    }
+    char buffer[65536];
+    size_t n;
+    out.clear();
+    while((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        out.append(buffer, n);
+    }
+    fclose(f);
+    return true;
+}
+
+
+static void check_loaded(const std::string &path, const cv::Mat &source, const cv::Mat &filter,
+                         const QuineStringTable &meta, const cv::vector<std::string> &hashtable)
+{
+    QuineDescriptorStore store;
+    QuineStringTable meta2;
+    cv::vector<std::string> hashtable2;
+    std::vector<bool> tombstones;
+    QuineMemory::database()->load_database_from_file(path, store, meta2, hashtable2, tombstones);
+
+    std::vector<quine_store_chunk_t> chunks;
+    store.snapshot(chunks);
+    cv::Mat source2, filter2;
+    QuineDescriptorStore::gather(chunks, source2, filter2);
+
+    QUINE_CHECK(quine_test_equal(source, source2));
+    QUINE_CHECK(quine_test_equal(filter, filter2));
+    QUINE_CHECK(meta2.size() == meta.size());
+    for(size_t i = 0; i < meta.size() && i < meta2.size(); i++) {
+        QUINE_CHECK(meta2[i] == meta[i]);
+    }
+    QUINE_CHECK(hashtable2 == hashtable);
+}
+
+
+QUINE_TEST(test_compressed_round_trip)
+{
+    // Large enough to take several rounds of streamed blocks
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    make_database(400, 100, source, filter, meta, hashtable);
+
+    QUINE_CHECK(save_compressed_mapped_database("images.qdbz", source, filter, meta, hashtable, 5));
+    QUINE_CHECK(!is_mapped_database("images.qdbz"));
+
+    std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+    cv::Mat source2, filter2;
+    QuineStringTable meta2;
+    cv::vector<std::string> hashtable2;
+    QUINE_CHECK(inflate_mapped_database("images.qdbz", mapping, source2, filter2, meta2, hashtable2));
+    QUINE_CHECK(quine_test_equal(source, source2));
+    QUINE_CHECK(quine_test_equal(filter, filter2));
+    QUINE_CHECK(meta2.size() == 400 && meta2[399] == meta[399]);
+    QUINE_CHECK(hashtable2 == hashtable);
+    QUINE_CHECK(((const quine_db_header_t *)mapping->data())->log_segment == 5);
+}
+
+
+QUINE_TEST(test_compressed_matches_raw_layout)
+{
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    make_database(60, 50, source, filter, meta, hashtable);
+
+    QUINE_CHECK(save_mapped_database("images.qdb", source, filter, meta, hashtable, 2));
+    QUINE_CHECK(save_compressed_mapped_database("images.qdbz", source, filter, meta, hashtable, 2));
+
+    // Inflating the compressed file gives the raw .qdb byte for byte
+    std::string raw, inflated;
+    QUINE_CHECK(read_file("images.qdb", raw));
+    QUINE_CHECK(gzip_uncompress("images.qdbz", inflated));
+    QUINE_CHECK(!raw.empty());
+    QUINE_CHECK(inflated == raw);
+}
+
+
+QUINE_TEST(test_compress_stream)
+{
+    std::string data(9 * QUINE_GZIP_BLOCK_BYTES + 17, '\0');
+    for(size_t i = 0; i < data.size(); i++) {
+        data[i] = (char)((i * 7) % 251);
+    }
+
+    // The data is only handed out range by range
+    gzip_block_reader_t read = [&data](size_t offset, size_t bytes, char *out) {
+        memcpy(out, data.data() + offset, bytes);
+    };
+    QUINE_CHECK(gzip_compress_stream(data.size(), read, "data.gz", 1));
+
+    std::string out;
+    QUINE_CHECK(gzip_uncompress("data.gz", out));
+    QUINE_CHECK(out == data);
+}
+
+
+QUINE_TEST(test_save_database_to_file)
+{
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    make_database(120, 30, source, filter, meta, hashtable);
+
+    QuineMemory *memory = QuineMemory::database();
+
+    // .qdb is mappable, .qdbz is the same layout as block gzip
+    QUINE_CHECK(memory->save_database_to_file("images.qdb", source, filter, meta, hashtable, false));
+    QUINE_CHECK(is_mapped_database("images.qdb"));
+    check_loaded("images.qdb", source, filter, meta, hashtable);
+
+    QUINE_CHECK(memory->save_database_to_file("images.qdbz", source, filter, meta, hashtable, true));
+    std::string compressed;
+    QUINE_CHECK(read_file("images.qdbz", compressed));
+    std::vector<gzip_block_t> blocks;
+    QUINE_CHECK(gzip_block_index(compressed.data(), compressed.size(), blocks));
+    check_loaded("images.qdbz", source, filter, meta, hashtable);
+
+    // .bin stays gzipped YAML, written as block gzip
+    QUINE_CHECK(memory->save_database_to_file("images.bin", source, filter, meta, hashtable, true));
+    QUINE_CHECK(read_file("images.bin", compressed));
+    QUINE_CHECK(gzip_block_index(compressed.data(), compressed.size(), blocks));
+
+    cv::vector<std::string> metadata;
+    meta.to_vector(metadata);
+    cv::FileStorage storage(".yml", cv::FileStorage::WRITE + cv::FileStorage::MEMORY);
+    storage << "data" << source << "idx" << metadata << "hash" << hashtable << "class" << filter;
+    storage << "log_segment" << 0;
+    std::string yaml = storage.releaseAndGetString();
+    std::string inflated;
+    QUINE_CHECK(gzip_uncompress("images.bin", inflated));
+    QUINE_CHECK(inflated == yaml);
+
+    // No temporary file is left behind
+    QUINE_CHECK(access("images.bin.tmp", F_OK) != 0);
+    QUINE_CHECK(access("images.qdb.tmp", F_OK) != 0);
+    QUINE_CHECK(access("images.qdbz.tmp", F_OK) != 0);
+}
+
+
+QUINE_TEST_MAIN()
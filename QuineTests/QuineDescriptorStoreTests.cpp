@@ -0,0 +1,90 @@
+//
+//  QuineDescriptorStoreTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineDescriptorStore.h"
+#include "QuineTest.h"
+
+
+QUINE_TEST(test_small_database_stays_small)
+{
+    QuineDescriptorStore store;
+    QUINE_CHECK(store.append(quine_test_descriptors(10, 61, 1), quine_test_filter(10, 1)));
+
+    // The first chunk is not the full chunk size, and only used rows count
+    size_t descriptors = 0, filter = 0;
+    store.footprint(descriptors, filter);
+    QUINE_CHECK(descriptors == 10 * 61 * sizeof(float));
+    QUINE_CHECK(filter == 10);
+    QUINE_CHECK(store.bytes() == descriptors + filter);
+    QUINE_CHECK(store.reserved_bytes() == QUINE_STORE_MIN_CHUNK_ROWS * (61 * sizeof(float) + 1));
+}
+
+
+QUINE_TEST(test_chunks_grow_geometrically)
+{
+    const size_t rows = 300000;
+    QuineDescriptorStore store;
+    for(size_t r = 0; r < rows; r += 100) {
+        QUINE_CHECK(store.append(quine_test_descriptors(100, 61, (int)r), quine_test_filter(100, (int)r)));
+    }
+    QUINE_CHECK(store.rows() == rows);
+
+    // 1024, 1024, 2048, ... doubling to the cap, then full chunks
+    std::vector<quine_store_chunk_t> chunks;
+    store.snapshot(chunks);
+    QUINE_CHECK(chunks.size() < 16);
+    QUINE_CHECK(chunks[0].desc.rows == QUINE_STORE_MIN_CHUNK_ROWS);
+    for(size_t i = 1; i + 1 < chunks.size(); i++) {
+        QUINE_CHECK(chunks[i].desc.rows >= chunks[i - 1].desc.rows);
+        QUINE_CHECK(chunks[i].desc.rows <= QUINE_STORE_CHUNK_ROWS);
+    }
+
+    // Rows come back in order across the chunks
+    cv::Mat desc, filter;
+    QuineDescriptorStore::gather(chunks, desc, filter);
+    QUINE_CHECK(quine_test_equal(desc.rowRange(1000, 1100), quine_test_descriptors(100, 61, 1000)));
+    QUINE_CHECK(quine_test_equal(desc.rowRange(299900, 300000), quine_test_descriptors(100, 61, 299900)));
+
+    // The slack is bounded by the rows in use
+    QUINE_CHECK(store.reserved_bytes() < 2 * store.bytes());
+}
+
+
+QUINE_TEST(test_large_append_fills_one_chunk)
+{
+    QuineDescriptorStore store;
+    QUINE_CHECK(store.append(quine_test_descriptors(5000, 61, 1), quine_test_filter(5000, 1)));
+
+    std::vector<quine_store_chunk_t> chunks;
+    store.snapshot(chunks);
+    QUINE_CHECK(chunks.size() == 1);
+    QUINE_CHECK(store.reserved_bytes() == store.bytes());
+}
+
+
+QUINE_TEST(test_adopt_rejects_mismatch)
+{
+    QuineDescriptorStore store;
+    QUINE_CHECK(store.adopt(quine_test_descriptors(20, 61, 1), quine_test_filter(20, 1)));
+
+    // Another width, or a filter that does not have a row per descriptor
+    QUINE_CHECK(!store.adopt(quine_test_descriptors(20, 64, 2), quine_test_filter(20, 2)));
+    QUINE_CHECK(!store.adopt(quine_test_descriptors(20, 61, 3), quine_test_filter(19, 3)));
+    QUINE_CHECK(!store.append(quine_test_descriptors(20, 64, 4), quine_test_filter(20, 4)));
+    QUINE_CHECK(store.rows() == 20);
+
+    QUINE_CHECK(store.adopt(quine_test_descriptors(30, 61, 5), quine_test_filter(30, 5)));
+    QUINE_CHECK(store.rows() == 50);
+
+    std::vector<quine_store_chunk_t> chunks;
+    store.snapshot(chunks);
+    QUINE_CHECK(chunks.size() == 2 && chunks[1].first_row == 20);
+}
+
+
+QUINE_TEST_MAIN()
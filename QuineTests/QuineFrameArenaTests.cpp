@@ -0,0 +1,147 @@
+//
+//  QuineFrameArenaTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineFrameArena.h"
+#include "QuineTest.h"
+
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+
+static bool is_aligned(const void *p)
+{
+    return ((uintptr_t)p % QUINE_FRAME_ARENA_ALIGN) == 0;
+}
+
+
+static bool inside(const void *p, const void *start, size_t bytes)
+{
+    return (const char *)p >= (const char *)start && (const char *)p < (const char *)start + bytes;
+}
+
+
+QUINE_TEST(test_alignment)
+{
+    QuineFrameArena arena(1000);
+    QUINE_CHECK(arena.capacity() == 1008);
+
+    // Odd sizes are rounded up, so every allocation starts aligned
+    char *a = (char *)arena.allocate(1);
+    char *b = (char *)arena.allocate(3);
+    char *c = (char *)arena.allocate(17);
+    char *d = (char *)arena.allocate(16);
+    QUINE_CHECK(is_aligned(a) && is_aligned(b) && is_aligned(c) && is_aligned(d));
+    QUINE_CHECK(b == a + 16 && c == b + 16 && d == c + 32);
+    QUINE_CHECK(arena.used() == 80);
+
+    cv::Mat m = arena.mat(3, 5, CV_32FC1);
+    QUINE_CHECK(is_aligned(m.data));
+    QUINE_CHECK((char *)m.data == d + 16);
+    QUINE_CHECK(m.rows == 3 && m.cols == 5 && m.isContinuous());
+    QUINE_CHECK(arena.used() == 80 + 64);
+}
+
+
+QUINE_TEST(test_overflow_spills_then_regrows)
+{
+    QuineFrameArena arena(256);
+    char *first = (char *)arena.allocate(200);
+    QUINE_CHECK(inside(first, first, arena.capacity()));
+
+    // The frame outgrows the arena: the rest spills into the heap
+    char *spilled = (char *)arena.allocate(100);
+    char *more = (char *)arena.allocate(40);
+    QUINE_CHECK(spilled != NULL && more != NULL);
+    QUINE_CHECK(!inside(spilled, first, arena.capacity()));
+    QUINE_CHECK(!inside(more, first, arena.capacity()));
+    QUINE_CHECK(is_aligned(spilled) && is_aligned(more));
+    memset(first, 1, 200);
+    memset(spilled, 2, 100);
+    memset(more, 3, 40);
+    QUINE_CHECK(first[199] == 1 && spilled[99] == 2 && more[39] == 3);
+    QUINE_CHECK(arena.used() == 256 + 112 + 48);
+
+    // reset() frees the spill and grows the arena to the frame's size
+    arena.reset();
+    QUINE_CHECK(arena.used() == 0);
+    QUINE_CHECK(arena.peak() == 256 + 112 + 48);
+    QUINE_CHECK(arena.capacity() == arena.peak());
+
+    // The same frame now fits
+    char *a = (char *)arena.allocate(200);
+    char *b = (char *)arena.allocate(100);
+    char *c = (char *)arena.allocate(40);
+    QUINE_CHECK(b == a + 208 && c == b + 112);
+    QUINE_CHECK(inside(c, a, arena.capacity()));
+
+    // A frame that fits leaves the arena as it is
+    size_t capacity = arena.capacity();
+    arena.reset();
+    QUINE_CHECK(arena.capacity() == capacity);
+    QUINE_CHECK(arena.allocate(8) == a);
+}
+
+
+QUINE_TEST(test_parallel_allocations)
+{
+    const int threads = 4;
+    const int count = 2000;
+    QuineFrameArena arena(threads * count * 16 / 2);
+
+    // Half of the allocations spill; none overlaps another
+    std::vector<int *> blocks[threads];
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&arena, &blocks, t]() {
+            for(int i = 0; i < count; i++) {
+                int *block = (int *)arena.allocate(sizeof(int));
+                *block = t * count + i;
+                blocks[t].push_back(block);
+            }
+        }));
+    }
+    for(int t = 0; t < threads; t++) {
+        workers[t].join();
+    }
+
+    int wrong = 0;
+    for(int t = 0; t < threads; t++) {
+        for(int i = 0; i < count; i++) {
+            wrong += *blocks[t][i] != t * count + i;
+        }
+    }
+    QUINE_CHECK(wrong == 0);
+
+    arena.reset();
+    QUINE_CHECK(arena.capacity() >= (size_t)(threads * count * 16));
+}
+
+
+QUINE_TEST(test_allocator)
+{
+    QuineFrameArena arena(4096);
+    char *base = (char *)arena.allocate(0);
+    {
+        QuineArenaAllocator<int> allocator(arena);
+        std::vector<int, QuineArenaAllocator<int> > values(allocator);
+        for(int i = 0; i < 100; i++) {
+            values.push_back(i);
+        }
+        QUINE_CHECK(values.size() == 100 && values[99] == 99);
+        QUINE_CHECK(inside(&values[0], base, arena.capacity()));
+    }
+
+    // Everything the vector grew through stays allocated until reset()
+    QUINE_CHECK(arena.used() >= 100 * sizeof(int));
+    arena.reset();
+    QUINE_CHECK(arena.used() == 0);
+}
+
+
+QUINE_TEST_MAIN()
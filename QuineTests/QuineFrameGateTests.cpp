@@ -0,0 +1,104 @@
+//
+//  QuineFrameGateTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineFrameGate.h"
+#include "QuineTest.h"
+
+#include <math.h>
+
+
+#define FRAME_WIDTH     320
+#define FRAME_HEIGHT    240
+
+
+// Sharp edges everywhere: 8 px squares of dark and light
+static cv::Mat checkerboard(uchar light)
+{
+    cv::Mat frame(FRAME_HEIGHT, FRAME_WIDTH, CV_8UC1);
+    for(int r = 0; r < frame.rows; r++) {
+        for(int c = 0; c < frame.cols; c++) {
+            frame.ptr<uchar>(r)[c] = ((r / 8 + c / 8) % 2) ? light : 20;
+        }
+    }
+    return frame;
+}
+
+
+// What motion blur leaves: slow gradients and no edges
+static cv::Mat blurred()
+{
+    cv::Mat frame(FRAME_HEIGHT, FRAME_WIDTH, CV_8UC1);
+    for(int r = 0; r < frame.rows; r++) {
+        for(int c = 0; c < frame.cols; c++) {
+            frame.ptr<uchar>(r)[c] = (uchar)(128 + 100 * sin(2 * M_PI * c / 160.0));
+        }
+    }
+    return frame;
+}
+
+
+QUINE_TEST(test_static_frames_are_skipped_up_to_the_limit)
+{
+    QuineFrameGate gate;
+    cv::Mat frame = checkerboard(230);
+
+    double sharpness = -1;
+    QUINE_CHECK(gate.check(frame, &sharpness) == QUINE_GATE_PASS);
+    QUINE_CHECK(sharpness >= QUINE_GATE_MIN_SHARPNESS);
+
+    // The same scene is skipped, without measuring its sharpness
+    for(int i = 0; i < QUINE_GATE_MAX_SKIPS; i++) {
+        QUINE_CHECK(gate.check(frame, &sharpness) == QUINE_GATE_STATIC);
+        QUINE_CHECK(sharpness == 0.0);
+    }
+
+    // ... until it has been skipped QUINE_GATE_MAX_SKIPS times in a row
+    QUINE_CHECK(gate.check(frame) == QUINE_GATE_PASS);
+    QUINE_CHECK(gate.check(frame) == QUINE_GATE_STATIC);
+
+    QUINE_CHECK(gate.stats().passed == 2);
+    QUINE_CHECK(gate.stats().skipped_static == QUINE_GATE_MAX_SKIPS + 1);
+    QUINE_CHECK(gate.stats().skipped_blurry == 0);
+
+    // A new scene passes at once
+    QUINE_CHECK(gate.check(checkerboard(120)) == QUINE_GATE_PASS);
+
+    // After reset() nothing is remembered
+    gate.reset();
+    QUINE_CHECK(gate.check(checkerboard(120)) == QUINE_GATE_PASS);
+}
+
+
+QUINE_TEST(test_blurry_frame_keeps_the_thumbnail)
+{
+    QuineFrameGate gate;
+    cv::Mat sharp = checkerboard(230);
+    QUINE_CHECK(gate.check(sharp) == QUINE_GATE_PASS);
+
+    double sharpness = -1;
+    QUINE_CHECK(gate.check(blurred(), &sharpness) == QUINE_GATE_BLURRY);
+    QUINE_CHECK(sharpness < QUINE_GATE_MIN_SHARPNESS);
+
+    // The blurry frame was not let through, so the sharp one is still
+    //   what later frames are compared to
+    QUINE_CHECK(gate.check(sharp) == QUINE_GATE_STATIC);
+
+    // A blurry first frame leaves nothing to compare to either
+    QuineFrameGate fresh;
+    QUINE_CHECK(fresh.check(blurred()) == QUINE_GATE_BLURRY);
+    QUINE_CHECK(fresh.check(blurred()) == QUINE_GATE_BLURRY);
+    QUINE_CHECK(fresh.check(sharp) == QUINE_GATE_PASS);
+
+    QUINE_CHECK(gate.stats().passed == 1);
+    QUINE_CHECK(gate.stats().skipped_blurry == 1);
+    QUINE_CHECK(gate.stats().skipped_static == 1);
+    QUINE_CHECK(fresh.stats().skipped_blurry == 2);
+}
+
+
+QUINE_TEST_MAIN()
@@ -0,0 +1,173 @@
+//
+//  QuineGzipTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineGzip.h"
+#include "QuineTest.h"
+
+#include <stdio.h>
+
+
+// Mildly compressible bytes, different for every offset
+static std::string make_data(size_t size)
+{
+    std::string data(size, '\0');
+    uint32_t x = 12345;
+    for(size_t i = 0; i < size; i++) {
+        x = x * 1103515245 + 12345;
+        data[i] = (char)('a' + (x >> 16) % 8);
+    }
+    return data;
+}
+
+
+static bool write_plain_gzip(const std::string &path, const std::string &data)
+{
+    gzFile f = gzopen(path.c_str(), "wb");
+    if(f == NULL) {
+        return false;
+    }
+    bool ok = gzwrite(f, data.data(), (unsigned)data.size()) == (int)data.size();
+    return gzclose(f) == Z_OK && ok;
+}
+
+
+static bool read_file(const std::string &path, std::string &out)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if(f == NULL) {
+        return false;
+    }
+    char buffer[65536];
+    size_t n;
+    out.clear();
+    while((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        out.append(buffer, n);
+    }
+    fclose(f);
+    return true;
+}
+
+
+QUINE_TEST(test_block_round_trip)
+{
+    std::string data = make_data(100000);
+
+    // Small blocks, so the data spans many of them and a short last one
+    std::string compressed;
+    QUINE_CHECK(gzip_compress_blocks(data.data(), data.size(), compressed, Z_DEFAULT_COMPRESSION, 4096));
+    QUINE_CHECK(compressed.size() < data.size());
+
+    std::vector<gzip_block_t> blocks;
+    QUINE_CHECK(gzip_block_index(compressed.data(), compressed.size(), blocks));
+    QUINE_CHECK(blocks.size() == (data.size() + 4095) / 4096);
+    QUINE_CHECK(gzip_block_raw_size(blocks) == data.size());
+
+    size_t offset = 0, raw_offset = 0;
+    for(size_t i = 0; i < blocks.size(); i++) {
+        QUINE_CHECK(blocks[i].offset == offset);
+        QUINE_CHECK(blocks[i].raw_offset == raw_offset);
+        offset += blocks[i].bytes;
+        raw_offset += blocks[i].raw_bytes;
+    }
+    QUINE_CHECK(offset == compressed.size());
+
+    std::string inflated(data.size(), '\0');
+    QUINE_CHECK(gzip_inflate_blocks(compressed.data(), blocks, &inflated[0]));
+    QUINE_CHECK(inflated == data);
+
+    char head[16];
+    QUINE_CHECK(gzip_block_peek(compressed.data(), blocks[3], head, sizeof(head)) == sizeof(head));
+    QUINE_CHECK(memcmp(head, data.data() + 3 * 4096, sizeof(head)) == 0);
+}
+
+
+QUINE_TEST(test_file_round_trip)
+{
+    std::string data = make_data(3 * QUINE_GZIP_BLOCK_BYTES + 1234);
+    QUINE_CHECK(gzip_compress(data.data(), data.size(), "data.gz"));
+
+    std::string out;
+    QUINE_CHECK(gzip_uncompress("data.gz", out));
+    QUINE_CHECK(out == data);
+
+    // Block gzip is still plain gzip to zlib (and gunzip)
+    gzFile f = gzopen("data.gz", "rb");
+    QUINE_CHECK(f != NULL);
+    std::string streamed(data.size() + 1, '\0');
+    int n = f ? gzread(f, &streamed[0], (unsigned)streamed.size()) : 0;
+    if(f) {
+        gzclose(f);
+    }
+    QUINE_CHECK(n == (int)data.size());
+    QUINE_CHECK(streamed.compare(0, data.size(), data) == 0);
+}
+
+
+QUINE_TEST(test_compress_file)
+{
+    std::string data = make_data(500000);
+    FILE *f = fopen("data", "wb");
+    QUINE_CHECK(f != NULL);
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+
+    QUINE_CHECK(gzip_compress("data", "data.gz"));
+
+    std::string out;
+    QUINE_CHECK(gzip_uncompress("data.gz", out));
+    QUINE_CHECK(out == data);
+}
+
+
+QUINE_TEST(test_empty_input)
+{
+    QUINE_CHECK(gzip_compress("", 0, "empty.gz"));
+
+    std::string out = "stale";
+    QUINE_CHECK(gzip_uncompress("empty.gz", out));
+    QUINE_CHECK(out.empty());
+}
+
+
+QUINE_TEST(test_plain_gzip_is_streamed)
+{
+    std::string data = make_data(200000);
+    QUINE_CHECK(write_plain_gzip("plain.gz", data));
+
+    std::string compressed;
+    QUINE_CHECK(read_file("plain.gz", compressed));
+
+    std::vector<gzip_block_t> blocks;
+    QUINE_CHECK(!gzip_block_index(compressed.data(), compressed.size(), blocks));
+
+    std::string out;
+    QUINE_CHECK(gzip_uncompress("plain.gz", out));
+    QUINE_CHECK(out == data);
+}
+
+
+QUINE_TEST(test_corrupt_block_is_rejected)
+{
+    std::string data = make_data(50000);
+    std::string compressed;
+    QUINE_CHECK(gzip_compress_blocks(data.data(), data.size(), compressed, Z_DEFAULT_COMPRESSION, 8192));
+
+    std::vector<gzip_block_t> blocks;
+    QUINE_CHECK(gzip_block_index(compressed.data(), compressed.size(), blocks));
+    QUINE_CHECK(blocks.size() > 2);
+
+    // Flip a bit in the crc of the second block
+    size_t crc = blocks[1].offset + blocks[1].bytes - QUINE_GZIP_BLOCK_TRAILER_BYTES;
+    compressed[crc] ^= 1;
+
+    std::string inflated(data.size(), '\0');
+    QUINE_CHECK(!gzip_inflate_blocks(compressed.data(), blocks, &inflated[0]));
+}
+
+
+QUINE_TEST_MAIN()
@@ -0,0 +1,143 @@
+//
+//  QuineHashIndexTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineHashIndex.h"
+#include "QuineMemoryDatabase.h"
+#include "QuineTest.h"
+
+
+static std::string hash_of(int i)
+{
+    return "d41d8cd98f00b204e980" + std::to_string(i * 7919);
+}
+
+
+QUINE_TEST(test_insert_find_erase)
+{
+    QuineHashIndex index;
+    const int count = 20000;
+    for(int i = 0; i < count; i++) {
+        index.insert(hash_of(i), (uint32_t)i);
+    }
+    QUINE_CHECK(index.size() == (size_t)count);
+
+    // The table grew well past its initial size, and kept every entry
+    uint32_t slot = 0;
+    int missing = 0;
+    for(int i = 0; i < count; i++) {
+        if(!index.find(hash_of(i), slot) || slot != (uint32_t)i) {
+            missing++;
+        }
+    }
+    QUINE_CHECK(missing == 0);
+    QUINE_CHECK(!index.find(hash_of(count), slot));
+
+    // Erasing shifts probe runs back; everything else stays reachable
+    for(int i = 0; i < count; i += 3) {
+        index.erase(hash_of(i));
+    }
+    QUINE_CHECK(index.size() == (size_t)(count - (count + 2) / 3));
+    missing = 0;
+    int found_erased = 0;
+    for(int i = 0; i < count; i++) {
+        bool found = index.find(hash_of(i), slot);
+        if(i % 3 == 0) {
+            found_erased += found;
+        }
+        else if(!found || slot != (uint32_t)i) {
+            missing++;
+        }
+    }
+    QUINE_CHECK(missing == 0);
+    QUINE_CHECK(found_erased == 0);
+
+    // Erasing something absent does nothing
+    index.erase(hash_of(0));
+    index.erase("not there");
+    QUINE_CHECK(index.size() == (size_t)(count - (count + 2) / 3));
+}
+
+
+QUINE_TEST(test_insert_replaces)
+{
+    QuineHashIndex index;
+    index.insert("abc", 1);
+    index.insert("abc", 7);
+    QUINE_CHECK(index.size() == 1);
+
+    uint32_t slot = 0;
+    QUINE_CHECK(index.find("abc", slot) && slot == 7);
+
+    // Pointer and length lookups see the same entries
+    const char *buffer = "xxabcxx";
+    QUINE_CHECK(index.find(buffer + 2, 3, slot) && slot == 7);
+
+    // Images saved without a hash are never indexed
+    index.insert("", 3);
+    QUINE_CHECK(index.size() == 1);
+    QUINE_CHECK(!index.find("", slot));
+}
+
+
+QUINE_TEST(test_build)
+{
+    std::vector<std::string> hashes;
+    for(int i = 0; i < 1000; i++) {
+        hashes.push_back(i % 10 == 0 ? std::string() : hash_of(i));
+    }
+
+    // Dead slots are left out; slots past the tombstones are live
+    std::vector<bool> tombstones(500, false);
+    tombstones[1] = true;
+    tombstones[499] = true;
+
+    QuineHashIndex index;
+    index.insert("stale", 5);
+    index.build(hashes, tombstones);
+    QUINE_CHECK(index.size() == 1000 - 100 - 2);
+
+    uint32_t slot = 0;
+    QUINE_CHECK(!index.find("stale", slot));
+    QUINE_CHECK(!index.find(hash_of(1), slot));
+    QUINE_CHECK(!index.find(hash_of(499), slot));
+    QUINE_CHECK(index.find(hash_of(2), slot) && slot == 2);
+    QUINE_CHECK(index.find(hash_of(999), slot) && slot == 999);
+    QUINE_CHECK(index.bytes() >= index.size() * 16);
+}
+
+
+QUINE_TEST(test_contains_image)
+{
+    QuineMemory *memory = QuineMemory::database();
+    const std::string db = "hashes.qdb";
+
+    for(int i = 0; i < 20; i++) {
+        QUINE_CHECK(memory->append_image(db, quine_test_descriptors(5, 61, i), quine_test_filter(5, i),
+                                         "image-" + std::to_string(i), hash_of(i)));
+    }
+    QUINE_CHECK(memory->contains_image(db, hash_of(0)));
+    QUINE_CHECK(memory->contains_image(db, hash_of(19)));
+    QUINE_CHECK(!memory->contains_image(db, hash_of(20)));
+    QUINE_CHECK(!memory->contains_image(db, ""));
+
+    // A deleted image no longer counts as a duplicate
+    QUINE_CHECK(memory->delete_image(db, "image-4"));
+    QUINE_CHECK(!memory->contains_image(db, hash_of(4)));
+
+    // The index is rebuilt from the persisted hashes on reload
+    QUINE_CHECK(memory->reload_database(db));
+    QUINE_CHECK(memory->contains_image(db, hash_of(3)));
+    QUINE_CHECK(!memory->contains_image(db, hash_of(4)));
+
+    // Unloaded databases are loaded to answer
+    memory->unload_database(db);
+    QUINE_CHECK(memory->contains_image(db, hash_of(5)));
+}
+
+
+QUINE_TEST_MAIN()
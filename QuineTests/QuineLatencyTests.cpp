@@ -0,0 +1,137 @@
+//
+//  QuineLatencyTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineLatency.h"
+#include "QuineTest.h"
+
+#include <math.h>
+#include <thread>
+
+
+// Width of the bucket a latency falls in (us)
+static double bucket_width(double us)
+{
+    const double sub_buckets = 1 << QUINE_LATENCY_SUB_BITS;
+    if(us < 2 * sub_buckets) {
+        return 1.0;
+    }
+    return pow(2.0, floor(log2(us)) - QUINE_LATENCY_SUB_BITS);
+}
+
+
+static bool within_bucket(double ms, double expected_us)
+{
+    return fabs(ms * 1000.0 - expected_us) <= bucket_width(expected_us);
+}
+
+
+QUINE_TEST(test_uniform)
+{
+    QuineLatencyHistogram histogram;
+    for(uint64_t us = 1; us <= 10000; us++) {
+        histogram.record_us(us);
+    }
+
+    quine_latency_summary_t summary;
+    histogram.summary(summary);
+    QUINE_CHECK(summary.count == 10000);
+    QUINE_CHECK(fabs(summary.mean_ms - 5.0005) < 1e-9);
+    QUINE_CHECK(summary.max_ms == 10.0);
+    QUINE_CHECK(within_bucket(summary.p50_ms, 5000));
+    QUINE_CHECK(within_bucket(summary.p95_ms, 9500));
+    QUINE_CHECK(within_bucket(summary.p99_ms, 9900));
+}
+
+
+QUINE_TEST(test_small_values_are_exact)
+{
+    QuineLatencyHistogram histogram;
+    for(uint64_t us = 1; us <= 60; us++) {
+        histogram.record_us(us);
+    }
+
+    quine_latency_summary_t summary;
+    histogram.summary(summary);
+    QUINE_CHECK(summary.p50_ms * 1000.0 == 30.0);
+    QUINE_CHECK(summary.p95_ms * 1000.0 == 57.0);
+    QUINE_CHECK(summary.p99_ms * 1000.0 == 60.0);
+}
+
+
+QUINE_TEST(test_long_tail)
+{
+    // 90% fast queries at 2 ms, then a slow tail at 80 ms and one at 3 s
+    QuineLatencyHistogram histogram;
+    for(int i = 0; i < 900; i++) {
+        histogram.record_us(2000);
+    }
+    for(int i = 0; i < 99; i++) {
+        histogram.record_us(80000);
+    }
+    histogram.record_us(3000000);
+
+    quine_latency_summary_t summary;
+    histogram.summary(summary);
+    QUINE_CHECK(summary.count == 1000);
+    QUINE_CHECK(within_bucket(summary.p50_ms, 2000));
+    QUINE_CHECK(within_bucket(summary.p95_ms, 80000));
+    QUINE_CHECK(within_bucket(summary.p99_ms, 80000));
+    QUINE_CHECK(summary.max_ms == 3000.0);
+
+    // A percentile never reads above the largest latency recorded
+    QuineLatencyHistogram single;
+    single.record_us(1000001);
+    single.summary(summary);
+    QUINE_CHECK(summary.p50_ms <= summary.max_ms && summary.p99_ms <= summary.max_ms);
+    QUINE_CHECK(within_bucket(summary.p99_ms, 1000001));
+}
+
+
+QUINE_TEST(test_every_value_lands_in_its_bucket)
+{
+    // A lone value reads back within one bucket width, across the range
+    for(uint64_t us = 1; us < ((uint64_t)1 << QUINE_LATENCY_MAX_BITS); us = us * 3 + 1) {
+        QuineLatencyHistogram histogram;
+        histogram.record_us(us);
+        histogram.record_us(us);
+
+        quine_latency_summary_t summary;
+        histogram.summary(summary);
+        QUINE_CHECK(within_bucket(summary.p50_ms, (double)us));
+    }
+}
+
+
+QUINE_TEST(test_concurrent_record_and_reset)
+{
+    QuineLatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.push_back(std::thread([&histogram, t]() {
+            for(int i = 0; i < 25000; i++) {
+                histogram.record_us(100 * (t + 1));
+            }
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+
+    quine_latency_summary_t summary;
+    histogram.summary(summary);
+    QUINE_CHECK(summary.count == 100000);
+    QUINE_CHECK(within_bucket(summary.p50_ms, 200));
+    QUINE_CHECK(within_bucket(summary.p99_ms, 400));
+
+    histogram.reset();
+    histogram.summary(summary);
+    QUINE_CHECK(summary.count == 0 && summary.p99_ms == 0.0 && summary.max_ms == 0.0);
+}
+
+
+QUINE_TEST_MAIN()
@@ -0,0 +1,199 @@
+//
+//  QuineMappedDatabaseTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineMappedDatabase.h"
+#include "QuineTest.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+
+static void make_database(int images, cv::Mat &source, cv::Mat &filter,
+                          QuineStringTable &meta, cv::vector<std::string> &hashtable)
+{
+    std::vector<std::string> strings;
+    hashtable.clear();
+    for(int i = 0; i < images; i++) {
+        // Every 7th image has empty metadata, which the table must keep
+        strings.push_back(i % 7 == 0 ? std::string() : "{\"image\":" + std::to_string(i) + "}");
+        hashtable.push_back("hash-" + std::to_string(i * 31));
+    }
+    meta.assign(strings);
+
+    source = quine_test_descriptors(images * 10, 61, 1);
+    filter = quine_test_filter(images * 10, 1);
+}
+
+
+static bool same_strings(const QuineStringTable &a, const QuineStringTable &b)
+{
+    if(a.size() != b.size()) {
+        return false;
+    }
+    for(size_t i = 0; i < a.size(); i++) {
+        if(a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+QUINE_TEST(test_round_trip)
+{
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    make_database(500, source, filter, meta, hashtable);
+
+    QUINE_CHECK(save_mapped_database("images.qdb", source, filter, meta, hashtable, 3));
+    QUINE_CHECK(is_mapped_database("images.qdb"));
+
+    std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+    cv::Mat source2, filter2;
+    QuineStringTable meta2;
+    cv::vector<std::string> hashtable2;
+    QUINE_CHECK(load_mapped_database("images.qdb", mapping, source2, filter2, meta2, hashtable2));
+
+    QUINE_CHECK(quine_test_equal(source, source2));
+    QUINE_CHECK(quine_test_equal(filter, filter2));
+    QUINE_CHECK(same_strings(meta, meta2));
+    QUINE_CHECK(hashtable2 == hashtable);
+
+    // The descriptors are used in place, from a page aligned section
+    QUINE_CHECK((const char *)source2.data >= mapping->data());
+    QUINE_CHECK((const char *)source2.data < mapping->data() + mapping->size());
+    QUINE_CHECK(((const char *)source2.data - mapping->data()) % QUINE_DB_ALIGNMENT == 0);
+
+    const quine_db_header_t *header = (const quine_db_header_t *)mapping->data();
+    QUINE_CHECK(memcmp(header->magic, QUINE_DB_MAGIC, 4) == 0);
+    QUINE_CHECK(header->image_count == 500);
+    QUINE_CHECK(header->desc_rows == 5000);
+    QUINE_CHECK(header->log_segment == 3);
+}
+
+
+QUINE_TEST(test_without_hashes)
+{
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    make_database(20, source, filter, meta, hashtable);
+    hashtable.clear();
+
+    QUINE_CHECK(save_mapped_database("images.qdb", source, filter, meta, hashtable));
+
+    std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+    cv::Mat source2, filter2;
+    QuineStringTable meta2;
+    cv::vector<std::string> hashtable2;
+    QUINE_CHECK(load_mapped_database("images.qdb", mapping, source2, filter2, meta2, hashtable2));
+    QUINE_CHECK(same_strings(meta, meta2));
+    QUINE_CHECK(hashtable2.empty());
+}
+
+
+QUINE_TEST(test_metadata_outlives_load)
+{
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    make_database(50, source, filter, meta, hashtable);
+    QUINE_CHECK(save_mapped_database("images.qdb", source, filter, meta, hashtable));
+
+    // The loaded strings point into the mapping, which they keep alive
+    QuineStringTable meta2;
+    {
+        std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+        cv::Mat source2, filter2;
+        cv::vector<std::string> hashtable2;
+        QUINE_CHECK(load_mapped_database("images.qdb", mapping, source2, filter2, meta2, hashtable2));
+    }
+    QUINE_CHECK(same_strings(meta, meta2));
+
+    // Appending to a loaded table leaves the mapped strings as they are
+    meta2.push_back("added");
+    QUINE_CHECK(meta2.size() == 51);
+    QUINE_CHECK(meta2[50] == "added");
+    QUINE_CHECK(meta2[1] == meta[1]);
+}
+
+
+QUINE_TEST(test_rejects_other_files)
+{
+    FILE *f = fopen("images.yaml", "w");
+    QUINE_CHECK(f != NULL);
+    fputs("%YAML:1.0\nmeta: []\n", f);
+    fclose(f);
+
+    std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    QUINE_CHECK(!is_mapped_database("images.yaml"));
+    QUINE_CHECK(!load_mapped_database("images.yaml", mapping, source, filter, meta, hashtable));
+    QUINE_CHECK(!is_mapped_database("missing.qdb"));
+    QUINE_CHECK(!load_mapped_database("missing.qdb", mapping, source, filter, meta, hashtable));
+}
+
+
+QUINE_TEST(test_rejects_truncated_file)
+{
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    make_database(200, source, filter, meta, hashtable);
+    QUINE_CHECK(save_mapped_database("images.qdb", source, filter, meta, hashtable));
+
+    // Cut the file inside the descriptor section, as a torn copy would
+    QUINE_CHECK(truncate("images.qdb", QUINE_DB_ALIGNMENT + 100) == 0);
+    QUINE_CHECK(is_mapped_database("images.qdb"));
+
+    std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+    cv::Mat source2, filter2;
+    QuineStringTable meta2;
+    cv::vector<std::string> hashtable2;
+    QUINE_CHECK(!load_mapped_database("images.qdb", mapping, source2, filter2, meta2, hashtable2));
+}
+
+
+QUINE_TEST(test_save_replaces_atomically)
+{
+    cv::Mat source, filter;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    make_database(30, source, filter, meta, hashtable);
+    QUINE_CHECK(save_mapped_database("images.qdb", source, filter, meta, hashtable));
+
+    // A reader holding the old mapping keeps seeing the old database
+    std::shared_ptr<QuineMappedFile> mapping(new QuineMappedFile());
+    cv::Mat source2, filter2;
+    QuineStringTable meta2;
+    cv::vector<std::string> hashtable2;
+    QUINE_CHECK(load_mapped_database("images.qdb", mapping, source2, filter2, meta2, hashtable2));
+
+    cv::Mat source3, filter3;
+    QuineStringTable meta3;
+    cv::vector<std::string> hashtable3;
+    make_database(40, source3, filter3, meta3, hashtable3);
+    QUINE_CHECK(save_mapped_database("images.qdb", source3, filter3, meta3, hashtable3));
+
+    QUINE_CHECK(quine_test_equal(source, source2));
+    QUINE_CHECK(meta2.size() == 30);
+
+    std::shared_ptr<QuineMappedFile> mapping4(new QuineMappedFile());
+    cv::Mat source4, filter4;
+    QuineStringTable meta4;
+    cv::vector<std::string> hashtable4;
+    QUINE_CHECK(load_mapped_database("images.qdb", mapping4, source4, filter4, meta4, hashtable4));
+    QUINE_CHECK(meta4.size() == 40);
+    QUINE_CHECK(quine_test_equal(source3, source4));
+}
+
+
+QUINE_TEST_MAIN()
@@ -0,0 +1,97 @@
+//
+//  QuineMemoryBudgetTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineMemoryDatabase.h"
+#include "QuineTest.h"
+
+
+#define IMAGES          200
+#define ROWS_PER_IMAGE  10
+
+
+static bool save_database(const std::string &db, int seed)
+{
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    for(int i = 0; i < IMAGES; i++) {
+        meta.push_back(db + "-" + std::to_string(i));
+        hashtable.push_back("");
+    }
+    return QuineMemory::database()->save_database_to_file(db, quine_test_descriptors(IMAGES * ROWS_PER_IMAGE, 61, seed),
+                                                          quine_test_filter(IMAGES * ROWS_PER_IMAGE, seed),
+                                                          meta, hashtable, false);
+}
+
+
+static quine_database_stats_t stats_of(const std::string &db)
+{
+    quine_database_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    QuineMemory::database()->get_database_stats(db, stats);
+    return stats;
+}
+
+
+QUINE_TEST(test_least_recently_used_is_evicted)
+{
+    QuineMemory *memory = QuineMemory::database();
+    QUINE_CHECK(save_database("a.qdb", 1));
+    QUINE_CHECK(save_database("b.qdb", 2));
+    QUINE_CHECK(save_database("c.qdb", 3));
+
+    // Measure one database, then budget room for two and a half
+    QUINE_CHECK(memory->pin_database("a.qdb"));
+    size_t footprint = stats_of("a.qdb").footprint.total;
+    QUINE_CHECK(footprint >= IMAGES * ROWS_PER_IMAGE * 61 * sizeof(float));
+    memory->unload_database("a.qdb");
+    memory->set_memory_budget(footprint * 5 / 2);
+
+    QUINE_CHECK(memory->pin_database("a.qdb"));
+    std::shared_ptr<const quine_database_snapshot_t> b = memory->pin_database("b.qdb");
+    QUINE_CHECK(b);
+    QUINE_CHECK(memory->pin_database("a.qdb"));
+
+    // a was used after b, so loading c evicts b
+    QUINE_CHECK(memory->pin_database("c.qdb"));
+    QUINE_CHECK(stats_of("a.qdb").resident && stats_of("c.qdb").resident);
+    QUINE_CHECK(!stats_of("b.qdb").resident);
+    QUINE_CHECK(stats_of("b.qdb").resident_bytes == 0);
+    QUINE_CHECK(stats_of("b.qdb").evictions == 1);
+    QUINE_CHECK(stats_of("a.qdb").evictions == 0 && stats_of("c.qdb").evictions == 0);
+    QUINE_CHECK(memory->get_resident_bytes() <= memory->get_memory_budget());
+
+    // Every database was read once; a was then served from memory
+    QUINE_CHECK(stats_of("a.qdb").misses == 1 && stats_of("a.qdb").hits == 1);
+    QUINE_CHECK(stats_of("b.qdb").misses == 1 && stats_of("b.qdb").hits == 0);
+    QUINE_CHECK(stats_of("c.qdb").misses == 1);
+
+    // An evicted database's footprint is kept, as the room it needs
+    QUINE_CHECK(stats_of("b.qdb").footprint.total == footprint);
+
+    // The snapshot pinned before the eviction is still whole
+    QUINE_CHECK(b->metadata.size() == IMAGES && b->metadata[IMAGES - 1] == "b.qdb-199");
+
+    // The next pin reloads b, evicting a, now the least recently used
+    std::shared_ptr<const quine_database_snapshot_t> reloaded = memory->pin_database("b.qdb");
+    QUINE_CHECK(reloaded && reloaded->metadata.size() == IMAGES);
+    QUINE_CHECK(reloaded && reloaded->metadata[0] == "b.qdb-0");
+    QUINE_CHECK(stats_of("b.qdb").resident && stats_of("b.qdb").misses == 2);
+    QUINE_CHECK(!stats_of("a.qdb").resident && stats_of("a.qdb").evictions == 1);
+    QUINE_CHECK(stats_of("c.qdb").resident);
+
+    // Lowering the budget evicts down to it; 0 lifts it
+    memory->set_memory_budget(footprint * 3 / 2);
+    QUINE_CHECK(memory->get_resident_bytes() <= footprint * 3 / 2);
+    QUINE_CHECK(stats_of("c.qdb").evictions == 1);
+    memory->set_memory_budget(0);
+    QUINE_CHECK(memory->pin_database("a.qdb") && memory->pin_database("c.qdb"));
+    QUINE_CHECK(stats_of("a.qdb").resident && stats_of("b.qdb").resident && stats_of("c.qdb").resident);
+}
+
+
+QUINE_TEST_MAIN()
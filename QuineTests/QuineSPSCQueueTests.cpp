@@ -0,0 +1,129 @@
+//
+//  QuineSPSCQueueTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineSPSCQueue.h"
+#include "QuineTest.h"
+
+#include <memory>
+#include <thread>
+
+
+QUINE_TEST(test_fifo_and_full)
+{
+    QuineSPSCQueue<int> queue(4);
+    QUINE_CHECK(queue.capacity() == 4);
+    QUINE_CHECK(queue.size() == 0);
+
+    int item = 0;
+    QUINE_CHECK(!queue.try_pop(item));
+
+    for(int i = 0; i < 4; i++) {
+        item = i;
+        QUINE_CHECK(queue.try_push(item));
+    }
+    QUINE_CHECK(queue.size() == 4);
+
+    // A full queue refuses the push and leaves the item alone
+    item = 99;
+    QUINE_CHECK(!queue.try_push(item));
+    QUINE_CHECK(item == 99);
+
+    for(int i = 0; i < 4; i++) {
+        QUINE_CHECK(queue.try_pop(item) && item == i);
+    }
+    QUINE_CHECK(!queue.try_pop(item));
+    QUINE_CHECK(queue.size() == 0);
+}
+
+
+QUINE_TEST(test_wraps_around)
+{
+    QuineSPSCQueue<int> queue(3);
+    int next_push = 0, next_pop = 0;
+
+    // Uneven pushes and pops, so head and tail wrap many times
+    for(int round = 0; round < 100; round++) {
+        for(int i = 0; i < 1 + round % 3; i++) {
+            int item = next_push;
+            if(queue.try_push(item)) {
+                next_push++;
+            }
+        }
+        for(int i = 0; i < 1 + (round + 1) % 3; i++) {
+            int item = -1;
+            if(queue.try_pop(item)) {
+                QUINE_CHECK(item == next_pop);
+                next_pop++;
+            }
+        }
+        QUINE_CHECK(queue.size() == (size_t)(next_push - next_pop));
+    }
+    QUINE_CHECK(next_pop > 100);
+}
+
+
+QUINE_TEST(test_moves_items)
+{
+    QuineSPSCQueue<std::unique_ptr<int> > queue(2);
+
+    std::unique_ptr<int> item(new int(7));
+    QUINE_CHECK(queue.try_push(item));
+    QUINE_CHECK(!item);
+
+    std::unique_ptr<int> out;
+    QUINE_CHECK(queue.try_pop(out));
+    QUINE_CHECK(out && *out == 7);
+
+    // The slot gives up what it held once popped
+    std::shared_ptr<int> shared(new int(1));
+    QuineSPSCQueue<std::shared_ptr<int> > shared_queue(2);
+    std::shared_ptr<int> copy = shared;
+    QUINE_CHECK(shared_queue.try_push(copy));
+    std::shared_ptr<int> popped;
+    QUINE_CHECK(shared_queue.try_pop(popped));
+    popped.reset();
+    QUINE_CHECK(shared.use_count() == 1);
+}
+
+
+QUINE_TEST(test_two_threads)
+{
+    const int count = 1000000;
+    QuineSPSCQueue<int> queue(64);
+
+    std::thread producer([&queue]() {
+        for(int i = 0; i < count; i++) {
+            int item = i;
+            while(!queue.try_push(item)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Every item arrives once, in order
+    int expected = 0;
+    int out_of_order = 0;
+    while(expected < count) {
+        int item = -1;
+        if(!queue.try_pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if(item != expected) {
+            out_of_order++;
+        }
+        expected++;
+    }
+    producer.join();
+
+    QUINE_CHECK(out_of_order == 0);
+    QUINE_CHECK(queue.size() == 0);
+}
+
+
+QUINE_TEST_MAIN()
@@ -0,0 +1,140 @@
+//
+//  QuineShardTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineMemoryDatabase.h"
+#include "QuineShardManifest.h"
+#include "QuineTest.h"
+
+#include <stdio.h>
+
+
+#define ROWS_PER_IMAGE  AKAZEOptions::AKAZE_KEYPOINTCOUNT
+#define COLUMNS         8
+
+// Two full shards and a partial one
+#define IMAGES          (2 * QUINE_SHARD_IMAGES + 100)
+
+
+static bool read_file(const std::string &path, std::string &out)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if(f == NULL) {
+        return false;
+    }
+    char buffer[65536];
+    size_t n;
+    out.clear();
+    while((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        out.append(buffer, n);
+    }
+    fclose(f);
+    return true;
+}
+
+
+// Folds the log and writes the database out, as quine-db compact does
+static void compact(const std::string &db)
+{
+    QuineMemory *memory = QuineMemory::database();
+    std::shared_ptr<QuineDescriptorStore> store;
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    memory->get_database(db, store, metadata, hashtable, true);
+    memory->update_database(db, store, metadata, hashtable, true);
+}
+
+
+QUINE_TEST(test_incremental_save_and_reload)
+{
+    QuineMemory *memory = QuineMemory::database();
+    const std::string db = "images.qdb";
+
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    for(int i = 0; i < IMAGES; i++) {
+        meta.push_back("image-" + std::to_string(i));
+        hashtable.push_back("hash-" + std::to_string(i));
+    }
+    cv::Mat desc = quine_test_descriptors(IMAGES * ROWS_PER_IMAGE, COLUMNS, 1);
+    QUINE_CHECK(memory->save_database_to_file(db, desc, quine_test_filter(IMAGES * ROWS_PER_IMAGE, 1),
+                                              meta, hashtable, false));
+
+    // Past QUINE_SHARD_IMAGES the database is written as shards
+    compact(db);
+    quine_manifest_t before;
+    QUINE_CHECK(read_manifest(db, before));
+    QUINE_CHECK(before.shards.size() == 3);
+    QUINE_CHECK(access(db.c_str(), F_OK) != 0);
+    if(before.shards.size() != 3) {
+        return;
+    }
+    std::string files[3];
+    for(int s = 0; s < 3; s++) {
+        QUINE_CHECK(read_file(shard_path(db, before.shards[s].id), files[s]));
+    }
+
+    // Delete from the first shard and append to the tail
+    cv::Mat added = quine_test_descriptors(ROWS_PER_IMAGE, COLUMNS, 2);
+    QUINE_CHECK(memory->delete_image(db, "image-10"));
+    QUINE_CHECK(memory->append_image(db, added, quine_test_filter(ROWS_PER_IMAGE, 2), "added", "hash-added"));
+    compact(db);
+
+    // Only the shards that changed were written again
+    quine_manifest_t after;
+    QUINE_CHECK(read_manifest(db, after));
+    QUINE_CHECK(after.shards.size() == 3);
+    if(after.shards.size() != 3) {
+        return;
+    }
+    QUINE_CHECK(after.shards[0].id != before.shards[0].id);
+    QUINE_CHECK(after.shards[0].image_count == QUINE_SHARD_IMAGES - 1);
+    QUINE_CHECK(after.shards[1].id == before.shards[1].id);
+    QUINE_CHECK(after.shards[1].crc == before.shards[1].crc);
+    QUINE_CHECK(after.shards[2].id != before.shards[2].id);
+    QUINE_CHECK(after.shards[2].image_count == 101);
+
+    std::string file;
+    QUINE_CHECK(read_file(shard_path(db, after.shards[1].id), file) && file == files[1]);
+    QUINE_CHECK(access(shard_path(db, before.shards[0].id).c_str(), F_OK) != 0);
+    QUINE_CHECK(access(shard_path(db, before.shards[2].id).c_str(), F_OK) != 0);
+
+    // Reloaded, the slots, metadata and descriptors still line up
+    memory->unload_database(db);
+    std::shared_ptr<const quine_database_snapshot_t> snapshot = memory->pin_database(db);
+    QUINE_CHECK(snapshot && snapshot->metadata.size() == IMAGES);
+    if(!snapshot || snapshot->metadata.size() != IMAGES) {
+        return;
+    }
+    QUINE_CHECK(snapshot->metadata[9] == "image-9");
+    QUINE_CHECK(snapshot->metadata[10] == "image-11");
+    QUINE_CHECK(snapshot->metadata[QUINE_SHARD_IMAGES - 1] == "image-" + std::to_string(QUINE_SHARD_IMAGES));
+    QUINE_CHECK(snapshot->metadata[IMAGES - 1] == "added");
+
+    cv::Mat reloaded, filter;
+    QuineDescriptorStore::gather(snapshot->chunks, reloaded, filter);
+    QUINE_CHECK(reloaded.rows == IMAGES * ROWS_PER_IMAGE);
+    if(reloaded.rows != IMAGES * ROWS_PER_IMAGE) {
+        return;
+    }
+    QUINE_CHECK(quine_test_equal(reloaded.rowRange(9 * ROWS_PER_IMAGE, 10 * ROWS_PER_IMAGE),
+                                 desc.rowRange(9 * ROWS_PER_IMAGE, 10 * ROWS_PER_IMAGE)));
+    QUINE_CHECK(quine_test_equal(reloaded.rowRange(10 * ROWS_PER_IMAGE, 11 * ROWS_PER_IMAGE),
+                                 desc.rowRange(11 * ROWS_PER_IMAGE, 12 * ROWS_PER_IMAGE)));
+    QUINE_CHECK(quine_test_equal(reloaded.rowRange(5000 * ROWS_PER_IMAGE, 5001 * ROWS_PER_IMAGE),
+                                 desc.rowRange(5001 * ROWS_PER_IMAGE, 5002 * ROWS_PER_IMAGE)));
+    QUINE_CHECK(quine_test_equal(reloaded.rowRange((IMAGES - 1) * ROWS_PER_IMAGE, IMAGES * ROWS_PER_IMAGE), added));
+
+    uint32_t slot = 0;
+    QUINE_CHECK(!memory->find_image(db, "image-10", slot));
+    QUINE_CHECK(memory->find_image(db, "added", slot) && slot == IMAGES - 1);
+    QUINE_CHECK(memory->contains_image(db, "hash-added"));
+    QUINE_CHECK(!memory->contains_image(db, "hash-10"));
+}
+
+
+QUINE_TEST_MAIN()
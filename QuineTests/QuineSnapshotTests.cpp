@@ -0,0 +1,116 @@
+//
+//  QuineSnapshotTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineMemoryDatabase.h"
+#include "QuineTest.h"
+
+#include <thread>
+
+
+#define ROWS_PER_IMAGE  10
+
+
+static bool add_image(const std::string &db, int i)
+{
+    return QuineMemory::database()->append_image(db, quine_test_descriptors(ROWS_PER_IMAGE, 61, i),
+                                                 quine_test_filter(ROWS_PER_IMAGE, i),
+                                                 "image-" + std::to_string(i), "hash-" + std::to_string(i));
+}
+
+
+static cv::Mat snapshot_rows(const quine_database_snapshot_t &snapshot)
+{
+    cv::Mat desc, filter;
+    QuineDescriptorStore::gather(snapshot.chunks, desc, filter);
+    return desc;
+}
+
+
+QUINE_TEST(test_snapshot_is_immutable)
+{
+    QuineMemory *memory = QuineMemory::database();
+    const std::string db = "immutable.qdb";
+    for(int i = 0; i < 4; i++) {
+        QUINE_CHECK(add_image(db, i));
+    }
+
+    std::shared_ptr<const quine_database_snapshot_t> pinned = memory->pin_database(db);
+    QUINE_CHECK(pinned && pinned->metadata.size() == 4);
+    cv::Mat rows = snapshot_rows(*pinned).clone();
+
+    // Later changes publish new snapshots and leave the pinned one as it was
+    for(int i = 4; i < 40; i++) {
+        QUINE_CHECK(add_image(db, i));
+    }
+    QUINE_CHECK(memory->delete_image(db, "image-1"));
+
+    std::shared_ptr<const quine_database_snapshot_t> latest = memory->pin_database(db);
+    QUINE_CHECK(latest->generation > pinned->generation);
+    QUINE_CHECK(latest->metadata.size() == 40);
+    QUINE_CHECK(pinned->metadata.size() == 4);
+    QUINE_CHECK(pinned->metadata[3] == "image-3");
+    QUINE_CHECK(quine_test_equal(snapshot_rows(*pinned), rows));
+    QUINE_CHECK(!(pinned->tombstones->size() > 1 && (*pinned->tombstones)[1]));
+}
+
+
+QUINE_TEST(test_snapshot_outlives_database)
+{
+    QuineMemory *memory = QuineMemory::database();
+    const std::string db = "outlives.qdb";
+    for(int i = 0; i < 3; i++) {
+        QUINE_CHECK(add_image(db, i));
+    }
+
+    QuineDatabaseHandle handle = memory->open_database(db);
+    QUINE_CHECK(handle.valid());
+    cv::Mat rows = snapshot_rows(*memory->pin_database(db)).clone();
+
+    // Unloading or reloading the database does not pull memory from under a query
+    memory->unload_database(db);
+    QUINE_CHECK(handle.size() == 3);
+    QUINE_CHECK(handle.metadata()[2] == "image-2");
+
+    QUINE_CHECK(memory->reload_database(db));
+    cv::Mat desc, filter;
+    QuineDescriptorStore::gather(handle.chunks(), desc, filter);
+    QUINE_CHECK(quine_test_equal(desc, rows));
+}
+
+
+QUINE_TEST(test_pin_while_writing)
+{
+    QuineMemory *memory = QuineMemory::database();
+    const std::string db = "concurrent.qdb";
+    QUINE_CHECK(add_image(db, 0));
+
+    // Every snapshot a reader pins is consistent: one row block per image
+    int inconsistent = 0;
+    std::thread reader([&]() {
+        for(int i = 0; i < 2000; i++) {
+            std::shared_ptr<const quine_database_snapshot_t> snapshot = memory->pin_database(db);
+            size_t rows = 0;
+            for(size_t c = 0; c < snapshot->chunks.size(); c++) {
+                rows += snapshot->chunks[c].desc.rows;
+            }
+            if(rows != snapshot->metadata.size() * ROWS_PER_IMAGE) {
+                inconsistent++;
+            }
+        }
+    });
+    for(int i = 1; i < 50; i++) {
+        add_image(db, i);
+    }
+    reader.join();
+
+    QUINE_CHECK(inconsistent == 0);
+    QUINE_CHECK(memory->get_indices(db).size() == 50);
+}
+
+
+QUINE_TEST_MAIN()
@@ -0,0 +1,172 @@
+//
+//  QuineTest.h
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#ifndef __Quine__QuineTest__
+#define __Quine__QuineTest__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Minimal harness for the tests of the C++ core, which ctest runs
+ *        one executable per test file (see CMakeLists.txt).
+ *
+ *        A test file defines its cases with QUINE_TEST(name) and ends with
+ *        QUINE_TEST_MAIN(). QUINE_CHECK() reports a failed expression and
+ *        carries on, so one run shows every failure; the executable exits
+ *        non-zero if any check failed. Cases run in order, in a fresh
+ *        directory of their own.
+ */
+typedef void (*quine_test_fn_t)();
+
+typedef struct quine_test_case {
+    const char *name;
+    quine_test_fn_t fn;
+} quine_test_case_t;
+
+
+inline std::vector<quine_test_case_t> &quine_test_cases() {
+    static std::vector<quine_test_case_t> cases;
+    return cases;
+}
+
+inline int &quine_test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+struct quine_test_registrar {
+    quine_test_registrar(const char *name, quine_test_fn_t fn) {
+        quine_test_case_t test = { name, fn };
+        quine_test_cases().push_back(test);
+    }
+};
+
+
+#define QUINE_TEST(name) \
+    static void name(); \
+    static quine_test_registrar name##_registrar(#name, name); \
+    static void name()
+
+#define QUINE_CHECK(expr) \
+    do { \
+        if(!(expr)) { \
+            std::cout << "[Quine: Test]: " << __FILE__ << ":" << __LINE__ \
+                      << ": check failed: " << #expr << std::endl; \
+            quine_test_failures()++; \
+        } \
+    } while(0)
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Runs every case, each in a new directory under the working
+ *        directory, and reports the result.
+ *
+ * @return (int) exit status for ctest
+ */
+inline int quine_run_tests() {
+
+    char dir[] = "run.XXXXXX";
+    if(mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        std::cout << "[Quine: Test]: Could not create a scratch directory" << std::endl;
+        return 1;
+    }
+
+    std::vector<quine_test_case_t> &cases = quine_test_cases();
+    for(size_t i = 0; i < cases.size(); i++) {
+        int failures = quine_test_failures();
+
+        std::string case_dir = cases[i].name;
+        if(mkdir(case_dir.c_str(), 0755) != 0 || chdir(case_dir.c_str()) != 0) {
+            std::cout << "[Quine: Test]: Could not enter " << case_dir << std::endl;
+            return 1;
+        }
+        cases[i].fn();
+        if(chdir("..") != 0) {
+            return 1;
+        }
+
+        std::cout << "[Quine: Test]: " << cases[i].name
+                  << (quine_test_failures() == failures ? " passed" : " FAILED") << std::endl;
+    }
+
+    std::cout << "[Quine: Test]: " << cases.size() << " cases, "
+              << quine_test_failures() << " failed checks" << std::endl;
+    return quine_test_failures() == 0 ? 0 : 1;
+}
+
+#define QUINE_TEST_MAIN() \
+    int main() { return quine_run_tests(); }
+
+
+#pragma mark -
+#pragma mark Fixtures
+
+/* ************************************************************************* */
+/*!
+ * @brief Descriptors (CV_32FC1) filled with a deterministic pattern, so
+ *        rows written by different cases or seeds never compare equal.
+ *
+ * @return (cv::Mat)
+ */
+inline cv::Mat quine_test_descriptors(int rows, int cols, int seed) {
+    cv::Mat desc(rows, cols, CV_32FC1);
+    for(int r = 0; r < rows; r++) {
+        for(int c = 0; c < cols; c++) {
+            desc.at<float>(r, c) = seed * 1000.0f + r * 0.5f + c * 0.25f;
+        }
+    }
+    return desc;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Keypoint class filter (CV_8UC1) to go with quine_test_descriptors().
+ *
+ * @return (cv::Mat)
+ */
+inline cv::Mat quine_test_filter(int rows, int seed) {
+    cv::Mat filter(rows, 1, CV_8UC1);
+    for(int r = 0; r < rows; r++) {
+        filter.at<uchar>(r, 0) = (uchar)((r + seed) % 5);
+    }
+    return filter;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Compares the type, shape and every element of two matrices.
+ *
+ * @return (bool)
+ */
+inline bool quine_test_equal(const cv::Mat &a, const cv::Mat &b) {
+    if(a.rows != b.rows || a.cols != b.cols || a.type() != b.type()) {
+        return false;
+    }
+    size_t row_bytes = (size_t)a.cols * a.elemSize();
+    for(int r = 0; r < a.rows; r++) {
+        if(memcmp(a.ptr(r), b.ptr(r), row_bytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+#endif /* defined(__Quine__QuineTest__) */
@@ -0,0 +1,211 @@
+//
+//  QuineTombstoneTests.cpp
+//  QuineTests
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+
+#include "QuineDatabaseLog.h"
+#include "QuineMemoryDatabase.h"
+#include "QuineTest.h"
+
+#include <algorithm>
+
+
+#define ROWS_PER_IMAGE  10
+
+
+static quine_log_entry_t image_entry(uint32_t type, int seed, const std::string &meta)
+{
+    quine_log_entry_t entry;
+    entry.type = type;
+    entry.meta = meta;
+    if(type != QUINE_LOG_DELETE_IMAGE) {
+        entry.desc = quine_test_descriptors(ROWS_PER_IMAGE, 61, seed);
+        entry.filter = quine_test_filter(ROWS_PER_IMAGE, seed);
+        entry.hash = "hash-" + std::to_string(seed);
+    }
+    return entry;
+}
+
+
+static bool is_dead(const std::vector<bool> &tombstones, size_t slot)
+{
+    return slot < tombstones.size() && tombstones[slot];
+}
+
+
+QUINE_TEST(test_delete_retires_every_slot)
+{
+    QuineDescriptorStore store;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    std::vector<bool> tombstones;
+    quine_image_slots_t images;
+
+    // Slots 0..5; "a" is in slots 0, 2 and 5
+    const char *names[] = { "a", "b", "a", "c", "d", "a" };
+    for(int i = 0; i < 6; i++) {
+        apply_log_entry(image_entry(QUINE_LOG_ADD_IMAGE, i, names[i]), store, meta, hashtable, tombstones, images);
+    }
+    QUINE_CHECK(meta.size() == 6);
+    QUINE_CHECK(store.rows() == 6 * ROWS_PER_IMAGE);
+
+    // Adding never grows the tombstones; slots past their end are live
+    QUINE_CHECK(tombstones.empty());
+
+    std::vector<uint32_t> killed;
+    apply_log_entry(image_entry(QUINE_LOG_DELETE_IMAGE, 0, "a"), store, meta, hashtable, tombstones, images, &killed);
+    std::sort(killed.begin(), killed.end());
+    QUINE_CHECK(killed.size() == 3);
+    QUINE_CHECK(killed.size() == 3 && killed[0] == 0 && killed[1] == 2 && killed[2] == 5);
+    QUINE_CHECK(is_dead(tombstones, 0) && is_dead(tombstones, 2) && is_dead(tombstones, 5));
+    QUINE_CHECK(!is_dead(tombstones, 1) && !is_dead(tombstones, 3) && !is_dead(tombstones, 4));
+
+    // The rows stay until compaction; only the flags change
+    QUINE_CHECK(meta.size() == 6);
+    QUINE_CHECK(store.rows() == 6 * ROWS_PER_IMAGE);
+
+    // Deleting it again, or something that was never there, does nothing
+    killed.clear();
+    apply_log_entry(image_entry(QUINE_LOG_DELETE_IMAGE, 0, "a"), store, meta, hashtable, tombstones, images, &killed);
+    apply_log_entry(image_entry(QUINE_LOG_DELETE_IMAGE, 0, "missing"), store, meta, hashtable, tombstones, images, &killed);
+    QUINE_CHECK(killed.empty());
+
+    // An image added after the deletion is live, and only it is deleted next
+    apply_log_entry(image_entry(QUINE_LOG_ADD_IMAGE, 6, "a"), store, meta, hashtable, tombstones, images);
+    QUINE_CHECK(!is_dead(tombstones, 6));
+    apply_log_entry(image_entry(QUINE_LOG_DELETE_IMAGE, 0, "a"), store, meta, hashtable, tombstones, images, &killed);
+    QUINE_CHECK(killed.size() == 1 && killed[0] == 6);
+}
+
+
+QUINE_TEST(test_replace)
+{
+    QuineDescriptorStore store;
+    QuineStringTable meta;
+    cv::vector<std::string> hashtable;
+    std::vector<bool> tombstones;
+    quine_image_slots_t images;
+
+    apply_log_entry(image_entry(QUINE_LOG_ADD_IMAGE, 0, "a"), store, meta, hashtable, tombstones, images);
+    apply_log_entry(image_entry(QUINE_LOG_ADD_IMAGE, 1, "b"), store, meta, hashtable, tombstones, images);
+    apply_log_entry(image_entry(QUINE_LOG_ADD_IMAGE, 2, "a"), store, meta, hashtable, tombstones, images);
+
+    std::vector<uint32_t> killed;
+    apply_log_entry(image_entry(QUINE_LOG_REPLACE_IMAGE, 3, "a"), store, meta, hashtable, tombstones, images, &killed);
+    QUINE_CHECK(killed.size() == 2);
+    QUINE_CHECK(meta.size() == 4 && meta[3] == "a");
+    QUINE_CHECK(hashtable.size() == 4 && hashtable[3] == "hash-3");
+    QUINE_CHECK(is_dead(tombstones, 0) && is_dead(tombstones, 2));
+    QUINE_CHECK(!is_dead(tombstones, 1) && !is_dead(tombstones, 3));
+
+    // Replacing something that is not there just adds it
+    killed.clear();
+    apply_log_entry(image_entry(QUINE_LOG_REPLACE_IMAGE, 4, "new"), store, meta, hashtable, tombstones, images, &killed);
+    QUINE_CHECK(killed.empty());
+    QUINE_CHECK(meta.size() == 5 && !is_dead(tombstones, 4));
+}
+
+
+QUINE_TEST(test_build_image_slots)
+{
+    std::vector<std::string> strings;
+    strings.push_back("a");
+    strings.push_back("b");
+    strings.push_back("a");
+    strings.push_back("a");
+    QuineStringTable meta;
+    meta.assign(strings);
+
+    // Slot 2 was deleted before the database was saved; slot 3 is past the flags
+    std::vector<bool> tombstones(3, false);
+    tombstones[2] = true;
+
+    quine_image_slots_t images;
+    build_image_slots(meta, tombstones, images);
+
+    uint32_t slot = 0;
+    QUINE_CHECK(images.latest.find("a", slot) && slot == 3);
+    QUINE_CHECK(images.previous.size() == 4);
+    QUINE_CHECK(images.previous.size() == 4 && images.previous[3] == 0);
+    QUINE_CHECK(images.previous.size() == 4 && images.previous[0] == QUINE_LOG_NO_SLOT);
+    QUINE_CHECK(images.latest.find("b", slot) && slot == 1);
+    QUINE_CHECK(!images.latest.find("c", slot));
+}
+
+
+QUINE_TEST(test_memory_delete_and_replace)
+{
+    QuineMemory *memory = QuineMemory::database();
+    const std::string db = "tombstones.qdb";
+
+    for(int i = 0; i < 10; i++) {
+        quine_log_entry_t entry = image_entry(QUINE_LOG_ADD_IMAGE, i, "image-" + std::to_string(i % 8));
+        QUINE_CHECK(memory->append_image(db, entry.desc, entry.filter, entry.meta, entry.hash));
+    }
+
+    // image-1 is in slots 1 and 9
+    QUINE_CHECK(memory->delete_image(db, "image-1"));
+    std::vector<bool> tombstones = memory->get_tombstones(db);
+    QUINE_CHECK(tombstones.size() == 10);
+    QUINE_CHECK(is_dead(tombstones, 1) && is_dead(tombstones, 9));
+    QUINE_CHECK(std::count(tombstones.begin(), tombstones.end(), true) == 2);
+
+    uint32_t slot = 0;
+    QUINE_CHECK(!memory->find_image(db, "image-1", slot));
+    QUINE_CHECK(!memory->contains_image(db, "hash-1"));
+    QUINE_CHECK(!memory->contains_image(db, "hash-9"));
+
+    quine_log_entry_t replacement = image_entry(QUINE_LOG_REPLACE_IMAGE, 20, "image-2");
+    QUINE_CHECK(memory->replace_image(db, replacement.desc, replacement.filter, replacement.meta, replacement.hash));
+    QUINE_CHECK(memory->find_image(db, "image-2", slot) && slot == 10);
+    QUINE_CHECK(!memory->contains_image(db, "hash-2"));
+    QUINE_CHECK(memory->contains_image(db, "hash-20"));
+
+    // Reloading replays the deletions from the log
+    std::vector<bool> before = memory->get_tombstones(db);
+    QUINE_CHECK(memory->reload_database(db));
+    QUINE_CHECK(memory->get_tombstones(db) == before);
+    QUINE_CHECK(memory->get_indices(db).size() == 11);
+    QUINE_CHECK(!memory->find_image(db, "image-1", slot));
+    QUINE_CHECK(memory->find_image(db, "image-2", slot) && slot == 10);
+}
+
+
+QUINE_TEST(test_snapshot_keeps_its_tombstones)
+{
+    QuineMemory *memory = QuineMemory::database();
+    const std::string db = "snapshots.qdb";
+
+    for(int i = 0; i < 5; i++) {
+        quine_log_entry_t entry = image_entry(QUINE_LOG_ADD_IMAGE, i, "image-" + std::to_string(i));
+        QUINE_CHECK(memory->append_image(db, entry.desc, entry.filter, entry.meta, entry.hash));
+    }
+    QuineDatabaseHandle before = memory->open_database(db);
+    QUINE_CHECK(before.valid() && before.size() == 5);
+
+    // Adding shares the tombstones with the earlier snapshot
+    quine_log_entry_t entry = image_entry(QUINE_LOG_ADD_IMAGE, 5, "image-5");
+    QUINE_CHECK(memory->append_image(db, entry.desc, entry.filter, entry.meta, entry.hash));
+    std::shared_ptr<const quine_database_snapshot_t> added = memory->pin_database(db);
+    QUINE_CHECK(added->tombstones.get() == &before.tombstones());
+    QUINE_CHECK(added->metadata.size() == 6);
+
+    // Deleting copies them, and the pinned snapshots do not see it
+    QUINE_CHECK(memory->delete_image(db, "image-3"));
+    QuineDatabaseHandle after = memory->open_database(db);
+    QUINE_CHECK(!after.is_live(3));
+    QUINE_CHECK(before.is_live(3));
+    QUINE_CHECK(!is_dead(*added->tombstones, 3));
+    QUINE_CHECK(before.size() == 5 && after.size() == 6);
+    QUINE_CHECK(before.generation() < after.generation());
+
+    // A slot added after the last deletion is live in every snapshot
+    QUINE_CHECK(after.is_live(5));
+    QUINE_CHECK(before.metadata()[3] == "image-3");
+}
+
+
+QUINE_TEST_MAIN()
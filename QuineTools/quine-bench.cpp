@@ -0,0 +1,661 @@
+//
+//  quine-bench.cpp
+//  QuineTools
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+//  Benchmark suite of the C++ core. Micro-benchmarks time each step of a
+//  query (graying, resizing, describing, matching) and database loads and
+//  saves; macro-benchmarks time end-to-end queries, as QuineCompare runs
+//  them, against synthetic databases of 1k to 1M images. Results are
+//  written as JSON, one result per line, and can be compared against an
+//  earlier run with --compare.
+//
+//  Build from the repository root, with OpenCV 2.4 and libAKAZE, by compiling
+//  this file together with Quine/*.cpp and linking opencv, akaze, z and pthread.
+//
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "QuineConstants.h"
+#include "QuineDatabaseOperations.h"
+#include "QuineFeatureDetection.h"
+#include "QuineFrameArena.h"
+#include "QuineMatcher.h"
+#include "QuineMemoryDatabase.h"
+#include "QuineSyntheticDatabase.h"
+
+
+// Runs of each micro-benchmark, after the warm-up runs
+#define QUINE_BENCH_ITERATIONS      50
+#define QUINE_BENCH_WARMUP          3
+
+// Queries of each macro-benchmark
+#define QUINE_BENCH_QUERIES         20
+
+// Images of the database micro-benchmarks match, load and save
+#define QUINE_BENCH_MICRO_IMAGES    1000
+
+// Database sizes of the macro-benchmarks, unless --sizes is given
+#define QUINE_BENCH_SIZES           "1000,10000,100000"
+
+// Synthetic camera frame, as AVCaptureSessionPresetMedium delivers
+#define QUINE_BENCH_FRAME_WIDTH     480
+#define QUINE_BENCH_FRAME_HEIGHT    360
+
+// A median this much slower than the baseline's is a regression (%)
+#define QUINE_BENCH_THRESHOLD       10.0
+
+// Query defaults, as in QuineCompare
+#define QUINE_BENCH_DRATIO          0.96f
+#define QUINE_BENCH_ACCEPT_RATIO    0.10f
+
+
+static void usage()
+{
+    std::cout <<
+    "usage: quine-bench [options]\n"
+    "\n"
+    "  --micro                 Runs the micro-benchmarks only\n"
+    "  --macro                 Runs the macro-benchmarks only\n"
+    "  --sizes <n,n,...>       Images of the macro-benchmark databases (" QUINE_BENCH_SIZES ")\n"
+    "  --iterations <n>        Runs of each micro-benchmark\n"
+    "  --image <path>          Query image (a synthetic frame by default)\n"
+    "  --workdir <directory>   Where databases are written (/tmp)\n"
+    "  --output <path>         Writes the results there instead of stdout\n"
+    "  --compare <path>        Compares the medians with an earlier run\n"
+    "  --threshold <percent>   Slowdown reported as a regression\n";
+}
+
+
+static double elapsed_ms(int64_t start)
+{
+    return 1000.0 * (cv::getTickCount() - start) / cv::getTickFrequency();
+}
+
+
+static size_t file_size(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+
+#pragma mark -
+#pragma mark Results
+/* ************************************************************************* */
+/*!
+ * @brief Timings of one benchmark, plus the figures that go with them
+ *        (images, bytes, ...).
+ */
+typedef struct bench_result {
+    std::string id;
+    std::vector<double> samples_ms;
+    std::vector<std::pair<std::string, double> > figures;
+    std::string note;
+} bench_result_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Runs the body a few times to warm up, then iterations times,
+ *        timing each run.
+ *
+ * @return (void)
+ */
+template <class Body>
+static void measure(bench_result_t &result, int iterations, Body body)
+{
+    for(int i = 0; i < QUINE_BENCH_WARMUP; i++) {
+        body();
+    }
+    for(int i = 0; i < iterations; i++) {
+        int64_t start = cv::getTickCount();
+        body();
+        result.samples_ms.push_back(elapsed_ms(start));
+    }
+}
+
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if(sorted.empty()) {
+        return 0.0;
+    }
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief One result as a single line of JSON, so that --compare can read
+ *        it back without a JSON parser.
+ *
+ * @return (std::string)
+ */
+static std::string result_json(const bench_result_t &result)
+{
+    std::vector<double> sorted(result.samples_ms);
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for(size_t i = 0; i < sorted.size(); i++) {
+        total += sorted[i];
+    }
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "{\"id\": \"%s\", \"runs\": %zu, \"min_ms\": %.4f, \"median_ms\": %.4f, \"p95_ms\": %.4f, "
+             "\"mean_ms\": %.4f, \"max_ms\": %.4f",
+             result.id.c_str(), sorted.size(), sorted.empty() ? 0.0 : sorted.front(), percentile(sorted, 0.5),
+             percentile(sorted, 0.95), sorted.empty() ? 0.0 : total / sorted.size(),
+             sorted.empty() ? 0.0 : sorted.back());
+
+    std::string line(buffer);
+    for(size_t i = 0; i < result.figures.size(); i++) {
+        snprintf(buffer, sizeof(buffer), ", \"%s\": %.17g", result.figures[i].first.c_str(), result.figures[i].second);
+        line += buffer;
+    }
+    if(!result.note.empty()) {
+        line += ", \"note\": \"" + result.note + "\"";
+    }
+    return line + "}";
+}
+
+
+static void write_results(std::ostream &out, const std::vector<bench_result_t> &results)
+{
+    char started[32];
+    time_t now = time(NULL);
+    strftime(started, sizeof(started), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    out << "{\n";
+    out << "  \"suite\": \"quine-bench\",\n";
+    out << "  \"format\": 1,\n";
+    out << "  \"started\": \"" << started << "\",\n";
+    out << "  \"host\": {\"threads\": " << cv::getNumThreads() << ", \"opencv\": \"" << CV_VERSION << "\"},\n";
+    out << "  \"results\": [\n";
+    for(size_t i = 0; i < results.size(); i++) {
+        out << "    " << result_json(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads the median of every result of an earlier run.
+ *
+ * @return (bool) false if the file can't be read
+ */
+static bool read_medians(const std::string &path, std::map<std::string, double> &medians)
+{
+    std::ifstream in(path.c_str());
+    if(!in.good()) {
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(in, line)) {
+        size_t id = line.find("\"id\": \"");
+        size_t median = line.find("\"median_ms\": ");
+        if(id == std::string::npos || median == std::string::npos) {
+            continue;
+        }
+        id += 7;
+        medians[line.substr(id, line.find('"', id) - id)] = atof(line.c_str() + median + 13);
+    }
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Prints the change of every median against the baseline.
+ *
+ * @return (int) number of regressions beyond the threshold
+ */
+static int compare_results(const std::vector<bench_result_t> &results,
+                           const std::map<std::string, double> &baseline,
+                           double threshold)
+{
+    int regressions = 0;
+    fprintf(stderr, "%-40s %12s %12s %9s\n", "benchmark", "baseline ms", "median ms", "change");
+    for(size_t i = 0; i < results.size(); i++) {
+        std::map<std::string, double>::const_iterator before = baseline.find(results[i].id);
+        if(before == baseline.end() || results[i].samples_ms.empty()) {
+            continue;
+        }
+
+        std::vector<double> sorted(results[i].samples_ms);
+        std::sort(sorted.begin(), sorted.end());
+        double median = percentile(sorted, 0.5);
+        double change = before->second > 0.0 ? 100.0 * (median - before->second) / before->second : 0.0;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        fprintf(stderr, "%-40s %12.3f %12.3f %+8.1f%%%s\n", results[i].id.c_str(), before->second, median, change,
+                regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+
+#pragma mark -
+#pragma mark Synthetic data
+/* ************************************************************************* */
+/*!
+ * @brief A textured BGRA camera frame (rectangles and circles over noise),
+ *        with enough corners for AKAZE to find keypoints in.
+ *
+ * @return (cv::Mat)
+ */
+static cv::Mat synthetic_frame(int width, int height, uint64_t seed)
+{
+    cv::RNG rng(seed);
+    cv::Mat frame(height, width, CV_8UC4);
+    rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(64));
+
+    for(int i = 0; i < 60; i++) {
+        cv::Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256), 255);
+        cv::Point center(rng.uniform(0, width), rng.uniform(0, height));
+        if(i % 2) {
+            cv::circle(frame, center, rng.uniform(4, width / 8), color, -1);
+        }
+        else {
+            cv::Point corner(center.x + rng.uniform(8, width / 5), center.y + rng.uniform(8, height / 5));
+            cv::rectangle(frame, center, corner, color, -1);
+        }
+    }
+    return frame;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Synthetic images (see QuineSyntheticDatabase), with the query's
+ *        descriptors planted in one image so the query has something to
+ *        match.
+ *
+ * @return (void)
+ */
+static void synthetic_database(size_t images,
+                               size_t planted,
+                               const akaze_response_struc &query,
+                               cv::Mat &desc,
+                               cv::Mat &filter,
+                               QuineStringTable &metadata,
+                               cv::vector<std::string> &hashtable)
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+
+    quine_descriptor_model_t model;
+    default_descriptor_model(model);
+    QuineSyntheticDatabase generator(model, images);
+    generator.generate(0, images, desc, filter);
+
+    int rows = std::min(K, query.desc.rows);
+    if(rows > 0 && query.desc.cols == desc.cols) {
+        cv::Mat query_desc;
+        query.desc.rowRange(0, rows).convertTo(query_desc, CV_32FC1);
+        query_desc.copyTo(desc.rowRange((int)(planted * K), (int)(planted * K) + rows));
+        query.filter.rowRange(0, rows).copyTo(filter.rowRange((int)(planted * K), (int)(planted * K) + rows));
+    }
+
+    metadata.clear();
+    hashtable.clear();
+    for(size_t i = 0; i < images; i++) {
+        metadata.push_back(QuineSyntheticDatabase::image_name(i));
+        hashtable.push_back("");
+    }
+}
+
+
+static size_t physical_memory()
+{
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    return pages > 0 && page_size > 0 ? (size_t)pages * (size_t)page_size : 0;
+}
+
+
+#pragma mark -
+#pragma mark Benchmarks
+/* ************************************************************************* */
+/*!
+ * @brief Each step of a query, in QuineCompare's order, then matching,
+ *        loading and saving a QUINE_BENCH_MICRO_IMAGES database.
+ *
+ * @return (bool) false if a database could not be written
+ */
+static bool run_micro(const cv::Mat &frame,
+                      int iterations,
+                      const std::string &workdir,
+                      std::vector<bench_result_t> &results)
+{
+    QuineFeatureDetection feature;
+    cv::Mat resized_img, gray_img;
+    akaze_response_struc query;
+
+    bench_result_t resize;
+    resize.id = "micro/resize_to_width";
+    measure(resize, iterations, [&]() { feature.resize_to_width(frame, resized_img, RESIZED_IMAGE_WIDTH); });
+    resize.figures.push_back(std::make_pair("width", (double)frame.cols));
+    resize.figures.push_back(std::make_pair("height", (double)frame.rows));
+    results.push_back(resize);
+
+    bench_result_t gray;
+    gray.id = "micro/get_gray";
+    measure(gray, iterations, [&]() { feature.get_gray(resized_img, gray_img); });
+    gray.figures.push_back(std::make_pair("width", (double)resized_img.cols));
+    gray.figures.push_back(std::make_pair("height", (double)resized_img.rows));
+    results.push_back(gray);
+
+    bench_result_t signature;
+    bench_result_t akaze;
+    signature.id = "micro/compute_signature";
+    akaze.id = "micro/compute_signature/akaze";
+    measure(signature, iterations, [&]() {
+        akaze_response_struc response;
+        feature.compute_signature(gray_img, response, true);
+        akaze.samples_ms.push_back(response.akaze_ms);
+        query = response;
+    });
+    akaze.samples_ms.erase(akaze.samples_ms.begin(), akaze.samples_ms.begin() + QUINE_BENCH_WARMUP);
+    signature.figures.push_back(std::make_pair("keypoints", (double)query.kpts_count));
+    results.push_back(signature);
+    results.push_back(akaze);
+
+
+    //////////////////////////////////////////////////////////
+    // A database to match, load and save
+
+    cv::Mat desc, filter;
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    synthetic_database(QUINE_BENCH_MICRO_IMAGES, QUINE_BENCH_MICRO_IMAGES / 2, query, desc, filter, metadata,
+                       hashtable);
+
+    std::vector<quine_store_chunk_t> chunks(1);
+    chunks[0].desc = desc;
+    chunks[0].filter = filter;
+    chunks[0].first_row = 0;
+    std::vector<bool> tombstones(metadata.size(), false);
+
+    QuineFrameArena arena;
+    bench_result_t match;
+    match.id = "micro/compare_mat_souces";
+    int slot = -1;
+    measure(match, iterations, [&]() {
+        std::set<int> matched;
+        slot = compare_mat_souces(query.desc, query.kpts_count, chunks, query.filter, metadata, tombstones,
+                                  matched, QUINE_BENCH_DRATIO, QUINE_BENCH_ACCEPT_RATIO, NULL, &arena);
+        arena.reset();
+    });
+    match.figures.push_back(std::make_pair("images", (double)metadata.size()));
+    match.figures.push_back(std::make_pair("matched", (double)(slot == QUINE_BENCH_MICRO_IMAGES / 2)));
+    results.push_back(match);
+
+    QuineMemory *memory = QuineMemory::database();
+    const char *formats[] = { "qdb", "qdbz", "bin" };
+    for(int f = 0; f < 3; f++) {
+        std::string path = workdir + "/quine-bench-micro." + formats[f];
+        bool compressed = f > 0;
+
+        bench_result_t save;
+        save.id = std::string("micro/save_database_to_file/") + formats[f];
+        bool saved = true;
+        measure(save, iterations, [&]() {
+            saved = memory->save_database_to_file(path, desc, filter, metadata, hashtable, compressed) && saved;
+        });
+        if(!saved) {
+            std::cerr << "[Quine: Error]: Could not write database: " << path << std::endl;
+            return false;
+        }
+        save.figures.push_back(std::make_pair("images", (double)metadata.size()));
+        save.figures.push_back(std::make_pair("bytes", (double)file_size(path)));
+        results.push_back(save);
+
+        bench_result_t load;
+        load.id = std::string("micro/load_database_from_file/") + formats[f];
+        measure(load, iterations, [&]() {
+            QuineDescriptorStore store;
+            QuineStringTable loaded_metadata;
+            cv::vector<std::string> loaded_hashtable;
+            std::vector<bool> loaded_tombstones;
+            memory->load_database_from_file(path, store, loaded_metadata, loaded_hashtable, loaded_tombstones);
+        });
+        load.figures.push_back(std::make_pair("images", (double)metadata.size()));
+        results.push_back(load);
+
+        unlink(path.c_str());
+    }
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief End-to-end queries against a database of each size: the camera
+ *        frame is resized, grayed, described and matched against every
+ *        loaded database, as -[QuineCompare compareMatToLoadedDatabase:]
+ *        does.
+ *
+ * @return (void)
+ */
+static void run_macro(const cv::Mat &frame,
+                      const std::vector<size_t> &sizes,
+                      const std::string &workdir,
+                      std::vector<bench_result_t> &results)
+{
+    QuineFeatureDetection feature;
+    QuineFrameArena arena;
+    QuineMemory *memory = QuineMemory::database();
+    QuineDatabaseOperations database_op;
+
+    cv::Mat resized_img, gray_img;
+    akaze_response_struc query;
+    feature.resize_to_width(frame, resized_img, RESIZED_IMAGE_WIDTH);
+    feature.get_gray(resized_img, gray_img);
+    feature.compute_signature(gray_img, query, true);
+
+    const size_t row_bytes = AKAZEOptions::AKAZE_FEATURECOUNT * sizeof(float) + 1;
+    size_t available = physical_memory();
+
+    for(size_t s = 0; s < sizes.size(); s++) {
+        size_t images = sizes[s];
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "macro/%zu", images);
+
+        // The descriptors are generated, saved and loaded, so twice over in memory
+        size_t needed = 2 * images * AKAZEOptions::AKAZE_KEYPOINTCOUNT * row_bytes;
+        if(available > 0 && needed > available / 2) {
+            bench_result_t skipped;
+            skipped.id = std::string(prefix) + "/query";
+            skipped.note = "skipped: needs more memory than the host has";
+            skipped.figures.push_back(std::make_pair("images", (double)images));
+            skipped.figures.push_back(std::make_pair("bytes_needed", (double)needed));
+            results.push_back(skipped);
+            fprintf(stderr, "%s: skipped, needs %zu bytes\n", prefix, needed);
+            continue;
+        }
+        fprintf(stderr, "%s: generating\n", prefix);
+
+        std::string path = workdir + "/quine-bench-" + std::to_string(images) + ".qdb";
+        bench_result_t save, load, query_result;
+        save.id = std::string(prefix) + "/save";
+        load.id = std::string(prefix) + "/load";
+        query_result.id = std::string(prefix) + "/query";
+        {
+            cv::Mat desc, filter;
+            QuineStringTable metadata;
+            cv::vector<std::string> hashtable;
+            synthetic_database(images, images / 2, query, desc, filter, metadata, hashtable);
+
+            int64_t start = cv::getTickCount();
+            if(!memory->save_database_to_file(path, desc, filter, metadata, hashtable, false)) {
+                std::cerr << "[Quine: Error]: Could not write database: " << path << std::endl;
+                continue;
+            }
+            save.samples_ms.push_back(elapsed_ms(start));
+            save.figures.push_back(std::make_pair("bytes", (double)file_size(path)));
+        }
+
+        int64_t start = cv::getTickCount();
+        database_op.load_database(path, true);
+        load.samples_ms.push_back(elapsed_ms(start));
+        load.figures.push_back(std::make_pair("resident_bytes", (double)memory->get_resident_bytes()));
+
+        std::string expected = "image-" + std::to_string(images / 2);
+        size_t matched = 0;
+        for(int q = 0; q < QUINE_BENCH_QUERIES; q++) {
+            start = cv::getTickCount();
+            akaze_response_struc signature;
+            feature.resize_to_width(frame, resized_img, RESIZED_IMAGE_WIDTH, &arena);
+            feature.get_gray(resized_img, gray_img, &arena);
+            feature.compute_signature(gray_img, signature, true, &arena);
+
+            std::vector<quine_database_match_t> matches;
+            database_op.match_loaded_databases(signature, QUINE_BENCH_DRATIO, QUINE_BENCH_ACCEPT_RATIO, &arena,
+                                               matches);
+            for(size_t m = 0; m < matches.size(); m++) {
+                matched += matches[m].meta == expected;
+            }
+            signature.desc.release();
+            signature.filter.release();
+            resized_img.release();
+            gray_img.release();
+            arena.reset();
+            query_result.samples_ms.push_back(elapsed_ms(start));
+        }
+
+        quine_database_stats_t stats;
+        database_op.get_database_stats(path, stats);
+        query_result.figures.push_back(std::make_pair("images", (double)images));
+        query_result.figures.push_back(std::make_pair("matched", (double)matched / QUINE_BENCH_QUERIES));
+        query_result.figures.push_back(std::make_pair("peak_query_bytes", (double)stats.peak_query_bytes));
+        query_result.figures.push_back(std::make_pair("arena_bytes", (double)arena.peak()));
+
+        results.push_back(save);
+        results.push_back(load);
+        results.push_back(query_result);
+
+        memory->unload_database(path);
+        unlink(path.c_str());
+    }
+}
+
+
+int main(int argc, const char *argv[])
+{
+    bool micro = true, macro = true;
+    int iterations = QUINE_BENCH_ITERATIONS;
+    double threshold = QUINE_BENCH_THRESHOLD;
+    std::string sizes_list = QUINE_BENCH_SIZES, image_path, workdir = "/tmp", output_path, baseline_path;
+
+    for(int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        bool has_value = i + 1 < argc;
+        if(option == "--micro") {
+            macro = false;
+        }
+        else if(option == "--macro") {
+            micro = false;
+        }
+        else if(option == "--sizes" && has_value) {
+            sizes_list = argv[++i];
+        }
+        else if(option == "--iterations" && has_value) {
+            iterations = std::max(1, atoi(argv[++i]));
+        }
+        else if(option == "--image" && has_value) {
+            image_path = argv[++i];
+        }
+        else if(option == "--workdir" && has_value) {
+            workdir = argv[++i];
+        }
+        else if(option == "--output" && has_value) {
+            output_path = argv[++i];
+        }
+        else if(option == "--compare" && has_value) {
+            baseline_path = argv[++i];
+        }
+        else if(option == "--threshold" && has_value) {
+            threshold = atof(argv[++i]);
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    std::vector<size_t> sizes;
+    std::stringstream list(sizes_list);
+    std::string size;
+    while(std::getline(list, size, ',')) {
+        if(atoll(size.c_str()) > 0) {
+            sizes.push_back((size_t)atoll(size.c_str()));
+        }
+    }
+
+    cv::Mat frame;
+    if(image_path.empty()) {
+        frame = synthetic_frame(QUINE_BENCH_FRAME_WIDTH, QUINE_BENCH_FRAME_HEIGHT, 1);
+    }
+    else {
+        frame = cv::imread(image_path);
+        if(frame.empty()) {
+            std::cerr << "[Quine: Error]: Could not read image: " << image_path << std::endl;
+            return 1;
+        }
+        cv::cvtColor(frame, frame, CV_BGR2BGRA);
+    }
+
+    std::vector<bench_result_t> results;
+    if(micro && !run_micro(frame, iterations, workdir, results)) {
+        return 1;
+    }
+    if(macro) {
+        run_macro(frame, sizes, workdir, results);
+    }
+
+    if(output_path.empty()) {
+        write_results(std::cout, results);
+    }
+    else {
+        std::ofstream out(output_path.c_str());
+        write_results(out, results);
+        if(!out.good()) {
+            std::cerr << "[Quine: Error]: Could not write results: " << output_path << std::endl;
+            return 1;
+        }
+    }
+
+    if(!baseline_path.empty()) {
+        std::map<std::string, double> baseline;
+        if(!read_medians(baseline_path, baseline)) {
+            std::cerr << "[Quine: Error]: Could not read baseline: " << baseline_path << std::endl;
+            return 1;
+        }
+        return compare_results(results, baseline, threshold) > 0 ? 2 : 0;
+    }
+    return 0;
+}
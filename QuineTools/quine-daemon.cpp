@@ -0,0 +1,968 @@
+//
+//  quine-daemon.cpp
+//  QuineTools
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+//  Headless recognition daemon (Linux). Loads databases once and answers
+//  queries over a Unix domain socket, so several services share one warm
+//  process instead of each loading the databases. Queries are either
+//  encoded images, described as QuineCompare describes camera frames, or
+//  descriptors already extracted by the client. Queries arriving together,
+//  from any connections, are matched in one batched pass per database, and
+//  each gets back its best images with their scores.
+//
+//  Protocol (all integers little-endian). A connection carries any number
+//  of requests, one at a time: a request, then its response. Open more
+//  connections to have queries in flight together.
+//
+//    request header (16 bytes)
+//      uint32  magic           "QNRQ" (0x51524E51)
+//      uint8   version         1
+//      uint8   type            1 image, 2 descriptors, 3 ping
+//      uint16  top_k           images wanted, 0 for the daemon's --top
+//      uint32  id              echoed in the response
+//      uint32  length          payload bytes that follow
+//
+//    image payload             the encoded file (JPEG, PNG, ...)
+//    descriptors payload
+//      uint32  rows, uint32 cols (64)
+//      float32 rows * cols     descriptors, row by row
+//      uint8   rows            class (AKAZE class_id) of each row
+//
+//    response header (16 bytes)
+//      uint32  magic           "QNRS" (0x53524E51)
+//      uint8   version         1
+//      uint8   status          0 ok, 1 bad request, 2 undecodable image,
+//                              3 overloaded, 4 shutting down
+//      uint16  count           results that follow
+//      uint32  id
+//      uint32  length          payload bytes that follow
+//
+//    result, best first
+//      uint32  votes           query features matching the image
+//      float32 score           votes / AKAZE_KEYPOINTCOUNT
+//      uint8   accepted        1 if the image passes the accept ratio
+//      uint8   reserved
+//      uint16  database bytes, uint16 metadata bytes, then both strings
+//
+//  A request with a bad header gets a bad request response and its
+//  connection is closed, as the stream can't be followed past it.
+//
+//  Build from the repository root, with OpenCV 2.4 and libAKAZE, by compiling
+//  this file together with Quine/*.cpp and linking opencv, akaze, z and pthread.
+//
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "QuineConstants.h"
+#include "QuineDatabaseOperations.h"
+#include "QuineFeatureDetection.h"
+#include "QuineLatency.h"
+
+
+#define QUINE_DAEMON_REQUEST_MAGIC      0x51524E51u     // "QNRQ"
+#define QUINE_DAEMON_RESPONSE_MAGIC     0x53524E51u     // "QNRS"
+#define QUINE_DAEMON_VERSION            1
+#define QUINE_DAEMON_HEADER_BYTES       16
+
+// Largest payload read: an encoded photograph, or descriptors
+#define QUINE_DAEMON_MAX_PAYLOAD        (16 * 1024 * 1024)
+#define QUINE_DAEMON_MAX_ROWS           4096
+#define QUINE_DAEMON_MAX_TOP_K          100
+
+// Batching: a batch is matched once it holds --max-batch queries, or once
+//   its first query has waited --batch-us
+#define QUINE_DAEMON_BATCH_US           2000
+#define QUINE_DAEMON_MAX_BATCH          32
+
+// Queries waiting for a batch beyond which new ones are turned away
+#define QUINE_DAEMON_MAX_QUEUE          256
+#define QUINE_DAEMON_MAX_CLIENTS        64
+
+// Query defaults, as in QuineCompare
+#define QUINE_DAEMON_DRATIO             0.96f
+#define QUINE_DAEMON_ACCEPT_RATIO       0.10f
+#define QUINE_DAEMON_TOP_K              5
+
+
+typedef enum {
+    QUINE_DAEMON_IMAGE = 1,
+    QUINE_DAEMON_DESCRIPTORS = 2,
+    QUINE_DAEMON_PING = 3
+} quine_daemon_request_type_t;
+
+
+typedef enum {
+    QUINE_DAEMON_OK = 0,
+    QUINE_DAEMON_BAD_REQUEST = 1,
+    QUINE_DAEMON_UNDECODABLE = 2,
+    QUINE_DAEMON_OVERLOADED = 3,
+    QUINE_DAEMON_SHUTTING_DOWN = 4
+} quine_daemon_status_t;
+
+
+typedef struct quine_daemon_header {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;           // request type, or response status
+    uint16_t count;         // top_k of a request, results of a response
+    uint32_t id;
+    uint32_t length;
+} quine_daemon_header_t;
+
+
+static void usage()
+{
+    std::cout <<
+    "usage: quine-daemon <command> [arguments]\n"
+    "\n"
+    "  serve <socket> <database> [<database> ...] [options]\n"
+    "                                Loads the databases and answers queries on the socket\n"
+    "      --batch-us <us>           Longest a query waits for others to batch with (2000)\n"
+    "      --max-batch <n>           Queries matched in one pass at most (32)\n"
+    "      --max-queue <n>           Queries waiting beyond which new ones are refused (256)\n"
+    "      --max-clients <n>         Connections served at once (64)\n"
+    "      --top <k>                 Results of a query that asks for 0 (5)\n"
+    "      --dratio <d>              Feature match threshold (0.96)\n"
+    "      --accept <a>              Image accept ratio (0.10)\n"
+    "      --mode <octal>            Permissions of the socket file, e.g. 0660\n"
+    "  query <socket> <image> [--top <k>]\n"
+    "                                Sends an image to a running daemon, prints its results\n";
+}
+
+
+#pragma mark -
+#pragma mark Wire
+static void put_u16(std::vector<uchar> &out, uint16_t v)
+{
+    out.push_back((uchar)v);
+    out.push_back((uchar)(v >> 8));
+}
+
+
+static void put_u32(std::vector<uchar> &out, uint32_t v)
+{
+    for(int i = 0; i < 4; i++) {
+        out.push_back((uchar)(v >> (8 * i)));
+    }
+}
+
+
+static uint16_t get_u16(const uchar *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+static uint32_t get_u32(const uchar *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static float get_f32(const uchar *p)
+{
+    uint32_t bits = get_u32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+
+static void put_f32(std::vector<uchar> &out, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put_u32(out, bits);
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads exactly length bytes, across signals and short reads.
+ *
+ * @return (bool) false at end of stream or on an error
+ */
+static bool read_full(int fd, void *buffer, size_t length)
+{
+    uchar *p = (uchar *)buffer;
+    while(length > 0) {
+        ssize_t n = recv(fd, p, length, 0);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= n;
+    }
+    return true;
+}
+
+
+static bool write_full(int fd, const void *buffer, size_t length)
+{
+    const uchar *p = (const uchar *)buffer;
+    while(length > 0) {
+        ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= n;
+    }
+    return true;
+}
+
+
+static bool read_header(int fd, quine_daemon_header_t &header)
+{
+    uchar bytes[QUINE_DAEMON_HEADER_BYTES];
+    if(!read_full(fd, bytes, sizeof(bytes))) {
+        return false;
+    }
+    header.magic = get_u32(bytes);
+    header.version = bytes[4];
+    header.type = bytes[5];
+    header.count = get_u16(bytes + 6);
+    header.id = get_u32(bytes + 8);
+    header.length = get_u32(bytes + 12);
+    return true;
+}
+
+
+static void put_header(std::vector<uchar> &out, const quine_daemon_header_t &header)
+{
+    put_u32(out, header.magic);
+    out.push_back(header.version);
+    out.push_back(header.type);
+    put_u16(out, header.count);
+    put_u32(out, header.id);
+    put_u32(out, header.length);
+}
+
+
+static void put_string(std::vector<uchar> &out, const std::string &s)
+{
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Response to a request: its header, then every result.
+ *        Strings are cut to 65535 bytes, the most their length field holds.
+ *
+ * @return (bool) false if the client is gone
+ */
+static bool write_response(int fd, uint32_t id, quine_daemon_status_t status,
+                           const std::vector<quine_ranked_match_t> &results)
+{
+    std::vector<uchar> payload;
+    for(size_t r = 0; r < results.size(); r++) {
+        std::string database = results[r].database.substr(0, 0xFFFF);
+        std::string meta = results[r].meta.substr(0, 0xFFFF);
+        put_u32(payload, (uint32_t)results[r].votes);
+        put_f32(payload, results[r].score);
+        payload.push_back(results[r].accepted ? 1 : 0);
+        payload.push_back(0);
+        put_u16(payload, (uint16_t)database.size());
+        put_u16(payload, (uint16_t)meta.size());
+        put_string(payload, database);
+        put_string(payload, meta);
+    }
+
+    quine_daemon_header_t header;
+    header.magic = QUINE_DAEMON_RESPONSE_MAGIC;
+    header.version = QUINE_DAEMON_VERSION;
+    header.type = (uint8_t)status;
+    header.count = (uint16_t)results.size();
+    header.id = id;
+    header.length = (uint32_t)payload.size();
+
+    std::vector<uchar> message;
+    message.reserve(QUINE_DAEMON_HEADER_BYTES + payload.size());
+    put_header(message, header);
+    message.insert(message.end(), payload.begin(), payload.end());
+    return write_full(fd, message.data(), message.size());
+}
+
+
+#pragma mark -
+#pragma mark Batching
+/* ************************************************************************* */
+/*!
+ * @brief A query waiting for its batch.
+ */
+typedef struct daemon_query {
+    akaze_response_struc signature;
+    size_t top_k;
+    std::promise<std::vector<quine_ranked_match_t> > results;
+} daemon_query_t;
+
+
+/* ************************************************************************* */
+/*!
+ *  @class      DaemonBatcher
+ *
+ *  @abstract   Coalesces the queries of every connection into batches and
+ *              matches each batch in one pass over the loaded databases.
+ *
+ *  @discussion A single thread matches. It waits for a first query, then
+ *              up to the batch window for others; the queries that arrive
+ *              while a batch is matched make up the next one, so batches
+ *              grow with the load and an idle daemon adds no more than the
+ *              window to a query's latency.
+ */
+class DaemonBatcher {
+public:
+
+    DaemonBatcher(float dratio, float accept_ratio, int batch_us, size_t max_batch, size_t max_queue)
+    : m_dratio(dratio), m_accept_ratio(accept_ratio), m_batch_us(batch_us), m_max_batch(max_batch),
+      m_max_queue(max_queue), m_stopping(false), m_batches(0), m_queries(0) {
+        m_thread = std::thread(&DaemonBatcher::run, this);
+    }
+
+    ~DaemonBatcher() {
+        stop();
+    }
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Queues a query for the next batch.
+     *
+     * @return (quine_daemon_status_t) QUINE_DAEMON_OK if queued; results
+     *          then receives its ranking
+     */
+    quine_daemon_status_t submit(std::unique_ptr<daemon_query_t> query,
+                                 std::future<std::vector<quine_ranked_match_t> > &results) {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if(m_stopping) {
+            return QUINE_DAEMON_SHUTTING_DOWN;
+        }
+        if(m_queue.size() >= m_max_queue) {
+            return QUINE_DAEMON_OVERLOADED;
+        }
+
+        results = query->results.get_future();
+        if(m_queue.empty()) {
+            m_first_arrival = std::chrono::steady_clock::now();
+        }
+        m_queue.push_back(std::move(query));
+        m_ready.notify_one();
+        return QUINE_DAEMON_OK;
+    }
+
+
+    /* ************************************************************************* */
+    /*!
+     * @brief Matches the queries already queued, then stops the thread.
+     *
+     * @return (void)
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_stopping = true;
+            m_ready.notify_one();
+        }
+        if(m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    size_t batches() const { return m_batches.load(); }
+    size_t queries() const { return m_queries.load(); }
+
+private:
+
+    void run() {
+        QuineDatabaseOperations database_op;
+        while(true) {
+            std::vector<std::unique_ptr<daemon_query_t> > batch;
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_ready.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+                if(m_queue.empty()) {
+                    return;
+                }
+
+                std::chrono::steady_clock::time_point deadline =
+                    m_first_arrival + std::chrono::microseconds(m_batch_us);
+                m_ready.wait_until(lock, deadline, [this]() {
+                    return m_stopping || m_queue.size() >= m_max_batch;
+                });
+
+                size_t count = std::min(m_queue.size(), m_max_batch);
+                for(size_t i = 0; i < count; i++) {
+                    batch.push_back(std::move(m_queue.front()));
+                    m_queue.pop_front();
+                }
+                // What was left over starts the next window now
+                m_first_arrival = std::chrono::steady_clock::now();
+            }
+
+            match(database_op, batch);
+        }
+    }
+
+
+    void match(QuineDatabaseOperations &database_op, std::vector<std::unique_ptr<daemon_query_t> > &batch) {
+        std::vector<const akaze_response_struc*> signatures;
+        size_t top_k = 0;
+        for(size_t i = 0; i < batch.size(); i++) {
+            signatures.push_back(&batch[i]->signature);
+            top_k = std::max(top_k, batch[i]->top_k);
+        }
+
+        std::vector<std::vector<quine_ranked_match_t> > rankings;
+        database_op.rank_loaded_databases(signatures, m_dratio, m_accept_ratio, top_k, rankings);
+
+        for(size_t i = 0; i < batch.size(); i++) {
+            if(rankings[i].size() > batch[i]->top_k) {
+                rankings[i].resize(batch[i]->top_k);
+            }
+            batch[i]->results.set_value(rankings[i]);
+        }
+        m_batches++;
+        m_queries += batch.size();
+    }
+
+    float m_dratio;
+    float m_accept_ratio;
+    int m_batch_us;
+    size_t m_max_batch;
+    size_t m_max_queue;
+
+    std::mutex m_lock;
+    std::condition_variable m_ready;
+    std::deque<std::unique_ptr<daemon_query_t> > m_queue;
+    std::chrono::steady_clock::time_point m_first_arrival;
+    bool m_stopping;
+
+    std::atomic<size_t> m_batches;
+    std::atomic<size_t> m_queries;
+    std::thread m_thread;
+};
+
+
+#pragma mark -
+#pragma mark Connections
+/* ************************************************************************* */
+/*!
+ * @brief Descriptors payload into a signature. Rows and the query keypoint
+ *        count are the descriptors given, as compute_signature leaves them.
+ *
+ * @return (bool) false if the payload is malformed
+ */
+static bool parse_descriptors(const std::vector<uchar> &payload, akaze_response_struc &signature)
+{
+    if(payload.size() < 8) {
+        return false;
+    }
+    uint32_t rows = get_u32(payload.data());
+    uint32_t cols = get_u32(payload.data() + 4);
+    if(rows == 0 || rows > QUINE_DAEMON_MAX_ROWS || cols != (uint32_t)AKAZEOptions::AKAZE_FEATURECOUNT ||
+       payload.size() != 8 + (size_t)rows * cols * 4 + rows) {
+        return false;
+    }
+
+    signature.desc.create((int)rows, (int)cols, CV_32FC1);
+    signature.filter.create((int)rows, 1, CV_8UC1);
+    const uchar *p = payload.data() + 8;
+    for(uint32_t r = 0; r < rows; r++) {
+        float *row = signature.desc.ptr<float>((int)r);
+        for(uint32_t c = 0; c < cols; c++, p += 4) {
+            row[c] = get_f32(p);
+        }
+    }
+    for(uint32_t r = 0; r < rows; r++) {
+        signature.filter.at<uchar>((int)r) = *p++;
+    }
+    signature.kpts_count = (int)rows;
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Image payload into a signature, described as QuineCompare
+ *        describes a camera frame.
+ *
+ * @return (bool) false if the image can't be decoded
+ */
+static bool describe_image(QuineFeatureDetection &feature, const std::vector<uchar> &payload,
+                           akaze_response_struc &signature)
+{
+    cv::Mat image = cv::imdecode(cv::Mat(1, (int)payload.size(), CV_8UC1, (void *)payload.data()),
+                                 CV_LOAD_IMAGE_COLOR);
+    if(image.empty()) {
+        return false;
+    }
+
+    cv::Mat resized_img, gray_img;
+    QuineLatencyTimer preprocess_timer(QuineLatency::instance()->stage(QUINE_LATENCY_PREPROCESS));
+    feature.resize_to_width(image, resized_img, RESIZED_IMAGE_WIDTH);
+    feature.get_gray(resized_img, gray_img);
+    preprocess_timer.stop();
+
+    feature.compute_signature(gray_img, signature, true);
+    return true;
+}
+
+
+typedef struct daemon_connection {
+    int fd;
+    std::thread thread;
+    std::atomic<bool> done;
+} daemon_connection_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Serves one connection until the client closes it. Images are
+ *        described here, on the connection's thread, so extraction runs
+ *        in parallel across clients; only matching is batched.
+ *
+ * @return (void)
+ */
+static void serve_connection(daemon_connection_t *connection, DaemonBatcher *batcher, size_t default_top_k)
+{
+    QuineFeatureDetection feature;
+    std::vector<uchar> payload;
+    const std::vector<quine_ranked_match_t> none;
+
+    while(true) {
+        quine_daemon_header_t header;
+        if(!read_header(connection->fd, header)) {
+            break;
+        }
+        if(header.magic != QUINE_DAEMON_REQUEST_MAGIC || header.version != QUINE_DAEMON_VERSION ||
+           header.length > QUINE_DAEMON_MAX_PAYLOAD) {
+            write_response(connection->fd, header.id, QUINE_DAEMON_BAD_REQUEST, none);
+            break;
+        }
+
+        payload.resize(header.length);
+        if(header.length > 0 && !read_full(connection->fd, payload.data(), header.length)) {
+            break;
+        }
+
+        if(header.type == QUINE_DAEMON_PING) {
+            if(!write_response(connection->fd, header.id, QUINE_DAEMON_OK, none)) {
+                break;
+            }
+            continue;
+        }
+
+        std::unique_ptr<daemon_query_t> query(new daemon_query_t());
+        query->top_k = std::min((size_t)QUINE_DAEMON_MAX_TOP_K, header.count ? (size_t)header.count : default_top_k);
+
+        quine_daemon_status_t status = QUINE_DAEMON_OK;
+        if(header.type == QUINE_DAEMON_DESCRIPTORS) {
+            if(!parse_descriptors(payload, query->signature)) {
+                status = QUINE_DAEMON_BAD_REQUEST;
+            }
+        }
+        else if(header.type == QUINE_DAEMON_IMAGE) {
+            if(!describe_image(feature, payload, query->signature)) {
+                status = QUINE_DAEMON_UNDECODABLE;
+            }
+        }
+        else {
+            status = QUINE_DAEMON_BAD_REQUEST;
+        }
+
+        std::vector<quine_ranked_match_t> results;
+        if(status == QUINE_DAEMON_OK && query->signature.kpts_count > 0) {
+            std::future<std::vector<quine_ranked_match_t> > pending;
+            status = batcher->submit(std::move(query), pending);
+            if(status == QUINE_DAEMON_OK) {
+                results = pending.get();
+            }
+        }
+
+        if(!write_response(connection->fd, header.id, status, results)) {
+            break;
+        }
+    }
+
+    connection->done = true;
+}
+
+
+#pragma mark -
+#pragma mark Serve
+static int s_signal_pipe[2] = { -1, -1 };
+
+
+static void on_signal(int)
+{
+    char c = 1;
+    ssize_t ignored = write(s_signal_pipe[1], &c, 1);
+    (void)ignored;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Binds the socket, replacing a stale socket file a previous daemon
+ *        left behind, but never one a running daemon listens on.
+ *
+ * @return (int) listening descriptor, -1 on failure
+ */
+static int listen_on(const std::string &path, int mode)
+{
+    struct sockaddr_un address;
+    if(path.size() >= sizeof(address.sun_path)) {
+        std::cout << "[Quine: Error]: Socket path is too long: " << path << std::endl;
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    struct stat st;
+    if(lstat(path.c_str(), &st) == 0) {
+        if(!S_ISSOCK(st.st_mode)) {
+            std::cout << "[Quine: Error]: Not a socket: " << path << std::endl;
+            return -1;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = probe >= 0 && connect(probe, (struct sockaddr *)&address, sizeof(address)) == 0;
+        if(probe >= 0) {
+            close(probe);
+        }
+        if(live) {
+            std::cout << "[Quine: Error]: A daemon already listens on " << path << std::endl;
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        std::cout << "[Quine: Error]: Could not create socket: " << strerror(errno) << std::endl;
+        return -1;
+    }
+    if(bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        std::cout << "[Quine: Error]: Could not listen on " << path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    if(mode >= 0 && chmod(path.c_str(), (mode_t)mode) != 0) {
+        std::cout << "[Quine: Warning]: Could not set the socket's permissions: " << strerror(errno) << std::endl;
+    }
+    return fd;
+}
+
+
+static void reap_connections(std::list<std::unique_ptr<daemon_connection_t> > &connections, bool all)
+{
+    for(std::list<std::unique_ptr<daemon_connection_t> >::iterator it = connections.begin(); it != connections.end(); ) {
+        if(all) {
+            shutdown((*it)->fd, SHUT_RDWR);
+        }
+        if(all || (*it)->done) {
+            (*it)->thread.join();
+            close((*it)->fd);
+            it = connections.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+
+static int serve(int argc, const char *argv[])
+{
+    if(argc < 4) {
+        usage();
+        return 1;
+    }
+
+    std::string socket_path = argv[2];
+    std::vector<std::string> databases;
+    int batch_us = QUINE_DAEMON_BATCH_US;
+    size_t max_batch = QUINE_DAEMON_MAX_BATCH, max_queue = QUINE_DAEMON_MAX_QUEUE;
+    size_t max_clients = QUINE_DAEMON_MAX_CLIENTS, top_k = QUINE_DAEMON_TOP_K;
+    float dratio = QUINE_DAEMON_DRATIO, accept_ratio = QUINE_DAEMON_ACCEPT_RATIO;
+    int mode = -1;
+
+    for(int i = 3; i < argc; i++) {
+        std::string option = argv[i];
+        bool has_value = i + 1 < argc;
+        if(option == "--batch-us" && has_value) {
+            batch_us = std::max(0, atoi(argv[++i]));
+        }
+        else if(option == "--max-batch" && has_value) {
+            max_batch = (size_t)std::max(1, atoi(argv[++i]));
+        }
+        else if(option == "--max-queue" && has_value) {
+            max_queue = (size_t)std::max(1, atoi(argv[++i]));
+        }
+        else if(option == "--max-clients" && has_value) {
+            max_clients = (size_t)std::max(1, atoi(argv[++i]));
+        }
+        else if(option == "--top" && has_value) {
+            top_k = (size_t)std::max(1, std::min(QUINE_DAEMON_MAX_TOP_K, atoi(argv[++i])));
+        }
+        else if(option == "--dratio" && has_value) {
+            dratio = (float)atof(argv[++i]);
+        }
+        else if(option == "--accept" && has_value) {
+            accept_ratio = (float)atof(argv[++i]);
+        }
+        else if(option == "--mode" && has_value) {
+            mode = (int)strtol(argv[++i], NULL, 8);
+        }
+        else if(option[0] != '-') {
+            databases.push_back(option);
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if(databases.empty()) {
+        usage();
+        return 1;
+    }
+
+
+    //////////////////////////////////////////////////////////
+    // Load every database before taking queries
+
+    QuineDatabaseOperations database_op;
+    for(size_t d = 0; d < databases.size(); d++) {
+        int64_t start = cv::getTickCount();
+        database_op.load_database(databases[d], true);
+
+        QuineDatabaseHandle handle = database_op.open_database(databases[d]);
+        if(!handle.valid() || handle.metadata().empty()) {
+            std::cout << "[Quine: Error]: Could not load database, or it has no images: " << databases[d] << std::endl;
+            return 1;
+        }
+        std::cout << "[Quine: Daemon]: Loaded " << databases[d] << " (" << handle.metadata().size() << " images) in "
+                  << 1000.0 * (cv::getTickCount() - start) / cv::getTickFrequency() << " ms" << std::endl;
+    }
+
+    if(pipe(s_signal_pipe) != 0) {
+        std::cout << "[Quine: Error]: Could not create the signal pipe" << std::endl;
+        return 1;
+    }
+    fcntl(s_signal_pipe[1], F_SETFL, O_NONBLOCK);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = listen_on(socket_path, mode);
+    if(listen_fd < 0) {
+        return 1;
+    }
+    std::cout << "[Quine: Daemon]: Listening on " << socket_path << std::endl;
+
+
+    //////////////////////////////////////////////////////////
+    // Accept until SIGINT or SIGTERM
+
+    DaemonBatcher batcher(dratio, accept_ratio, batch_us, max_batch, max_queue);
+    std::list<std::unique_ptr<daemon_connection_t> > connections;
+
+    while(true) {
+        struct pollfd fds[2];
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = s_signal_pipe[0];
+        fds[1].events = POLLIN;
+        if(poll(fds, 2, 1000) < 0 && errno != EINTR) {
+            std::cout << "[Quine: Error]: poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if(fds[1].revents & POLLIN) {
+            break;
+        }
+
+        reap_connections(connections, false);
+        if(!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        int fd = accept(listen_fd, NULL, NULL);
+        if(fd < 0) {
+            continue;
+        }
+        if(connections.size() >= max_clients) {
+            write_response(fd, 0, QUINE_DAEMON_OVERLOADED, std::vector<quine_ranked_match_t>());
+            close(fd);
+            continue;
+        }
+
+        std::unique_ptr<daemon_connection_t> connection(new daemon_connection_t());
+        connection->fd = fd;
+        connection->done = false;
+        connection->thread = std::thread(serve_connection, connection.get(), &batcher, top_k);
+        connections.push_back(std::move(connection));
+    }
+
+    std::cout << "[Quine: Daemon]: Shutting down" << std::endl;
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    reap_connections(connections, true);
+    batcher.stop();
+
+    size_t batches = batcher.batches(), queries = batcher.queries();
+    std::cout << "[Quine: Daemon]: " << queries << " queries in " << batches << " batches ("
+              << (batches ? (double)queries / batches : 0.0) << " per batch)" << std::endl;
+    return 0;
+}
+
+
+#pragma mark -
+#pragma mark Query
+/* ************************************************************************* */
+/*!
+ * @brief Client of a running daemon: sends one image, prints its results.
+ *
+ * @return (int)
+ */
+static int query(int argc, const char *argv[])
+{
+    if(argc < 4) {
+        usage();
+        return 1;
+    }
+    std::string socket_path = argv[2], image_path = argv[3];
+    int top_k = 0;
+    if(argc >= 6 && std::string(argv[4]) == "--top") {
+        top_k = std::max(0, std::min(QUINE_DAEMON_MAX_TOP_K, atoi(argv[5])));
+    }
+
+    std::ifstream in(image_path.c_str(), std::ios::binary);
+    std::vector<uchar> image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if(image.empty() || image.size() > QUINE_DAEMON_MAX_PAYLOAD) {
+        std::cout << "[Quine: Error]: Could not read image: " << image_path << std::endl;
+        return 1;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        std::cout << "[Quine: Error]: Could not connect to " << socket_path << ": " << strerror(errno) << std::endl;
+        if(fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+
+    quine_daemon_header_t header;
+    header.magic = QUINE_DAEMON_REQUEST_MAGIC;
+    header.version = QUINE_DAEMON_VERSION;
+    header.type = QUINE_DAEMON_IMAGE;
+    header.count = (uint16_t)top_k;
+    header.id = 1;
+    header.length = (uint32_t)image.size();
+    std::vector<uchar> request;
+    put_header(request, header);
+    request.insert(request.end(), image.begin(), image.end());
+
+    quine_daemon_header_t response;
+    std::vector<uchar> payload;
+    bool ok = write_full(fd, request.data(), request.size()) && read_header(fd, response) &&
+              response.magic == QUINE_DAEMON_RESPONSE_MAGIC && response.length <= QUINE_DAEMON_MAX_PAYLOAD;
+    if(ok) {
+        payload.resize(response.length);
+        ok = response.length == 0 || read_full(fd, payload.data(), response.length);
+    }
+    close(fd);
+    if(!ok) {
+        std::cout << "[Quine: Error]: No response from " << socket_path << std::endl;
+        return 1;
+    }
+    if(response.type != QUINE_DAEMON_OK) {
+        std::cout << "[Quine: Error]: Daemon answered status " << (int)response.type << std::endl;
+        return 1;
+    }
+
+    size_t offset = 0;
+    for(int r = 0; r < response.count && offset + 14 <= payload.size(); r++) {
+        const uchar *p = payload.data() + offset;
+        uint32_t votes = get_u32(p);
+        float score = get_f32(p + 4);
+        bool accepted = p[8] != 0;
+        size_t database_bytes = get_u16(p + 10), meta_bytes = get_u16(p + 12);
+        offset += 14;
+        if(offset + database_bytes + meta_bytes > payload.size()) {
+            break;
+        }
+        std::string database((const char *)payload.data() + offset, database_bytes);
+        std::string meta((const char *)payload.data() + offset + database_bytes, meta_bytes);
+        offset += database_bytes + meta_bytes;
+
+        printf("%d\t%s\t%s\t%u\t%.4f%s\n", r + 1, database.c_str(), meta.c_str(), votes, score,
+               accepted ? "\taccepted" : "");
+    }
+    return 0;
+}
+
+
+int main(int argc, const char *argv[])
+{
+    if(argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    if(command == "serve") {
+        return serve(argc, argv);
+    }
+    if(command == "query") {
+        return query(argc, argv);
+    }
+    usage();
+    return 1;
+}
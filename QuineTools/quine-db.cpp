@@ -0,0 +1,935 @@
+//
+//  quine-db.cpp
+//  QuineTools
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+//  Offline database tool. Builds databases from directories of images,
+//  converts between database formats, folds write-ahead logs, prints
+//  statistics, benchmarks queries, makes and applies sync deltas and
+//  generates synthetic databases and query sets for scaling tests, all
+//  without the iOS front end.
+//
+//  Build from the repository root, with OpenCV 2.4 and libAKAZE, by compiling
+//  this file together with Quine/*.cpp and linking opencv, akaze, z and pthread.
+//
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "QuineConstants.h"
+#include "QuineFeatureDetection.h"
+#include "QuineMemoryDatabase.h"
+#include "QuineMappedDatabase.h"
+#include "QuineFrameArena.h"
+#include "QuineMatcher.h"
+#include "QuineMemoryStats.h"
+#include "QuineSyntheticDatabase.h"
+
+
+// Images described in parallel before they are appended
+#define QUINE_DB_BUILD_BATCH    256
+
+// Query defaults, as in QuineCompare
+#define QUINE_DB_DRATIO         0.96f
+#define QUINE_DB_ACCEPT_RATIO   0.10f
+
+// Queries of a generated query set: share of the image's keypoints found
+//   again, and descriptor noise in per-dimension deviations
+#define QUINE_DB_QUERY_KEEP     0.6f
+#define QUINE_DB_QUERY_NOISE    0.15f
+
+
+static void usage()
+{
+    std::cout <<
+    "usage: quine-db <command> [arguments]\n"
+    "\n"
+    "  build   <database> <image directory>   Adds every image of the directory\n"
+    "  convert <source> <destination>         Rewrites a database in the format of\n"
+    "                                         the destination's extension (.qdb, .qdbz, .bin, .yaml)\n"
+    "  compact <database>                     Folds the write-ahead log into the database\n"
+    "  inspect <database>                     Prints database statistics\n"
+    "  bench   <database> <image> [queries]   Measures load and query latency\n"
+    "  throughput <database> <image> [secs]   Measures queries/s from 1 to 32 threads\n"
+    "  delta   <base> <target> <delta>        Writes the sync delta from base to target\n"
+    "  apply   <database> <delta>             Applies a sync delta to a database\n"
+    "  generate <database> <images> [options] Writes a synthetic database, sharded past\n"
+    "                                         4096 images, in the extension's format\n"
+    "      --model <database>                 Fits descriptor statistics to a real database\n"
+    "      --queries <path> <count>           Also writes a query set: queries of random images,\n"
+    "                                         the expected image's name as metadata\n"
+    "      --distractors <count>              Adds queries of images not in the database,\n"
+    "                                         with empty metadata\n"
+    "      --keep <share>                     Share of an image's keypoints a query finds (0.6)\n"
+    "      --noise <deviations>               Noise of a query's descriptors (0.15)\n"
+    "      --seed <n>                         Same seed, same database (default 1)\n";
+}
+
+
+static double elapsed_ms(int64_t start)
+{
+    return 1000.0 * (cv::getTickCount() - start) / cv::getTickFrequency();
+}
+
+
+static size_t file_size(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Content hash of an image file: 64-bit FNV-1a of its bytes, in hex.
+ *        Re-running a build over the same directory skips every image.
+ *
+ * @return (bool)
+ */
+static bool file_hash(const std::string &path, std::string &hash)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if(!in.good()) {
+        return false;
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    char buffer[65536];
+    while(in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+        for(std::streamsize i = 0; i < in.gcount(); i++) {
+            h ^= (unsigned char)buffer[i];
+            h *= 1099511628211ULL;
+        }
+    }
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+    hash = hex;
+    return true;
+}
+
+
+static bool is_image_file(const std::string &name)
+{
+    size_t dot = name.find_last_of('.');
+    if(dot == std::string::npos) {
+        return false;
+    }
+    std::string ext = name.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp" || ext == "tif" || ext == "tiff";
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Describes an image exactly as QuineDatabaseOperations::add_image does.
+ *
+ * @return (bool) false if the image can't be read
+ */
+static bool describe_image(const std::string &path, bool is_query, akaze_response_struc &result)
+{
+    cv::Mat img = cv::imread(path);
+    if(img.empty()) {
+        return false;
+    }
+
+    QuineFeatureDetection image = QuineFeatureDetection();
+    cv::Mat resized_img, gray_img;
+    image.resize_to_width(img, resized_img, RESIZED_IMAGE_WIDTH);
+    image.get_gray(resized_img, gray_img);
+    image.compute_signature(gray_img, result, is_query);
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief cv::parallel_for_ body that describes a range of images
+ */
+class DescribeBody : public cv::ParallelLoopBody {
+public:
+    DescribeBody(const std::vector<std::string> &paths,
+                 std::vector<akaze_response_struc> &results,
+                 std::vector<char> &ok)
+    : m_paths(paths), m_results(results), m_ok(ok) { }
+
+    void operator()(const cv::Range &range) const {
+        for(int i = range.start; i < range.end; i++) {
+            m_ok[i] = describe_image(m_paths[i], false, m_results[i]);
+        }
+    }
+
+private:
+    const std::vector<std::string> &m_paths;
+    std::vector<akaze_response_struc> &m_results;
+    std::vector<char> &m_ok;
+};
+
+
+#pragma mark -
+#pragma mark Commands
+/* ************************************************************************* */
+/*!
+ * @brief Adds every image of a directory to a database. Images are
+ *        described in parallel, a batch at a time, and appended to the
+ *        database's log; the log is folded into the database at the end.
+ *        The file name (without directory) is the image's metadata.
+ *
+ * @return (int) exit status
+ */
+static int build_database(const std::string &db, const std::string &directory)
+{
+    DIR *dir = opendir(directory.c_str());
+    if(!dir) {
+        std::cout << "[Quine: Error]: Could not open directory: " << directory << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL) {
+        if(is_image_file(entry->d_name)) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    QuineMemory *memory = QuineMemory::database();
+    size_t added = 0, duplicates = 0, unreadable = 0;
+    int64_t start = cv::getTickCount();
+
+    for(size_t first = 0; first < names.size(); first += QUINE_DB_BUILD_BATCH) {
+        size_t last = std::min(first + QUINE_DB_BUILD_BATCH, names.size());
+
+        // Skip images already in the database before describing anything
+        std::vector<std::string> paths, metas, hashes;
+        for(size_t i = first; i < last; i++) {
+            std::string path = directory + "/" + names[i];
+            std::string hash;
+            if(!file_hash(path, hash)) {
+                unreadable++;
+                continue;
+            }
+            if(memory->contains_image(db, hash) || std::find(hashes.begin(), hashes.end(), hash) != hashes.end()) {
+                duplicates++;
+                continue;
+            }
+            paths.push_back(path);
+            metas.push_back(names[i]);
+            hashes.push_back(hash);
+        }
+
+        std::vector<akaze_response_struc> results(paths.size());
+        std::vector<char> ok(paths.size(), 0);
+        cv::parallel_for_(cv::Range(0, (int)paths.size()), DescribeBody(paths, results, ok));
+
+        for(size_t i = 0; i < paths.size(); i++) {
+            if(!ok[i]) {
+                std::cout << "[Quine: Warning]: Could not read image: " << paths[i] << std::endl;
+                unreadable++;
+                continue;
+            }
+            if(memory->append_image(db, results[i].desc, results[i].filter, metas[i], hashes[i])) {
+                added++;
+            }
+        }
+    }
+
+    // Fold the log, so the database file holds everything
+    std::shared_ptr<QuineDescriptorStore> store;
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    memory->get_database(db, store, metadata, hashtable, false);
+    if(store) {
+        memory->update_database(db, store, metadata, hashtable, true);
+    }
+
+    printf("%zu added, %zu already in the database, %zu unreadable in %.1f s\n",
+           added, duplicates, unreadable, elapsed_ms(start) / 1000.0);
+    return 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Rewrites a database (with its log applied and dead images left
+ *        out) in the format given by the destination's extension.
+ *
+ * @return (int) exit status
+ */
+static int convert_database(const std::string &source_path, const std::string &destination_path)
+{
+    QuineMemory *memory = QuineMemory::database();
+
+    std::shared_ptr<QuineDescriptorStore> store;
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    memory->get_database(source_path, store, metadata, hashtable, true);
+    if(!store || store->empty()) {
+        std::cout << "[Quine: Error]: Could not open database: " << source_path << std::endl;
+        return 1;
+    }
+
+    std::vector<bool> tombstones = memory->get_tombstones(source_path);
+    std::vector<quine_store_chunk_t> chunks;
+    store->snapshot(chunks);
+
+    cv::Mat source, filter;
+    QuineDescriptorStore::gather(chunks, source, filter, &tombstones, AKAZEOptions::AKAZE_KEYPOINTCOUNT);
+
+    QuineStringTable live_metadata;
+    cv::vector<std::string> live_hashtable;
+    for(size_t i = 0; i < metadata.size(); i++) {
+        if(i < tombstones.size() && tombstones[i]) {
+            continue;
+        }
+        live_metadata.push_back(metadata[i]);
+        live_hashtable.push_back(i < hashtable.size() ? hashtable[i] : "");
+    }
+
+    std::string file_ext = destination_path.substr(destination_path.find_last_of('.') + 1);
+    if(!memory->save_database_to_file(destination_path, source, filter, live_metadata, live_hashtable, file_ext == "bin")) {
+        std::cout << "[Quine: Error]: Could not write database: " << destination_path << std::endl;
+        return 1;
+    }
+
+    printf("%zu images: %zu -> %zu bytes\n", live_metadata.size(), file_size(source_path), file_size(destination_path));
+    return 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Folds the write-ahead log of a database into its file.
+ *
+ * @return (int) exit status
+ */
+static int compact_database(const std::string &db)
+{
+    QuineMemory *memory = QuineMemory::database();
+
+    std::shared_ptr<QuineDescriptorStore> store;
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    memory->get_database(db, store, metadata, hashtable, true);
+    if(!store || store->empty()) {
+        std::cout << "[Quine: Error]: Could not open database: " << db << std::endl;
+        return 1;
+    }
+
+    memory->update_database(db, store, metadata, hashtable, true);
+    return 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Prints image counts, keypoints per image, the keypoint class
+ *        histogram and the bytes taken by each part of a database.
+ *
+ * @return (int) exit status
+ */
+static int inspect_database(const std::string &db)
+{
+    QuineMemory *memory = QuineMemory::database();
+
+    int64_t start = cv::getTickCount();
+    std::shared_ptr<QuineDescriptorStore> store;
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    memory->get_database(db, store, metadata, hashtable, true);
+    double load_ms = elapsed_ms(start);
+    if(!store || store->empty()) {
+        std::cout << "[Quine: Error]: Could not open database: " << db << std::endl;
+        return 1;
+    }
+
+    std::vector<bool> tombstones = memory->get_tombstones(db);
+    size_t dead = std::count(tombstones.begin(), tombstones.end(), true);
+
+    std::vector<quine_store_chunk_t> chunks;
+    store->snapshot(chunks);
+
+
+    //////////////////////////////////////////////////////////
+    // Keypoints per image (rows that aren't zero padding) and
+    //   the keypoint class histogram, over live images only
+
+    const size_t rows_per_image = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    std::vector<size_t> keypoints(metadata.size(), 0);
+    std::map<int, size_t> classes;
+
+    for(size_t c = 0; c < chunks.size(); c++) {
+        const quine_store_chunk_t &chunk = chunks[c];
+        for(int r = 0; r < chunk.desc.rows; r++) {
+            size_t image = (chunk.first_row + r) / rows_per_image;
+            if(image >= keypoints.size() || (image < tombstones.size() && tombstones[image])) {
+                continue;
+            }
+            if(cv::countNonZero(chunk.desc.row(r)) > 0) {
+                keypoints[image]++;
+                classes[chunk.filter.at<uchar>(r)]++;
+            }
+        }
+    }
+
+    size_t kp_min = rows_per_image, kp_max = 0, kp_total = 0, live = 0;
+    for(size_t i = 0; i < keypoints.size(); i++) {
+        if(i < tombstones.size() && tombstones[i]) {
+            continue;
+        }
+        kp_min = std::min(kp_min, keypoints[i]);
+        kp_max = std::max(kp_max, keypoints[i]);
+        kp_total += keypoints[i];
+        live++;
+    }
+
+    printf("database:        %s\n", db.c_str());
+    printf("version:         %llu\n", (unsigned long long)memory->get_database_version(db));
+    printf("images:          %zu live, %zu deleted (not yet compacted)\n", live, dead);
+    printf("keypoints/image: min %zu, mean %.1f, max %zu (of %zu)\n",
+           live ? kp_min : 0, live ? (double)kp_total / live : 0.0, kp_max, rows_per_image);
+    printf("descriptors:     %zu rows x %d cols in %zu chunk(s)\n", store->rows(), store->cols(), chunks.size());
+    printf("load time:       %.1f ms\n", load_ms);
+
+    printf("class histogram:\n");
+    for(std::map<int, size_t>::iterator it = classes.begin(); it != classes.end(); ++it) {
+        printf("  %3d: %zu (%.1f%%)\n", it->first, it->second, kp_total ? 100.0 * it->second / kp_total : 0.0);
+    }
+
+
+    //////////////////////////////////////////////////////////
+    // Bytes per section. Raw databases report their sections as
+    //   stored; other formats report the in-memory equivalents.
+
+    printf("bytes:\n");
+    quine_manifest_t manifest;
+    std::vector<std::string> files;
+    if(read_manifest(db, manifest)) {
+        files.push_back(manifest_path(db));
+        for(size_t i = 0; i < manifest.shards.size(); i++) {
+            files.push_back(shard_path(db, manifest.shards[i].id));
+        }
+    }
+    else {
+        files.push_back(db);
+    }
+
+    size_t on_disk = 0;
+    for(size_t i = 0; i < files.size(); i++) {
+        on_disk += file_size(files[i]);
+    }
+
+    if(files.size() == 1 && is_mapped_database(db)) {
+        QuineMappedFile file;
+        if(file.open(db)) {
+            const quine_db_header_t *header = (const quine_db_header_t *)file.data();
+            const char *names[] = { "", "descriptors", "filter", "metadata", "hashes" };
+            for(uint32_t i = 0; i < header->section_count && i < QUINE_DB_MAX_SECTIONS; i++) {
+                uint32_t id = header->sections[i].id;
+                printf("  %-14s %llu\n", id <= QUINE_DB_SECTION_HASH ? names[id] : "unknown",
+                       (unsigned long long)header->sections[i].bytes);
+            }
+        }
+    }
+    else {
+        size_t hash_bytes = 0;
+        for(size_t i = 0; i < hashtable.size(); i++) {
+            hash_bytes += hashtable[i].size();
+        }
+        printf("  %-14s %zu\n", "descriptors", store->rows() * store->cols() * sizeof(float));
+        printf("  %-14s %zu\n", "filter", store->rows());
+        printf("  %-14s %zu\n", "metadata", metadata.bytes());
+        printf("  %-14s %zu\n", "hashes", hash_bytes);
+    }
+    printf("  %-14s %zu in %zu file(s)\n", "on disk", on_disk, files.size());
+
+    quine_database_stats_t stats;
+    if(memory->get_database_stats(db, stats)) {
+        printf("in memory:\n");
+        printf("  %-14s %zu\n", "descriptors", stats.footprint.descriptors);
+        printf("  %-14s %zu\n", "filter", stats.footprint.filter);
+        printf("  %-14s %zu\n", "metadata", stats.footprint.metadata);
+        printf("  %-14s %zu\n", "hashes", stats.footprint.hashes);
+        printf("  %-14s %zu\n", "indexes", stats.footprint.indexes);
+        printf("  %-14s %zu\n", "tombstones", stats.footprint.tombstones);
+        printf("  %-14s %zu\n", "snapshot", stats.footprint.snapshot);
+        printf("  %-14s %zu\n", "total", stats.footprint.total);
+    }
+
+    return 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Loads a database cold, then times repeated queries of one image
+ *        against it through the same matcher as QuineCompare.
+ *
+ * @return (int) exit status
+ */
+static int bench_database(const std::string &db, const std::string &image_path, int queries)
+{
+    akaze_response_struc query;
+    int64_t start = cv::getTickCount();
+    if(!describe_image(image_path, true, query)) {
+        std::cout << "[Quine: Error]: Could not read image: " << image_path << std::endl;
+        return 1;
+    }
+    double describe_ms = elapsed_ms(start);
+
+    QuineMemory *memory = QuineMemory::database();
+    start = cv::getTickCount();
+    std::shared_ptr<QuineDescriptorStore> store;
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    memory->get_database(db, store, metadata, hashtable, true);
+    double load_ms = elapsed_ms(start);
+    if(!store || store->empty()) {
+        std::cout << "[Quine: Error]: Could not open database: " << db << std::endl;
+        return 1;
+    }
+
+    std::vector<quine_store_chunk_t> chunks;
+    store->snapshot(chunks);
+    std::vector<bool> tombstones = memory->get_tombstones(db);
+
+    quine_allocator_stats_t heap_before, heap_after;
+    bool heap = read_allocator_stats(heap_before);
+
+    // Queries allocate from a frame arena, as QuineCompare's do
+    QuineFrameArena arena;
+    std::vector<double> times;
+    int slot = -1;
+    size_t transient = 0;
+    for(int i = 0; i < queries; i++) {
+        std::set<int> results;
+        quine_match_stats_t match_stats;
+        start = cv::getTickCount();
+        slot = compare_mat_souces(query.desc, query.kpts_count, chunks, query.filter, metadata, tombstones,
+                                  results, QUINE_DB_DRATIO, QUINE_DB_ACCEPT_RATIO, &match_stats, &arena);
+        arena.reset();
+        times.push_back(elapsed_ms(start));
+        transient = std::max(transient, match_stats.peak_transient_bytes);
+    }
+    heap = heap && read_allocator_stats(heap_after);
+    std::sort(times.begin(), times.end());
+
+    double total = 0.0;
+    for(size_t i = 0; i < times.size(); i++) {
+        total += times[i];
+    }
+
+    printf("images:    %zu\n", metadata.size());
+    printf("load:      %.1f ms\n", load_ms);
+    printf("describe:  %.1f ms (%d keypoints)\n", describe_ms, query.kpts_count);
+    if(!times.empty()) {
+        printf("query:     min %.2f, median %.2f, p95 %.2f, mean %.2f ms over %d queries\n",
+               times.front(), times[times.size() / 2], times[std::min(times.size() - 1, times.size() * 95 / 100)],
+               total / times.size(), queries);
+    }
+    printf("match:     %s\n", slot >= 0 ? metadata[slot].c_str() : "(none)");
+    printf("memory:    %zu resident, %zu transient per query at most\n", memory->get_resident_bytes(), transient);
+    printf("arena:     %zu bytes at most per query, %zu reserved\n", arena.peak(), arena.capacity());
+    if(heap) {
+        printf("heap:      %zu in use (%+lld over the queries), %zu reserved\n", heap_after.in_use,
+               (long long)heap_after.in_use - (long long)heap_before.in_use, heap_after.reserved);
+    }
+    return 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes the delta that brings base to target, as the server does
+ *        for each database version it keeps. The delta is keyed by the
+ *        version of base; it results in the version of target, or in the
+ *        next version if target has none (or an older one).
+ *
+ * @return (int) exit status
+ */
+static int make_delta(const std::string &base_path, const std::string &target_path, const std::string &delta_path)
+{
+    QuineMemory *memory = QuineMemory::database();
+
+    std::shared_ptr<QuineDescriptorStore> base_store, store;
+    QuineStringTable base_meta, metadata;
+    cv::vector<std::string> base_hashtable, hashtable;
+    memory->get_database(base_path, base_store, base_meta, base_hashtable, true);
+    memory->get_database(target_path, store, metadata, hashtable, true);
+    if(!store || store->empty()) {
+        std::cout << "[Quine: Error]: Could not open database: " << target_path << std::endl;
+        return 1;
+    }
+
+    std::vector<quine_store_chunk_t> chunks;
+    store->snapshot(chunks);
+    cv::Mat desc, filter;
+    QuineDescriptorStore::gather(chunks, desc, filter);
+
+    quine_delta_t delta;
+    delta.base_version = memory->get_database_version(base_path);
+    delta.version = std::max(memory->get_database_version(target_path), delta.base_version + 1);
+    diff_databases(base_meta, base_hashtable, memory->get_tombstones(base_path),
+                   desc, filter, metadata, hashtable, memory->get_tombstones(target_path),
+                   AKAZEOptions::AKAZE_KEYPOINTCOUNT, delta);
+
+    if(!write_delta(delta_path, delta)) {
+        std::cout << "[Quine: Error]: Could not write delta: " << delta_path << std::endl;
+        return 1;
+    }
+
+    size_t deleted = 0;
+    for(size_t i = 0; i < delta.entries.size(); i++) {
+        deleted += delta.entries[i].type == QUINE_LOG_DELETE_IMAGE;
+    }
+    printf("version %llu -> %llu: %zu added or changed, %zu deleted, %zu bytes (target is %zu bytes)\n",
+           (unsigned long long)delta.base_version, (unsigned long long)delta.version,
+           delta.entries.size() - deleted, deleted, file_size(delta_path), file_size(target_path));
+    return 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Applies a sync delta to a database, as a device does.
+ *
+ * @return (int) exit status
+ */
+static int apply_delta(const std::string &db, const std::string &delta_path)
+{
+    QuineMemory *memory = QuineMemory::database();
+
+    int64_t start = cv::getTickCount();
+    if(!memory->apply_database_delta(db, delta_path)) {
+        return 1;
+    }
+
+    printf("%s is at version %llu (%.1f ms)\n", db.c_str(),
+           (unsigned long long)memory->get_database_version(db), elapsed_ms(start));
+    return 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Query threads for the throughput benchmark. Each opens a handle
+ *        on the database for every query, as QuineCompare does.
+ */
+static void throughput_worker(const std::string &db,
+                              const akaze_response_struc &query,
+                              int64_t deadline,
+                              std::atomic<uint64_t> &queries)
+{
+    QuineMemory *memory = QuineMemory::database();
+    uint64_t count = 0;
+    while(cv::getTickCount() < deadline) {
+        QuineDatabaseHandle handle = memory->open_database(db);
+        std::set<int> results;
+        compare_mat_souces(query.desc, query.kpts_count, handle.chunks(), query.filter, handle.metadata(),
+                           handle.tombstones(), results, QUINE_DB_DRATIO, QUINE_DB_ACCEPT_RATIO);
+        count++;
+    }
+    queries += count;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Measures query throughput against one database from 1 to 32
+ *        concurrent query threads. Each query runs on its own thread
+ *        (OpenCV's pool is limited to one thread meanwhile), so the scaling
+ *        is that of the shared read path.
+ *
+ * @return (int) exit status
+ */
+static int throughput_database(const std::string &db, const std::string &image_path, double seconds)
+{
+    akaze_response_struc query;
+    if(!describe_image(image_path, true, query)) {
+        std::cout << "[Quine: Error]: Could not read image: " << image_path << std::endl;
+        return 1;
+    }
+
+    QuineMemory *memory = QuineMemory::database();
+    if(!memory->pin_database(db)) {
+        std::cout << "[Quine: Error]: Could not open database: " << db << std::endl;
+        return 1;
+    }
+
+    int pool_threads = cv::getNumThreads();
+    cv::setNumThreads(1);
+
+    printf("threads   queries/s   ms/query   speedup\n");
+    double single = 0.0;
+    for(int threads = 1; threads <= 32; threads *= 2) {
+        std::atomic<uint64_t> queries(0);
+        int64_t start = cv::getTickCount();
+        int64_t deadline = start + (int64_t)(seconds * cv::getTickFrequency());
+
+        std::vector<std::thread> workers;
+        for(int t = 0; t < threads; t++) {
+            workers.push_back(std::thread(throughput_worker, db, std::cref(query), deadline, std::ref(queries)));
+        }
+        for(size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+
+        double elapsed = elapsed_ms(start) / 1000.0;
+        double rate = queries / elapsed;
+        if(threads == 1) {
+            single = rate;
+        }
+        printf("%7d   %9.1f   %8.2f   %7.2f\n", threads, rate,
+               queries ? 1000.0 * elapsed * threads / queries : 0.0, single > 0.0 ? rate / single : 0.0);
+    }
+
+    cv::setNumThreads(pool_threads);
+    return 0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes images [first, end) of a synthetic database to one file.
+ *
+ * @return (bool)
+ */
+static bool write_synthetic(const QuineSyntheticDatabase &generator,
+                            const std::string &path,
+                            size_t first,
+                            size_t end)
+{
+    cv::Mat desc, filter;
+    generator.generate(first, end - first, desc, filter);
+
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    for(size_t i = first; i < end; i++) {
+        metadata.push_back(QuineSyntheticDatabase::image_name(i));
+        hashtable.push_back("");
+    }
+
+    std::string file_ext = path.substr(path.find_last_of('.') + 1);
+    if(!QuineMemory::database()->save_database_to_file(path, desc, filter, metadata, hashtable, file_ext == "bin")) {
+        std::cout << "[Quine: Error]: Could not write database: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes a query set in the database schema: one image per query,
+ *        padded to AKAZE_KEYPOINTCOUNT rows, whose metadata is the name of
+ *        the image it should match, or empty for a distractor (a query of
+ *        an image past the end of the database).
+ *
+ * @return (bool)
+ */
+static bool write_queries(const QuineSyntheticDatabase &generator,
+                          const std::string &path,
+                          size_t images,
+                          size_t count,
+                          size_t distractors,
+                          float keep,
+                          float noise,
+                          uint64_t seed)
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    size_t total = count + distractors;
+    cv::Mat desc = cv::Mat::zeros((int)(total * K), generator.model().columns, CV_32FC1);
+    cv::Mat filter((int)(total * K), 1, CV_8UC1, cv::Scalar(QUINE_SYNTHETIC_NO_CLASS));
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+
+    cv::RNG rng(seed);
+    for(size_t q = 0; q < total; q++) {
+        bool distractor = q >= count;
+        size_t image = distractor ? images + (q - count) : (size_t)rng.uniform(0.0, (double)images);
+
+        cv::Mat query_desc, query_filter;
+        generator.make_query(image, keep, noise, query_desc, query_filter);
+        if(query_desc.rows > 0) {
+            query_desc.copyTo(desc.rowRange((int)(q * K), (int)(q * K) + query_desc.rows));
+            query_filter.copyTo(filter.rowRange((int)(q * K), (int)(q * K) + query_filter.rows));
+        }
+        metadata.push_back(distractor ? "" : QuineSyntheticDatabase::image_name(image));
+        hashtable.push_back("");
+    }
+
+    std::string file_ext = path.substr(path.find_last_of('.') + 1);
+    if(!QuineMemory::database()->save_database_to_file(path, desc, filter, metadata, hashtable, file_ext == "bin")) {
+        std::cout << "[Quine: Error]: Could not write query set: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Writes a synthetic database of any size. Past QUINE_SHARD_IMAGES
+ *        images it is written shard by shard, with its manifest, so only
+ *        one shard is ever in memory.
+ *
+ * @return (int) exit status
+ */
+static int generate_database(const std::string &db, size_t images, int argc, const char *argv[])
+{
+    std::string model_path, queries_path;
+    size_t queries = 0, distractors = 0;
+    float keep = QUINE_DB_QUERY_KEEP, noise = QUINE_DB_QUERY_NOISE;
+    uint64_t seed = 1;
+    for(int i = 0; i < argc; i++) {
+        std::string option = argv[i];
+        if(option == "--model" && i + 1 < argc) {
+            model_path = argv[++i];
+        } else if(option == "--queries" && i + 2 < argc) {
+            queries_path = argv[++i];
+            queries = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if(option == "--distractors" && i + 1 < argc) {
+            distractors = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if(option == "--keep" && i + 1 < argc) {
+            keep = std::max(0.0f, std::min(1.0f, (float)atof(argv[++i])));
+        } else if(option == "--noise" && i + 1 < argc) {
+            noise = std::max(0.0f, (float)atof(argv[++i]));
+        } else if(option == "--seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    if(images == 0) {
+        std::cout << "[Quine: Error]: A database needs at least one image" << std::endl;
+        return 1;
+    }
+    struct stat st;
+    if(stat(db.c_str(), &st) == 0 || stat(manifest_path(db).c_str(), &st) == 0) {
+        std::cout << "[Quine: Error]: Database already exists: " << db << std::endl;
+        return 1;
+    }
+
+    quine_descriptor_model_t model;
+    default_descriptor_model(model);
+    if(!model_path.empty()) {
+        QuineMemory *memory = QuineMemory::database();
+        std::shared_ptr<QuineDescriptorStore> store;
+        QuineStringTable metadata;
+        cv::vector<std::string> hashtable;
+        memory->get_database(model_path, store, metadata, hashtable, true);
+        std::vector<quine_store_chunk_t> chunks;
+        if(store) {
+            store->snapshot(chunks);
+        }
+        if(!fit_descriptor_model(chunks, memory->get_tombstones(model_path), metadata.size(), model)) {
+            std::cout << "[Quine: Error]: No keypoints to fit a model to in: " << model_path << std::endl;
+            return 1;
+        }
+        memory->unload_database(model_path);
+    }
+
+    QuineSyntheticDatabase generator(model, seed);
+    int64_t start = cv::getTickCount();
+
+    if(images <= QUINE_SHARD_IMAGES) {
+        if(!write_synthetic(generator, db, 0, images)) {
+            return 1;
+        }
+    } else {
+        quine_manifest_t manifest;
+        manifest.log_segment = 0;
+        manifest.next_id = 0;
+        for(size_t first = 0; first < images; first += QUINE_SHARD_IMAGES) {
+            quine_shard_t shard;
+            shard.id = manifest.next_id++;
+            shard.first_slot = first;
+            shard.end_slot = std::min(first + QUINE_SHARD_IMAGES, images);
+            shard.image_count = (uint32_t)(shard.end_slot - shard.first_slot);
+
+            std::string path = shard_path(db, shard.id);
+            if(!write_synthetic(generator, path, shard.first_slot, shard.end_slot) || !file_crc32(path, shard.crc)) {
+                return 1;
+            }
+            manifest.shards.push_back(shard);
+        }
+        if(!write_manifest(db, manifest)) {
+            std::cout << "[Quine: Error]: Could not write manifest: " << manifest_path(db) << std::endl;
+            return 1;
+        }
+    }
+    printf("%zu images in %.1f s\n", images, elapsed_ms(start) / 1000.0);
+
+    if(!queries_path.empty() && queries + distractors > 0) {
+        if(!write_queries(generator, queries_path, images, queries, distractors, keep, noise, seed)) {
+            return 1;
+        }
+        printf("%zu queries, %zu distractors: %s\n", queries, distractors, queries_path.c_str());
+    }
+    return 0;
+}
+
+
+int main(int argc, const char *argv[])
+{
+    if(argc < 3) {
+        usage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    if(command == "build" && argc == 4) {
+        return build_database(argv[2], argv[3]);
+    }
+    if(command == "convert" && argc == 4) {
+        return convert_database(argv[2], argv[3]);
+    }
+    if(command == "compact" && argc == 3) {
+        return compact_database(argv[2]);
+    }
+    if(command == "inspect" && argc == 3) {
+        return inspect_database(argv[2]);
+    }
+    if(command == "bench" && (argc == 4 || argc == 5)) {
+        return bench_database(argv[2], argv[3], argc == 5 ? std::max(1, atoi(argv[4])) : 100);
+    }
+
+    if(command == "throughput" && (argc == 4 || argc == 5)) {
+        return throughput_database(argv[2], argv[3], argc == 5 ? std::max(0.1, atof(argv[4])) : 2.0);
+    }
+    if(command == "delta" && argc == 5) {
+        return make_delta(argv[2], argv[3], argv[4]);
+    }
+    if(command == "apply" && argc == 4) {
+        return apply_delta(argv[2], argv[3]);
+    }
+    if(command == "generate" && argc >= 4) {
+        return generate_database(argv[2], (size_t)strtoull(argv[3], NULL, 10), argc - 4, argv + 4);
+    }
+
+    usage();
+    return 1;
+}
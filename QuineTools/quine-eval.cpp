@@ -0,0 +1,1025 @@
+//
+//  quine-eval.cpp
+//  QuineTools
+//
+//  Created by agent on 10/19/26.
+//  Copyright (c) 2026 Spurrier. All rights reserved.
+//
+//  Recall versus latency evaluation. Runs a labelled query set against a
+//  database under every combination of the given settings (dratio, accept
+//  ratio, keypoints per database image, query resize width) and matching
+//  backends, and reports recall@1, the false-accept rate and latency
+//  percentiles of each, so the fastest configuration that meets an
+//  accuracy bar can be picked.
+//
+//  Backends:
+//    float      compare_mat_souces' own vote counting (what ships)
+//    quantized  int8 descriptors, int32 dot products
+//    binary     sign bits of the centered descriptors, Hamming distance
+//    indexed    coarse k-means inverted lists, probing the nearest lists
+//
+//  Query sets are either written by quine-db generate --queries (database
+//  schema, metadata naming the expected image, empty for distractors) or a
+//  list of images, one "<image path> <expected metadata or ->" per line.
+//
+//  Build from the repository root, with OpenCV 2.4 and libAKAZE, by compiling
+//  this file together with Quine/*.cpp and linking opencv, akaze, z and pthread.
+//
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "QuineConstants.h"
+#include "QuineFeatureDetection.h"
+#include "QuineLatency.h"
+#include "QuineMatcher.h"
+#include "QuineMemoryDatabase.h"
+
+
+// Settings swept unless given
+#define QUINE_EVAL_BACKENDS         "float,binary,quantized,indexed"
+#define QUINE_EVAL_DRATIOS          "0.90,0.93,0.96,0.98"
+#define QUINE_EVAL_ACCEPTS          "0.05,0.10,0.15,0.20"
+#define QUINE_EVAL_PROBES           "1,4,16"
+
+// Accuracy bar of the recommendation, unless given
+#define QUINE_EVAL_MIN_RECALL       0.90
+#define QUINE_EVAL_MAX_FALSE        0.01
+
+// Inverted lists of the indexed backend: about the square root of the
+//   database rows, up to this many, trained on at most QUINE_EVAL_TRAIN_ROWS
+#define QUINE_EVAL_MAX_LISTS        1024
+#define QUINE_EVAL_TRAIN_ROWS       50000
+#define QUINE_EVAL_KMEANS_ROUNDS    10
+
+// Class of the rows padding an image, as compute_signature leaves them
+#define QUINE_EVAL_NO_CLASS         255
+
+
+static void usage()
+{
+    std::cout <<
+    "usage: quine-eval <database> <query set> [options]\n"
+    "       quine-eval <database> --images <list> [options]\n"
+    "\n"
+    "  --images <list>          Query images, one \"<path> <expected metadata or ->\" per line\n"
+    "  --backends <b,b,...>     Matching backends (" QUINE_EVAL_BACKENDS ")\n"
+    "  --dratios <d,d,...>      Feature match thresholds (" QUINE_EVAL_DRATIOS ")\n"
+    "  --accepts <a,a,...>      Image accept ratios (" QUINE_EVAL_ACCEPTS ")\n"
+    "  --keypoints <n,n,...>    Keypoints kept per database image, the strongest first\n"
+    "                           (all of them). Latency stays that of every row.\n"
+    "  --widths <w,w,...>       Query resize widths, with --images only (reported as 0\n"
+    "                           for a query set, described when it was written)\n"
+    "  --probes <n,n,...>       Lists the indexed backend probes (" QUINE_EVAL_PROBES ")\n"
+    "  --min-recall <r>         Recall@1 the recommendation must reach (0.90)\n"
+    "  --max-false <f>          False-accept rate it must stay under (0.01)\n"
+    "  --output <path>          Writes the results there instead of stdout\n";
+}
+
+
+static std::vector<double> parse_list(const std::string &text)
+{
+    std::vector<double> values;
+    std::stringstream list(text);
+    std::string value;
+    while(std::getline(list, value, ',')) {
+        if(!value.empty()) {
+            values.push_back(atof(value.c_str()));
+        }
+    }
+    return values;
+}
+
+
+#pragma mark -
+#pragma mark Inputs
+/* ************************************************************************* */
+/*!
+ * @brief One query: its descriptors (not padded) and the metadata of the
+ *        image it should match, empty for a distractor.
+ */
+typedef struct eval_query {
+    cv::Mat desc;
+    cv::Mat filter;
+    std::string expected;
+} eval_query_t;
+
+
+typedef struct eval_database {
+    std::shared_ptr<QuineDescriptorStore> store;
+    std::vector<quine_store_chunk_t> chunks;
+    QuineStringTable metadata;
+    std::vector<bool> tombstones;
+
+    /*!
+     * Every row, AKAZE_KEYPOINTCOUNT per image, for the backends that keep
+     *   their own copy of the descriptors
+     */
+    cv::Mat desc;
+    cv::Mat filter;
+} eval_database_t;
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Reads a query set written in the database schema: an image per
+ *        query, whose rows past its last keypoint are padding.
+ *
+ * @return (bool)
+ */
+static bool read_query_set(const std::string &path, std::vector<eval_query_t> &queries)
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+
+    QuineDescriptorStore store;
+    QuineStringTable metadata;
+    cv::vector<std::string> hashtable;
+    std::vector<bool> tombstones;
+    QuineMemory::database()->load_database_from_file(path, store, metadata, hashtable, tombstones);
+
+    std::vector<quine_store_chunk_t> chunks;
+    store.snapshot(chunks);
+    cv::Mat desc, filter;
+    QuineDescriptorStore::gather(chunks, desc, filter, NULL, K);
+    if(metadata.empty() || desc.rows < (int)metadata.size() * K) {
+        return false;
+    }
+
+    for(size_t q = 0; q < metadata.size(); q++) {
+        eval_query_t query;
+        query.expected = metadata[q];
+
+        std::vector<int> rows;
+        for(int r = (int)q * K; r < (int)(q + 1) * K; r++) {
+            if(filter.at<uchar>(r) != QUINE_EVAL_NO_CLASS) {
+                rows.push_back(r);
+            }
+        }
+        query.desc.create((int)rows.size(), desc.cols, CV_32FC1);
+        query.filter.create((int)rows.size(), 1, CV_8UC1);
+        for(size_t i = 0; i < rows.size(); i++) {
+            desc.row(rows[i]).copyTo(query.desc.row((int)i));
+            query.filter.at<uchar>((int)i) = filter.at<uchar>(rows[i]);
+        }
+        queries.push_back(query);
+    }
+    return true;
+}
+
+
+typedef struct eval_image {
+    cv::Mat image;
+    std::string expected;
+} eval_image_t;
+
+
+static bool read_image_list(const std::string &path, std::vector<eval_image_t> &images)
+{
+    std::ifstream in(path.c_str());
+    if(!in.good()) {
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(in, line)) {
+        std::stringstream fields(line);
+        std::string image_path, expected;
+        if(!(fields >> image_path) || image_path[0] == '#') {
+            continue;
+        }
+        fields >> expected;
+
+        eval_image_t image;
+        image.image = cv::imread(image_path);
+        if(image.image.empty()) {
+            std::cerr << "[Quine: Warning]: Could not read image: " << image_path << std::endl;
+            continue;
+        }
+        image.expected = expected == "-" ? "" : expected;
+        images.push_back(image);
+    }
+    return !images.empty();
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Describes the query images at one resize width, as QuineCompare
+ *        describes camera frames.
+ *
+ * @return (void)
+ */
+static void describe_queries(const std::vector<eval_image_t> &images, int width, std::vector<eval_query_t> &queries)
+{
+    QuineFeatureDetection feature;
+    queries.clear();
+    for(size_t i = 0; i < images.size(); i++) {
+        cv::Mat resized_img, gray_img;
+        feature.resize_to_width(images[i].image, resized_img, width);
+        feature.get_gray(resized_img, gray_img);
+
+        akaze_response_struc signature;
+        feature.compute_signature(gray_img, signature, true);
+
+        eval_query_t query;
+        signature.desc.convertTo(query.desc, CV_32FC1);
+        query.filter = signature.filter;
+        query.expected = images[i].expected;
+        queries.push_back(query);
+    }
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief The database with only the first keypoints of every image: the
+ *        others are given the padding class, which no query row has.
+ *
+ * @return (void)
+ */
+static void keep_keypoints(const eval_database_t &database, int keypoints, eval_database_t &kept)
+{
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    kept.metadata = database.metadata;
+    kept.tombstones = database.tombstones;
+    kept.desc = database.desc;
+    kept.filter = database.filter.clone();
+    for(int r = 0; r < kept.filter.rows; r++) {
+        if(r % K >= keypoints) {
+            kept.filter.at<uchar>(r) = QUINE_EVAL_NO_CLASS;
+        }
+    }
+
+    kept.chunks.resize(1);
+    kept.chunks[0].desc = kept.desc;
+    kept.chunks[0].filter = kept.filter;
+    kept.chunks[0].first_row = 0;
+}
+
+
+#pragma mark -
+#pragma mark Backends
+/* ************************************************************************* */
+/*!
+ * @brief cv::parallel_for_ body running a scorer over a range of rows (of
+ *        the database or of the query, as the scorer splits its work) into
+ *        votes of its own, merged once per range.
+ */
+template <class Scorer>
+class VoteBody : public cv::ParallelLoopBody {
+public:
+    VoteBody(const Scorer &scorer, int *votes, size_t images, std::mutex &lock)
+    : m_scorer(scorer), m_votes(votes), m_images(images), m_lock(lock) { }
+
+    void operator()(const cv::Range &range) const {
+        std::vector<int> votes(m_images, 0);
+        m_scorer(range, votes.data());
+
+        std::lock_guard<std::mutex> guard(m_lock);
+        for(size_t i = 0; i < m_images; i++) {
+            m_votes[i] += votes[i];
+        }
+    }
+
+private:
+    const Scorer &m_scorer;
+    int *m_votes;
+    size_t m_images;
+    std::mutex &m_lock;
+};
+
+
+template <class Scorer>
+static void run_votes(const Scorer &scorer, int rows, size_t images, int *votes)
+{
+    std::fill(votes, votes + images, 0);
+    std::mutex lock;
+    cv::parallel_for_(cv::Range(0, rows), VoteBody<Scorer>(scorer, votes, images, lock),
+                      std::max(1, cv::getNumThreads()));
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief A way of counting the votes of a query's features for the images
+ *        of a database. Every backend votes as compare_mat_souces does: a
+ *        feature matches a database row whose similarity passes dratio and
+ *        whose keypoint class is its own, and votes for the row's image.
+ */
+class EvalBackend {
+public:
+    virtual ~EvalBackend() { }
+
+    virtual const char *name() const = 0;
+
+    virtual void build(const eval_database_t &database) = 0;
+
+    virtual void count_votes(const eval_query_t &query, float dratio, int probes, int *votes) const = 0;
+
+    /*!
+     * Whether the backend has a probes setting to sweep
+     */
+    virtual bool probed() const { return false; }
+
+protected:
+    const eval_database_t *m_database;
+};
+
+
+class FloatBackend : public EvalBackend {
+public:
+    const char *name() const { return "float"; }
+
+    void build(const eval_database_t &database) { m_database = &database; }
+
+    void count_votes(const eval_query_t &query, float dratio, int /* probes */, int *votes) const {
+        count_image_votes(query.desc, m_database->chunks, query.filter, m_database->metadata.size(),
+                          m_database->tombstones, dratio, votes);
+    }
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief int8 descriptors, with one scale for every dimension so that an
+ *        int32 dot product divided by the scale squared is the similarity.
+ */
+class QuantizedBackend : public EvalBackend {
+public:
+    const char *name() const { return "quantized"; }
+
+    void build(const eval_database_t &database) {
+        m_database = &database;
+        double min_value = 0.0, max_value = 0.0;
+        cv::minMaxLoc(database.desc, &min_value, &max_value);
+        double largest = std::max(fabs(min_value), fabs(max_value));
+        m_scale = largest > 0.0 ? 127.0 / largest : 1.0;
+        quantize(database.desc, m_codes);
+    }
+
+    void count_votes(const eval_query_t &query, float dratio, int /* probes */, int *votes) const {
+        cv::Mat codes;
+        quantize(query.desc, codes);
+        Scorer scorer(*this, codes, query.filter, (int)(dratio * m_scale * m_scale));
+        run_votes(scorer, m_codes.rows, m_database->metadata.size(), votes);
+    }
+
+private:
+    void quantize(const cv::Mat &desc, cv::Mat &codes) const {
+        codes.create(desc.rows, desc.cols, CV_8SC1);
+        for(int r = 0; r < desc.rows; r++) {
+            const float *row = desc.ptr<float>(r);
+            schar *code = codes.ptr<schar>(r);
+            for(int c = 0; c < desc.cols; c++) {
+                code[c] = (schar)std::max(-127.0, std::min(127.0, floor(row[c] * m_scale + 0.5)));
+            }
+        }
+    }
+
+    class Scorer {
+    public:
+        Scorer(const QuantizedBackend &backend, const cv::Mat &codes, const cv::Mat &filter, int threshold)
+        : m_backend(backend), m_codes(codes), m_filter(filter), m_threshold(threshold) { }
+
+        void operator()(const cv::Range &range, int *votes) const {
+            const eval_database_t &database = *m_backend.m_database;
+            const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+            int columns = m_codes.cols;
+
+            for(int s = range.start; s < range.end; s++) {
+                size_t image = s / K;
+                if(image < database.tombstones.size() && database.tombstones[image]) {
+                    continue;
+                }
+                uchar s_class = database.filter.at<uchar>(s);
+                const schar *row = m_backend.m_codes.ptr<schar>(s);
+
+                for(int q = 0; q < m_codes.rows; q++) {
+                    if(m_filter.at<uchar>(q) != s_class) {
+                        continue;
+                    }
+                    const schar *code = m_codes.ptr<schar>(q);
+                    int dot = 0;
+                    for(int c = 0; c < columns; c++) {
+                        dot += code[c] * row[c];
+                    }
+                    if(dot > m_threshold) {
+                        votes[image]++;
+                    }
+                }
+            }
+        }
+
+    private:
+        const QuantizedBackend &m_backend;
+        const cv::Mat &m_codes;
+        const cv::Mat &m_filter;
+        int m_threshold;
+    };
+
+    double m_scale;
+    cv::Mat m_codes;
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief One bit per dimension: whether the descriptor is above the
+ *        dimension's mean. The angle between two descriptors is about
+ *        pi * (Hamming distance) / bits, so dratio becomes a largest
+ *        distance of bits * acos(dratio) / pi.
+ */
+class BinaryBackend : public EvalBackend {
+public:
+    const char *name() const { return "binary"; }
+
+    void build(const eval_database_t &database) {
+        m_database = &database;
+        m_columns = database.desc.cols;
+        m_words = (m_columns + 63) / 64;
+
+        // Mean of the rows that hold a keypoint
+        m_mean.assign(m_columns, 0.0f);
+        size_t rows = 0;
+        for(int r = 0; r < database.desc.rows; r++) {
+            if(database.filter.at<uchar>(r) == QUINE_EVAL_NO_CLASS) {
+                continue;
+            }
+            const float *row = database.desc.ptr<float>(r);
+            for(int c = 0; c < m_columns; c++) {
+                m_mean[c] += row[c];
+            }
+            rows++;
+        }
+        for(int c = 0; c < m_columns && rows > 0; c++) {
+            m_mean[c] /= rows;
+        }
+
+        encode(database.desc, m_codes);
+    }
+
+    void count_votes(const eval_query_t &query, float dratio, int /* probes */, int *votes) const {
+        std::vector<uint64_t> codes;
+        encode(query.desc, codes);
+        int distance = (int)(m_columns * acos(std::max(-1.0f, std::min(1.0f, dratio))) / CV_PI);
+        Scorer scorer(*this, codes, query.filter, distance);
+        run_votes(scorer, m_database->desc.rows, m_database->metadata.size(), votes);
+    }
+
+private:
+    void encode(const cv::Mat &desc, std::vector<uint64_t> &codes) const {
+        codes.assign((size_t)desc.rows * m_words, 0);
+        for(int r = 0; r < desc.rows; r++) {
+            const float *row = desc.ptr<float>(r);
+            uint64_t *code = &codes[(size_t)r * m_words];
+            for(int c = 0; c < m_columns; c++) {
+                if(row[c] > m_mean[c]) {
+                    code[c / 64] |= 1ULL << (c % 64);
+                }
+            }
+        }
+    }
+
+    class Scorer {
+    public:
+        Scorer(const BinaryBackend &backend, const std::vector<uint64_t> &codes, const cv::Mat &filter, int distance)
+        : m_backend(backend), m_codes(codes), m_filter(filter), m_distance(distance) { }
+
+        void operator()(const cv::Range &range, int *votes) const {
+            const eval_database_t &database = *m_backend.m_database;
+            const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+            int words = m_backend.m_words;
+            int queries = m_filter.rows;
+
+            for(int s = range.start; s < range.end; s++) {
+                size_t image = s / K;
+                uchar s_class = database.filter.at<uchar>(s);
+                if(s_class == QUINE_EVAL_NO_CLASS ||
+                   (image < database.tombstones.size() && database.tombstones[image])) {
+                    continue;
+                }
+                const uint64_t *row = &m_backend.m_codes[(size_t)s * words];
+
+                for(int q = 0; q < queries; q++) {
+                    if(m_filter.at<uchar>(q) != s_class) {
+                        continue;
+                    }
+                    const uint64_t *code = &m_codes[(size_t)q * words];
+                    int distance = 0;
+                    for(int w = 0; w < words; w++) {
+                        distance += __builtin_popcountll(code[w] ^ row[w]);
+                    }
+                    if(distance < m_distance) {
+                        votes[image]++;
+                    }
+                }
+            }
+        }
+
+    private:
+        const BinaryBackend &m_backend;
+        const std::vector<uint64_t> &m_codes;
+        const cv::Mat &m_filter;
+        int m_distance;
+    };
+
+    int m_columns;
+    int m_words;
+    std::vector<float> m_mean;
+    std::vector<uint64_t> m_codes;
+};
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Database rows grouped by their nearest k-means center. A query
+ *        feature is only scored (exactly, in float) against the rows of the
+ *        centers nearest to it, so probes trades recall for speed.
+ */
+class IndexedBackend : public EvalBackend {
+public:
+    const char *name() const { return "indexed"; }
+
+    bool probed() const { return true; }
+
+    void build(const eval_database_t &database) {
+        m_database = &database;
+
+        std::vector<int> rows;
+        for(int r = 0; r < database.desc.rows; r++) {
+            size_t image = r / AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+            if(database.filter.at<uchar>(r) != QUINE_EVAL_NO_CLASS &&
+               !(image < database.tombstones.size() && database.tombstones[image])) {
+                rows.push_back(r);
+            }
+        }
+        int lists = std::max(1, std::min(QUINE_EVAL_MAX_LISTS, (int)sqrt((double)rows.size())));
+        m_lists.assign(lists, std::vector<int>());
+        if(rows.empty()) {
+            m_centers = cv::Mat::zeros(1, database.desc.cols, CV_32FC1);
+            return;
+        }
+
+        // Train on an even sample of the rows
+        size_t stride = std::max((size_t)1, rows.size() / QUINE_EVAL_TRAIN_ROWS);
+        cv::Mat sample;
+        for(size_t i = 0; i < rows.size(); i += stride) {
+            sample.push_back(database.desc.row(rows[i]));
+        }
+        lists = std::min(lists, sample.rows);
+        m_lists.resize(lists);
+
+        cv::Mat labels;
+        cv::kmeans(sample, lists, labels,
+                   cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, QUINE_EVAL_KMEANS_ROUNDS, 1e-4),
+                   1, cv::KMEANS_PP_CENTERS, m_centers);
+
+        for(size_t i = 0; i < rows.size(); i++) {
+            m_lists[nearest(database.desc.ptr<float>(rows[i]), 1)[0]].push_back(rows[i]);
+        }
+    }
+
+    void count_votes(const eval_query_t &query, float dratio, int probes, int *votes) const {
+        Scorer scorer(*this, query, dratio, std::max(1, std::min(probes, m_centers.rows)));
+        run_votes(scorer, query.desc.rows, m_database->metadata.size(), votes);
+    }
+
+private:
+    std::vector<int> nearest(const float *row, int count) const {
+        std::vector<std::pair<float, int> > distances(m_centers.rows);
+        for(int l = 0; l < m_centers.rows; l++) {
+            const float *center = m_centers.ptr<float>(l);
+            float distance = 0.0f;
+            for(int c = 0; c < m_centers.cols; c++) {
+                float d = row[c] - center[c];
+                distance += d * d;
+            }
+            distances[l] = std::make_pair(distance, l);
+        }
+        std::partial_sort(distances.begin(), distances.begin() + count, distances.end());
+
+        std::vector<int> lists(count);
+        for(int i = 0; i < count; i++) {
+            lists[i] = distances[i].second;
+        }
+        return lists;
+    }
+
+    class Scorer {
+    public:
+        Scorer(const IndexedBackend &backend, const eval_query_t &query, float dratio, int probes)
+        : m_backend(backend), m_query(query), m_dratio(dratio), m_probes(probes) { }
+
+        void operator()(const cv::Range &range, int *votes) const {
+            const eval_database_t &database = *m_backend.m_database;
+            int columns = m_query.desc.cols;
+
+            for(int q = range.start; q < range.end; q++) {
+                const float *feature = m_query.desc.ptr<float>(q);
+                uchar q_class = m_query.filter.at<uchar>(q);
+                std::vector<int> lists = m_backend.nearest(feature, m_probes);
+
+                for(size_t l = 0; l < lists.size(); l++) {
+                    const std::vector<int> &rows = m_backend.m_lists[lists[l]];
+                    for(size_t i = 0; i < rows.size(); i++) {
+                        if(database.filter.at<uchar>(rows[i]) != q_class) {
+                            continue;
+                        }
+                        const float *row = database.desc.ptr<float>(rows[i]);
+                        float score = 0.0f;
+                        for(int c = 0; c < columns; c++) {
+                            score += feature[c] * row[c];
+                        }
+                        if(score > m_dratio) {
+                            votes[rows[i] / AKAZEOptions::AKAZE_KEYPOINTCOUNT]++;
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        const IndexedBackend &m_backend;
+        const eval_query_t &m_query;
+        float m_dratio;
+        int m_probes;
+    };
+
+    cv::Mat m_centers;
+    std::vector<std::vector<int> > m_lists;
+};
+
+
+static EvalBackend *make_backend(const std::string &name)
+{
+    if(name == "float") {
+        return new FloatBackend();
+    }
+    if(name == "quantized") {
+        return new QuantizedBackend();
+    }
+    if(name == "binary") {
+        return new BinaryBackend();
+    }
+    if(name == "indexed") {
+        return new IndexedBackend();
+    }
+    return NULL;
+}
+
+
+#pragma mark -
+#pragma mark Evaluation
+/* ************************************************************************* */
+/*!
+ * @brief Accuracy and latency of one configuration.
+ */
+typedef struct eval_result {
+    std::string backend;
+    int width;
+    int keypoints;
+    float dratio;
+    float accept;
+    int probes;
+
+    size_t queries;
+    size_t genuine;
+    size_t correct;
+    size_t false_accepts;
+    quine_latency_summary_t latency;
+} eval_result_t;
+
+
+static double recall_at_1(const eval_result_t &result)
+{
+    return result.genuine ? (double)result.correct / result.genuine : 0.0;
+}
+
+
+static double false_accept_rate(const eval_result_t &result)
+{
+    return result.queries ? (double)result.false_accepts / result.queries : 0.0;
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief Runs every query once per dratio (and probes), timing the vote
+ *        counting, then decides each query under every accept ratio from
+ *        the same votes. An accepted image other than the expected one,
+ *        or any accepted image for a distractor, is a false accept.
+ *
+ * @return (void)
+ */
+static void evaluate(const EvalBackend &backend,
+                     const eval_database_t &database,
+                     const std::vector<eval_query_t> &queries,
+                     int width,
+                     int keypoints,
+                     const std::vector<double> &dratios,
+                     const std::vector<double> &accepts,
+                     const std::vector<double> &probes,
+                     std::vector<eval_result_t> &results)
+{
+    size_t images = database.metadata.size();
+    std::vector<int> votes(images);
+    std::vector<double> single_probe(1, 0.0);
+    const std::vector<double> &probe_list = backend.probed() ? probes : single_probe;
+
+    for(size_t d = 0; d < dratios.size(); d++) {
+        for(size_t p = 0; p < probe_list.size(); p++) {
+            std::vector<eval_result_t> configuration(accepts.size());
+            for(size_t a = 0; a < accepts.size(); a++) {
+                eval_result_t &result = configuration[a];
+                result.backend = backend.name();
+                result.width = width;
+                result.keypoints = keypoints;
+                result.dratio = (float)dratios[d];
+                result.accept = (float)accepts[a];
+                result.probes = (int)probe_list[p];
+                result.queries = result.genuine = result.correct = result.false_accepts = 0;
+            }
+
+            QuineLatencyHistogram latency;
+            for(size_t q = 0; q < queries.size(); q++) {
+                const eval_query_t &query = queries[q];
+
+                int64_t start = cv::getTickCount();
+                backend.count_votes(query, (float)dratios[d], (int)probe_list[p], votes.data());
+                latency.record_ticks(cv::getTickCount() - start);
+
+                for(size_t a = 0; a < accepts.size(); a++) {
+                    eval_result_t &result = configuration[a];
+                    int slot = select_voted_image(votes.data(), images, query.desc.rows, (float)accepts[a]);
+                    bool genuine = !query.expected.empty();
+
+                    result.queries++;
+                    result.genuine += genuine;
+                    if(slot < 0) {
+                        continue;
+                    }
+                    if(genuine && database.metadata[slot] == query.expected) {
+                        result.correct++;
+                    }
+                    else {
+                        result.false_accepts++;
+                    }
+                }
+            }
+
+            for(size_t a = 0; a < accepts.size(); a++) {
+                latency.summary(configuration[a].latency);
+                results.push_back(configuration[a]);
+
+                const eval_result_t &result = configuration[a];
+                fprintf(stderr, "%-10s %6d %5d %7.3f %7.3f %6d %9.3f %9.4f %9.3f %9.3f %9.3f\n",
+                        result.backend.c_str(), result.width, result.keypoints, result.dratio, result.accept,
+                        result.probes, recall_at_1(result), false_accept_rate(result), result.latency.p50_ms,
+                        result.latency.p95_ms, result.latency.p99_ms);
+            }
+        }
+    }
+}
+
+
+static std::string result_json(const eval_result_t &result)
+{
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "{\"backend\": \"%s\", \"width\": %d, \"keypoints\": %d, \"dratio\": %.4f, \"accept\": %.4f, "
+             "\"probes\": %d, \"queries\": %zu, \"genuine\": %zu, \"recall_at_1\": %.6f, "
+             "\"false_accept_rate\": %.6f, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, "
+             "\"p99_ms\": %.4f, \"max_ms\": %.4f}",
+             result.backend.c_str(), result.width, result.keypoints, result.dratio, result.accept, result.probes,
+             result.queries, result.genuine, recall_at_1(result), false_accept_rate(result), result.latency.mean_ms,
+             result.latency.p50_ms, result.latency.p95_ms, result.latency.p99_ms, result.latency.max_ms);
+    return buffer;
+}
+
+
+static void write_results(std::ostream &out, const std::vector<eval_result_t> &results, int recommended)
+{
+    char started[32];
+    time_t now = time(NULL);
+    strftime(started, sizeof(started), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    out << "{\n";
+    out << "  \"suite\": \"quine-eval\",\n";
+    out << "  \"format\": 1,\n";
+    out << "  \"started\": \"" << started << "\",\n";
+    out << "  \"host\": {\"threads\": " << cv::getNumThreads() << ", \"opencv\": \"" << CV_VERSION << "\"},\n";
+    out << "  \"recommended\": " << (recommended >= 0 ? result_json(results[recommended]) : "null") << ",\n";
+    out << "  \"results\": [\n";
+    for(size_t i = 0; i < results.size(); i++) {
+        out << "    " << result_json(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+
+/* ************************************************************************* */
+/*!
+ * @brief The configuration with the lowest p95 latency among those that
+ *        meet the accuracy bar.
+ *
+ * @return (int) its index in results, or -1 if none does
+ */
+static int recommend(const std::vector<eval_result_t> &results, double min_recall, double max_false)
+{
+    int best = -1;
+    for(size_t i = 0; i < results.size(); i++) {
+        if(recall_at_1(results[i]) < min_recall || false_accept_rate(results[i]) > max_false) {
+            continue;
+        }
+        if(best < 0 || results[i].latency.p95_ms < results[best].latency.p95_ms) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+
+int main(int argc, const char *argv[])
+{
+    if(argc < 3) {
+        usage();
+        return 1;
+    }
+
+    std::string db = argv[1], query_path, images_path, output_path;
+    std::string backends_list = QUINE_EVAL_BACKENDS, dratios_list = QUINE_EVAL_DRATIOS;
+    std::string accepts_list = QUINE_EVAL_ACCEPTS, probes_list = QUINE_EVAL_PROBES;
+    std::string keypoints_list, widths_list;
+    double min_recall = QUINE_EVAL_MIN_RECALL, max_false = QUINE_EVAL_MAX_FALSE;
+
+    for(int i = 2; i < argc; i++) {
+        std::string option = argv[i];
+        bool has_value = i + 1 < argc;
+        if(option == "--images" && has_value) {
+            images_path = argv[++i];
+        }
+        else if(option == "--backends" && has_value) {
+            backends_list = argv[++i];
+        }
+        else if(option == "--dratios" && has_value) {
+            dratios_list = argv[++i];
+        }
+        else if(option == "--accepts" && has_value) {
+            accepts_list = argv[++i];
+        }
+        else if(option == "--keypoints" && has_value) {
+            keypoints_list = argv[++i];
+        }
+        else if(option == "--widths" && has_value) {
+            widths_list = argv[++i];
+        }
+        else if(option == "--probes" && has_value) {
+            probes_list = argv[++i];
+        }
+        else if(option == "--min-recall" && has_value) {
+            min_recall = atof(argv[++i]);
+        }
+        else if(option == "--max-false" && has_value) {
+            max_false = atof(argv[++i]);
+        }
+        else if(option == "--output" && has_value) {
+            output_path = argv[++i];
+        }
+        else if(option[0] != '-' && query_path.empty()) {
+            query_path = option;
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if(query_path.empty() == images_path.empty()) {
+        usage();
+        return 1;
+    }
+
+    const int K = AKAZEOptions::AKAZE_KEYPOINTCOUNT;
+    std::vector<double> dratios = parse_list(dratios_list);
+    std::vector<double> accepts = parse_list(accepts_list);
+    std::vector<double> probes = parse_list(probes_list);
+    std::vector<double> keypoints = keypoints_list.empty() ? std::vector<double>(1, K) : parse_list(keypoints_list);
+    std::vector<double> widths = widths_list.empty() ? std::vector<double>(1, RESIZED_IMAGE_WIDTH)
+                                                     : parse_list(widths_list);
+
+    std::vector<std::string> backend_names;
+    std::stringstream names(backends_list);
+    std::string name;
+    while(std::getline(names, name, ',')) {
+        std::unique_ptr<EvalBackend> backend(make_backend(name));
+        if(!backend) {
+            std::cerr << "[Quine: Error]: Unknown backend: " << name << std::endl;
+            return 1;
+        }
+        backend_names.push_back(name);
+    }
+
+
+    //////////////////////////////////////////////////////////
+    // Database and queries
+
+    QuineMemory *memory = QuineMemory::database();
+    eval_database_t database;
+    cv::vector<std::string> hashtable;
+    memory->get_database(db, database.store, database.metadata, hashtable, true);
+    if(!database.store || database.store->empty() || database.metadata.empty()) {
+        std::cerr << "[Quine: Error]: Could not open database: " << db << std::endl;
+        return 1;
+    }
+    database.tombstones = memory->get_tombstones(db);
+    database.store->snapshot(database.chunks);
+    QuineDescriptorStore::gather(database.chunks, database.desc, database.filter, NULL, K);
+
+    std::vector<eval_image_t> images;
+    std::vector<eval_query_t> queries;
+    if(!images_path.empty()) {
+        if(!read_image_list(images_path, images)) {
+            std::cerr << "[Quine: Error]: Could not read query images: " << images_path << std::endl;
+            return 1;
+        }
+    }
+    else {
+        if(!read_query_set(query_path, queries)) {
+            std::cerr << "[Quine: Error]: Could not read query set: " << query_path << std::endl;
+            return 1;
+        }
+        if(!widths_list.empty()) {
+            std::cerr << "[Quine: Warning]: --widths needs --images; the query set is already described" << std::endl;
+        }
+        widths.assign(1, 0.0);
+    }
+
+    fprintf(stderr, "%zu images, %zu queries\n", database.metadata.size(),
+            images.empty() ? queries.size() : images.size());
+    fprintf(stderr, "%-10s %6s %5s %7s %7s %6s %9s %9s %9s %9s %9s\n", "backend", "width", "kpts", "dratio",
+            "accept", "probes", "recall@1", "false", "p50 ms", "p95 ms", "p99 ms");
+
+
+    //////////////////////////////////////////////////////////
+    // Every configuration
+
+    std::vector<eval_result_t> results;
+    for(size_t w = 0; w < widths.size(); w++) {
+        if(!images.empty()) {
+            describe_queries(images, (int)widths[w], queries);
+        }
+
+        for(size_t k = 0; k < keypoints.size(); k++) {
+            int kept = std::max(1, std::min(K, (int)keypoints[k]));
+            eval_database_t masked;
+            const eval_database_t *source = &database;
+            if(kept < K) {
+                keep_keypoints(database, kept, masked);
+                source = &masked;
+            }
+
+            for(size_t b = 0; b < backend_names.size(); b++) {
+                std::unique_ptr<EvalBackend> backend(make_backend(backend_names[b]));
+                backend->build(*source);
+                evaluate(*backend, *source, queries, (int)widths[w], kept, dratios, accepts, probes, results);
+            }
+        }
+    }
+
+    int recommended = recommend(results, min_recall, max_false);
+    if(recommended >= 0) {
+        fprintf(stderr, "fastest with recall@1 >= %.3f and false accepts <= %.4f:\n  %s\n", min_recall, max_false,
+                result_json(results[recommended]).c_str());
+    }
+    else {
+        fprintf(stderr, "no configuration reaches recall@1 >= %.3f with false accepts <= %.4f\n", min_recall,
+                max_false);
+    }
+
+    if(output_path.empty()) {
+        write_results(std::cout, results, recommended);
+    }
+    else {
+        std::ofstream out(output_path.c_str());
+        write_results(out, results, recommended);
+        if(!out.good()) {
+            std::cerr << "[Quine: Error]: Could not write results: " << output_path << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}